@@ -0,0 +1,54 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COUNTING_ALLOCATOR_TEST_UTIL_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_COUNTING_ALLOCATOR_TEST_UTIL_H_
+
+#include <atomic>
+#include <string>
+
+#include "tensorflow/core/framework/allocator.h"
+
+namespace tensorflow {
+
+// Forwards to cpu_allocator(), counting allocations and live buffers.
+class CountingAllocator : public Allocator {
+ public:
+  std::string Name() override { return "counting"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    num_allocs_.fetch_add(1);
+    live_.fetch_add(1);
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    live_.fetch_sub(1);
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  // Returns the number of AllocateRaw() calls so far.
+  int num_allocs() const { return num_allocs_.load(); }
+
+  // Returns the number of buffers allocated and not yet deallocated.
+  int live() const { return live_.load(); }
+
+ private:
+  std::atomic<int> num_allocs_{0};
+  std::atomic<int> live_{0};
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COUNTING_ALLOCATOR_TEST_UTIL_H_
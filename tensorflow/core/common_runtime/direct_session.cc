@@ -669,6 +669,14 @@ Status DirectSession::RunInternal(
   args.run_all_kernels_inline = pool == nullptr;
   args.start_time_usecs = start_time_usecs;
   args.deadline = deadline;
+  args.use_step_arena_allocator =
+      run_options.experimental().use_step_arena_allocator();
+  args.use_static_memory_plan =
+      run_options.experimental().use_static_memory_plan();
+  if (run_options.experimental().use_work_stealing_scheduler() &&
+      pool != nullptr) {
+    args.num_work_stealing_workers = pool->NumThreads();
+  }
 
   const bool do_trace = (run_options.trace_level() > RunOptions::NO_TRACE);
 
@@ -801,6 +801,89 @@ TEST_F(DirectSessionMinusAXTest, UseRunHandlerPool) {
   EXPECT_FLOAT_EQ(5.0, mat(0, 0));
 }
 
+TEST_F(DirectSessionMinusAXTest, UseStepArenaAllocator) {
+  Initialize({3, 2, -1, 0});
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  std::vector<std::pair<string, Tensor>> inputs;
+
+  std::vector<string> output_names = {y_ + ":0"};
+  std::vector<string> target_nodes = {y_neg_};
+
+  RunOptions run_options;
+  RunOptions arena_options;
+  arena_options.mutable_experimental()->set_use_step_arena_allocator(true);
+
+  const DeviceMgr* mgr = nullptr;
+  TF_ASSERT_OK(session->LocalDeviceManager(&mgr));
+  Allocator* allocator =
+      mgr->ListDevices()[0]->GetAllocator(AllocatorAttributes());
+  const bool stats_enabled = CPUAllocatorStatsEnabled();
+  EnableCPUAllocatorStats();
+  // Returns the number of allocations from the CPU allocator made by
+  // `num_steps` steps run with `options`, after one warm-up step.
+  auto count_allocations = [&](const RunOptions& options, int num_steps) {
+    std::vector<Tensor> step_outputs;
+    TF_CHECK_OK(session->Run(options, inputs, output_names, target_nodes,
+                             &step_outputs, nullptr));
+    const int64_t before = allocator->GetStats()->num_allocs;
+    for (int i = 0; i < num_steps; ++i) {
+      step_outputs.clear();
+      TF_CHECK_OK(session->Run(options, inputs, output_names, target_nodes,
+                               &step_outputs, nullptr));
+    }
+    return allocator->GetStats()->num_allocs - before;
+  };
+  // The output of y_neg is step-local, so in steady state the arena serves
+  // it instead of the CPU allocator.
+  const int64_t num_allocs = count_allocations(run_options, 10);
+  const int64_t num_arena_allocs = count_allocations(arena_options, 10);
+  if (!stats_enabled) DisableCPUAllocatorStats();
+  EXPECT_LE(num_arena_allocs + 10, num_allocs);
+
+  // Fetched tensors are kept by the caller beyond the step.
+  std::vector<std::vector<Tensor>> outputs(10);
+  for (auto& step_outputs : outputs) {
+    TF_ASSERT_OK(session->Run(arena_options, inputs, output_names,
+                              target_nodes, &step_outputs, nullptr));
+  }
+  for (const auto& step_outputs : outputs) {
+    ASSERT_EQ(1, step_outputs.size());
+    ASSERT_TRUE(step_outputs[0].IsInitialized());
+    EXPECT_FLOAT_EQ(5.0, step_outputs[0].matrix<float>()(0, 0));
+  }
+}
+
+TEST_F(DirectSessionMinusAXTest, UseStaticMemoryPlan_Callable) {
+  Initialize({3, 2, -1, 0});
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  CallableOptions callable_options = MakeCallableOptions({}, {z_ + ":0"}, {});
+  callable_options.mutable_run_options()
+      ->mutable_experimental()
+      ->set_use_static_memory_plan(true);
+  Session::CallableHandle handle;
+  TF_ASSERT_OK(session->MakeCallable(callable_options, &handle));
+
+  // The first run records the output sizes, later runs use the plan.  The
+  // fetched tensors, which `z` forwards from `y_neg`, are kept beyond the run
+  // and must not be overwritten by later runs.
+  std::vector<std::vector<Tensor>> outputs(5);
+  for (auto& run_outputs : outputs) {
+    TF_ASSERT_OK(session->RunCallable(handle, {}, &run_outputs, nullptr));
+  }
+  for (const auto& run_outputs : outputs) {
+    ASSERT_EQ(1, run_outputs.size());
+    auto mat = run_outputs[0].matrix<float>();
+    EXPECT_FLOAT_EQ(-5.0, mat(0, 0));
+    EXPECT_FLOAT_EQ(1.0, mat(1, 0));
+  }
+  TF_ASSERT_OK(session->ReleaseCallable(handle));
+}
+
 TEST(DirectSessionTest, KeepsStateAcrossRunsOfSession) {
   GraphDef def;
   Graph g(OpRegistry::Global());
@@ -33,7 +33,10 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/common_runtime/work_stealing_scheduler.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
@@ -149,6 +152,11 @@ class ExecutorImpl : public Executor {
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
     kernel_stats_.Initialize(immutable_state_.graph_view());
+    Device* device = immutable_state_.params().device;
+    if (device->device_type() == DEVICE_CPU) {
+      step_arena_pool_.reset(
+          new StepArenaBlockPool(device->GetAllocator(AllocatorAttributes())));
+    }
     return OkStatus();
   }
 
@@ -158,6 +166,11 @@ class ExecutorImpl : public Executor {
   template <class PropagatorStateType>
   friend class ExecutorState;
 
+  // Returns the planner for Args::use_static_memory_plan, creating it on first
+  // use, or nullptr if the graph of this executor is not planned.
+  StaticMemoryPlanner* GetMemoryPlanner()
+      TF_LOCKS_EXCLUDED(memory_planner_mu_);
+
   // Stores execution time information about the kernels in an executor's graph.
   class KernelStats {
    public:
@@ -223,6 +236,14 @@ class ExecutorImpl : public Executor {
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
 
+  // Blocks for the step arenas of Args::use_step_arena_allocator.  Null unless
+  // the executor runs on a CPU device.
+  core::RefCountPtr<StepArenaBlockPool> step_arena_pool_;
+
+  mutex memory_planner_mu_;
+  core::RefCountPtr<StaticMemoryPlanner> memory_planner_
+      TF_GUARDED_BY(memory_planner_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(ExecutorImpl);
 };
 
@@ -280,7 +301,9 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                StepArenaBlockPool* step_arena_pool,
+                StaticMemoryPlanner* memory_planner);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -374,6 +397,10 @@ class ExecutorState {
   TensorStore* tensor_store_;
   // Step-local container.
   ScopedStepContainer* step_container_;
+  // Step-local allocator, released when the step finishes.
+  StepArenaAllocator* step_arena_ = nullptr;
+  // Allocators for the outputs of planned nodes, or null.
+  StaticMemoryPlanner* const memory_planner_;
   StepStatsCollectorInterface* const stats_collector_;
   const tracing::EventCollector* const event_collector_;
   Context context_;
@@ -390,6 +417,8 @@ class ExecutorState {
   // If not null, use this device to schedule intra-op operation
   std::unique_ptr<DeviceBase> user_device_;
   Executor::Args::Runner runner_;
+  // If not null, runs the tasks of RunTask() instead of `runner_`.
+  WorkStealingScheduler* work_stealing_scheduler_ = nullptr;
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
 
@@ -413,7 +442,8 @@ class ExecutorState {
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats,
+    StepArenaBlockPool* step_arena_pool, StaticMemoryPlanner* memory_planner)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -426,6 +456,7 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       session_metadata_(immutable_state.params().session_metadata),
       tensor_store_(args.tensor_store),
       step_container_(args.step_container),
+      memory_planner_(memory_planner),
       stats_collector_(args.stats_collector),
       event_collector_(
           tracing::GetEventCollector(tracing::EventCategory::kCompute)),
@@ -447,6 +478,13 @@ ExecutorState<PropagatorStateType>::ExecutorState(
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (args.use_step_arena_allocator && step_arena_pool != nullptr) {
+    step_arena_ = new StepArenaAllocator(step_arena_pool);
+  }
+  if (args.num_work_stealing_workers > 0 && !run_all_kernels_inline_) {
+    work_stealing_scheduler_ =
+        new WorkStealingScheduler(args.num_work_stealing_workers, runner_);
+  }
 }
 
 template <class PropagatorStateType>
@@ -454,6 +492,13 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
   if (device_context_) {
     device_context_->Unref();
   }
+  if (step_arena_) {
+    step_arena_->Release();
+  }
+  if (work_stealing_scheduler_) {
+    // The worker running this step's last task holds its own reference.
+    work_stealing_scheduler_->Unref();
+  }
   delete slice_reader_cache_;
 }
 
@@ -475,10 +520,16 @@ void ExecutorState<PropagatorStateType>::RunTask(Closure&& c, int sample_rate) {
 
   // mutable is needed because std::forward<Closure> in the lambda body may move
   // the Closure `c`.
-  runner_([c = std::forward<Closure>(c)]() mutable {
+  auto task = [c = std::forward<Closure>(c)]() mutable {
     num_dequeue_ops.fetch_add(1, std::memory_order_relaxed);
     std::forward<Closure>(c)();
-  });
+  };
+  if (work_stealing_scheduler_ != nullptr) {
+    // Expensive successors scheduled from a worker stay on its core.
+    work_stealing_scheduler_->Schedule(std::move(task));
+  } else {
+    runner_(std::move(task));
+  }
 }
 
 template <class PropagatorStateType>
@@ -812,6 +863,11 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
             /*level=*/2);
 
     params.track_allocations = false;
+    params.step_arena_allocator = step_arena_;
+    params.step_arena_allocator_for_outputs = item.outputs_are_step_local;
+    params.output_allocator_array =
+        memory_planner_ ? memory_planner_->output_allocators(item.node_id)
+                        : nullptr;
     stats = nullptr;
     if (stats_collector_ && !tagged_node.get_is_dead()) {
       stats = stats_collector_->CreateNodeExecStats(&item.kernel->def());
@@ -1354,6 +1410,11 @@ void ExecutorState<PropagatorStateType>::Finish() {
   CHECK(done_cb != nullptr);
   Device* device = immutable_state_.params().device;
 
+  if (memory_planner_ != nullptr && status.ok()) {
+    // The plan is made from the output sizes of the first successful step.
+    memory_planner_->Finalize();
+  }
+
   if (vlog_ && !status.ok() && VLOG_IS_ON(1)) {
     // Logs verbose information about the current state of active and pending
     // nodes in the propagator.
@@ -1458,17 +1519,42 @@ void ExecutorState<PropagatorStateType>::Finish() {
   }
 }
 
+StaticMemoryPlanner* ExecutorImpl::GetMemoryPlanner() {
+  // Graphs with control flow run nodes more than once per step, so their
+  // outputs have no single lifetime.
+  Device* device = immutable_state_.params().device;
+  if (device->device_type() != DEVICE_CPU ||
+      immutable_state_.requires_control_flow_support()) {
+    return nullptr;
+  }
+  mutex_lock l(memory_planner_mu_);
+  if (!memory_planner_) {
+    memory_planner_.reset(
+        new StaticMemoryPlanner(immutable_state_.graph_view(),
+                                device->GetAllocator(AllocatorAttributes())));
+  }
+  return memory_planner_.get();
+}
+
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
+  StaticMemoryPlanner* memory_planner =
+      args.use_static_memory_plan ? GetMemoryPlanner() : nullptr;
   if (OpOrderDeterminismRequired()) {
     (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+                                               &kernel_stats_,
+                                               step_arena_pool_.get(),
+                                               memory_planner))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_,
+                                        step_arena_pool_.get(),
+                                        memory_planner))
         ->RunAsync(std::move(done));
   } else {
     (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+                                              &kernel_stats_,
+                                              step_arena_pool_.get(),
+                                              memory_planner))
         ->RunAsync(std::move(done));
   }
 }
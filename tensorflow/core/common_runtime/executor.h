@@ -118,6 +118,24 @@ class Executor {
     // If true, all kernels will be treated as "inexpensive", and hence executed
     // on the scheduling thread.
     bool run_all_kernels_inline = false;
+
+    // If true and the executor runs on a CPU device, kernel temporaries, and
+    // outputs that no op can keep beyond the step, are allocated from a
+    // per-step arena that is recycled as a whole when the step finishes.
+    bool use_step_arena_allocator = false;
+
+    // If true and the executor runs on a CPU device, node outputs are
+    // allocated at offsets in a single arena, planned from the output sizes
+    // of the first step.  Meant for graphs without control flow whose shapes
+    // do not change from step to step.
+    bool use_static_memory_plan = false;
+
+    // If positive, and kernels are not all run inline, nodes that would be
+    // passed to `runner` one by one are instead run by this many workers,
+    // each started with `runner` and owning a deque of ready nodes.  A
+    // worker runs the expensive successors of its nodes itself, newest
+    // first, and steals from the other workers when it runs out.
+    int num_work_stealing_workers = 0;
   };
   typedef std::function<void(const Status&)> DoneCallback;
   virtual void RunAsync(const Args& args, DoneCallback done) = 0;
@@ -39,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
@@ -97,6 +98,7 @@ class ExecutorTest : public ::testing::Test {
     args.rendezvous = rendez;
     args.stats_collector = &step_stats_collector_;
     args.runner = runner_;
+    args.num_work_stealing_workers = num_work_stealing_workers_;
     return exec_->Run(args);
   }
 
@@ -106,6 +108,7 @@ class ExecutorTest : public ::testing::Test {
   StepStatsCollector step_stats_collector_;
   StepStats step_stats_;
   Executor::Args::Runner runner_;
+  int num_work_stealing_workers_ = 0;
   Rendezvous* rendez_ = nullptr;
 };
 
@@ -261,6 +264,25 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWorkStealing) {
+  num_work_stealing_workers_ = 4;
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g));
+  // The first steps treat every node as expensive; later ones inline most.
+  for (int iters = 0; iters < 4; ++iters) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -516,6 +538,83 @@ BENCHMARK(BM_const_identity)
     ->ArgPair(100, 1)
     ->ArgPair(100, 100);
 
+// Create an inference-like graph of small ops that is 'depth' layers deep and
+// 'width' nodes wide, where node j of a layer computes
+// Relu(MatMul(x[j] + x[j + 1], w)) from nodes j and j + 1 of the layer above.
+// The MatMuls stay expensive enough to be dispatched to the inter-op threads
+// while the Adds and Relus are run inline.  The third argument selects the
+// scheduler: 0 for the inter-op thread pool, 1 for work stealing.
+static void BM_SmallOpInference(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  const bool work_stealing = state.range(2);
+  constexpr int kNumThreads = 8;
+  constexpr int kDim = 32;
+
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Tensor x(DT_FLOAT, TensorShape({kDim, kDim}));
+  x.flat<float>().setConstant(1.0f);
+  Tensor w(DT_FLOAT, TensorShape({kDim, kDim}));
+  w.flat<float>().setConstant(0.5f / kDim);
+  Node* weights = test::graph::Constant(g.get(), w);
+  std::vector<Node*> layer(width, test::graph::Constant(g.get(), x));
+  for (int i = 0; i < depth; ++i) {
+    std::vector<Node*> next(width);
+    for (int j = 0; j < width; ++j) {
+      Node* sum = test::graph::Add(g.get(), layer[j], layer[(j + 1) % width]);
+      Node* product = test::graph::Matmul(g.get(), sum, weights, false, false);
+      next[j] = test::graph::Unary(g.get(), "Relu", product);
+    }
+    layer = std::move(next);
+  }
+  FixupSourceAndSinkEdges(g.get());
+
+  std::unique_ptr<Device> device(DeviceFactory::NewDevice(
+      "CPU", {}, "/job:localhost/replica:0/task:0"));
+  const int version = g->versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.create_kernel =
+      [&device, version](const std::shared_ptr<const NodeProperties>& props,
+                         OpKernel** kernel) {
+        return CreateNonCachedKernel(device.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  Executor* exec = nullptr;
+  TF_CHECK_OK(NewLocalExecutor(params, *g, &exec));
+  std::unique_ptr<Executor> exec_holder(exec);
+
+  thread::ThreadPool pool(Env::Default(), "inter_op", kNumThreads);
+  Executor::Args args;
+  args.runner = [&pool](std::function<void()> fn) {
+    pool.Schedule(std::move(fn));
+  };
+  args.num_work_stealing_workers = work_stealing ? kNumThreads : 0;
+  // Let the cost model learn which nodes are cheap.
+  for (int i = 0; i < 10; ++i) {
+    TF_CHECK_OK(exec->Run(args));
+  }
+
+  for (auto s : state) {
+    TF_CHECK_OK(exec->Run(args));
+  }
+  const int64_t num_nodes = 3 * width * depth + 2;
+  state.SetLabel(strings::StrCat("Nodes = ", num_nodes));
+  state.SetItemsProcessed(num_nodes * static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_SmallOpInference)
+    ->UseRealTime()
+    ->Args({16, 16, 0})
+    ->Args({16, 16, 1})
+    ->Args({64, 16, 0})
+    ->Args({64, 16, 1})
+    ->Args({256, 8, 0})
+    ->Args({256, 8, 1});
+
 static void BM_FeedInputFetchOutput(::testing::benchmark::State& state) {
   Graph* g = new Graph(OpRegistry::Global());
   // z = x + y: x and y are provided as benchmark inputs.  z is the
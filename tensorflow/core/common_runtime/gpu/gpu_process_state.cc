@@ -357,8 +357,16 @@ Allocator* GPUProcessState::GetGpuHostAllocator(int numa_node) {
     }
     int64_t gpu_host_mem_limit = gpu_host_mem_limit_in_mb * (1LL << 20);
 
+    int64_t per_cpu_cache_bytes = 0;
+    status = tsl::ReadInt64FromEnvVar("TF_GPU_HOST_PER_CPU_CACHE_BYTES",
+                                      /*default_val=*/0, &per_cpu_cache_bytes);
+    if (!status.ok()) {
+      LOG(ERROR) << "GetGpuHostAllocator: " << status.error_message();
+    }
+
     tsl::BFCAllocator::Options allocator_opts;
     allocator_opts.allow_growth = true;
+    allocator_opts.per_cpu_cache_bytes = per_cpu_cache_bytes;
     tsl::Allocator* allocator = new tsl::BFCAllocator(
         absl::WrapUnique(sub_allocator), gpu_host_mem_limit,
         /*name=*/"gpu_host_bfc", allocator_opts);
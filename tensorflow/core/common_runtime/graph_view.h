@@ -85,6 +85,11 @@ struct NodeItem {
                                     // node's input types.
   bool is_distributed_communication : 1;  // True iff the op is registered to
                                           // use distributed communication.
+  bool may_keep_inputs : 1;  // True iff the op is stateful or has ref-typed
+                             // inputs or outputs.
+  bool outputs_are_step_local : 1;  // True iff no op that may keep a tensor
+                                    // beyond the step is reachable from this
+                                    // node's outputs.
 
   // The kernel for this node.
   OpKernel* kernel = nullptr;
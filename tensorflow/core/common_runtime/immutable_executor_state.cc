@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
 
+#include <deque>
+
 #include "absl/memory/memory.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -256,6 +258,36 @@ Status ImmutableExecutorState::Initialize(const Graph& graph) {
     }
   }
 
+  // The outputs of a node are step-local unless they can reach, along data
+  // edges, an op that may keep its inputs beyond the step: a stateful op, or
+  // one with reference-typed inputs or outputs.
+  std::vector<bool> may_escape(graph.num_node_ids(), false);
+  std::deque<const Node*> escaping;
+  for (const Node* n : graph.nodes()) {
+    bool has_ref_type = false;
+    for (DataType dt : n->input_types()) has_ref_type |= IsRefType(dt);
+    for (DataType dt : n->output_types()) has_ref_type |= IsRefType(dt);
+    const bool may_keep_inputs = n->op_def().is_stateful() || has_ref_type;
+    if (!IsSink(n)) gview_.node(n->id())->may_keep_inputs = may_keep_inputs;
+    if (may_keep_inputs) {
+      may_escape[n->id()] = true;
+      escaping.push_back(n);
+    }
+  }
+  while (!escaping.empty()) {
+    const Node* n = escaping.front();
+    escaping.pop_front();
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge() || may_escape[e->src()->id()]) continue;
+      may_escape[e->src()->id()] = true;
+      escaping.push_back(e->src());
+    }
+  }
+  for (const Node* n : graph.nodes()) {
+    if (IsSink(n)) continue;
+    gview_.node(n->id())->outputs_are_step_local = !may_escape[n->id()];
+  }
+
   // Initialize PendingCounts only after pending_ids_[node.id] is initialized
   // for all nodes.
   InitializePending(&graph, cf_info);
@@ -101,8 +101,16 @@ Allocator* ProcessState::GetCPUAllocator(int numa_node) {
       int64_t cpu_mem_limit = cpu_mem_limit_in_mb * (1LL << 20);
       DCHECK(sub_allocator);
 
+      int64_t per_cpu_cache_bytes = 0;
+      status = ReadInt64FromEnvVar("TF_CPU_BFC_PER_CPU_CACHE_BYTES",
+                                   /*default_val=*/0, &per_cpu_cache_bytes);
+      if (!status.ok()) {
+        LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+      }
+
       BFCAllocator::Options allocator_opts;
       allocator_opts.allow_growth = true;
+      allocator_opts.per_cpu_cache_bytes = per_cpu_cache_bytes;
       allocator = new BFCAllocator(
           absl::WrapUnique(sub_allocator), cpu_mem_limit,
           /*name=*/"bfc_cpu_allocator_for_gpu", allocator_opts);
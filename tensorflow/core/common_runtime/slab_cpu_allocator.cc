@@ -0,0 +1,335 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/slab_cpu_allocator.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "tensorflow/core/framework/allocator_registry.h"
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+constexpr size_t SlabCPUAllocator::kSlabSize;
+constexpr size_t SlabCPUAllocator::kMaxSlabObjectSize;
+constexpr int SlabCPUAllocator::kNumSizeClasses;
+constexpr size_t SlabCPUAllocator::kSpanSize;
+
+namespace {
+
+constexpr size_t kSmallClassLimit = 1024;
+constexpr int kNumSmallClasses =
+    kSmallClassLimit / Allocator::kAllocatorAlignment;
+constexpr int kClassesPerPowerOfTwo = 4;
+constexpr int kSmallClassLimitLog2 = 10;
+constexpr int kMaxSlabObjectSizeLog2 = 18;
+
+static_assert(size_t{1} << kSmallClassLimitLog2 == kSmallClassLimit,
+              "kSmallClassLimitLog2 mismatch");
+static_assert(size_t{1} << kMaxSlabObjectSizeLog2 ==
+                  SlabCPUAllocator::kMaxSlabObjectSize,
+              "kMaxSlabObjectSizeLog2 mismatch");
+static_assert(kNumSmallClasses +
+                      (kMaxSlabObjectSizeLog2 - kSmallClassLimitLog2) *
+                          kClassesPerPowerOfTwo ==
+                  SlabCPUAllocator::kNumSizeClasses,
+              "kNumSizeClasses mismatch");
+
+}  // namespace
+
+int SlabCPUAllocator::SizeClass(size_t num_bytes) {
+  DCHECK_GT(num_bytes, 0);
+  DCHECK_LE(num_bytes, kMaxSlabObjectSize);
+  if (num_bytes <= kSmallClassLimit) {
+    return (num_bytes - 1) / kAllocatorAlignment;
+  }
+  // (2^k, 2^(k+1)] is split into kClassesPerPowerOfTwo equal parts.
+  const int k = Log2Floor64(num_bytes - 1);
+  const size_t step = size_t{1} << (k - 2);
+  const int sub = (num_bytes - 1 - (size_t{1} << k)) / step;
+  return kNumSmallClasses + (k - kSmallClassLimitLog2) * kClassesPerPowerOfTwo +
+         sub;
+}
+
+size_t SlabCPUAllocator::ClassSize(int size_class) {
+  DCHECK_GE(size_class, 0);
+  DCHECK_LT(size_class, kNumSizeClasses);
+  if (size_class < kNumSmallClasses) {
+    return (size_class + 1) * kAllocatorAlignment;
+  }
+  const int k = kSmallClassLimitLog2 +
+                (size_class - kNumSmallClasses) / kClassesPerPowerOfTwo;
+  const int sub = (size_class - kNumSmallClasses) % kClassesPerPowerOfTwo;
+  return (size_t{1} << k) + (sub + 1) * (size_t{1} << (k - 2));
+}
+
+SlabCPUAllocator::SlabCPUAllocator() {
+  const int num_arenas = port::NUMAEnabled() ? port::NUMANumNodes() : 1;
+  for (int i = 0; i < num_arenas; ++i) {
+    arenas_.push_back(std::make_unique<Arena>());
+    arenas_.back()->numa_node =
+        port::NUMAEnabled() ? i : port::kNUMANoAffinity;
+  }
+  span_remainder_.resize(num_arenas, {nullptr, nullptr});
+  for (auto& leaf : slab_map_) {
+    leaf.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+SlabCPUAllocator::~SlabCPUAllocator() {
+  mutex_lock l(mu_);
+  for (const Span& span : spans_) {
+    if (span.numa_node == port::kNUMANoAffinity) {
+      port::AlignedFree(span.ptr);
+    } else {
+      port::NUMAFree(span.ptr, kSpanSize);
+    }
+  }
+}
+
+int SlabCPUAllocator::CurrentArena() const {
+  if (arenas_.size() == 1) return 0;
+  // Looking up the affinity can be a system call, so it is only done once per
+  // thread.  Inter-op and intra-op threads are bound before they run any op.
+  static thread_local int node = port::NUMAGetThreadNodeAffinity();
+  return node == port::kNUMANoAffinity || node >= arenas_.size() ? 0 : node;
+}
+
+char* SlabCPUAllocator::NewSlab(int arena, int size_class) {
+  mutex_lock l(mu_);
+  std::pair<char*, char*>& remainder = span_remainder_[arena];
+  if (remainder.first == remainder.second) {
+    const int numa_node = arenas_[arena]->numa_node;
+    void* ptr =
+        numa_node == port::kNUMANoAffinity
+            ? port::AlignedMalloc(kSpanSize, kSlabSize)
+            : port::NUMAMalloc(numa_node, kSpanSize, kAllocatorAlignment);
+    if (ptr == nullptr) return nullptr;
+    spans_.push_back({ptr, numa_node});
+    // NUMAMalloc only guarantees page alignment, in which case the first
+    // partial slab is skipped.
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+    const uintptr_t aligned_begin = (begin + kSlabSize - 1) & ~(kSlabSize - 1);
+    remainder.first = reinterpret_cast<char*>(aligned_begin);
+    remainder.second = reinterpret_cast<char*>(
+        aligned_begin + (begin + kSpanSize - aligned_begin) / kSlabSize *
+                            kSlabSize);
+  }
+  char* base = remainder.first;
+  remainder.first += kSlabSize;
+
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(base);
+  if (addr >> kAddressBits) {
+    // Outside of the range covered by slab_map_.  This does not happen with
+    // 4-level page tables; the slab is handed out as if it were exhausted.
+    LOG_FIRST_N(WARNING, 1)
+        << "Slab at " << base << " is outside of the mapped address range.";
+    return nullptr;
+  }
+  std::atomic<SlabMapLeaf*>& root = slab_map_[addr >> (kSlabShift + kLeafBits)];
+  SlabMapLeaf* leaf = root.load(std::memory_order_relaxed);
+  if (leaf == nullptr) {
+    slab_map_leaves_.push_back(std::make_unique<SlabMapLeaf>());
+    leaf = slab_map_leaves_.back().get();
+    for (auto& entry : *leaf) {
+      entry.store(nullptr, std::memory_order_relaxed);
+    }
+    root.store(leaf, std::memory_order_release);
+  }
+  slabs_.push_back(std::make_unique<Slab>(Slab{arena, size_class}));
+  (*leaf)[(addr >> kSlabShift) & ((1 << kLeafBits) - 1)].store(
+      slabs_.back().get(), std::memory_order_release);
+  return base;
+}
+
+const SlabCPUAllocator::Slab* SlabCPUAllocator::FindSlab(
+    const void* ptr) const {
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+  if (addr >> kAddressBits) return nullptr;
+  const SlabMapLeaf* leaf =
+      slab_map_[addr >> (kSlabShift + kLeafBits)].load(
+          std::memory_order_acquire);
+  if (leaf == nullptr) return nullptr;
+  return (*leaf)[(addr >> kSlabShift) & ((1 << kLeafBits) - 1)].load(
+      std::memory_order_acquire);
+}
+
+void* SlabCPUAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  num_bytes = std::max<size_t>(num_bytes, 1);
+  void* ptr = nullptr;
+  size_t alloc_size = 0;
+  if (num_bytes <= kMaxSlabObjectSize && alignment <= kAllocatorAlignment) {
+    const int size_class = SizeClass(num_bytes);
+    const int arena = CurrentArena();
+    SizeClassList& list = arenas_[arena]->classes[size_class];
+    alloc_size = ClassSize(size_class);
+    mutex_lock l(list.mu);
+    if (list.free_list != nullptr) {
+      ptr = list.free_list;
+      list.free_list = list.free_list->next;
+    } else {
+      if (list.next == list.end) {
+        char* slab = NewSlab(arena, size_class);
+        if (slab != nullptr) {
+          list.next = slab;
+          list.end = slab + kSlabSize / alloc_size * alloc_size;
+        }
+      }
+      if (list.next != list.end) {
+        ptr = list.next;
+        list.next += alloc_size;
+      }
+    }
+  }
+  if (ptr == nullptr) {
+    ptr = port::AlignedMalloc(num_bytes, alignment);
+    if (ptr == nullptr) return nullptr;
+    alloc_size = port::MallocExtension_GetAllocatedSize(ptr);
+  }
+  if (CPUAllocatorStatsEnabled()) {
+    RecordAllocation(ptr, num_bytes, alloc_size);
+  }
+  return ptr;
+}
+
+void SlabCPUAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) return;
+  const Slab* slab = FindSlab(ptr);
+  if (slab == nullptr) {
+    if (CPUAllocatorStatsEnabled()) {
+      RecordDeallocation(ptr, port::MallocExtension_GetAllocatedSize(ptr));
+    }
+    port::AlignedFree(ptr);
+    return;
+  }
+  if (CPUAllocatorStatsEnabled()) {
+    RecordDeallocation(ptr, ClassSize(slab->size_class));
+  }
+  SizeClassList& list = arenas_[slab->arena]->classes[slab->size_class];
+  FreeObject* object = static_cast<FreeObject*>(ptr);
+  mutex_lock l(list.mu);
+  object->next = list.free_list;
+  list.free_list = object;
+}
+
+size_t SlabCPUAllocator::AllocatedSizeSlow(const void* ptr) const {
+  const Slab* slab = FindSlab(ptr);
+  if (slab == nullptr) return port::MallocExtension_GetAllocatedSize(ptr);
+  return ClassSize(slab->size_class);
+}
+
+void SlabCPUAllocator::RecordAllocation(void* ptr, size_t num_bytes,
+                                        size_t alloc_size) {
+  mutex_lock l(stats_mu_);
+  ++stats_.num_allocs;
+  stats_.bytes_in_use += alloc_size;
+  stats_.peak_bytes_in_use =
+      std::max<int64_t>(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+  stats_.largest_alloc_size =
+      std::max<int64_t>(stats_.largest_alloc_size, alloc_size);
+}
+
+void SlabCPUAllocator::RecordDeallocation(void* ptr, size_t alloc_size) {
+  mutex_lock l(stats_mu_);
+  stats_.bytes_in_use -= alloc_size;
+}
+
+absl::optional<AllocatorStats> SlabCPUAllocator::GetStats() {
+  if (!CPUAllocatorStatsEnabled()) return absl::nullopt;
+  int64_t bytes_reserved;
+  {
+    mutex_lock l(mu_);
+    bytes_reserved = slabs_.size() * kSlabSize;
+  }
+  mutex_lock l(stats_mu_);
+  AllocatorStats stats = stats_;
+  stats.bytes_reserved = bytes_reserved;
+  return stats;
+}
+
+bool SlabCPUAllocator::ClearStats() {
+  if (!CPUAllocatorStatsEnabled()) return false;
+  mutex_lock l(stats_mu_);
+  stats_.num_allocs = 0;
+  stats_.peak_bytes_in_use = stats_.bytes_in_use;
+  stats_.largest_alloc_size = 0;
+  return true;
+}
+
+namespace {
+
+class SlabCPUAllocatorFactory : public AllocatorFactory {
+ public:
+  // Arenas are per NUMA node internally, but all of them are reachable from a
+  // single allocator.
+  bool NumaEnabled() override { return false; }
+
+  Allocator* CreateAllocator() override { return new SlabCPUAllocator; }
+
+  SubAllocator* CreateSubAllocator(int numa_node) override {
+    return new SlabSubAllocator(new SlabCPUAllocator);
+  }
+
+ private:
+  class SlabSubAllocator : public SubAllocator {
+   public:
+    explicit SlabSubAllocator(SlabCPUAllocator* allocator)
+        : SubAllocator({}, {}), allocator_(allocator) {}
+
+    void* Alloc(size_t alignment, size_t num_bytes,
+                size_t* bytes_received) override {
+      *bytes_received = num_bytes;
+      return allocator_->AllocateRaw(alignment, num_bytes);
+    }
+
+    void Free(void* ptr, size_t num_bytes) override {
+      allocator_->DeallocateRaw(ptr);
+    }
+
+    bool SupportsCoalescing() const override { return false; }
+
+    AllocatorMemoryType GetMemoryType() const override {
+      return allocator_->GetMemoryType();
+    }
+
+   private:
+    std::unique_ptr<SlabCPUAllocator> allocator_;
+  };
+};
+
+// Outranks DefaultCPUAllocator (100) and MklCPUAllocator (200) when requested
+// through TF_CPU_ALLOCATOR_USE_SLAB, and is never picked otherwise.
+int SlabCPUAllocatorPriority() {
+  bool use_slab_allocator = false;
+  Status status =
+      ReadBoolFromEnvVar("TF_CPU_ALLOCATOR_USE_SLAB", /*default_val=*/false,
+                         &use_slab_allocator);
+  if (!status.ok()) {
+    LOG(ERROR) << "SlabCPUAllocatorPriority: " << status.error_message();
+  }
+  return use_slab_allocator ? 300 : 50;
+}
+
+REGISTER_MEM_ALLOCATOR("SlabCPUAllocator", SlabCPUAllocatorPriority(),
+                       SlabCPUAllocatorFactory);
+
+}  // namespace
+
+}  // namespace tensorflow
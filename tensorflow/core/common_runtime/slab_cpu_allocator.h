@@ -0,0 +1,167 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_SLAB_CPU_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_SLAB_CPU_ALLOCATOR_H_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A CPU Allocator that serves small requests from size-class slabs instead
+// of going to port::AlignedMalloc for every tensor.
+//
+// Requests of up to kMaxSlabObjectSize bytes are rounded up to one of
+// kNumSizeClasses object sizes, spaced at most 25% apart, and carved out of
+// kSlabSize-byte slabs.  A freed object goes onto the free list of its size
+// class and is handed out to the next request of that class.  Successive
+// training or inference steps allocate and free the same mix of temporaries,
+// so in steady state a step is served entirely from objects recycled from the
+// previous one.  Slab memory is kept until the allocator is destroyed.
+//
+// There is one arena of slabs per NUMA node.  A request is served from the
+// arena of the NUMA node the calling thread is bound to (as of its first
+// allocation), and an object always returns to the arena it came from.
+// Requests larger than kMaxSlabObjectSize, or aligned to more than
+// kAllocatorAlignment, are passed through to port::AlignedMalloc.
+//
+// The process-wide CPU allocator is a SlabCPUAllocator when the environment
+// variable TF_CPU_ALLOCATOR_USE_SLAB is set to true.
+class SlabCPUAllocator : public Allocator {
+ public:
+  static constexpr size_t kSlabSize = 2 << 20;
+  static constexpr size_t kMaxSlabObjectSize = 256 << 10;
+  // Sixteen classes of kAllocatorAlignment steps up to 1KB, then four classes
+  // per power of two up to kMaxSlabObjectSize.
+  static constexpr int kNumSizeClasses = 48;
+
+  SlabCPUAllocator();
+  ~SlabCPUAllocator() override;
+
+  string Name() override { return "slab_cpu"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+
+  void DeallocateRaw(void* ptr) override;
+
+  // Stats are only collected when CPUAllocatorStatsEnabled() is true.
+  // bytes_in_use counts the rounded-up size of live objects, bytes_reserved
+  // the slabs carved so far.
+  absl::optional<AllocatorStats> GetStats() override;
+
+  bool ClearStats() override;
+
+  size_t AllocatedSizeSlow(const void* ptr) const override;
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return AllocatorMemoryType::kHostPageable;
+  }
+
+  // Returns the size class serving a request of 'num_bytes', which must be in
+  // [1, kMaxSlabObjectSize].
+  static int SizeClass(size_t num_bytes);
+
+  // Returns the size of the objects of 'size_class'.
+  static size_t ClassSize(int size_class);
+
+ private:
+  // Slab memory is reserved from the system kSpanSize bytes at a time, both to
+  // amortize the cost of port::NUMAMalloc and to align slabs to kSlabSize.
+  static constexpr size_t kSpanSize = 16 * kSlabSize;
+
+  // Every slab is entered into a two-level map indexed by the kSlabSize-aligned
+  // part of its address, so that DeallocateRaw can tell slab objects from
+  // large allocations without reading the object.
+  static constexpr int kAddressBits = 48;
+  static constexpr int kSlabShift = 21;
+  static constexpr int kLeafBits = 14;
+  static constexpr int kRootBits = kAddressBits - kSlabShift - kLeafBits;
+  static_assert(size_t{1} << kSlabShift == kSlabSize, "kSlabShift mismatch");
+
+  struct Slab {
+    int arena;
+    int size_class;
+  };
+
+  // A free object holds the link to the next one.
+  struct FreeObject {
+    FreeObject* next;
+  };
+
+  struct SizeClassList {
+    mutex mu;
+    FreeObject* free_list TF_GUARDED_BY(mu) = nullptr;
+    // The part of the most recent slab of this class not handed out yet.
+    char* next TF_GUARDED_BY(mu) = nullptr;
+    char* end TF_GUARDED_BY(mu) = nullptr;
+  };
+
+  struct Arena {
+    int numa_node;
+    SizeClassList classes[kNumSizeClasses];
+  };
+
+  struct Span {
+    void* ptr;
+    int numa_node;
+  };
+
+  using SlabMapLeaf = std::array<std::atomic<const Slab*>, 1 << kLeafBits>;
+
+  // Returns the index of the arena serving the calling thread.
+  int CurrentArena() const;
+
+  // Returns a new slab of 'size_class' in 'arena', or nullptr if out of
+  // memory.
+  char* NewSlab(int arena, int size_class) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the slab containing 'ptr', or nullptr if 'ptr' is not part of a
+  // slab.
+  const Slab* FindSlab(const void* ptr) const;
+
+  void RecordAllocation(void* ptr, size_t num_bytes, size_t alloc_size)
+      TF_LOCKS_EXCLUDED(stats_mu_);
+  void RecordDeallocation(void* ptr, size_t alloc_size)
+      TF_LOCKS_EXCLUDED(stats_mu_);
+
+  std::vector<std::unique_ptr<Arena>> arenas_;
+
+  std::array<std::atomic<SlabMapLeaf*>, 1 << kRootBits> slab_map_;
+
+  // Guards slab creation.
+  mutex mu_;
+  std::vector<Span> spans_ TF_GUARDED_BY(mu_);
+  std::vector<std::unique_ptr<Slab>> slabs_ TF_GUARDED_BY(mu_);
+  std::vector<std::unique_ptr<SlabMapLeaf>> slab_map_leaves_
+      TF_GUARDED_BY(mu_);
+  // Unused slabs of the most recent span of each arena.
+  std::vector<std::pair<char*, char*>> span_remainder_ TF_GUARDED_BY(mu_);
+
+  mutex stats_mu_;
+  AllocatorStats stats_ TF_GUARDED_BY(stats_mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SlabCPUAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_SLAB_CPU_ALLOCATOR_H_
@@ -0,0 +1,254 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/slab_cpu_allocator.h"
+
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(SlabCPUAllocatorTest, SizeClasses) {
+  EXPECT_EQ(SlabCPUAllocator::SizeClass(1), 0);
+  EXPECT_EQ(SlabCPUAllocator::SizeClass(64), 0);
+  EXPECT_EQ(SlabCPUAllocator::SizeClass(65), 1);
+  const int max_class =
+      SlabCPUAllocator::SizeClass(SlabCPUAllocator::kMaxSlabObjectSize);
+  EXPECT_EQ(max_class, SlabCPUAllocator::kNumSizeClasses - 1);
+  EXPECT_EQ(SlabCPUAllocator::ClassSize(max_class),
+            SlabCPUAllocator::kMaxSlabObjectSize);
+
+  int prev_class = 0;
+  for (size_t n = 1; n <= SlabCPUAllocator::kMaxSlabObjectSize; ++n) {
+    const int size_class = SlabCPUAllocator::SizeClass(n);
+    const size_t class_size = SlabCPUAllocator::ClassSize(size_class);
+    ASSERT_GE(class_size, n);
+    ASSERT_EQ(class_size % Allocator::kAllocatorAlignment, 0);
+    ASSERT_LT(class_size - n,
+              std::max<size_t>(n / 4, Allocator::kAllocatorAlignment))
+        << n;
+    ASSERT_TRUE(size_class == prev_class || size_class == prev_class + 1) << n;
+    if (size_class > 0) {
+      // 'n' does not fit the previous class.
+      ASSERT_LT(SlabCPUAllocator::ClassSize(size_class - 1), n);
+    }
+    prev_class = size_class;
+  }
+}
+
+TEST(SlabCPUAllocatorTest, FreedObjectsAreRecycled) {
+  SlabCPUAllocator a;
+  std::vector<void*> ptrs;
+  for (size_t n : {1, 100, 1000, 4096, 100000, 256 << 10}) {
+    void* p = a.AllocateRaw(Allocator::kAllocatorAlignment, n);
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % Allocator::kAllocatorAlignment,
+              0);
+    EXPECT_EQ(a.AllocatedSizeSlow(p),
+              SlabCPUAllocator::ClassSize(SlabCPUAllocator::SizeClass(n)));
+    memset(p, 0xab, n);
+    ptrs.push_back(p);
+  }
+  // The next step allocates the same sizes again and gets the same objects.
+  for (void* p : ptrs) {
+    a.DeallocateRaw(p);
+  }
+  std::vector<void*> recycled;
+  for (size_t n : {1, 100, 1000, 4096, 100000, 256 << 10}) {
+    recycled.push_back(a.AllocateRaw(Allocator::kAllocatorAlignment, n));
+  }
+  EXPECT_EQ(recycled, ptrs);
+  for (void* p : recycled) {
+    a.DeallocateRaw(p);
+  }
+}
+
+TEST(SlabCPUAllocatorTest, LargeAndOveralignedRequestsBypassSlabs) {
+  SlabCPUAllocator a;
+  void* large = a.AllocateRaw(Allocator::kAllocatorAlignment,
+                              SlabCPUAllocator::kMaxSlabObjectSize + 1);
+  ASSERT_NE(large, nullptr);
+  memset(large, 0, SlabCPUAllocator::kMaxSlabObjectSize + 1);
+  void* aligned = a.AllocateRaw(4096, 100);
+  ASSERT_NE(aligned, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 4096, 0);
+  a.DeallocateRaw(large);
+  a.DeallocateRaw(aligned);
+}
+
+TEST(SlabCPUAllocatorTest, Stats) {
+  EnableCPUAllocatorStats();
+  SlabCPUAllocator a;
+  void* p1 = a.AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  void* p2 = a.AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  absl::optional<AllocatorStats> stats = a.GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->num_allocs, 2);
+  EXPECT_EQ(stats->bytes_in_use, 1024 + 128);
+  EXPECT_EQ(stats->peak_bytes_in_use, 1024 + 128);
+  EXPECT_EQ(stats->largest_alloc_size, 1024);
+  EXPECT_EQ(stats->bytes_reserved, 2 * SlabCPUAllocator::kSlabSize);
+
+  a.DeallocateRaw(p1);
+  a.DeallocateRaw(p2);
+  stats = a.GetStats();
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->peak_bytes_in_use, 1024 + 128);
+  EXPECT_TRUE(a.ClearStats());
+  stats = a.GetStats();
+  EXPECT_EQ(stats->num_allocs, 0);
+  EXPECT_EQ(stats->peak_bytes_in_use, 0);
+  DisableCPUAllocatorStats();
+  EXPECT_FALSE(a.GetStats());
+}
+
+TEST(SlabCPUAllocatorTest, MultiThreaded) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocsPerThread = 5000;
+  SlabCPUAllocator a;
+  thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+  BlockingCounter counter(kNumThreads);
+  for (int t = 0; t < kNumThreads; ++t) {
+    pool.Schedule([&a, &counter, t]() {
+      random::PhiloxRandom philox(t, 17);
+      random::SimplePhilox rand(&philox);
+      std::vector<std::pair<char*, size_t>> live;
+      for (int i = 0; i < kNumAllocsPerThread; ++i) {
+        const size_t bytes = 1 + rand.Uniform(300 << 10);
+        char* p = static_cast<char*>(
+            a.AllocateRaw(Allocator::kAllocatorAlignment, bytes));
+        CHECK(p != nullptr);
+        memset(p, t, bytes);
+        live.emplace_back(p, bytes);
+        if (live.size() > 16 || rand.OneIn(2)) {
+          const size_t index = rand.Uniform(live.size());
+          // No other thread wrote into this object while it was live.
+          const auto& object = live[index];
+          CHECK_EQ(object.first[object.second - 1], static_cast<char>(t));
+          a.DeallocateRaw(object.first);
+          live[index] = live.back();
+          live.pop_back();
+        }
+      }
+      for (const auto& p : live) {
+        a.DeallocateRaw(p.first);
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+}
+
+// Replays the allocation pattern of a training step from 'num_threads'
+// threads: activations are allocated on the way forward and freed in reverse
+// order on the way back, with short-lived temporaries in between.  The second
+// argument selects the allocator: 0 for cpu_allocator_base(), 1 for a
+// SlabCPUAllocator.
+void BM_StepAllocations(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  constexpr int kLayers = 64;
+  SlabCPUAllocator slab_allocator;
+  Allocator* a = state.range(1) ? &slab_allocator : cpu_allocator_base();
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+
+  for (auto s : state) {
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([a, &counter]() {
+        const size_t sizes[] = {256, 4096, 1000, 64 << 10, 48, 12288, 512};
+        void* activations[kLayers];
+        for (int i = 0; i < kLayers; ++i) {
+          activations[i] = a->AllocateRaw(64, sizes[i % 7]);
+          a->DeallocateRaw(a->AllocateRaw(64, sizes[(i + 3) % 7]));
+        }
+        for (int i = kLayers - 1; i >= 0; --i) {
+          a->DeallocateRaw(a->AllocateRaw(64, sizes[(i + 5) % 7]));
+          a->DeallocateRaw(activations[i]);
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads * kLayers * 3);
+}
+BENCHMARK(BM_StepAllocations)
+    ->UseRealTime()
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(8, 0)
+    ->ArgPair(8, 1)
+    ->ArgPair(32, 0)
+    ->ArgPair(32, 1);
+
+// One forward and backward step of a three-layer perceptron with a batch of
+// 'batch' and hidden layers of 'width' units.  The executor allocates every
+// activation and gradient from the process CPU allocator; compare runs with
+// TF_CPU_ALLOCATOR_USE_SLAB=true and false.
+void BM_MLPTrainingStep(::testing::benchmark::State& state) {
+  const int batch = state.range(0);
+  const int width = state.range(1);
+  constexpr int kLayers = 3;
+  Graph* g = new Graph(OpRegistry::Global());
+  auto random_matrix = [g](int rows, int cols) {
+    Tensor t(DT_FLOAT, TensorShape({rows, cols}));
+    t.flat<float>().setRandom();
+    return test::graph::Constant(g, t);
+  };
+
+  Node* x = random_matrix(batch, width);
+  std::vector<Node*> inputs;
+  std::vector<Node*> weights;
+  std::vector<Node*> activations;
+  Node* h = x;
+  for (int i = 0; i < kLayers; ++i) {
+    inputs.push_back(h);
+    weights.push_back(random_matrix(width, width));
+    h = test::graph::Unary(
+        g, "Relu", test::graph::Matmul(g, h, weights.back(), false, false));
+    activations.push_back(h);
+  }
+  Node* grad = test::graph::Binary(g, "Sub", h, x);
+  for (int i = kLayers - 1; i >= 0; --i) {
+    grad = test::graph::Binary(g, "ReluGrad", grad, activations[i]);
+    // The weight gradient is the step's output; the input gradient feeds the
+    // layer below.
+    test::graph::Matmul(g, inputs[i], grad, true, false);
+    grad = test::graph::Matmul(g, grad, weights[i], false, true);
+  }
+
+  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_MLPTrainingStep)
+    ->UseRealTime()
+    ->ArgPair(32, 64)
+    ->ArgPair(32, 256)
+    ->ArgPair(128, 512);
+
+}  // namespace
+}  // namespace tensorflow
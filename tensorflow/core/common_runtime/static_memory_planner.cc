@@ -0,0 +1,289 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <numeric>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+size_t RoundUp(size_t n) {
+  return (n + Allocator::kAllocatorAlignment - 1) &
+         ~(Allocator::kAllocatorAlignment - 1);
+}
+
+}  // namespace
+
+// Serves one node output, from its place in the arena when possible.
+class StaticMemoryPlanner::OutputAllocator : public Allocator {
+ public:
+  OutputAllocator(StaticMemoryPlanner* planner, int first, int last)
+      : planner_(planner), first_(first), last_(last) {}
+
+  string Name() override { return "static_memory_plan"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    char* arena = planner_->arena_.load(std::memory_order_acquire);
+    if (arena == nullptr) {
+      size_t recorded = recorded_bytes_.load(std::memory_order_relaxed);
+      while (recorded < num_bytes &&
+             !recorded_bytes_.compare_exchange_weak(
+                 recorded, num_bytes, std::memory_order_relaxed)) {
+      }
+    } else if (num_bytes > 0 && num_bytes <= size_ &&
+               alignment <= Allocator::kAllocatorAlignment && TryAcquire()) {
+      planner_->Ref();
+      return arena + offset_;
+    }
+    void* ptr = planner_->backing_->AllocateRaw(alignment, num_bytes);
+    if (ptr != nullptr) planner_->Ref();
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    char* arena = planner_->arena_.load(std::memory_order_acquire);
+    if (arena != nullptr && size_ > 0 && ptr == arena + offset_) {
+      in_use_.store(false, std::memory_order_release);
+    } else {
+      planner_->backing_->DeallocateRaw(ptr);
+    }
+    // May delete this allocator if the executor is gone.
+    planner_->Unref();
+  }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return planner_->backing_->GetMemoryType();
+  }
+
+ private:
+  friend class StaticMemoryPlanner;
+
+  // Claims the place of this output in the arena, which requires that it is
+  // not in use and that no output sharing its memory is.
+  bool TryAcquire() {
+    if (in_use_.exchange(true, std::memory_order_seq_cst)) return false;
+    for (const OutputAllocator* other : overlapping_) {
+      if (other->in_use_.load(std::memory_order_seq_cst)) {
+        in_use_.store(false, std::memory_order_release);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  StaticMemoryPlanner* const planner_;
+  // The lifetime of the output in the planned execution order.
+  const int first_;
+  const int last_;
+  // The largest request seen before the plan was made.
+  std::atomic<size_t> recorded_bytes_{0};
+
+  // Set by Finalize() before the arena is published.  `size_` is 0 if the
+  // output has no place in the arena.
+  size_t offset_ = 0;
+  size_t size_ = 0;
+  std::vector<const OutputAllocator*> overlapping_;
+
+  std::atomic<bool> in_use_{false};
+};
+
+size_t StaticMemoryPlanner::AssignOffsets(
+    const std::vector<Interval>& intervals, std::vector<size_t>* offsets) {
+  const int n = intervals.size();
+  offsets->assign(n, 0);
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&intervals](int a, int b) {
+    if (intervals[a].size != intervals[b].size) {
+      return intervals[a].size > intervals[b].size;
+    }
+    return intervals[a].first < intervals[b].first;
+  });
+
+  size_t arena_bytes = 0;
+  std::vector<int> placed;
+  std::vector<int> live;
+  for (int i : order) {
+    const Interval& t = intervals[i];
+    DCHECK_EQ(t.size % Allocator::kAllocatorAlignment, 0);
+    live.clear();
+    for (int j : placed) {
+      if (intervals[j].first <= t.last && t.first <= intervals[j].last) {
+        live.push_back(j);
+      }
+    }
+    std::sort(live.begin(), live.end(), [offsets](int a, int b) {
+      return (*offsets)[a] < (*offsets)[b];
+    });
+    // Find the smallest gap between the tensors live at the same time that
+    // holds this one, or else place it after all of them.
+    size_t best_offset = std::numeric_limits<size_t>::max();
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    size_t gap_start = 0;
+    for (int j : live) {
+      const size_t offset = (*offsets)[j];
+      if (offset >= gap_start + t.size && offset - gap_start < best_gap) {
+        best_offset = gap_start;
+        best_gap = offset - gap_start;
+      }
+      gap_start = std::max(gap_start, offset + intervals[j].size);
+    }
+    if (best_offset == std::numeric_limits<size_t>::max()) {
+      best_offset = gap_start;
+    }
+    (*offsets)[i] = best_offset;
+    arena_bytes = std::max(arena_bytes, best_offset + t.size);
+    placed.push_back(i);
+  }
+  return arena_bytes;
+}
+
+StaticMemoryPlanner::StaticMemoryPlanner(const GraphView& gview,
+                                         Allocator* backing)
+    : backing_(backing) {
+  const int num_nodes = gview.num_nodes();
+
+  // Order the nodes as a sequential executor would run them.
+  std::vector<int> pending(num_nodes, 0);
+  for (int id = 0; id < num_nodes; ++id) {
+    const NodeItem* item = gview.node(id);
+    if (item == nullptr) continue;
+    for (const EdgeInfo& e : item->output_edges()) ++pending[e.dst_id];
+    for (const ControlEdgeInfo& e : item->output_control_edges()) {
+      ++pending[e.dst_id];
+    }
+  }
+  std::deque<int> ready;
+  for (int id = 0; id < num_nodes; ++id) {
+    if (gview.node(id) != nullptr && pending[id] == 0) ready.push_back(id);
+  }
+  std::vector<int> position(num_nodes, -1);
+  int next_position = 0;
+  while (!ready.empty()) {
+    const int id = ready.front();
+    ready.pop_front();
+    position[id] = next_position++;
+    const NodeItem* item = gview.node(id);
+    for (const EdgeInfo& e : item->output_edges()) {
+      if (--pending[e.dst_id] == 0) ready.push_back(e.dst_id);
+    }
+    for (const ControlEdgeInfo& e : item->output_control_edges()) {
+      if (--pending[e.dst_id] == 0) ready.push_back(e.dst_id);
+    }
+  }
+
+  output_start_.assign(num_nodes, -1);
+  for (int id = 0; id < num_nodes; ++id) {
+    const NodeItem* item = gview.node(id);
+    // Nodes in a cycle have no position; they only occur in graphs with
+    // control flow, which are not planned.
+    if (item == nullptr || position[id] < 0 || item->may_keep_inputs ||
+        item->num_outputs == 0) {
+      continue;
+    }
+    std::vector<int> last(item->num_outputs, position[id]);
+    std::vector<bool> plannable(item->num_outputs, true);
+    for (const EdgeInfo& e : item->output_edges()) {
+      const NodeItem* dst = gview.node(e.dst_id);
+      if (dst->may_keep_inputs || position[e.dst_id] < 0) {
+        plannable[e.output_slot] = false;
+      }
+      last[e.output_slot] = std::max(last[e.output_slot], position[e.dst_id]);
+    }
+    if (std::find(plannable.begin(), plannable.end(), true) ==
+        plannable.end()) {
+      continue;
+    }
+    output_start_[id] = output_allocators_.size();
+    for (int i = 0; i < item->num_outputs; ++i) {
+      if (plannable[i]) {
+        allocators_.emplace_back(
+            new OutputAllocator(this, position[id], last[i]));
+        output_allocators_.push_back(allocators_.back().get());
+      } else {
+        output_allocators_.push_back(nullptr);
+      }
+    }
+  }
+}
+
+StaticMemoryPlanner::~StaticMemoryPlanner() {
+  char* arena = arena_.load(std::memory_order_relaxed);
+  if (arena != nullptr) {
+    backing_->DeallocateRaw(arena);
+  }
+}
+
+void StaticMemoryPlanner::Finalize() {
+  mutex_lock l(mu_);
+  if (finalized_) return;
+  finalized_ = true;
+
+  std::vector<OutputAllocator*> planned;
+  std::vector<Interval> intervals;
+  for (const auto& a : allocators_) {
+    const size_t bytes = a->recorded_bytes_.load(std::memory_order_relaxed);
+    if (bytes == 0) continue;
+    planned.push_back(a.get());
+    intervals.push_back({RoundUp(bytes), a->first_, a->last_});
+  }
+  std::vector<size_t> offsets;
+  const size_t arena_bytes = AssignOffsets(intervals, &offsets);
+  if (arena_bytes == 0) return;
+  char* arena = static_cast<char*>(
+      backing_->AllocateRaw(Allocator::kAllocatorAlignment, arena_bytes));
+  if (arena == nullptr) {
+    LOG(WARNING) << "Failed to allocate a " << arena_bytes
+                 << " byte arena for the static memory plan; node outputs "
+                    "will be allocated dynamically.";
+    return;
+  }
+
+  for (size_t i = 0; i < planned.size(); ++i) {
+    planned[i]->offset_ = offsets[i];
+    planned[i]->size_ = intervals[i].size;
+  }
+  std::vector<int> by_offset(planned.size());
+  std::iota(by_offset.begin(), by_offset.end(), 0);
+  std::sort(by_offset.begin(), by_offset.end(),
+            [&offsets](int a, int b) { return offsets[a] < offsets[b]; });
+  for (size_t i = 0; i < by_offset.size(); ++i) {
+    OutputAllocator* a = planned[by_offset[i]];
+    for (size_t j = i + 1; j < by_offset.size(); ++j) {
+      OutputAllocator* b = planned[by_offset[j]];
+      if (b->offset_ >= a->offset_ + a->size_) break;
+      a->overlapping_.push_back(b);
+      b->overlapping_.push_back(a);
+    }
+  }
+  VLOG(1) << "Planned " << planned.size() << " node outputs into a "
+          << arena_bytes << " byte arena.";
+  arena_bytes_ = arena_bytes;
+  arena_.store(arena, std::memory_order_release);
+}
+
+size_t StaticMemoryPlanner::arena_bytes() const {
+  mutex_lock l(mu_);
+  return arena_bytes_;
+}
+
+}  // namespace tensorflow
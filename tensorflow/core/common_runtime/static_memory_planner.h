@@ -0,0 +1,111 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Plans the memory of the node outputs of one executor graph, in the manner
+// of TFLite's ArenaPlanner: every output gets a fixed offset in a single
+// preallocated arena, and outputs whose lifetimes do not overlap share memory.
+//
+// Output sizes are not known statically, so the planner records the size of
+// every output allocation until Finalize() is called, typically at the end of
+// the first step, and plans from those.  After that an output is served from
+// its place in the arena as long as it fits and no output sharing its memory
+// is still alive; otherwise, for instance when the executor runs nodes in a
+// different order than planned, when a later step has larger shapes, or when
+// a kernel has forwarded a planned buffer to an output that outlives the step,
+// the request is passed through to the backing allocator.  Correctness never
+// depends on the plan being followed.
+//
+// Lifetimes are taken from a sequential topological order of the graph: an
+// output is live from its producer until its last consumer.  Outputs of ops
+// that are stateful or have ref-typed inputs or outputs, and outputs consumed
+// by such ops, are not planned since they may be kept beyond the step.
+class StaticMemoryPlanner : public core::RefCounted {
+ public:
+  // A tensor to place in the arena, live from position `first` to position
+  // `last` of the execution order, inclusive.
+  struct Interval {
+    size_t size;
+    int first;
+    int last;
+  };
+
+  // Assigns to each of `intervals` an offset into an arena, such that tensors
+  // that are live at the same time do not overlap, and returns the size of the
+  // arena.  Tensors are placed largest first, each into the smallest gap that
+  // holds it.  Sizes must be multiples of Allocator::kAllocatorAlignment.
+  static size_t AssignOffsets(const std::vector<Interval>& intervals,
+                              std::vector<size_t>* offsets);
+
+  // `gview` and `backing` must outlive the planner.
+  StaticMemoryPlanner(const GraphView& gview, Allocator* backing);
+
+  // Returns the allocators for the outputs of node `node_id`, indexed by
+  // output, or nullptr if none of its outputs is planned.  The entry for an
+  // output that is not planned is nullptr.
+  Allocator* const* output_allocators(int node_id) const {
+    const int start = output_start_[node_id];
+    return start < 0 ? nullptr : &output_allocators_[start];
+  }
+
+  // Plans the arena from the output sizes recorded so far, unless that has
+  // already been done.
+  void Finalize() TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the size of the arena, or 0 if there is none.
+  size_t arena_bytes() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  class OutputAllocator;
+
+  // Every live buffer handed out by an OutputAllocator holds a reference.
+  ~StaticMemoryPlanner() override;
+
+  Allocator* const backing_;
+
+  // One per planned output.
+  std::vector<std::unique_ptr<OutputAllocator>> allocators_;
+  // For each node, the index in output_allocators_ of the allocator of its
+  // first output, or -1 if none of its outputs is planned.
+  std::vector<int> output_start_;
+  std::vector<Allocator*> output_allocators_;
+
+  // Set once by Finalize().
+  std::atomic<char*> arena_{nullptr};
+
+  mutable mutex mu_;
+  bool finalized_ TF_GUARDED_BY(mu_) = false;
+  size_t arena_bytes_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticMemoryPlanner);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
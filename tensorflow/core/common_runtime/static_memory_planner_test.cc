@@ -0,0 +1,183 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/counting_allocator_test_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(StaticMemoryPlannerTest, AssignOffsets) {
+  std::vector<StaticMemoryPlanner::Interval> intervals = {
+      {128, 0, 2}, {64, 1, 3}, {128, 3, 4}, {64, 4, 5}};
+  std::vector<size_t> offsets;
+  EXPECT_EQ(StaticMemoryPlanner::AssignOffsets(intervals, &offsets), 192);
+  EXPECT_EQ(offsets, std::vector<size_t>({0, 128, 0, 128}));
+}
+
+TEST(StaticMemoryPlannerTest, AssignOffsetsRandom) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  for (int iter = 0; iter < 100; ++iter) {
+    std::vector<StaticMemoryPlanner::Interval> intervals(1 + rnd.Uniform(50));
+    size_t total_bytes = 0;
+    for (auto& t : intervals) {
+      t.size = Allocator::kAllocatorAlignment * (1 + rnd.Uniform(32));
+      t.first = rnd.Uniform(100);
+      t.last = t.first + rnd.Uniform(10);
+      total_bytes += t.size;
+    }
+    std::vector<size_t> offsets;
+    const size_t arena_bytes =
+        StaticMemoryPlanner::AssignOffsets(intervals, &offsets);
+    EXPECT_LE(arena_bytes, total_bytes);
+    for (int i = 0; i < intervals.size(); ++i) {
+      EXPECT_EQ(offsets[i] % Allocator::kAllocatorAlignment, 0);
+      EXPECT_LE(offsets[i] + intervals[i].size, arena_bytes);
+      for (int j = i + 1; j < intervals.size(); ++j) {
+        const bool live_together = intervals[i].first <= intervals[j].last &&
+                                   intervals[j].first <= intervals[i].last;
+        const bool share_memory =
+            offsets[i] < offsets[j] + intervals[j].size &&
+            offsets[j] < offsets[i] + intervals[i].size;
+        EXPECT_FALSE(live_together && share_memory) << i << " " << j;
+      }
+    }
+  }
+}
+
+class StaticMemoryPlannerGraphTest : public ::testing::Test {
+ protected:
+  // Builds a chain a -> b -> c -> d -> keep, where `keep` stands for an op
+  // that may keep its input.
+  StaticMemoryPlannerGraphTest() : graph_(OpRegistry::Global()) {
+    a_ = test::graph::Constant(&graph_, Tensor(1.0f));
+    b_ = test::graph::Unary(&graph_, "Neg", a_);
+    c_ = test::graph::Unary(&graph_, "Neg", b_);
+    d_ = test::graph::Unary(&graph_, "Neg", c_);
+    keep_ = test::graph::Unary(&graph_, "Neg", d_);
+    TF_CHECK_OK(gview_.Initialize(&graph_));
+    for (const Node* n : graph_.nodes()) {
+      gview_.node(n->id())->may_keep_inputs = n == keep_;
+    }
+    planner_.reset(new StaticMemoryPlanner(gview_, &backing_));
+  }
+
+  Allocator* output_allocator(const Node* n) {
+    Allocator* const* allocators = planner_->output_allocators(n->id());
+    return allocators == nullptr ? nullptr : allocators[0];
+  }
+
+  Graph graph_;
+  Node* a_;
+  Node* b_;
+  Node* c_;
+  Node* d_;
+  Node* keep_;
+  GraphView gview_;
+  CountingAllocator backing_;
+  core::RefCountPtr<StaticMemoryPlanner> planner_;
+};
+
+TEST_F(StaticMemoryPlannerGraphTest, PlansStepLocalOutputs) {
+  Allocator* a = output_allocator(a_);
+  Allocator* b = output_allocator(b_);
+  Allocator* c = output_allocator(c_);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  ASSERT_NE(c, nullptr);
+  // The output of `d` is consumed by `keep`, which may hold on to it.
+  EXPECT_EQ(output_allocator(d_), nullptr);
+  EXPECT_EQ(output_allocator(keep_), nullptr);
+
+  // The first step records the output sizes.
+  void* pa = a->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  void* pb = b->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  a->DeallocateRaw(pa);
+  void* pc = c->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  b->DeallocateRaw(pb);
+  c->DeallocateRaw(pc);
+  EXPECT_EQ(planner_->arena_bytes(), 0);
+  EXPECT_EQ(backing_.live(), 0);
+  planner_->Finalize();
+  // `a` and `c` are never live at the same time.
+  EXPECT_EQ(planner_->arena_bytes(), 2048);
+  EXPECT_EQ(backing_.live(), 1);
+
+  // Later steps are served from the arena.
+  char* arena = static_cast<char*>(
+      a->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  pb = b->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  EXPECT_EQ(pb, arena + 1024);
+  a->DeallocateRaw(arena);
+  pc = c->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  EXPECT_EQ(pc, arena);
+  b->DeallocateRaw(pb);
+  c->DeallocateRaw(pc);
+  EXPECT_EQ(backing_.live(), 1);
+}
+
+TEST_F(StaticMemoryPlannerGraphTest, FallsBackWhenPlanIsNotFollowed) {
+  Allocator* a = output_allocator(a_);
+  Allocator* c = output_allocator(c_);
+  a->DeallocateRaw(a->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  output_allocator(b_)->DeallocateRaw(
+      output_allocator(b_)->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  c->DeallocateRaw(c->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  planner_->Finalize();
+
+  char* arena = static_cast<char*>(
+      a->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  // `a` is still alive, for instance because a kernel forwarded it, so `c`
+  // cannot have the memory they share.
+  void* pc = c->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  EXPECT_NE(pc, arena);
+  EXPECT_EQ(backing_.live(), 2);
+  // Neither can a second use of `a` in the same step.
+  void* pa = a->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  EXPECT_NE(pa, arena);
+  // Nor a request larger than planned.
+  a->DeallocateRaw(arena);
+  c->DeallocateRaw(pc);
+  void* large = a->AllocateRaw(Allocator::kAllocatorAlignment, 2000);
+  EXPECT_NE(large, arena);
+  a->DeallocateRaw(pa);
+  a->DeallocateRaw(large);
+  EXPECT_EQ(backing_.live(), 1);
+}
+
+TEST_F(StaticMemoryPlannerGraphTest, BuffersOutliveThePlanner) {
+  Allocator* a = output_allocator(a_);
+  a->DeallocateRaw(a->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  planner_->Finalize();
+  Tensor t(a, DT_FLOAT, TensorShape({100}));
+  t.flat<float>().setConstant(2.0f);
+  planner_.reset();
+  EXPECT_EQ(t.flat<float>()(99), 2.0f);
+  EXPECT_EQ(backing_.live(), 1);
+  t = Tensor();
+  EXPECT_EQ(backing_.live(), 0);
+}
+
+}  // namespace
+}  // namespace tensorflow
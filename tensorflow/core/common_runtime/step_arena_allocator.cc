@@ -0,0 +1,184 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+#include <new>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+constexpr size_t StepArenaBlockPool::kDefaultBlockSize;
+constexpr int StepArenaBlockPool::kDefaultMaxFreeBlocks;
+
+namespace {
+
+uintptr_t RoundUp(uintptr_t n, size_t alignment) {
+  return (n + alignment - 1) & ~(alignment - 1);
+}
+
+// Offset of the first buffer in a block.
+constexpr size_t kBlockHeaderSize = Allocator::kAllocatorAlignment;
+
+}  // namespace
+
+StepArenaBlockPool::StepArenaBlockPool(Allocator* backing, size_t block_size,
+                                       int max_free_blocks)
+    : backing_(backing),
+      block_size_(block_size),
+      max_free_blocks_(max_free_blocks) {
+  static_assert(sizeof(Block) <= kBlockHeaderSize, "Block header too large");
+  CHECK_GT(block_size_, kBlockHeaderSize);
+}
+
+StepArenaBlockPool::~StepArenaBlockPool() {
+  mutex_lock l(mu_);
+  for (Block* block : free_blocks_) {
+    backing_->DeallocateRaw(block);
+  }
+}
+
+int StepArenaBlockPool::NumFreeBlocks() {
+  mutex_lock l(mu_);
+  return free_blocks_.size();
+}
+
+StepArenaBlockPool::Block* StepArenaBlockPool::GetBlock() {
+  Block* block = nullptr;
+  {
+    mutex_lock l(mu_);
+    if (!free_blocks_.empty()) {
+      block = free_blocks_.back();
+      free_blocks_.pop_back();
+    }
+  }
+  if (block == nullptr) {
+    void* ptr = backing_->AllocateRaw(Allocator::kAllocatorAlignment,
+                                      block_size_);
+    if (ptr == nullptr) return nullptr;
+    block = new (ptr) Block;
+    block->pool = this;
+  }
+  block->refs.store(1, std::memory_order_relaxed);
+  Ref();
+  return block;
+}
+
+void StepArenaBlockPool::UnrefBlock(Block* block) {
+  if (block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    block->pool->ReturnBlock(block);
+  }
+}
+
+void StepArenaBlockPool::ReturnBlock(Block* block) {
+  bool cached = false;
+  {
+    mutex_lock l(mu_);
+    if (free_blocks_.size() < static_cast<size_t>(max_free_blocks_)) {
+      free_blocks_.push_back(block);
+      cached = true;
+    }
+  }
+  if (!cached) {
+    backing_->DeallocateRaw(block);
+  }
+  // Drops the reference taken by GetBlock(), which may delete the pool.
+  Unref();
+}
+
+StepArenaAllocator::StepArenaAllocator(StepArenaBlockPool* pool)
+    : pool_(pool) {
+  pool_->Ref();
+}
+
+StepArenaAllocator::~StepArenaAllocator() {
+  DCHECK(current_ == nullptr);
+  pool_->Unref();
+}
+
+void StepArenaAllocator::Release() {
+  {
+    mutex_lock l(mu_);
+    if (current_ != nullptr) {
+      StepArenaBlockPool::UnrefBlock(current_);
+      current_ = nullptr;
+    }
+    next_ = end_ = 0;
+  }
+  Unref();
+}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  alignment = std::max(alignment, alignof(Prefix));
+  // The worst-case footprint of the request in a fresh block.
+  if (kBlockHeaderSize + sizeof(Prefix) + alignment + num_bytes >
+      pool_->block_size()) {
+    return AllocateFromBacking(alignment, num_bytes);
+  }
+  uintptr_t ptr;
+  StepArenaBlockPool::Block* block;
+  {
+    mutex_lock l(mu_);
+    ptr = RoundUp(next_ + sizeof(Prefix), alignment);
+    if (current_ == nullptr || ptr + num_bytes > end_) {
+      StepArenaBlockPool::Block* new_block = pool_->GetBlock();
+      if (new_block == nullptr) return nullptr;
+      if (current_ != nullptr) {
+        StepArenaBlockPool::UnrefBlock(current_);
+      }
+      current_ = new_block;
+      next_ = reinterpret_cast<uintptr_t>(current_) + kBlockHeaderSize;
+      end_ = reinterpret_cast<uintptr_t>(current_) + pool_->block_size();
+      ptr = RoundUp(next_ + sizeof(Prefix), alignment);
+    }
+    next_ = ptr + num_bytes;
+    block = current_;
+    block->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  Ref();
+  Prefix* prefix = reinterpret_cast<Prefix*>(ptr) - 1;
+  prefix->block = block;
+  prefix->base = nullptr;
+  return reinterpret_cast<void*>(ptr);
+}
+
+void* StepArenaAllocator::AllocateFromBacking(size_t alignment,
+                                              size_t num_bytes) {
+  const size_t offset = RoundUp(sizeof(Prefix), alignment);
+  void* base = pool_->backing()->AllocateRaw(alignment, offset + num_bytes);
+  if (base == nullptr) return nullptr;
+  Ref();
+  void* ptr = static_cast<char*>(base) + offset;
+  Prefix* prefix = static_cast<Prefix*>(ptr) - 1;
+  prefix->block = nullptr;
+  prefix->base = base;
+  return ptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) return;
+  const Prefix* prefix = static_cast<Prefix*>(ptr) - 1;
+  if (prefix->block != nullptr) {
+    StepArenaBlockPool::UnrefBlock(prefix->block);
+  } else {
+    pool_->backing()->DeallocateRaw(prefix->base);
+  }
+  // May delete this allocator if the step has ended.
+  Unref();
+}
+
+}  // namespace tensorflow
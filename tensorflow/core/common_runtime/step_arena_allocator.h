@@ -0,0 +1,143 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+class StepArenaAllocator;
+
+// A cache of fixed-size memory blocks shared by the StepArenaAllocators of
+// the steps of one executor, so that in steady state a step does not call
+// into the backing allocator at all.
+//
+// Every block handed out holds a reference on the pool, so the pool outlives
+// any buffer allocated from it.
+class StepArenaBlockPool : public core::RefCounted {
+ public:
+  static constexpr size_t kDefaultBlockSize = 256 << 10;
+  static constexpr int kDefaultMaxFreeBlocks = 64;
+
+  // 'backing' must outlive the pool.
+  StepArenaBlockPool(Allocator* backing, size_t block_size = kDefaultBlockSize,
+                     int max_free_blocks = kDefaultMaxFreeBlocks);
+
+  Allocator* backing() const { return backing_; }
+  size_t block_size() const { return block_size_; }
+
+  // Returns the number of blocks currently cached in the pool.
+  int NumFreeBlocks();
+
+ private:
+  friend class StepArenaAllocator;
+
+  ~StepArenaBlockPool() override;
+
+  // Placed at the start of every block.
+  struct Block {
+    // One reference per live buffer, plus one while the block is the current
+    // block of a StepArenaAllocator.
+    std::atomic<int64_t> refs;
+    StepArenaBlockPool* pool;
+  };
+
+  // Returns a block with one reference, or nullptr if out of memory.
+  Block* GetBlock() TF_LOCKS_EXCLUDED(mu_);
+
+  // Drops a reference on 'block', returning it to the pool when it was the
+  // last one.
+  static void UnrefBlock(Block* block);
+
+  void ReturnBlock(Block* block) TF_LOCKS_EXCLUDED(mu_);
+
+  Allocator* const backing_;
+  const size_t block_size_;
+  const int max_free_blocks_;
+
+  mutex mu_;
+  std::vector<Block*> free_blocks_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaBlockPool);
+};
+
+// An Allocator for host buffers that are expected to die within one step,
+// such as kernel temporaries.
+//
+// Buffers are carved from blocks of a StepArenaBlockPool by bumping a
+// pointer, and DeallocateRaw() only drops a reference on the block.  A block
+// goes back to the pool once the allocator has moved past it and all of its
+// buffers are freed, so the memory of a step is recycled wholesale when the
+// step calls Release().  A buffer that does outlive the step stays valid; it
+// merely keeps its block, and this allocator, alive until it is freed.
+//
+// Requests that do not fit in a block are passed through to the pool's
+// backing allocator.
+class StepArenaAllocator : public Allocator, public core::RefCounted {
+ public:
+  explicit StepArenaAllocator(StepArenaBlockPool* pool);
+
+  // Ends the step: gives up the current block and drops the reference held by
+  // the creator.  No allocation may be made after this.
+  void Release();
+
+  string Name() override { return "step_arena"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+
+  void DeallocateRaw(void* ptr) override;
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return pool_->backing()->GetMemoryType();
+  }
+
+ private:
+  // Every live buffer holds a reference, since TensorBuffer calls
+  // DeallocateRaw() on the allocator that made it.
+  ~StepArenaAllocator() override;
+
+  // Stored immediately before every buffer.
+  struct Prefix {
+    // The block of the buffer, or nullptr if it came from the backing
+    // allocator.
+    StepArenaBlockPool::Block* block;
+    // The address returned by the backing allocator, if 'block' is nullptr.
+    void* base;
+  };
+
+  void* AllocateFromBacking(size_t alignment, size_t num_bytes);
+
+  StepArenaBlockPool* const pool_;
+
+  mutex mu_;
+  StepArenaBlockPool::Block* current_ TF_GUARDED_BY(mu_) = nullptr;
+  // Unused part of current_.
+  uintptr_t next_ TF_GUARDED_BY(mu_) = 0;
+  uintptr_t end_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
@@ -0,0 +1,213 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/counting_allocator_test_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(StepArenaAllocatorTest, BumpAllocation) {
+  CountingAllocator backing;
+  core::RefCountPtr<StepArenaBlockPool> pool(
+      new StepArenaBlockPool(&backing));
+  StepArenaAllocator* a = new StepArenaAllocator(pool.get());
+
+  std::vector<void*> ptrs;
+  for (size_t alignment : {1, 8, 64, 256}) {
+    for (size_t n : {1, 100, 1000}) {
+      void* p = a->AllocateRaw(alignment, n);
+      ASSERT_NE(p, nullptr);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+      memset(p, 0xab, n);
+      ptrs.push_back(p);
+    }
+  }
+  // All of the above fit in one block.
+  EXPECT_EQ(backing.num_allocs(), 1);
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  a->Release();
+  EXPECT_EQ(pool->NumFreeBlocks(), 1);
+  EXPECT_EQ(backing.live(), 1);
+}
+
+TEST(StepArenaAllocatorTest, BlocksAreRecycledAcrossSteps) {
+  CountingAllocator backing;
+  core::RefCountPtr<StepArenaBlockPool> pool(
+      new StepArenaBlockPool(&backing, /*block_size=*/4096));
+  for (int step = 0; step < 10; ++step) {
+    StepArenaAllocator* a = new StepArenaAllocator(pool.get());
+    for (int i = 0; i < 16; ++i) {
+      a->DeallocateRaw(a->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+    }
+    a->Release();
+  }
+  // A block whose buffers are all freed goes back to the pool as soon as the
+  // allocator moves past it, so two blocks serve every step.
+  EXPECT_EQ(backing.num_allocs(), 2);
+  EXPECT_EQ(backing.live(), pool->NumFreeBlocks());
+}
+
+TEST(StepArenaAllocatorTest, BuffersOutliveTheStep) {
+  CountingAllocator backing;
+  core::RefCountPtr<StepArenaBlockPool> pool(
+      new StepArenaBlockPool(&backing, /*block_size=*/4096));
+  StepArenaAllocator* a = new StepArenaAllocator(pool.get());
+  Tensor escaping(a, DT_FLOAT, TensorShape({100}));
+  escaping.flat<float>().setConstant(3.0f);
+  a->DeallocateRaw(a->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  a->Release();
+
+  // The block is still in use by 'escaping', and a new step must not be
+  // handed the same memory.
+  EXPECT_EQ(pool->NumFreeBlocks(), 0);
+  StepArenaAllocator* b = new StepArenaAllocator(pool.get());
+  Tensor t(b, DT_FLOAT, TensorShape({100}));
+  t.flat<float>().setConstant(7.0f);
+  EXPECT_EQ(escaping.flat<float>()(99), 3.0f);
+  b->Release();
+
+  escaping = Tensor();
+  EXPECT_EQ(pool->NumFreeBlocks(), 1);
+  t = Tensor();
+  EXPECT_EQ(pool->NumFreeBlocks(), 2);
+}
+
+TEST(StepArenaAllocatorTest, LargeRequestsUseBackingAllocator) {
+  CountingAllocator backing;
+  core::RefCountPtr<StepArenaBlockPool> pool(
+      new StepArenaBlockPool(&backing, /*block_size=*/4096));
+  StepArenaAllocator* a = new StepArenaAllocator(pool.get());
+  void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 10000);
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % Allocator::kAllocatorAlignment,
+            0);
+  memset(p, 0, 10000);
+  EXPECT_EQ(backing.live(), 1);
+  EXPECT_EQ(pool->NumFreeBlocks(), 0);
+  a->Release();
+  a->DeallocateRaw(p);
+  EXPECT_EQ(backing.live(), 0);
+}
+
+TEST(StepArenaAllocatorTest, PoolKeepsAtMostMaxFreeBlocks) {
+  CountingAllocator backing;
+  core::RefCountPtr<StepArenaBlockPool> pool(new StepArenaBlockPool(
+      &backing, /*block_size=*/4096, /*max_free_blocks=*/2));
+  StepArenaAllocator* a = new StepArenaAllocator(pool.get());
+  for (int i = 0; i < 16; ++i) {
+    a->DeallocateRaw(a->AllocateRaw(Allocator::kAllocatorAlignment, 2000));
+  }
+  a->Release();
+  EXPECT_EQ(pool->NumFreeBlocks(), 2);
+  EXPECT_EQ(backing.live(), 2);
+}
+
+TEST(StepArenaAllocatorTest, MultiThreaded) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocsPerThread = 2000;
+  CountingAllocator backing;
+  core::RefCountPtr<StepArenaBlockPool> pool(
+      new StepArenaBlockPool(&backing, /*block_size=*/64 << 10));
+  thread::ThreadPool threads(Env::Default(), "test", kNumThreads);
+  for (int step = 0; step < 4; ++step) {
+    StepArenaAllocator* a = new StepArenaAllocator(pool.get());
+    BlockingCounter counter(kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      threads.Schedule([a, &counter, t]() {
+        std::vector<std::pair<char*, size_t>> live;
+        for (int i = 0; i < kNumAllocsPerThread; ++i) {
+          const size_t bytes = 1 + (i * 7919 + t) % 20000;
+          char* p = static_cast<char*>(
+              a->AllocateRaw(Allocator::kAllocatorAlignment, bytes));
+          CHECK(p != nullptr);
+          memset(p, t, bytes);
+          live.emplace_back(p, bytes);
+          if (live.size() > 8) {
+            // No other thread wrote into this buffer while it was live.
+            const auto& buffer = live.front();
+            CHECK_EQ(buffer.first[0], static_cast<char>(t));
+            CHECK_EQ(buffer.first[buffer.second - 1], static_cast<char>(t));
+            a->DeallocateRaw(buffer.first);
+            live.erase(live.begin());
+          }
+        }
+        for (const auto& buffer : live) {
+          a->DeallocateRaw(buffer.first);
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    a->Release();
+    EXPECT_EQ(backing.live(), pool->NumFreeBlocks());
+  }
+}
+
+// Allocates and frees the temporaries of kNumNodes kernels per step, from
+// 'num_threads' threads.  The second argument selects the allocator: 0 for
+// cpu_allocator(), 1 for a StepArenaAllocator created for every step.
+void BM_StepTemporaries(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const bool use_arena = state.range(1);
+  constexpr int kNumNodes = 64;
+  core::RefCountPtr<StepArenaBlockPool> pool(
+      new StepArenaBlockPool(cpu_allocator()));
+  thread::ThreadPool threads(Env::Default(), "test", num_threads);
+
+  for (auto s : state) {
+    StepArenaAllocator* arena =
+        use_arena ? new StepArenaAllocator(pool.get()) : nullptr;
+    Allocator* a = use_arena ? static_cast<Allocator*>(arena)
+                             : cpu_allocator();
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      threads.Schedule([a, &counter]() {
+        const size_t sizes[] = {256, 4096, 1000, 16 << 10, 48, 12288, 512};
+        for (int i = 0; i < kNumNodes; ++i) {
+          void* p1 = a->AllocateRaw(64, sizes[i % 7]);
+          void* p2 = a->AllocateRaw(64, sizes[(i + 3) % 7]);
+          a->DeallocateRaw(p2);
+          a->DeallocateRaw(p1);
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    if (arena != nullptr) arena->Release();
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads * kNumNodes * 2);
+}
+BENCHMARK(BM_StepTemporaries)
+    ->UseRealTime()
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(8, 0)
+    ->ArgPair(8, 1);
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,154 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/work_stealing_scheduler.h"
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+// The scheduler and deque of the worker running on this thread, if any.
+struct CurrentWorker {
+  const WorkStealingScheduler* scheduler;
+  int id;
+};
+thread_local CurrentWorker current_worker = {nullptr, -1};
+
+}  // namespace
+
+WorkStealingScheduler::WorkStealingScheduler(int num_workers, Runner runner)
+    : num_workers_(num_workers),
+      runner_(std::move(runner)),
+      queues_(new Queue[num_workers]),
+      active_(new std::atomic<bool>[num_workers]) {
+  CHECK_GT(num_workers, 0);
+  for (int i = 0; i < num_workers; ++i) {
+    active_[i].store(false, std::memory_order_relaxed);
+  }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() {
+  DCHECK_EQ(num_queued_.load(), 0);
+}
+
+void WorkStealingScheduler::Schedule(Closure task) {
+  if (current_worker.scheduler == this) {
+    // Keep the task on this core; another worker may steal it if this one is
+    // busy for long.
+    Push(current_worker.id, std::move(task));
+    MaybeStartIdleWorker();
+    return;
+  }
+  const int id =
+      next_queue_.fetch_add(1, std::memory_order_relaxed) % num_workers_;
+  Push(id, std::move(task));
+  if (!MaybeStartWorker(id)) {
+    // The owner of the deque may be busy running a long task.
+    MaybeStartIdleWorker();
+  }
+}
+
+void WorkStealingScheduler::Push(int id, Closure task) {
+  Queue& q = queues_[id];
+  mutex_lock l(q.mu);
+  q.tasks.push_back(std::move(task));
+  num_queued_.fetch_add(1, std::memory_order_seq_cst);
+}
+
+bool WorkStealingScheduler::PopBack(int id, Closure* task) {
+  Queue& q = queues_[id];
+  mutex_lock l(q.mu);
+  if (q.tasks.size() == q.head) return false;
+  *task = std::move(q.tasks.back());
+  q.tasks.pop_back();
+  if (q.tasks.size() == q.head) {
+    q.tasks.clear();
+    q.head = 0;
+  }
+  num_queued_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool WorkStealingScheduler::Steal(int thief, Closure* task) {
+  for (int i = 1; i < num_workers_; ++i) {
+    if (num_queued_.load(std::memory_order_relaxed) == 0) return false;
+    Queue& q = queues_[(thief + i) % num_workers_];
+    mutex_lock l(q.mu);
+    if (q.tasks.size() == q.head) continue;
+    *task = std::move(q.tasks[q.head++]);
+    if (q.tasks.size() == q.head) {
+      q.tasks.clear();
+      q.head = 0;
+    }
+    num_queued_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+bool WorkStealingScheduler::MaybeStartWorker(int id) {
+  bool expected = false;
+  if (active_[id].load(std::memory_order_seq_cst) ||
+      !active_[id].compare_exchange_strong(expected, true,
+                                           std::memory_order_seq_cst)) {
+    return false;
+  }
+  num_active_.fetch_add(1, std::memory_order_relaxed);
+  Ref();
+  runner_([this, id]() { WorkerLoop(id); });
+  return true;
+}
+
+void WorkStealingScheduler::MaybeStartIdleWorker() {
+  if (num_active_.load(std::memory_order_relaxed) >= num_workers_) return;
+  const unsigned start = next_queue_.fetch_add(1, std::memory_order_relaxed);
+  for (int i = 0; i < num_workers_; ++i) {
+    if (MaybeStartWorker((start + i) % num_workers_)) return;
+  }
+}
+
+void WorkStealingScheduler::WorkerLoop(int id) {
+  // `runner_` may run the worker inline, from within another worker.
+  const CurrentWorker saved = current_worker;
+  current_worker = {this, id};
+  Closure task;
+  while (true) {
+    if (PopBack(id, &task) || Steal(id, &task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    active_[id].store(false, std::memory_order_seq_cst);
+    num_active_.fetch_sub(1, std::memory_order_relaxed);
+    // A task pushed to this deque while the worker was running did not start
+    // another one, so look again after giving up the deque.
+    if (num_queued_.load(std::memory_order_seq_cst) == 0) break;
+    bool expected = false;
+    if (!active_[id].compare_exchange_strong(expected, true,
+                                             std::memory_order_seq_cst)) {
+      // Another worker took over the deque.
+      break;
+    }
+    num_active_.fetch_add(1, std::memory_order_relaxed);
+  }
+  current_worker = saved;
+  // Tasks may have deleted their owner, but not the scheduler while this
+  // worker holds a reference.
+  Unref();
+}
+
+}  // namespace tensorflow
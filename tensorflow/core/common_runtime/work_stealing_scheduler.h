@@ -0,0 +1,92 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Runs closures on up to `num_workers` workers, each of which is a closure
+// passed to `runner` that keeps running tasks until there are none left.
+//
+// Every worker owns a deque.  A task scheduled from a worker goes to the back
+// of that worker's deque and the worker runs its own tasks newest first, so
+// the successors of a node tend to run on the core that produced their
+// inputs.  An idle worker steals the oldest task of another worker's deque.
+// Tasks scheduled from outside the workers are spread over the deques round
+// robin.
+//
+// A worker that finds no task returns its thread to `runner`, so the
+// scheduler never blocks a thread while it is idle.
+class WorkStealingScheduler : public core::RefCounted {
+ public:
+  typedef std::function<void()> Closure;
+  typedef std::function<void(Closure)> Runner;
+
+  WorkStealingScheduler(int num_workers, Runner runner);
+
+  // Runs `task` on one of the workers, starting one if needed.
+  void Schedule(Closure task);
+
+  int num_workers() const { return num_workers_; }
+
+ private:
+  // Workers hold a reference while they run.
+  ~WorkStealingScheduler() override;
+
+  struct Queue {
+    mutex mu;
+    // The owner pushes and pops at the back, thieves pop at `head`.
+    std::vector<Closure> tasks TF_GUARDED_BY(mu);
+    size_t head TF_GUARDED_BY(mu) = 0;
+  };
+
+  void Push(int id, Closure task);
+  bool PopBack(int id, Closure* task);
+  bool Steal(int thief, Closure* task);
+
+  // Starts a worker on deque `id` unless one is running.  Returns true if it
+  // started one.
+  bool MaybeStartWorker(int id);
+  // Starts a worker on any free deque if fewer than all are running.
+  void MaybeStartIdleWorker();
+
+  void WorkerLoop(int id);
+
+  const int num_workers_;
+  const Runner runner_;
+  std::unique_ptr<Queue[]> queues_;
+  // Whether a worker is running on each deque.
+  std::unique_ptr<std::atomic<bool>[]> active_;
+  std::atomic<int> num_active_{0};
+  // The number of tasks in all deques.
+  std::atomic<int64_t> num_queued_{0};
+  std::atomic<unsigned> next_queue_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(WorkStealingScheduler);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
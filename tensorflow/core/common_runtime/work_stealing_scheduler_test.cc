@@ -0,0 +1,98 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/work_stealing_scheduler.h"
+
+#include <atomic>
+#include <functional>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(WorkStealingSchedulerTest, RunsAllTasks) {
+  thread::ThreadPool threads(Env::Default(), "test", 4);
+  core::RefCountPtr<WorkStealingScheduler> scheduler(new WorkStealingScheduler(
+      4, [&threads](std::function<void()> c) { threads.Schedule(c); }));
+  constexpr int kNumTasks = 10000;
+  std::atomic<int> count{0};
+  BlockingCounter counter(kNumTasks);
+  for (int i = 0; i < kNumTasks; ++i) {
+    scheduler->Schedule([&count, &counter]() {
+      count.fetch_add(1);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  EXPECT_EQ(count.load(), kNumTasks);
+}
+
+TEST(WorkStealingSchedulerTest, TasksScheduleSuccessors) {
+  thread::ThreadPool threads(Env::Default(), "test", 4);
+  core::RefCountPtr<WorkStealingScheduler> scheduler(new WorkStealingScheduler(
+      4, [&threads](std::function<void()> c) { threads.Schedule(c); }));
+  // Every task below depth 10 schedules two more, as a node with two expensive
+  // successors would.
+  constexpr int kDepth = 10;
+  BlockingCounter counter((1 << (kDepth + 1)) - 1);
+  std::function<void(int)> task = [&](int depth) {
+    if (depth < kDepth) {
+      scheduler->Schedule([&task, depth]() { task(depth + 1); });
+      scheduler->Schedule([&task, depth]() { task(depth + 1); });
+    }
+    counter.DecrementCount();
+  };
+  scheduler->Schedule([&task]() { task(0); });
+  counter.Wait();
+}
+
+TEST(WorkStealingSchedulerTest, InlineRunner) {
+  // With a runner that runs closures inline a worker may start another one
+  // on the same thread; every task must still run exactly once.
+  core::RefCountPtr<WorkStealingScheduler> scheduler(new WorkStealingScheduler(
+      2, [](std::function<void()> c) { c(); }));
+  int count = 0;
+  std::function<void(int)> task = [&](int depth) {
+    ++count;
+    if (depth < 5) {
+      scheduler->Schedule([&task, depth]() { task(depth + 1); });
+      scheduler->Schedule([&task, depth]() { task(depth + 1); });
+    }
+  };
+  scheduler->Schedule([&task]() { task(0); });
+  EXPECT_EQ(count, 63);
+}
+
+TEST(WorkStealingSchedulerTest, SchedulerOutlivesItsOwner) {
+  thread::ThreadPool threads(Env::Default(), "test", 2);
+  Notification done;
+  WorkStealingScheduler* scheduler = new WorkStealingScheduler(
+      2, [&threads](std::function<void()> c) { threads.Schedule(c); });
+  scheduler->Schedule([scheduler, &done]() {
+    // The last task drops the owner's reference, as a finishing executor
+    // step does; the running worker keeps the scheduler alive.
+    scheduler->Unref();
+    done.Notify();
+  });
+  done.WaitForNotification();
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -192,9 +192,10 @@ StatusOr<std::string> CompressAndSerialize(const std::vector<Tensor>& tensors) {
 }
 
 StatusOr<std::vector<Tensor>> DeserializeAndUncompress(
-    const std::string& serialized_tensors) {
+    StringPiece serialized_tensors) {
   CompressedElement compressed_tensors;
-  if (!compressed_tensors.ParseFromString(serialized_tensors)) {
+  if (!compressed_tensors.ParseFromArray(serialized_tensors.data(),
+                                         serialized_tensors.size())) {
     return errors::Internal("Failed to deserialize compressed Tensors: ",
                             serialized_tensors);
   }
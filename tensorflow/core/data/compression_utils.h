@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/stringpiece.h"
 
 namespace tensorflow {
 namespace data {
@@ -44,7 +45,7 @@ StatusOr<std::string> CompressAndSerialize(const std::vector<Tensor>& tensors);
 
 // Deserializes and uncompresses Tensors.
 StatusOr<std::vector<Tensor>> DeserializeAndUncompress(
-    const std::string& serialized_tensors);
+    StringPiece serialized_tensors);
 
 }  // namespace data
 }  // namespace tensorflow
@@ -884,6 +884,12 @@ bool ShouldUsePrivateThreadPool(const Options& options) {
          ThreadingOptions::kPrivateThreadpoolSize;
 }
 
+bool ShouldUseNumaAwareThreading(const Options& options) {
+  return options.threading_options().optional_numa_aware_case() ==
+             ThreadingOptions::kNumaAware &&
+         options.threading_options().numa_aware();
+}
+
 bool ShouldUseAutotuning(const Options& options) {
   return options.autotune_options().optional_enabled_case() !=
              AutotuneOptions::kEnabled ||
@@ -21,12 +21,19 @@ limitations under the License.
 #include <utility>
 
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/hash_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/rewrite_utils.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/data/unbounded_thread_pool.h"
 #include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/stringprintf.h"
 
 namespace tensorflow {
@@ -37,13 +44,16 @@ constexpr char kDatasetType[] = "Root";
 
 constexpr char kAlgorithm[] = "algorithm";
 constexpr char kCpuBudget[] = "cpu_budget";
+constexpr char kEnforceRamBudget[] = "enforce_ram_budget";
 constexpr char kExperiments[] = "experiments";
 constexpr char kInjectPrefetchEligibleOpt[] = "inject_prefetch_eligible";
 constexpr char kIntraOpParallelism[] = "intra_op_parallelism";
 constexpr char kMemBandwidth[] = "mem_bw_used_megabytes_per_sec";
+constexpr char kNumaNodes[] = "numa_nodes";
 constexpr char kPrivateThreadpoolSize[] = "threadpool_size";
 constexpr char kRamBudget[] = "ram_budget_megabytes";
 constexpr char kRamUsage[] = "ram_usage_megabytes";
+constexpr char kStateDir[] = "autotune_state_dir";
 constexpr char kMaxBufferBytes[] = "max_buffered_megabytes";
 
 // If value `x` matches `y`, returns default value `z`. Otherwise, return `x`.
@@ -60,6 +70,7 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
     params->private_threadpool_size =
         options.threading_options().private_threadpool_size();
   }
+  params->numa_aware = ShouldUseNumaAwareThreading(options);
   params->autotune = ShouldUseAutotuning(options);
   if (params->autotune) {
     params->autotune_algorithm = model::AutotuneAlgorithm::DEFAULT;
@@ -76,6 +87,9 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
     params->autotune_ram_budget =
         value_or_default(options.autotune_options().ram_budget(), 0,
                          model::kRamBudgetShare * port::AvailableRam());
+    params->autotune_enforce_ram_budget =
+        options.autotune_options().enforce_ram_budget();
+    params->autotune_state_dir = options.autotune_options().state_dir();
   }
 }
 
@@ -91,6 +105,13 @@ void AddTraceMetadata(const RootDataset::Params& params,
         kRamBudget,
         strings::Printf("%lld", static_cast<long long>(
                                     params.autotune_ram_budget / 1.0e6))));
+    if (params.autotune_enforce_ram_budget) {
+      trace_metadata->push_back(std::make_pair(kEnforceRamBudget, "true"));
+    }
+    if (!params.autotune_state_dir.empty()) {
+      trace_metadata->push_back(
+          std::make_pair(kStateDir, params.autotune_state_dir));
+    }
   }
   if (params.max_intra_op_parallelism >= 0) {
     trace_metadata->push_back(std::make_pair(
@@ -106,6 +127,10 @@ void AddTraceMetadata(const RootDataset::Params& params,
                                     params.private_threadpool_size, 0,
                                     port::MaxParallelism())))));
   }
+  if (params.numa_aware) {
+    trace_metadata->push_back(std::make_pair(
+        kNumaNodes, strings::Printf("%d", port::NUMANumNodes())));
+  }
   auto experiments = GetExperiments();
   if (!experiments.empty()) {
     trace_metadata->push_back(
@@ -142,19 +167,40 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       if (GetExperiments().contains("autotune_buffer_optimization")) {
         model_->SetExperiment("autotune_buffer_optimization");
       }
+      model_->SetEnforceRamBudget(
+          dataset()->params_.autotune_enforce_ram_budget);
     }
     if (dataset()->params_.max_intra_op_parallelism >= 0) {
       max_intra_op_parallelism_ =
           value_or_default(dataset()->params_.max_intra_op_parallelism, 0,
                            port::MaxParallelism());
     }
+    const int num_numa_nodes =
+        dataset()->params_.numa_aware ? port::NUMANumNodes() : 1;
+    if (num_numa_nodes > 1) {
+      numa_thread_pool_ = std::make_unique<UnboundedThreadPool>(
+          Env::Default(), "tf_data_numa", num_numa_nodes);
+    }
     if (dataset()->params_.private_threadpool_size >= 0) {
       threadpool_size_ =
           value_or_default(dataset()->params_.private_threadpool_size, 0,
                            port::MaxParallelism());
-      thread_pool_ = std::make_unique<thread::ThreadPool>(
-          Env::Default(), ThreadOptions{}, "data_private_threadpool",
-          threadpool_size_);
+      if (numa_thread_pool_) {
+        // Split the private threadpool into one pool per NUMA node so that
+        // parallel work runs on the node of the thread that schedules it.
+        for (int node = 0; node < num_numa_nodes; ++node) {
+          ThreadOptions thread_options;
+          thread_options.numa_node = node;
+          numa_thread_pools_.push_back(std::make_unique<thread::ThreadPool>(
+              Env::Default(), thread_options,
+              strings::StrCat("data_private_threadpool_numa", node),
+              std::max<int64_t>(threadpool_size_ / num_numa_nodes, 1)));
+        }
+      } else {
+        thread_pool_ = std::make_unique<thread::ThreadPool>(
+            Env::Default(), ThreadOptions{}, "data_private_threadpool",
+            threadpool_size_);
+      }
     }
     cancellation_manager_ = std::make_unique<CancellationManager>();
   }
@@ -162,6 +208,13 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
   ~Iterator() override { cancellation_manager_->StartCancel(); }
 
   Status Initialize(IteratorContext* ctx) override {
+    if (model_ != nullptr && !dataset()->params_.autotune_state_dir.empty()) {
+      Status s = SetUpAutotuneState(ctx);
+      if (!s.ok()) {
+        LOG(WARNING) << "Failed to set up persistent tf.data autotune state in "
+                     << dataset()->params_.autotune_state_dir << ": " << s;
+      }
+    }
     return dataset()->input_->MakeIterator(IteratorContext(CreateParams(ctx)),
                                            this, prefix(), &input_impl_);
   }
@@ -239,7 +292,15 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     if (dataset()->params_.autotune) {
       params.model = model_;
     }
-    if (dataset()->params_.private_threadpool_size >= 0) {
+    if (!numa_thread_pools_.empty()) {
+      params.runner = [this](std::function<void()> c) {
+        numa_thread_pools_[numa_thread_pool_->NextNumaNode()]->Schedule(
+            std::move(c));
+      };
+      // Each closure runs on a single node's pool, so that is the parallelism
+      // it can count on.
+      params.runner_threadpool_size = numa_thread_pools_[0]->NumThreads();
+    } else if (dataset()->params_.private_threadpool_size >= 0) {
       params.runner = [pool = thread_pool_.get()](std::function<void()> c) {
         pool->Schedule(std::move(c));
       };
@@ -249,10 +310,62 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       params.runner =
           RunnerWithMaxParallelism(params.runner, max_intra_op_parallelism_);
     }
+    if (numa_thread_pool_) {
+      params.thread_factory = numa_thread_pool_->get_thread_factory();
+      params.thread_pool = numa_thread_pool_.get();
+      if (ctx->flr() != nullptr &&
+          ctx->flr()->device()->device_type() == DEVICE_CPU) {
+        // Allocate element buffers on the NUMA node of the producing thread,
+        // which is the node its consumer within the pipeline runs on. Requests
+        // with non-default attributes (e.g. GPU-compatible or scoped memory)
+        // still go to the device's own allocator.
+        params.allocator_getter = [getter = params.allocator_getter](
+                                      AllocatorAttributes attrs) {
+          if (attrs.value != 0 || attrs.scope_id != 0) {
+            return getter(attrs);
+          }
+          const int node = port::NUMAGetThreadNodeAffinity();
+          if (node == port::kNUMANoAffinity) {
+            return getter(attrs);
+          }
+          return cpu_allocator(node);
+        };
+      }
+    }
     params.options = &dataset()->options();
     return params;
   }
 
+  // Restores the parameter values tuned by an earlier run of the same input
+  // pipeline, and makes the model save the values it tunes for the next run.
+  // Runs are matched by the fingerprint of the input dataset graph, which
+  // leaves out random seeds and the contents of data tensors.
+  Status SetUpAutotuneState(IteratorContext* ctx) {
+    std::vector<std::pair<string, Tensor>> input_list;
+    SerializationContext::Params params;
+    params.input_list = &input_list;
+    params.external_state_policy = ExternalStatePolicy::POLICY_IGNORE;
+    params.is_graph_rewrite = true;
+    params.resource_mgr = ctx->resource_mgr();
+    GraphDef graph_def;
+    TF_RETURN_IF_ERROR(AsGraphDef(dataset()->input_,
+                                  SerializationContext(params), &graph_def));
+    uint64 fingerprint;
+    TF_RETURN_IF_ERROR(HashGraph(graph_def, &fingerprint));
+    const std::string& state_dir = dataset()->params_.autotune_state_dir;
+    TF_RETURN_IF_ERROR(ctx->env()->RecursivelyCreateDir(state_dir));
+    const std::string fname = io::JoinPath(
+        state_dir,
+        strings::Printf("%016llx.autotune",
+                        static_cast<unsigned long long>(fingerprint)));
+    if (ctx->env()->FileExists(fname).ok()) {
+      TF_RETURN_IF_ERROR(model_->RestoreTunedParameters(fname));
+      VLOG(1) << "Restored tuned tf.data parameters from " << fname;
+    }
+    model_->SetTunedParametersFile(fname);
+    return OkStatus();
+  }
+
   Status EnsureModelThreadStarted(IteratorContext* ctx) {
     mutex_lock l(mu_);
     if (!model_thread_) {
@@ -279,6 +392,10 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
   int64_t max_intra_op_parallelism_;
   int64_t threadpool_size_;
   std::unique_ptr<thread::ThreadPool> thread_pool_;
+  // Set when the dataset runs NUMA-aware on a host with multiple NUMA nodes.
+  // `numa_thread_pools_` holds one private threadpool per node.
+  std::unique_ptr<UnboundedThreadPool> numa_thread_pool_;
+  std::vector<std::unique_ptr<thread::ThreadPool>> numa_thread_pools_;
 
   // The end time of the previous `GetNextInternal` call.
   uint64_t end_time_usec_ TF_GUARDED_BY(mu_) = 0;
@@ -32,8 +32,11 @@ class RootDataset : public DatasetBase {
     model::AutotuneAlgorithm autotune_algorithm;
     int64_t autotune_cpu_budget = 0;
     int64_t autotune_ram_budget = 0;
+    bool autotune_enforce_ram_budget = false;
+    std::string autotune_state_dir;
     int64_t max_intra_op_parallelism = 1;
     int64_t private_threadpool_size = 0;
+    bool numa_aware = false;
   };
 
   static Status FromOptions(const DatasetBase* input, DatasetBase** output);
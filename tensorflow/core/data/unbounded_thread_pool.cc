@@ -19,7 +19,9 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/resource.h"
+#include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/unbounded_work_queue.h"
 
 namespace tensorflow {
@@ -65,6 +67,21 @@ class UnboundedThreadPool::LogicalThreadFactory : public ThreadFactory {
   UnboundedThreadPool* const pool_;  // Not owned.
 };
 
+UnboundedThreadPool::UnboundedThreadPool(Env* env, const string& thread_name,
+                                         int num_numa_nodes)
+    : unbounded_work_queue_(env, thread_name) {
+  if (num_numa_nodes <= 1) {
+    return;
+  }
+  numa_work_queues_.reserve(num_numa_nodes);
+  for (int node = 0; node < num_numa_nodes; ++node) {
+    ThreadOptions thread_options;
+    thread_options.numa_node = node;
+    numa_work_queues_.push_back(std::make_unique<UnboundedWorkQueue>(
+        env, strings::StrCat(thread_name, "_numa", node), thread_options));
+  }
+}
+
 std::shared_ptr<ThreadFactory> UnboundedThreadPool::get_thread_factory() {
   return std::make_shared<LogicalThreadFactory>(this);
 }
@@ -81,6 +98,18 @@ int UnboundedThreadPool::NumThreads() const { return -1; }
 
 int UnboundedThreadPool::CurrentThreadId() const { return -1; }
 
+int UnboundedThreadPool::NextNumaNode() {
+  if (numa_work_queues_.empty()) {
+    return port::kNUMANoAffinity;
+  }
+  const int node = port::NUMAGetThreadNodeAffinity();
+  if (node >= 0 && node < NumNumaNodes()) {
+    return node;
+  }
+  return next_numa_node_.fetch_add(1, std::memory_order_relaxed) %
+         NumNumaNodes();
+}
+
 namespace {
 void WorkQueueFunc(const std::function<void()>& fn,
                    std::shared_ptr<Notification> done) {
@@ -93,7 +122,11 @@ void WorkQueueFunc(const std::function<void()>& fn,
 
 void UnboundedThreadPool::ScheduleOnWorkQueue(
     std::function<void()> fn, std::shared_ptr<Notification> done) {
-  unbounded_work_queue_.Schedule(
+  UnboundedWorkQueue* work_queue = &unbounded_work_queue_;
+  if (!numa_work_queues_.empty()) {
+    work_queue = numa_work_queues_[NextNumaNode()].get();
+  }
+  work_queue->Schedule(
       std::bind(&WorkQueueFunc, std::move(fn), std::move(done)));
 }
 
@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_UNBOUNDED_THREAD_POOL_H_
 #define TENSORFLOW_CORE_DATA_UNBOUNDED_THREAD_POOL_H_
 
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <vector>
@@ -32,6 +33,12 @@ namespace data {
 // potentially large number of "logical" threads onto a smaller number of
 // "physical" threads. The multiplexing is achieved by using an
 // `UnboundedWorkQueue`.
+//
+// A pool created with `num_numa_nodes` > 1 keeps one work queue per NUMA node,
+// whose physical threads are pinned to that node. Work started from a thread
+// that is pinned to a node stays on that node, so a logical thread and
+// everything it schedules share a node. Work started from an unpinned thread
+// is spread over the nodes in round-robin order.
 class UnboundedThreadPool : public thread::ThreadPoolInterface {
  public:
   UnboundedThreadPool(Env* env, const string& thread_name)
@@ -39,6 +46,7 @@ class UnboundedThreadPool : public thread::ThreadPoolInterface {
   UnboundedThreadPool(Env* env, const string& thread_name,
                       const ThreadOptions& thread_options)
       : unbounded_work_queue_(env, thread_name, thread_options) {}
+  UnboundedThreadPool(Env* env, const string& thread_name, int num_numa_nodes);
   ~UnboundedThreadPool() override = default;
 
   // Returns an implementation of `ThreadFactory` that can be used to create
@@ -49,6 +57,16 @@ class UnboundedThreadPool : public thread::ThreadPoolInterface {
   int NumThreads() const override;
   int CurrentThreadId() const override;
 
+  // Returns the number of NUMA nodes this pool spreads its work over, or 0 if
+  // the pool is not NUMA-aware.
+  int NumNumaNodes() const {
+    return static_cast<int>(numa_work_queues_.size());
+  }
+
+  // Returns the NUMA node that work started from the calling thread is run on,
+  // or `port::kNUMANoAffinity` if the pool is not NUMA-aware.
+  int NextNumaNode();
+
  private:
   class LogicalThreadFactory;
   class LogicalThreadWrapper;
@@ -57,6 +75,8 @@ class UnboundedThreadPool : public thread::ThreadPoolInterface {
                            std::shared_ptr<Notification> done);
 
   UnboundedWorkQueue unbounded_work_queue_;
+  std::vector<std::unique_ptr<UnboundedWorkQueue>> numa_work_queues_;
+  std::atomic<int> next_numa_node_{0};
 };
 
 }  // namespace data
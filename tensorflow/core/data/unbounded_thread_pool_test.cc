@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -79,6 +80,58 @@ TEST(UnboundedThreadPool, MultipleBlockingThreads) {
   }
 }
 
+TEST(UnboundedThreadPool, NumaNodes) {
+  UnboundedThreadPool pool(Env::Default(), "test");
+  EXPECT_EQ(pool.NumNumaNodes(), 0);
+  EXPECT_EQ(pool.NextNumaNode(), port::kNUMANoAffinity);
+
+  UnboundedThreadPool single_node_pool(Env::Default(), "test",
+                                       /*num_numa_nodes=*/1);
+  EXPECT_EQ(single_node_pool.NumNumaNodes(), 0);
+
+  // The test thread is not pinned to a node, so work started from it is
+  // spread over the nodes.
+  const int kNumNumaNodes = 2;
+  UnboundedThreadPool numa_pool(Env::Default(), "test", kNumNumaNodes);
+  EXPECT_EQ(numa_pool.NumNumaNodes(), kNumNumaNodes);
+  std::vector<int> counts(kNumNumaNodes, 0);
+  for (int i = 0; i < 2 * kNumNumaNodes; ++i) {
+    const int node = numa_pool.NextNumaNode();
+    ASSERT_GE(node, 0);
+    ASSERT_LT(node, kNumNumaNodes);
+    ++counts[node];
+  }
+  EXPECT_THAT(counts, ::testing::Each(2));
+}
+
+TEST(UnboundedThreadPool, NumaConcurrentThreadCreation) {
+  UnboundedThreadPool pool(Env::Default(), "test", /*num_numa_nodes=*/2);
+  auto thread_factory = pool.get_thread_factory();
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  const int kNumThreadsToCreate = 10;
+  std::atomic<int> i(0);
+  for (int j = 0; j < kNumThreadsToCreate; ++j) {
+    threads.push_back(thread_factory->StartThread("", [=, &i,
+                                                       &thread_factory]() {
+      std::vector<std::unique_ptr<Thread>> nested_threads;
+      for (int k = 0; k < kNumThreadsToCreate; ++k) {
+        nested_threads.push_back(
+            thread_factory->StartThread("", [&i]() { ++i; }));
+      }
+      nested_threads.clear();
+    }));
+  }
+  threads.clear();
+  BlockingCounter counter(kNumThreadsToCreate);
+  for (int j = 0; j < kNumThreadsToCreate; ++j) {
+    pool.Schedule([&counter]() { counter.DecrementCount(); });
+  }
+  counter.Wait();
+
+  EXPECT_EQ(i, kNumThreadsToCreate * kNumThreadsToCreate);
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
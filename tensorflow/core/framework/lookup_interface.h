@@ -75,6 +75,16 @@ class LookupInterface : public ResourceBase {
   // - Unimplemented: if the table does not support removals.
   virtual Status Remove(OpKernelContext* ctx, const Tensor& keys) = 0;
 
+  // Hints that the given keys are about to be looked up. Tables that keep
+  // part of their contents in a slower tier, such as local disk, can start
+  // moving those keys into memory in the background. The call does not block
+  // on that work and does not change the result of any later operation.
+  //
+  // The default implementation does nothing.
+  virtual Status Prefetch(OpKernelContext* ctx, const Tensor& keys) {
+    return OkStatus();
+  }
+
   // Returns the number of elements in the table.
   virtual size_t size() const = 0;
 
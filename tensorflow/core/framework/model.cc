@@ -35,6 +35,7 @@ namespace model {
 
 constexpr int64_t Model::kOptimizationPeriodMinMs;
 constexpr int64_t Model::kOptimizationPeriodMaxMs;
+constexpr int64_t Model::kTunedParametersSavePeriodMs;
 
 namespace {
 
@@ -47,6 +48,28 @@ constexpr uint64_t kGapDurationThresholdUsec = 10000000;  // 10 seconds
 // deviations are considered outliers.
 constexpr double kOutlierSigmas = 2.0;
 
+// Returns the stable name of the input `name` of a node whose stable name is
+// `parent`, given that `index` earlier inputs of that node have the same name.
+string StableInputName(const string& parent, const string& name, int index) {
+  if (index == 0) return strings::StrCat(parent, "::", name);
+  return strings::StrCat(parent, "::", name, "[", index, "]");
+}
+
+// Returns a name of `node` that, unlike its id, is the same across runs of
+// the same input pipeline: the names of the nodes on the path from the output
+// node, with each name that is shared with earlier inputs of the same node
+// followed by their number.
+string StableName(const Node& node) {
+  const Node* parent = node.output();
+  if (parent == nullptr) return node.name();
+  int index = 0;
+  for (const auto& input : parent->inputs()) {
+    if (input.get() == &node) break;
+    if (input->name() == node.name()) ++index;
+  }
+  return StableInputName(StableName(*parent), node.name(), index);
+}
+
 // A class to prune outliers given a set of points. To use it, instantiate an
 // object and call the `GetCleanPoints()` method.
 class OutlierPruner {
@@ -1644,6 +1667,61 @@ double Node::TotalMaximumBufferedBytes() const {
   return total_bytes[long_name()];
 }
 
+double Node::TotalRamUsage() const {
+  tf_shared_lock l(mu_);
+  double total_bytes = RamUsageLocked();
+  for (const auto& node : CollectNodesLocked(TraversalOrder::BFS, IsAnyNode)) {
+    tf_shared_lock l(node->mu_);
+    total_bytes += node->RamUsageLocked();
+  }
+  return total_bytes;
+}
+
+std::shared_ptr<Parameter> Node::BufferedBytesParameter(
+    double* bytes_per_unit) const {
+  tf_shared_lock l(mu_);
+  std::shared_ptr<Parameter> parameter = TunableBufferParameterLocked();
+  if (parameter == nullptr || parameter->value <= 0) {
+    return nullptr;
+  }
+  *bytes_per_unit = MaximumBufferedBytes() / parameter->value;
+  return parameter;
+}
+
+std::shared_ptr<Parameter> Node::TunableBufferParameterLocked() const {
+  // The parameter that `MaximumBufferedBytes()` is computed from.
+  for (const char* name : {kMaxBufferedElements, kBufferSize, kParallelism}) {
+    auto* parameter = gtl::FindOrNull(parameters_, name);
+    if (parameter == nullptr) {
+      continue;
+    }
+    if ((*parameter)->state == nullptr || !(*parameter)->state->tunable) {
+      return nullptr;
+    }
+    return *parameter;
+  }
+  return nullptr;
+}
+
+void Node::SetTunableParameterValues(
+    const absl::flat_hash_map<string, double>& values) {
+  ModelParameters parameters;
+  {
+    tf_shared_lock l(mu_);
+    for (const auto& [name, parameter] : parameters_) {
+      const double* value = gtl::FindOrNull(values, name);
+      if (value == nullptr || parameter->state == nullptr ||
+          !parameter->state->tunable) {
+        continue;
+      }
+      parameter->value =
+          std::min(std::max(*value, parameter->min), parameter->max);
+      parameters.push_back(std::make_pair(long_name(), parameter));
+    }
+  }
+  UpdateStateValues(&parameters);
+}
+
 double Node::TotalProcessingTime(Node::NodeValues* processing_times) {
   // Create a hash map to store the per-element CPU time spent in the subtree
   // rooted in each node.
@@ -1995,6 +2073,17 @@ double Node::MaximumBufferedBytes() const TF_SHARED_LOCKS_REQUIRED(mu_) {
   return 0;
 }
 
+double Node::RamUsageLocked() const TF_SHARED_LOCKS_REQUIRED(mu_) {
+  // The buffer of a tunable node is bounded by its parameter. Its measured
+  // bytes lag behind a change of the parameter, so counting them would make
+  // `Model::EnforceRamBudget()` shrink a buffer again in every round until
+  // it drains, while the autotuning algorithm grows it back.
+  if (autotune_ && TunableBufferParameterLocked() != nullptr) {
+    return MaximumBufferedBytes();
+  }
+  return std::max(static_cast<double>(buffered_bytes_), MaximumBufferedBytes());
+}
+
 Status Node::ToProto(ModelProto::Node* node_proto) const {
   tf_shared_lock l(mu_);
   node_proto->set_id(id_);
@@ -2137,17 +2226,33 @@ void Model::AddNode(Node::Factory factory, const string& name,
   // The name captures the sequence of iterators joined by `::`. We only use the
   // last element of the sequence as the name node.
   auto node_name = str_util::Split(name, ':', str_util::SkipEmpty()).back();
-  mutex_lock l(mu_);
-  std::shared_ptr<Node> node = factory({id_counter_++, node_name, parent});
-  if (!output_) {
-    output_ = node;
-  }
-  if (parent) {
-    VLOG(3) << "Adding " << node->long_name() << " as input for "
-            << parent->long_name();
-    parent->add_input(node);
-  } else {
-    VLOG(3) << "Adding " << node->long_name();
+  std::shared_ptr<Node> node;
+  absl::flat_hash_map<string, double> restored_values;
+  {
+    mutex_lock l(mu_);
+    node = factory({id_counter_++, node_name, parent});
+    if (!output_) {
+      output_ = node;
+    }
+    if (parent) {
+      VLOG(3) << "Adding " << node->long_name() << " as input for "
+              << parent->long_name();
+      parent->add_input(node);
+    } else {
+      VLOG(3) << "Adding " << node->long_name();
+    }
+    if (!restored_parameters_.empty()) {
+      auto it = restored_parameters_.find(StableName(*node));
+      if (it != restored_parameters_.end()) {
+        restored_values = it->second;
+      }
+    }
+  }
+  // Parameter states are guarded by iterator locks, so they are updated
+  // without holding `mu_`.
+  if (!restored_values.empty()) {
+    VLOG(2) << "Restoring tuned parameters of " << node->long_name();
+    node->SetTunableParameterValues(restored_values);
   }
   *out_node = std::move(node);
   // TODO(jsimsa): Reset the optimization period when a node is added so that
@@ -2186,6 +2291,14 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64_t cpu_budget,
   optimization_params.set_algorithm(algorithm);
   optimization_params.set_cpu_budget(cpu_budget);
   optimization_params.set_ram_budget(ram_budget);
+  if (enforce_ram_budget_) {
+    // The algorithms only account for the buffers of tunable nodes, so leave
+    // room for the bytes buffered by all other nodes.
+    const double untunable_bytes =
+        snapshot->TotalRamUsage() - TotalMaximumBufferedBytes(snapshot);
+    optimization_params.set_ram_budget(std::max<int64_t>(
+        0, ram_budget - static_cast<int64_t>(std::max(untunable_bytes, 0.0))));
+  }
   optimization_params.set_model_input_time(model_input_time);
   switch (algorithm) {
     case AutotuneAlgorithm::DEFAULT:
@@ -2211,6 +2324,9 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64_t cpu_budget,
   if (experiment_ == "autotune_buffer_optimization") {
     OptimizeBuffers(snapshot, optimization_params.ram_budget());
   }
+  if (enforce_ram_budget_) {
+    EnforceRamBudget(snapshot, ram_budget);
+  }
 }
 
 void Model::RemoveNode(std::shared_ptr<Node> node) {
@@ -2228,6 +2344,62 @@ Model::ModelParameters Model::CollectTunableParameters(
   return node->CollectTunableParameters();
 }
 
+bool Model::EnforceRamBudget(std::shared_ptr<Node> snapshot,
+                             int64_t ram_budget) {
+  double excess_bytes = snapshot->TotalRamUsage() - ram_budget;
+  if (excess_bytes <= 0) {
+    return false;
+  }
+  struct Candidate {
+    std::string node_name;
+    std::shared_ptr<Parameter> parameter;
+    double bytes_per_unit;
+  };
+  std::vector<Candidate> candidates;
+  Node::NodeVector nodes =
+      snapshot->CollectNodes(TraversalOrder::BFS, IsAnyNode);
+  nodes.push_back(snapshot);
+  for (auto& node : nodes) {
+    double bytes_per_unit = 0;
+    std::shared_ptr<Parameter> parameter =
+        node->BufferedBytesParameter(&bytes_per_unit);
+    if (parameter != nullptr && bytes_per_unit > 0 &&
+        parameter->value > parameter->min) {
+      candidates.push_back(
+          {node->long_name(), std::move(parameter), bytes_per_unit});
+    }
+  }
+  // Shrink the parameters of the nodes that buffer the most bytes first.
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.parameter->value * a.bytes_per_unit >
+                            b.parameter->value * b.bytes_per_unit;
+                   });
+  ModelParameters shrunk_parameters;
+  for (auto& candidate : candidates) {
+    if (excess_bytes <= 0) {
+      break;
+    }
+    Parameter* parameter = candidate.parameter.get();
+    const double units =
+        std::min(std::ceil(excess_bytes / candidate.bytes_per_unit),
+                 parameter->value - parameter->min);
+    VLOG(2) << "Shrinking " << candidate.node_name << "::" << parameter->name
+            << " from " << parameter->value << " to "
+            << parameter->value - units << " to fit the RAM budget";
+    parameter->value -= units;
+    excess_bytes -= units * candidate.bytes_per_unit;
+    shrunk_parameters.push_back(
+        std::make_pair(candidate.node_name, candidate.parameter));
+  }
+  if (excess_bytes > 0) {
+    VLOG(2) << "Buffers exceed the RAM budget by " << excess_bytes
+            << " bytes at their minimum sizes";
+  }
+  UpdateStateValues(&shrunk_parameters);
+  return !shrunk_parameters.empty();
+}
+
 bool Model::DownsizeBuffers(std::shared_ptr<Node> snapshot) {
   Node::NodeVector nodes =
       snapshot->CollectNodes(TraversalOrder::BFS, IsAsyncNode);
@@ -2292,8 +2464,34 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm, int64_t cpu_budget,
       },
       /*deregister_fn=*/&unused));
 
+  // Saves the tuned parameter values if a file is set, at most once per
+  // `kTunedParametersSavePeriodMs` unless `ignore_period` is true.
+  auto save_tuned_parameters = [this](bool ignore_period) {
+    std::string tuned_parameters_file;
+    {
+      tf_shared_lock l(mu_);
+      tuned_parameters_file = tuned_parameters_file_;
+    }
+    if (tuned_parameters_file.empty()) return;
+    Status s = MaybeSaveTunedParameters(tuned_parameters_file, ignore_period);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to save tuned tf.data parameters to "
+                   << tuned_parameters_file << ": " << s;
+    }
+  };
+
   int64_t last_optimization_ms = 0;
   int64_t current_time_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
+  {
+    tf_shared_lock l(mu_);
+    if (!restored_parameters_.empty()) {
+      // Keep the restored parameter values until a full optimization period
+      // worth of measurements is available. They are tuned already, so the
+      // period does not start short either.
+      optimization_period_ms_ = kOptimizationPeriodMaxMs;
+      last_optimization_ms = current_time_ms;
+    }
+  }
   while (true) {
     {
       mutex_lock l(mu_);
@@ -2306,7 +2504,7 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm, int64_t cpu_budget,
         current_time_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
       }
       if (cancellation_manager->IsCancelled()) {
-        return OkStatus();
+        break;
       }
     }
 
@@ -2323,6 +2521,7 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm, int64_t cpu_budget,
              cancellation_manager);
     int64_t end_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
     VLOG(2) << "Optimized for " << end_ms - start_ms << " ms.";
+    save_tuned_parameters(/*ignore_period=*/false);
 
     // Exponentially increase the period of running the optimization until a
     // threshold is reached.
@@ -2335,6 +2534,9 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm, int64_t cpu_budget,
     last_optimization_ms = current_time_ms;
     FlushMetrics();
   }
+  // Keep the values of the last optimization rounds, if they changed.
+  save_tuned_parameters(/*ignore_period=*/true);
+  return OkStatus();
 }
 
 void Model::OptimizeGradientDescent(
@@ -2783,6 +2985,106 @@ Status Model::Load(const string& fname, std::unique_ptr<Model>* model,
   return OkStatus();
 }
 
+Status Model::SaveTunedParameters(const string& fname) {
+  std::shared_ptr<Node> snapshot;
+  {
+    tf_shared_lock l(mu_);
+    if (!output_) {
+      return errors::FailedPrecondition("The model has no nodes.");
+    }
+    snapshot = output_->Snapshot();
+  }
+  return WriteTunedParameters(snapshot, fname);
+}
+
+Status Model::MaybeSaveTunedParameters(const string& fname,
+                                       bool ignore_period) {
+  const int64_t now_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
+  if (!ignore_period &&
+      now_ms < last_tuned_parameters_save_ms_ + kTunedParametersSavePeriodMs) {
+    return OkStatus();
+  }
+  std::shared_ptr<Node> snapshot;
+  {
+    tf_shared_lock l(mu_);
+    if (!output_) {
+      return OkStatus();
+    }
+    snapshot = output_->Snapshot();
+  }
+  absl::flat_hash_map<string, double> values;
+  for (const auto& pair : CollectTunableParameters(snapshot)) {
+    values[strings::StrCat(pair.first, ":", pair.second->name)] =
+        pair.second->value;
+  }
+  if (values == saved_tuned_parameter_values_) {
+    return OkStatus();
+  }
+  TF_RETURN_IF_ERROR(WriteTunedParameters(snapshot, fname));
+  saved_tuned_parameter_values_ = std::move(values);
+  last_tuned_parameters_save_ms_ = now_ms;
+  return OkStatus();
+}
+
+Status Model::WriteTunedParameters(std::shared_ptr<Node> snapshot,
+                                   const string& fname) {
+  ModelProto model_proto;
+  TF_RETURN_IF_ERROR(ModelToProtoHelper(snapshot, &model_proto));
+  // Write to a temporary file first, so that a run that is interrupted while
+  // saving does not leave a truncated file behind for the next run.
+  Env* env = Env::Default();
+  const std::string tmp_fname =
+      strings::StrCat(fname, ".tmp", random::New64());
+  TF_RETURN_IF_ERROR(WriteBinaryProto(env, tmp_fname, model_proto));
+  return env->RenameFile(tmp_fname, fname);
+}
+
+Status Model::RestoreTunedParameters(const string& fname) {
+  ModelProto model_proto;
+  TF_RETURN_IF_ERROR(ReadBinaryProto(Env::Default(), fname, &model_proto));
+  // Node ids depend on the order in which iterators are created, so the
+  // values are keyed by the stable names of their nodes instead, computed
+  // from the output node down as in `StableName()`.
+  const auto& nodes = model_proto.nodes();
+  absl::flat_hash_map<int64_t, string> stable_names;
+  std::deque<int64_t> queue;
+  if (nodes.count(model_proto.output()) > 0) {
+    stable_names[model_proto.output()] =
+        nodes.at(model_proto.output()).name();
+    queue.push_back(model_proto.output());
+  }
+  absl::flat_hash_map<string, absl::flat_hash_map<string, double>>
+      restored_parameters;
+  while (!queue.empty()) {
+    const ModelProto::Node& node_proto = nodes.at(queue.front());
+    const string stable_name = stable_names[queue.front()];
+    queue.pop_front();
+    for (const auto& parameter_proto : node_proto.parameters()) {
+      if (parameter_proto.tunable()) {
+        restored_parameters[stable_name][parameter_proto.name()] =
+            parameter_proto.state_value();
+      }
+    }
+    absl::flat_hash_map<string, int> name_counts;
+    for (int64_t input_id : node_proto.inputs()) {
+      auto it = nodes.find(input_id);
+      if (it == nodes.end() || stable_names.contains(input_id)) continue;
+      const string& name = it->second.name();
+      stable_names[input_id] =
+          StableInputName(stable_name, name, name_counts[name]++);
+      queue.push_back(input_id);
+    }
+  }
+  mutex_lock l(mu_);
+  restored_parameters_ = std::move(restored_parameters);
+  return OkStatus();
+}
+
+void Model::SetTunedParametersFile(const string& fname) {
+  mutex_lock l(mu_);
+  tuned_parameters_file_ = fname;
+}
+
 std::string Model::DebugString() {
   constexpr int64_t kMinSecondsBetweenCalls = 30;
   if (absl::Now() < cache_until_) return cached_debug_string_;
@@ -456,6 +456,24 @@ class Node {
   // would be used by the subtree nodes if all of their buffers were full.
   double TotalMaximumBufferedBytes() const TF_LOCKS_EXCLUDED(mu_);
 
+  // Returns an estimate of the memory used by the buffers of all nodes in the
+  // subtree, including nodes without tunable parameters (such as shuffle) and
+  // nodes for which autotuning is disabled. For each node, this is the larger
+  // of the bytes it currently buffers and the bytes its buffer would hold if
+  // it were full.
+  double TotalRamUsage() const TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the tunable parameter that bounds the number of elements buffered
+  // by this node and stores the number of bytes buffered per unit of its value
+  // in `bytes_per_unit`. Returns `nullptr` if there is no such parameter.
+  std::shared_ptr<Parameter> BufferedBytesParameter(
+      double* bytes_per_unit) const TF_LOCKS_EXCLUDED(mu_);
+
+  // Sets the tunable parameters of this node whose names appear in `values`
+  // to the given values, clamped to the range of each parameter.
+  void SetTunableParameterValues(
+      const absl::flat_hash_map<string, double>& values) TF_LOCKS_EXCLUDED(mu_);
+
   // Returns the per-element CPU time in nanoseconds spent in the subtree rooted
   // in this node. If `processing_times` is not `nullptr`, collects the
   // per-element CPU time spent in each node of the subtree.
@@ -655,6 +673,15 @@ class Node {
   // that the optimization algorithm respects the memory budget.
   virtual double MaximumBufferedBytes() const TF_SHARED_LOCKS_REQUIRED(mu_);
 
+  // Returns the memory used by the buffer of the node itself, as counted by
+  // `TotalRamUsage()`.
+  double RamUsageLocked() const TF_SHARED_LOCKS_REQUIRED(mu_);
+
+  // Returns the tunable parameter that `MaximumBufferedBytes()` is computed
+  // from, or `nullptr` if that parameter is not tunable or there is none.
+  std::shared_ptr<Parameter> TunableBufferParameterLocked() const
+      TF_SHARED_LOCKS_REQUIRED(mu_);
+
   // Restores node from the proto. Note that this is not done recursively, i.e.
   // input nodes are not restored.
   static Status FromProtoHelper(ModelProto::Node node_proto,
@@ -785,6 +812,13 @@ class Model {
   // Set the experiment that this job is part of.
   void SetExperiment(const string& experiment) { experiment_ = experiment; }
 
+  // Sets whether the RAM budget is a hard limit. If it is, the optimization
+  // accounts for the bytes buffered by all nodes, and shrinks buffer sizes
+  // and parallelism when the pipeline uses more memory than the budget.
+  void SetEnforceRamBudget(bool enforce_ram_budget) {
+    enforce_ram_budget_ = enforce_ram_budget;
+  }
+
   // Adds a node with the given name and given parent.
   void AddNode(Node::Factory factory, const string& name,
                std::shared_ptr<Node> parent, std::shared_ptr<Node>* out_node)
@@ -816,6 +850,13 @@ class Model {
   // watermarks of all nodes are reset to the buffered elements.
   void OptimizeBuffers(std::shared_ptr<Node> snapshot, int64_t ram_budget);
 
+  // Shrinks the tunable buffer sizes and parallelism in the pipeline rooted at
+  // `snapshot` until its estimated memory usage, as computed by
+  // `Node::TotalRamUsage()`, fits in `ram_budget`. The parameters of the nodes
+  // that buffer the most bytes are shrunk first. Returns true if any parameter
+  // is shrunk.
+  bool EnforceRamBudget(std::shared_ptr<Node> snapshot, int64_t ram_budget);
+
   // Collects the output time and if `gradients` is not `nullptr`, the output
   // time gradient w.r.t. tunable parameters of the subtree rooted in the given
   // node.
@@ -842,6 +883,23 @@ class Model {
   static Status Load(const string& fname, std::unique_ptr<Model>* model,
                      OptimizationParams* optimization_params);
 
+  // Saves the values of the tunable parameters of this model to a file, so
+  // that a later run of the same input pipeline can start from them.
+  Status SaveTunedParameters(const string& fname) TF_LOCKS_EXCLUDED(mu_);
+
+  // Restores tunable parameter values saved by `SaveTunedParameters()`. Nodes
+  // added to the model afterwards start with the saved values of the node
+  // with the same name at the same position in the tree, and `OptimizeLoop()`
+  // waits a full optimization period before its first optimization, so that
+  // it does not override them based on the few measurements taken right after
+  // start-up.
+  Status RestoreTunedParameters(const string& fname) TF_LOCKS_EXCLUDED(mu_);
+
+  // Sets a file that `OptimizeLoop()` saves the tuned parameter values to
+  // when they change, at most once per `kTunedParametersSavePeriodMs` and
+  // once more when it finishes.
+  void SetTunedParametersFile(const string& fname) TF_LOCKS_EXCLUDED(mu_);
+
   // Records gap time between consecutive `GetNext()` calls.
   void RecordIteratorGapTime(uint64_t duration_usec);
 
@@ -858,6 +916,19 @@ class Model {
   static constexpr int64_t kOptimizationPeriodMinMs = 10;
   static constexpr int64_t kOptimizationPeriodMaxMs =
       60 * EnvTime::kSecondsToMillis;
+  static constexpr int64_t kTunedParametersSavePeriodMs =
+      60 * EnvTime::kSecondsToMillis;
+
+  // Saves the tuned parameter values to `fname` unless they are the same as
+  // those saved last, or, if `ignore_period` is false, they were saved less
+  // than `kTunedParametersSavePeriodMs` ago.
+  Status MaybeSaveTunedParameters(const string& fname, bool ignore_period)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Writes the tuned parameter values of the tree rooted in `snapshot` to
+  // `fname`.
+  Status WriteTunedParameters(std::shared_ptr<Node> snapshot,
+                              const string& fname);
 
   // Collects tunable parameters in the tree rooted in the given node, returning
   // a vector which contains pairs of node names and tunable parameters.
@@ -996,6 +1067,18 @@ class Model {
   std::deque<uint64_t> gap_times_usec_ TF_GUARDED_BY(gap_mu_);
   // The experiment that this job is part of.
   std::string experiment_ = "";
+  // Whether the RAM budget is a hard limit.
+  bool enforce_ram_budget_ = false;
+  // Tunable parameter values restored by `RestoreTunedParameters()`, keyed by
+  // the stable name of their node and then by parameter name.
+  absl::flat_hash_map<string, absl::flat_hash_map<string, double>>
+      restored_parameters_ TF_GUARDED_BY(mu_);
+  // File to save the tuned parameter values to.
+  std::string tuned_parameters_file_ TF_GUARDED_BY(mu_);
+  // The tuned parameter values saved last, keyed by node long name and
+  // parameter name, and when they were saved. Only used by `OptimizeLoop()`.
+  absl::flat_hash_map<string, double> saved_tuned_parameter_values_;
+  int64_t last_tuned_parameters_save_ms_ = 0;
 };
 
 // Class to compute timing information for a model.
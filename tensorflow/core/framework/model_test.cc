@@ -1160,6 +1160,143 @@ TEST(SaveModelTest, Model) {
   EXPECT_TRUE(restored_current->inputs().empty());
 }
 
+// Adds a prefetch node and a parallel map node whose tunable parameters use
+// the given shared states to `model`.
+void AddTunedPipeline(Model* model, std::shared_ptr<SharedState> buffer_size,
+                      std::shared_ptr<SharedState> parallelism) {
+  std::shared_ptr<Node> prefetch;
+  model->AddNode(
+      [&buffer_size](Node::Args args) {
+        return MakeAsyncKnownRatioNode(
+            std::move(args), /*ratio=*/1,
+            {MakeParameter(kBufferSize, buffer_size, /*min=*/1, /*max=*/16)});
+      },
+      "Prefetch", nullptr, &prefetch);
+  std::shared_ptr<Node> parallel_map;
+  model->AddNode(
+      [&parallelism](Node::Args args) {
+        return MakeAsyncKnownRatioNode(
+            std::move(args), /*ratio=*/1,
+            {MakeParameter(kParallelism, parallelism, /*min=*/1, /*max=*/8)});
+      },
+      "ParallelMap", prefetch, &parallel_map);
+}
+
+std::shared_ptr<SharedState> MakeTunableState() {
+  return std::make_shared<SharedState>(
+      /*value=*/kAutotune, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+}
+
+TEST(TunedParametersTest, SaveAndRestore) {
+  const std::string fname = io::JoinPath(::tensorflow::testing::TmpDir(),
+                                         "tuned_parameters_test");
+  {
+    Model model;
+    auto buffer_size = MakeTunableState();
+    auto parallelism = MakeTunableState();
+    AddTunedPipeline(&model, buffer_size, parallelism);
+    buffer_size->value = 6;
+    parallelism->value = 20;
+    TF_ASSERT_OK(model.SaveTunedParameters(fname));
+  }
+
+  Model model;
+  TF_ASSERT_OK(model.RestoreTunedParameters(fname));
+  auto buffer_size = MakeTunableState();
+  auto parallelism = MakeTunableState();
+  AddTunedPipeline(&model, buffer_size, parallelism);
+  EXPECT_EQ(6, buffer_size->value);
+  // Restored values are clamped to the range of the parameter.
+  EXPECT_EQ(8, parallelism->value);
+}
+
+TEST(TunedParametersTest, RestoreSkipsUntunableParameters) {
+  const std::string fname = io::JoinPath(::tensorflow::testing::TmpDir(),
+                                         "tuned_parameters_untunable_test");
+  {
+    Model model;
+    auto buffer_size = MakeTunableState();
+    auto parallelism = MakeTunableState();
+    AddTunedPipeline(&model, buffer_size, parallelism);
+    buffer_size->value = 6;
+    parallelism->value = 4;
+    TF_ASSERT_OK(model.SaveTunedParameters(fname));
+  }
+
+  Model model;
+  TF_ASSERT_OK(model.RestoreTunedParameters(fname));
+  auto buffer_size = std::make_shared<SharedState>(
+      /*value=*/2, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+  auto parallelism = MakeTunableState();
+  AddTunedPipeline(&model, buffer_size, parallelism);
+  EXPECT_EQ(2, buffer_size->value);
+  EXPECT_EQ(4, parallelism->value);
+}
+
+// Adds a prefetch node to `model` with a parallel map input per state in
+// `parallelisms`, preceded by `num_maps` untunable map inputs.
+void AddTunedZipPipeline(
+    Model* model, int num_maps,
+    const std::vector<std::shared_ptr<SharedState>>& parallelisms) {
+  std::shared_ptr<Node> prefetch;
+  model->AddNode(
+      [](Node::Args args) {
+        return MakeAsyncKnownRatioNode(std::move(args), /*ratio=*/1, {});
+      },
+      "Prefetch", nullptr, &prefetch);
+  for (int i = 0; i < num_maps; ++i) {
+    std::shared_ptr<Node> map;
+    model->AddNode(
+        [](Node::Args args) {
+          return MakeKnownRatioNode(std::move(args), /*ratio=*/1);
+        },
+        "Map", prefetch, &map);
+  }
+  for (const auto& parallelism : parallelisms) {
+    std::shared_ptr<Node> parallel_map;
+    model->AddNode(
+        [&parallelism](Node::Args args) {
+          return MakeAsyncKnownRatioNode(
+              std::move(args), /*ratio=*/1,
+              {MakeParameter(kParallelism, parallelism, /*min=*/1,
+                             /*max=*/8)});
+        },
+        "ParallelMap", prefetch, &parallel_map);
+  }
+}
+
+TEST(TunedParametersTest, RestoreDoesNotDependOnNodeIds) {
+  const std::string fname = io::JoinPath(::tensorflow::testing::TmpDir(),
+                                         "tuned_parameters_node_ids_test");
+  {
+    Model model;
+    auto first = MakeTunableState();
+    auto second = MakeTunableState();
+    AddTunedZipPipeline(&model, /*num_maps=*/0, {first, second});
+    first->value = 3;
+    second->value = 5;
+    TF_ASSERT_OK(model.SaveTunedParameters(fname));
+  }
+
+  // The map nodes shift the ids of the parallel map nodes.
+  Model model;
+  TF_ASSERT_OK(model.RestoreTunedParameters(fname));
+  auto first = MakeTunableState();
+  auto second = MakeTunableState();
+  AddTunedZipPipeline(&model, /*num_maps=*/2, {first, second});
+  EXPECT_EQ(3, first->value);
+  EXPECT_EQ(5, second->value);
+}
+
+TEST(TunedParametersTest, RestoreMissingFile) {
+  const std::string fname = io::JoinPath(::tensorflow::testing::TmpDir(),
+                                         "tuned_parameters_missing");
+  Model model;
+  EXPECT_FALSE(model.RestoreTunedParameters(fname).ok());
+}
+
 class ComputeWaitTimeTest
     : public ::testing::TestWithParam<std::tuple<double, double, double>> {};
 
@@ -2288,6 +2425,138 @@ TEST_F(BufferSizeTest, OptimizeBuffers_TightMemory) {
   EXPECT_EQ(4, node_4->buffered_elements_high());
 }
 
+constexpr char kEnforceRamBudgetModel[] = R"pb(
+  nodes: {
+    key: 1
+    value: {
+      id: 1
+      name: "Prefetch"
+      autotune: true
+      bytes_produced: 10000
+      num_elements: 100
+      processing_time: 2000
+      node_class: ASYNC_KNOWN_RATIO
+      inputs: 2
+      ratio: 1
+      parameters: {
+        name: "buffer_size"
+        value: 10
+        state_value: 10
+        min: 1
+        max: 16
+        tunable: true
+      }
+    }
+  }
+  nodes: {
+    key: 2
+    value: {
+      id: 2
+      name: "Shuffle"
+      autotune: true
+      bytes_produced: 10000
+      num_elements: 100
+      processing_time: 2000
+      node_class: KNOWN_RATIO
+      inputs: 3
+      ratio: 1
+    }
+  }
+  nodes: {
+    key: 3
+    value: {
+      id: 3
+      name: "ParallelMap"
+      autotune: true
+      bytes_produced: 10000
+      num_elements: 100
+      processing_time: 2000
+      node_class: ASYNC_KNOWN_RATIO
+      ratio: 1
+      parameters: {
+        name: "parallelism"
+        value: 8
+        state_value: 8
+        min: 1
+        max: 16
+        tunable: true
+      }
+    }
+  }
+  output: 1
+)pb";
+
+TEST_F(BufferSizeTest, EnforceRamBudget_WithinBudget) {
+  ReadModel(kEnforceRamBudgetModel);
+  std::shared_ptr<Node> node_1 = GetNode(1);
+  // The shuffle buffer holds 20 elements of 100 bytes.
+  GetNode(2)->record_buffer_event(2000, 20);
+  // 1000 bytes for the prefetch buffer, 2000 bytes for the shuffle buffer and
+  // 800 bytes for the parallel map.
+  EXPECT_DOUBLE_EQ(3800, node_1->TotalRamUsage());
+
+  EXPECT_FALSE(model_->EnforceRamBudget(node_1->Snapshot(), 4000));
+  EXPECT_EQ(10, node_1->parameter_value(kBufferSize));
+  EXPECT_EQ(8, GetNode(3)->parameter_value(kParallelism));
+}
+
+TEST_F(BufferSizeTest, EnforceRamBudget_ShrinksLargestBuffer) {
+  ReadModel(kEnforceRamBudgetModel);
+  std::shared_ptr<Node> node_1 = GetNode(1);
+  GetNode(2)->record_buffer_event(2000, 20);
+
+  // The prefetch buffer holds the most bytes, and shrinking it by 8 elements
+  // is enough to fit the budget.
+  EXPECT_TRUE(model_->EnforceRamBudget(node_1->Snapshot(), 3000));
+  EXPECT_EQ(2, node_1->parameter_value(kBufferSize));
+  EXPECT_EQ(8, GetNode(3)->parameter_value(kParallelism));
+  EXPECT_DOUBLE_EQ(3000, node_1->TotalRamUsage());
+}
+
+TEST_F(BufferSizeTest, EnforceRamBudget_ShrinksParallelism) {
+  ReadModel(kEnforceRamBudgetModel);
+  std::shared_ptr<Node> node_1 = GetNode(1);
+  GetNode(2)->record_buffer_event(2000, 20);
+
+  // The prefetch buffer is shrunk to its minimum size, and the parallel map
+  // gives up the remaining 600 bytes.
+  EXPECT_TRUE(model_->EnforceRamBudget(node_1->Snapshot(), 2300));
+  EXPECT_EQ(1, node_1->parameter_value(kBufferSize));
+  EXPECT_EQ(2, GetNode(3)->parameter_value(kParallelism));
+  EXPECT_DOUBLE_EQ(2300, node_1->TotalRamUsage());
+}
+
+TEST_F(BufferSizeTest, EnforceRamBudget_SettlesWithMeasuredBytes) {
+  ReadModel(kEnforceRamBudgetModel);
+  std::shared_ptr<Node> node_1 = GetNode(1);
+  GetNode(2)->record_buffer_event(2000, 20);
+  // The prefetch buffer is full.
+  node_1->record_buffer_event(1000, 10);
+
+  EXPECT_TRUE(model_->EnforceRamBudget(node_1->Snapshot(), 3000));
+  EXPECT_EQ(2, node_1->parameter_value(kBufferSize));
+  // The prefetch buffer has not drained yet, but only its new size counts,
+  // so later rounds leave the parameters alone.
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FALSE(model_->EnforceRamBudget(node_1->Snapshot(), 3000));
+    EXPECT_EQ(2, node_1->parameter_value(kBufferSize));
+    EXPECT_EQ(8, GetNode(3)->parameter_value(kParallelism));
+  }
+  EXPECT_DOUBLE_EQ(3000, node_1->TotalRamUsage());
+}
+
+TEST_F(BufferSizeTest, EnforceRamBudget_UntunableBytesExceedBudget) {
+  ReadModel(kEnforceRamBudgetModel);
+  std::shared_ptr<Node> node_1 = GetNode(1);
+  GetNode(2)->record_buffer_event(2000, 20);
+
+  // The shuffle buffer alone exceeds the budget, so all tunable parameters are
+  // shrunk to their minimum values.
+  EXPECT_TRUE(model_->EnforceRamBudget(node_1->Snapshot(), 1000));
+  EXPECT_EQ(1, node_1->parameter_value(kBufferSize));
+  EXPECT_EQ(1, GetNode(3)->parameter_value(kParallelism));
+}
+
 TEST_F(ModelTimingTest, OptimizeStageBased_OneStage) {
   BuildModelFromProto(R"pb(
     nodes: {
@@ -747,10 +747,37 @@ Status OpKernelContext::allocate_output(StringPiece name,
   return allocate_output(start, shape, tensor, attr);
 }
 
+Allocator* OpKernelContext::get_step_local_allocator(AllocatorAttributes attr,
+                                                     int output_index) const {
+  if (params_->step_arena_allocator == nullptr &&
+      params_->output_allocator_array == nullptr) {
+    return nullptr;
+  }
+  // Tracked allocations have to go through the TrackingAllocator wrapping the
+  // device allocator.
+  if (track_allocations()) return nullptr;
+  // Step-local allocators hold pageable host memory only.
+  AllocatorAttributes host_attr;
+  host_attr.set_on_host(true);
+  if (attr.scope_id > 0 || !attr.IsEqualOrLessRestrictiveThan(host_attr)) {
+    return nullptr;
+  }
+  if (output_index < 0) return params_->step_arena_allocator;
+  if (params_->output_allocator_array != nullptr &&
+      params_->output_allocator_array[output_index] != nullptr) {
+    return params_->output_allocator_array[output_index];
+  }
+  return params_->step_arena_allocator_for_outputs
+             ? params_->step_arena_allocator
+             : nullptr;
+}
+
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
-    AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+    AllocatorAttributes attr, const AllocationAttributes& allocation_attr,
+    int output_index) {
+  Allocator* a = get_step_local_allocator(attr, output_index);
+  if (a == nullptr) a = get_allocator(attr);
   Tensor new_tensor(
       a, type, shape,
       AllocationAttributes(
@@ -809,7 +836,8 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
       op_kernel().name_view().data(), step_id(), "output", type,
       [&shape]() { return shape.DebugString(); });
   auto output_tensor = MakeUnique<Tensor>();
-  Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  Status s = allocate_tensor(type, shape, output_tensor.get(), attr,
+                             AllocationAttributes(), index);
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor.release());
     *output = outputs_[index].tensor;
@@ -946,7 +974,8 @@ bool OpKernelContext::maybe_set_output_by_allocate_and_copy(
         [&tensor]() { return tensor.shape().DebugString(); });
     auto new_tensor = MakeUnique<Tensor>();
     Status s = allocate_tensor(tensor.dtype(), tensor.shape(), new_tensor.get(),
-                               output_alloc_attr(index));
+                               output_alloc_attr(index),
+                               AllocationAttributes(), index);
     TF_CHECK_OK(s);
     device()->CopyTensorInSameDevice(&tensor, new_tensor.get(),
                                      op_device_context(), [](const Status&) {});
@@ -682,6 +682,19 @@ class OpKernelContext {
 
     // For access to distributed coordination service.
     CoordinationServiceAgent* coordination_service_agent = nullptr;
+
+    // If not null, the host temporaries of the kernel are allocated from it
+    // rather than from the device allocator, and so are its host outputs if
+    // `step_arena_allocator_for_outputs` is set.
+    Allocator* step_arena_allocator = nullptr;
+
+    // The caller sets this only if the outputs of the kernel are not consumed
+    // by any op that may keep them beyond the step.
+    bool step_arena_allocator_for_outputs = false;
+
+    // If not null, an array of num_outputs allocators, where a non-null entry
+    // is used in place of the above for the host allocations of that output.
+    Allocator* const* output_allocator_array = nullptr;
   };
 
   // params must outlive the OpKernelContext.
@@ -1241,9 +1254,17 @@ class OpKernelContext {
                            AllocationAttributes());
   }
 
+  // `output_index` is the output the tensor is allocated for, or -1 for a
+  // temporary.
   Status allocate_tensor(DataType type, const TensorShape& shape,
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
-                         const AllocationAttributes& allocation_attr);
+                         const AllocationAttributes& allocation_attr,
+                         int output_index = -1);
+
+  // Returns the step-local allocator to use for a tensor with `attr` that is
+  // allocated for `output_index`, or nullptr if it must come from the device.
+  Allocator* get_step_local_allocator(AllocatorAttributes attr,
+                                      int output_index) const;
 
   // Helpers for `set_output()`.
 
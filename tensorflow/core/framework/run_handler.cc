@@ -131,6 +131,9 @@ ThreadWorkSource::ThreadWorkSource()
       blocking_inflight_(0),
       non_blocking_inflight_(0),
       traceme_id_(0),
+      deadline_us_(kuint64max),
+      slo_class_inflight_(nullptr),
+      slo_class_quota_(0),
       version_(0),
       sub_thread_pool_waiter_(nullptr) {
   queue_waiters_.next = &queue_waiters_;
@@ -280,6 +283,33 @@ void ThreadWorkSource::SetWaiter(uint64 version, Waiter* waiter, mutex* mutex) {
   version_ = version;
 }
 
+void ThreadWorkSource::SetDeadline(uint64 deadline_us) {
+  deadline_us_.store(deadline_us, std::memory_order_relaxed);
+}
+
+uint64 ThreadWorkSource::GetDeadline() {
+  return deadline_us_.load(std::memory_order_relaxed);
+}
+
+bool ThreadWorkSource::HasDeadline() { return GetDeadline() != kuint64max; }
+
+void ThreadWorkSource::SetSloClass(std::atomic<int64_t>* inflight,
+                                   int64_t quota) {
+  slo_class_quota_.store(quota, std::memory_order_relaxed);
+  slo_class_inflight_.store(inflight, std::memory_order_relaxed);
+}
+
+std::atomic<int64_t>* ThreadWorkSource::GetSloClassInflight() {
+  return slo_class_inflight_.load(std::memory_order_relaxed);
+}
+
+bool ThreadWorkSource::HasSloClassQuota() {
+  std::atomic<int64_t>* inflight = GetSloClassInflight();
+  return inflight == nullptr ||
+         inflight->load(std::memory_order_relaxed) <
+             slo_class_quota_.load(std::memory_order_relaxed);
+}
+
 int64_t ThreadWorkSource::GetInflightTaskCount(bool is_blocking) {
   std::atomic<int64_t>* counter =
       is_blocking ? &blocking_inflight_ : &non_blocking_inflight_;
@@ -422,8 +452,19 @@ void RunHandlerThreadPool::SetThreadWorkSources(
           thread_work_sources[i]);
     }
   } else {
+    // Requests with a deadline that precede the start request come first, so
+    // that the thread turns to urgent work at the next node boundary.
+    std::vector<bool> added(thread_work_sources.size(), false);
+    for (int i = 0; i < start_request_idx; ++i) {
+      if (thread_work_sources[i]->HasDeadline()) {
+        thread_data_[tid].new_thread_work_sources->emplace_back(
+            thread_work_sources[i]);
+        added[i] = true;
+      }
+    }
     thread_data_[tid].new_thread_work_sources->emplace_back(
         thread_work_sources[start_request_idx]);
+    added[start_request_idx] = true;
     // The number of shards for the queue. Threads in each shard will
     // prioritize different thread_work_sources. Increase the number of shards
     // could decrease the contention in the queue. For example, when
@@ -437,7 +478,7 @@ void RunHandlerThreadPool::SetThreadWorkSources(
     int token = tid % num_shards;
     for (int i = 0; i < num_shards; ++i) {
       for (int j = token; j < thread_work_sources.size(); j += num_shards) {
-        if (j != start_request_idx) {
+        if (!added[j]) {
           thread_data_[tid].new_thread_work_sources->emplace_back(
               thread_work_sources[j]);
         }
@@ -506,7 +547,8 @@ Task RunHandlerThreadPool::FindTask(
 
     // For blocking thread, search for blocking tasks first.
     if (may_steal_blocking_work &&
-        (*tws)->GetInflightTaskCount(true) < max_blocking_inflight) {
+        (*tws)->GetInflightTaskCount(true) < max_blocking_inflight &&
+        (*tws)->HasSloClassQuota()) {
       t = (*tws)->PopBlockingTask();
       if (t.f) {
         *task_from_blocking_queue = true;
@@ -595,7 +637,8 @@ void RunHandlerThreadPool::WorkerLoop(int thread_id,
         // otherwise there will be contention in PropagateOutputs.
         // This is best effort policy.
         if (may_steal_blocking_work &&
-            tws->GetInflightTaskCount(true) < kMaxBlockingInflight) {
+            tws->GetInflightTaskCount(true) < kMaxBlockingInflight &&
+            tws->HasSloClassQuota()) {
           t = tws->PopBlockingTask();
           if (t.f) {
             break;
@@ -632,9 +675,19 @@ void RunHandlerThreadPool::WorkerLoop(int thread_id,
           profiler::TraceMeLevel::kInfo);
       VLOG(2) << "Running " << (task_from_blocking_queue ? "inter" : "intra")
               << " work from " << tws->GetTracemeId();
+      // The handler may be reset for another request of another class before
+      // the closure returns.
+      std::atomic<int64_t>* slo_class_inflight =
+          task_from_blocking_queue ? tws->GetSloClassInflight() : nullptr;
+      if (slo_class_inflight != nullptr) {
+        slo_class_inflight->fetch_add(1, std::memory_order_relaxed);
+      }
       tws->IncrementInflightTaskCount(task_from_blocking_queue);
       env_.ExecuteTask(t);
       tws->DecrementInflightTaskCount(task_from_blocking_queue);
+      if (slo_class_inflight != nullptr) {
+        slo_class_inflight->fetch_sub(1, std::memory_order_relaxed);
+      }
     } else {
       profiler::TraceMe activity(
           [=] {
@@ -736,6 +789,9 @@ class RunHandler::Impl {
   // Stores now time (in microseconds) since unix epoch when the handler is
   // requested via RunHandlerPool::Get().
   uint64 start_time_us() const { return start_time_us_; }
+  // The deadline of the request in microseconds since unix epoch, or
+  // kuint64max if it has no latency SLO.
+  uint64 deadline_us() const { return deadline_us_; }
   int64_t step_id() const { return step_id_; }
   void ScheduleInterOpClosure(std::function<void()> fn);
   void ScheduleIntraOpClosure(std::function<void()> fn);
@@ -765,6 +821,7 @@ class RunHandler::Impl {
 
   RunHandlerPool::Impl* pool_impl_;  // NOT OWNED.
   uint64 start_time_us_;
+  uint64 deadline_us_;
   int64_t step_id_;
   std::unique_ptr<thread::ThreadPoolInterface> thread_pool_interface_;
   internal::ThreadWorkSource tws_;
@@ -793,6 +850,17 @@ class RunHandlerPool::Impl {
             "TF_RUN_HANDLER_SUB_THREAD_POOL_END_REQUEST_PERCENTAGE",
             std::vector<double>({1}))) {
     VLOG(1) << "Creating a RunHandlerPool with max handlers: " << max_handlers_;
+    const std::vector<double> slo_class_thread_quota = ParamFromEnvWithDefault(
+        "TF_RUN_HANDLER_SLO_CLASS_THREAD_QUOTA", std::vector<double>());
+    const int num_slo_classes = slo_class_thread_quota.size();
+    slo_class_inflight_.reset(new std::atomic<int64_t>[num_slo_classes]);
+    for (int i = 0; i < num_slo_classes; ++i) {
+      slo_class_inflight_[i] = 0;
+      slo_class_quota_.push_back(std::max<int64_t>(
+          1, std::lround(slo_class_thread_quota[i] * num_inter_op_threads)));
+      VLOG(1) << "SLO class " << i + 1 << " may use " << slo_class_quota_.back()
+              << " inter-op threads.";
+    }
     free_handlers_.reserve(max_handlers_);
     handlers_.reserve(max_handlers_);
     for (int i = 0; i < max_handlers_; ++i) {
@@ -830,6 +898,18 @@ class RunHandlerPool::Impl {
     return !free_handlers_.empty();
   }
 
+  // Applies the thread quota of 'slo_class', if any, to 'tws'. Classes are
+  // numbered from 1; class 0 is the default of requests without a class.
+  void SetSloClass(int slo_class, internal::ThreadWorkSource* tws) {
+    if (slo_class > 0 &&
+        slo_class <= static_cast<int>(slo_class_quota_.size())) {
+      tws->SetSloClass(&slo_class_inflight_[slo_class - 1],
+                       slo_class_quota_[slo_class - 1]);
+    } else {
+      tws->SetSloClass(nullptr, 0);
+    }
+  }
+
   std::unique_ptr<RunHandler> Get(
       int64_t step_id, int64_t timeout_in_ms,
       const RunOptions::Experimental::RunHandlerPoolOptions& options)
@@ -874,12 +954,11 @@ class RunHandlerPool::Impl {
 
       num_active_requests = sorted_active_handlers_.size() + 1;
       thread_work_sources->resize(num_active_requests);
-      int priority = options.priority();
       auto it = sorted_active_handlers_.cbegin();
       bool new_handler_inserted = false;
       for (int i = 0; i < num_active_requests; ++i) {
         if (!new_handler_inserted && (it == sorted_active_handlers_.cend() ||
-                                      priority > (*it)->priority())) {
+                                      Precedes(handler_impl, *it))) {
           sorted_active_handlers_.insert(it, handler_impl);
           new_handler_inserted = true;
           // Point to the newly added handler.
@@ -935,7 +1014,27 @@ class RunHandlerPool::Impl {
     return ret;
   }
 
+  std::vector<int64_t> GetActiveHandlerStepIdsForTesting()
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    std::vector<int64_t> ret;
+    for (const auto& handler_impl : sorted_active_handlers_) {
+      ret.push_back(handler_impl->step_id());
+    }
+    return ret;
+  }
+
  private:
+  // Returns true if the request of 'a' is served before that of 'b': by
+  // priority, then earliest deadline first. Requests that tie keep their
+  // arrival order.
+  static bool Precedes(RunHandler::Impl* a, RunHandler::Impl* b) {
+    if (a->priority() != b->priority()) {
+      return a->priority() > b->priority();
+    }
+    return a->deadline_us() < b->deadline_us();
+  }
+
   void RecomputePoolStats(
       int num_active_requests, uint64 version,
       const Eigen::MaxSizeVector<internal::ThreadWorkSource*>&
@@ -952,10 +1051,14 @@ class RunHandlerPool::Impl {
   Eigen::MaxSizeVector<mutex> waiters_mu_;
   Eigen::MaxSizeVector<internal::Waiter> queue_waiters_;
 
+  // Per SLO class, the number of running inter-op closures and the most that
+  // may run at the same time.
+  std::unique_ptr<std::atomic<int64_t>[]> slo_class_inflight_;
+  std::vector<int64_t> slo_class_quota_;
+
   std::unique_ptr<internal::RunHandlerThreadPool> run_handler_thread_pool_;
   // Thread compatible part used only by lock under RunHandlerPool.
-  // Handlers are sorted by start time.
-  // TODO(azaks): sort by the remaining latency budget.
+  // Handlers are sorted by priority, deadline and start time.
   // TODO(chaox): Consider other data structure for maintaining the sorted
   // active handlers if the searching overhead(currently O(n)) becomes the
   // bottleneck.
@@ -1079,9 +1182,14 @@ void RunHandler::Impl::Reset(
     int64_t step_id,
     const RunOptions::Experimental::RunHandlerPoolOptions& options) {
   start_time_us_ = tensorflow::Env::Default()->NowMicros();
+  deadline_us_ = options.latency_slo_in_ms() > 0
+                     ? start_time_us_ + options.latency_slo_in_ms() * 1000
+                     : kuint64max;
   step_id_ = step_id;
   options_ = options;
   tws_.SetTracemeId(step_id);
+  tws_.SetDeadline(deadline_us_);
+  pool_impl_->SetSloClass(options.slo_class(), &tws_);
 }
 
 RunHandlerPool::RunHandlerPool(int num_inter_op_threads)
@@ -1104,6 +1212,11 @@ std::vector<int64_t> RunHandlerPool::GetActiveHandlerPrioritiesForTesting()
   return impl_->GetActiveHandlerPrioritiesForTesting();
 }
 
+std::vector<int64_t> RunHandlerPool::GetActiveHandlerStepIdsForTesting()
+    const {
+  return impl_->GetActiveHandlerStepIdsForTesting();
+}
+
 RunHandler::RunHandler(Impl* impl) : impl_(impl) {}
 
 void RunHandler::ScheduleInterOpClosure(std::function<void()> fn) {
@@ -72,6 +72,10 @@ class RunHandlerPool {
   // order of the active handler list.
   std::vector<int64_t> GetActiveHandlerPrioritiesForTesting() const;
 
+  // Get the step ids for active handlers, in the order of the active handler
+  // list.
+  std::vector<int64_t> GetActiveHandlerStepIdsForTesting() const;
+
  private:
   class Impl;
   friend class RunHandler;
@@ -81,8 +85,17 @@ class RunHandlerPool {
 
 // RunHandler can be used to schedule inter/intra-op closures to run on a global
 // pool shared across all Session::Run(s). The closures are enqueued to a
-// handler specific queue, from which the work is stolen in a priority order
-// (time of the Get() call).
+// handler specific queue, from which the work is stolen in a priority order:
+// by RunHandlerPoolOptions.priority, then earliest deadline first for requests
+// with a latency SLO, then by the time of the Get() call.
+//
+// Threads pick a new closure at every node boundary, and always try the
+// requests with a deadline that precede their own first request, so urgent
+// work preempts the rest as soon as a closure finishes. The number of threads
+// running the inter-op closures of each SLO class at the same time can be
+// capped with TF_RUN_HANDLER_SLO_CLASS_THREAD_QUOTA, a comma-separated list
+// giving classes 1, 2, ... each a fraction of the inter-op threads. Requests
+// in class 0, the default, are never capped.
 //
 // It can only be created via RunHandlerPool::Get().
 //
@@ -176,6 +189,27 @@ class ThreadWorkSource {
 
   void SetWaiter(uint64 version, Waiter* waiter, mutex* mutex);
 
+  // The deadline of the request in microseconds since the epoch, or
+  // kuint64max if it has none.
+  void SetDeadline(uint64 deadline_us);
+
+  uint64 GetDeadline();
+
+  bool HasDeadline();
+
+  // Sets the counter of running inter-op closures of the SLO class of the
+  // request, and the most that may run at the same time. 'inflight' is null
+  // if the class is not capped.
+  void SetSloClass(std::atomic<int64_t>* inflight, int64_t quota);
+
+  // Returns the counter to update while running an inter-op closure of the
+  // request, or null.
+  std::atomic<int64_t>* GetSloClassInflight();
+
+  // Returns true if the SLO class of the request may run another inter-op
+  // closure. Best effort: threads may exceed the quota briefly.
+  bool HasSloClassQuota();
+
   int64_t GetInflightTaskCount(bool is_blocking);
 
   void IncrementInflightTaskCount(bool is_blocking);
@@ -206,6 +240,10 @@ class ThreadWorkSource {
   Waiter queue_waiters_ TF_GUARDED_BY(waiters_mu_);
   std::atomic<int64_t> traceme_id_;
 
+  std::atomic<uint64> deadline_us_;
+  std::atomic<std::atomic<int64_t>*> slo_class_inflight_;
+  std::atomic<int64_t> slo_class_quota_;
+
   mutex run_handler_waiter_mu_;
   uint64 version_ TF_GUARDED_BY(run_handler_waiter_mu_);
   mutex* sub_thread_pool_waiter_mu_ TF_GUARDED_BY(run_handler_waiter_mu_);
@@ -236,8 +274,9 @@ class RunHandlerThreadPool {
                       std::function<void()> fn);
 
   // Set work queues from which the thread 'tid' can steal its work.
-  // The request with start_request_idx will be attempted first. Other requests
-  // will be attempted in FIFO order based on their arrival time.
+  // The requests with a deadline before start_request_idx, then the request
+  // with start_request_idx will be attempted first. Other requests will be
+  // attempted in the order of 'thread_work_sources'.
   void SetThreadWorkSources(
       int tid, int start_request_idx, uint64 version,
       const Eigen::MaxSizeVector<ThreadWorkSource*>& thread_work_sources);
@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -113,6 +114,32 @@ TEST(RunHandlerUtilTest, PrioritySchedulingTest) {
   EXPECT_EQ(sorted_active_list[3], 1);
 }
 
+TEST(RunHandlerUtilTest, EarliestDeadlineFirstTest) {
+  int num_threads = 2;
+  std::unique_ptr<RunHandlerPool> pool(
+      new RunHandlerPool(num_threads, num_threads));
+
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  auto handler1 = pool->Get(/*step_id=*/1, /*timeout_in_ms=*/0, options);
+  options.set_latency_slo_in_ms(100000);
+  auto handler2 = pool->Get(/*step_id=*/2, /*timeout_in_ms=*/0, options);
+  options.set_latency_slo_in_ms(1000);
+  auto handler3 = pool->Get(/*step_id=*/3, /*timeout_in_ms=*/0, options);
+  options.clear_latency_slo_in_ms();
+  auto handler4 = pool->Get(/*step_id=*/4, /*timeout_in_ms=*/0, options);
+
+  // Requests with a deadline come first, earliest deadline first, followed by
+  // the others in arrival order.
+  EXPECT_EQ(pool->GetActiveHandlerStepIdsForTesting(),
+            std::vector<int64_t>({3, 2, 1, 4}));
+
+  // Priority still comes before the deadline.
+  options.set_priority(1);
+  auto handler5 = pool->Get(/*step_id=*/5, /*timeout_in_ms=*/0, options);
+  EXPECT_EQ(pool->GetActiveHandlerStepIdsForTesting(),
+            std::vector<int64_t>({5, 3, 2, 1, 4}));
+}
+
 TEST(RunHandlerThreadPool, EnqueueTask) {
   Eigen::MaxSizeVector<mutex> waiters_mu(2);
   waiters_mu.resize(2);
@@ -426,6 +453,56 @@ TEST(RunHandlerThreadPool, FindTask) {
   }
 }
 
+TEST(RunHandlerThreadPool, FindTaskRespectsSloClassQuota) {
+  Eigen::MaxSizeVector<mutex> waiters_mu(2);
+  waiters_mu.resize(2);
+  Eigen::MaxSizeVector<internal::Waiter> waiters(2);
+  waiters.resize(2);
+  internal::RunHandlerThreadPool run_handler_thread_pool(
+      /*num_blocking_threads=*/1, /*num_non_blocking_threads=*/0,
+      Env::Default(), ThreadOptions(), "tf_run_handler_pool", &waiters_mu,
+      &waiters);
+
+  Eigen::MaxSizeVector<internal::ThreadWorkSource*> thread_work_sources(2);
+  thread_work_sources.resize(2);
+  internal::ThreadWorkSource tws[2];
+  thread_work_sources[0] = &tws[0];
+  thread_work_sources[1] = &tws[1];
+  // The class of the first request may run one inter-op closure at a time.
+  std::atomic<int64_t> inflight(1);
+  tws[0].SetSloClass(&inflight, /*quota=*/1);
+  EXPECT_FALSE(tws[0].HasSloClassQuota());
+  EXPECT_TRUE(tws[1].HasSloClassQuota());
+
+  int result = -1;
+  run_handler_thread_pool.AddWorkToQueue(&tws[0], /*is_blocking=*/true,
+                                         [&result] { result = 0; });
+  run_handler_thread_pool.AddWorkToQueue(&tws[1], /*is_blocking=*/true,
+                                         [&result] { result = 1; });
+  const auto find_task = [&]() {
+    bool task_from_blocking_queue;
+    internal::ThreadWorkSource* found;
+    return run_handler_thread_pool.FindTask(
+        /*searching_range_start=*/0, /*searching_range_end=*/2,
+        /*thread_id=*/0, /*sub_thread_pool_id=*/0,
+        /*max_blocking_inflight=*/10, /*may_steal_blocking_work=*/true,
+        thread_work_sources, &task_from_blocking_queue, &found);
+  };
+
+  // The first request is over its quota.
+  internal::Task t = find_task();
+  ASSERT_TRUE(t.f != nullptr);
+  t.f->f();
+  EXPECT_EQ(result, 1);
+  EXPECT_TRUE(find_task().f == nullptr);
+
+  inflight = 0;
+  t = find_task();
+  ASSERT_TRUE(t.f != nullptr);
+  t.f->f();
+  EXPECT_EQ(result, 0);
+}
+
 TEST(RunHandlerThreadPool, RoundRobinExecution) {
   // Set up environment for 1 sub thread pool.
   setenv("TF_RUN_HANDLER_USE_SUB_THREAD_POOL", "true", true);
@@ -811,5 +888,101 @@ TEST_F(RunHandlerTest, TestWaitTimeout) {
   EXPECT_NE(next_handle.get(), nullptr);
 }
 
+// Busy-waits for 'micros' microseconds, standing in for a kernel.
+void SpinFor(int64_t micros) {
+  const uint64 end = EnvTime::NowMicros() + micros;
+  while (EnvTime::NowMicros() < end) {
+  }
+}
+
+// Serves latency-critical requests, each a chain of kNumNodes short inter-op
+// closures, while batch requests keep all inter-op threads busy with long
+// closures, and reports the median and tail latency of the latency-critical
+// requests. The argument selects the scheduling: 0 for arrival order, 1 for a
+// latency SLO on the latency-critical requests and a quota of half of the
+// inter-op threads for the batch class.
+void BM_MixedLoadTailLatency(::testing::benchmark::State& state) {
+  const bool use_slo = state.range(0);
+  constexpr int kNumThreads = 8;
+  constexpr int kNumBatchClients = 4;
+  constexpr int kNumNodes = 4;
+  if (use_slo) {
+    setenv("TF_RUN_HANDLER_SLO_CLASS_THREAD_QUOTA", "0.5", true);
+  } else {
+    unsetenv("TF_RUN_HANDLER_SLO_CLASS_THREAD_QUOTA");
+  }
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(kNumThreads));
+
+  RunOptions::Experimental::RunHandlerPoolOptions batch_options;
+  RunOptions::Experimental::RunHandlerPoolOptions latency_options;
+  if (use_slo) {
+    batch_options.set_slo_class(1);
+    latency_options.set_latency_slo_in_ms(5);
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int64_t> step_id(0);
+  BlockingCounter batch_clients_done(kNumBatchClients);
+  thread::ThreadPool clients(Env::Default(), "clients", kNumBatchClients);
+  for (int c = 0; c < kNumBatchClients; ++c) {
+    clients.Schedule([&]() {
+      while (!done) {
+        auto handler = pool->Get(step_id++, 0, batch_options);
+        BlockingCounter nodes(kNumThreads);
+        for (int i = 0; i < kNumThreads; ++i) {
+          handler->ScheduleInterOpClosure([&nodes]() {
+            SpinFor(2000);
+            nodes.DecrementCount();
+          });
+        }
+        nodes.Wait();
+      }
+      batch_clients_done.DecrementCount();
+    });
+  }
+
+  // The chain of closures of the current latency-critical request.
+  RunHandler* handler = nullptr;
+  mutex mu;
+  condition_variable finished;
+  int64_t num_finished = 0;
+  std::function<void(int)> run_node = [&](int i) {
+    SpinFor(50);
+    if (i + 1 < kNumNodes) {
+      handler->ScheduleInterOpClosure([&run_node, i]() { run_node(i + 1); });
+    } else {
+      mutex_lock l(mu);
+      ++num_finished;
+      finished.notify_all();
+    }
+  };
+
+  histogram::Histogram latency_us;
+  int64_t num_started = 0;
+  for (auto s : state) {
+    const uint64 start = EnvTime::NowMicros();
+    auto latency_handler = pool->Get(step_id++, 0, latency_options);
+    handler = latency_handler.get();
+    handler->ScheduleInterOpClosure([&run_node]() { run_node(0); });
+    ++num_started;
+    {
+      mutex_lock l(mu);
+      while (num_finished < num_started) {
+        finished.wait(l);
+      }
+    }
+    latency_us.Add(EnvTime::NowMicros() - start);
+    latency_handler.reset();
+    // Leave time for the batch requests to occupy the threads again.
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  done = true;
+  batch_clients_done.Wait();
+
+  state.SetLabel(strings::StrCat("p50=", latency_us.Median(),
+                                 "us p99=", latency_us.Percentile(99), "us"));
+}
+BENCHMARK(BM_MixedLoadTailLatency)->UseRealTime()->Arg(0)->Arg(1);
+
 }  // namespace
 }  // namespace tensorflow
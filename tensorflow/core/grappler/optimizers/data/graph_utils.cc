@@ -442,6 +442,7 @@ const auto* kDeterministicAttrOps = new absl::flat_hash_set<string>{
     "ParallelInterleaveDatasetV4",
     "ParallelMapDatasetV2",
     "ParallelBatchDataset",
+    "SnapshotDatasetV2",
 };
 }  // anonymous namespace
 
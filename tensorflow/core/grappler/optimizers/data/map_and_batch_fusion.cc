@@ -16,16 +16,25 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/data/map_and_batch_fusion.h"
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/grappler/clusters/cluster.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/mutable_graph_view.h"
 #include "tensorflow/core/grappler/op_types.h"
 #include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
 #include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
 #include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/platform/numbers.h"
 #include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/strcat.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -34,6 +43,9 @@ namespace {
 constexpr char kFusedOpName[] = "MapAndBatchDataset";
 constexpr char kParallelMap[] = "ParallelMapDataset";
 constexpr char kParallelMapV2[] = "ParallelMapDatasetV2";
+constexpr char kBatchV2[] = "BatchDatasetV2";
+constexpr char kParseExampleDataset[] = "ParseExampleDatasetV2";
+constexpr char kParseExampleV2[] = "ParseExampleV2";
 
 bool IsParallelMap(const NodeDef& node) {
   return node.op() == kParallelMap || node.op() == kParallelMapV2;
@@ -103,6 +115,259 @@ NodeDef MakeMapAndBatchNode(const NodeDef& map_node, const NodeDef& batch_node,
   return new_node;
 }
 
+// A map function whose only computation is `ParseExampleV2` of its input
+// into fixed length dense features, e.g. `tf.io.parse_single_example` with
+// `FixedLenFeature`s.
+struct ParseExampleFunction {
+  std::vector<Tensor> dense_defaults;
+  std::vector<string> dense_keys;
+  AttrValue dense_types;
+  AttrValue dense_shapes;
+};
+
+// Returns the tensor that `tensor`, a reference to a function body output or
+// argument, forwards through Identity nodes.
+string SkipIdentities(const FunctionDef& function, string tensor) {
+  while (true) {
+    const std::vector<string> parts = absl::StrSplit(tensor, ':');
+    const int index =
+        function_utils::FindFunctionNodeWithName(parts[0], function);
+    if (index < 0) return tensor;
+    const NodeDef& node = function.node_def(index);
+    if (node.op() != "Identity" || node.input_size() != 1) return tensor;
+    tensor = node.input(0);
+  }
+}
+
+// Evaluates `tensor` of `function` if it is a constant, possibly reshaped to
+// a constant shape the way `tf.io` reshapes default values.
+bool EvaluateFunctionConstant(const FunctionDef& function,
+                              const string& tensor, Tensor* value) {
+  const std::vector<string> parts =
+      absl::StrSplit(SkipIdentities(function, tensor), ':');
+  const int index =
+      function_utils::FindFunctionNodeWithName(parts[0], function);
+  if (index < 0) return false;
+  const NodeDef& node = function.node_def(index);
+  if (node.op() == "Const") {
+    const AttrValue* proto = gtl::FindOrNull(node.attr(), "value");
+    return proto != nullptr && value->FromProto(proto->tensor());
+  }
+  if (node.op() != "Reshape" || node.input_size() != 2) return false;
+  Tensor input;
+  Tensor shape;
+  if (!EvaluateFunctionConstant(function, node.input(0), &input) ||
+      !EvaluateFunctionConstant(function, node.input(1), &shape) ||
+      shape.dims() != 1) {
+    return false;
+  }
+  std::vector<int64_t> dims;
+  for (int64_t i = 0; i < shape.NumElements(); ++i) {
+    if (shape.dtype() == DT_INT32) {
+      dims.push_back(shape.vec<int32>()(i));
+    } else if (shape.dtype() == DT_INT64) {
+      dims.push_back(shape.vec<int64_t>()(i));
+    } else {
+      return false;
+    }
+  }
+  TensorShape new_shape;
+  return TensorShapeUtils::MakeShape(dims, &new_shape).ok() &&
+         value->CopyFrom(input, new_shape);
+}
+
+// Returns true if `function` is a ParseExampleFunction whose results, batched
+// by `batch_node`, are exactly what `ParseExampleDatasetV2` would produce for
+// a batch of its inputs.
+bool MatchParseExampleFunction(const FunctionDef& function,
+                               const NodeDef& batch_node,
+                               ParseExampleFunction* match) {
+  const OpDef& signature = function.signature();
+  if (signature.input_arg_size() != 1 ||
+      signature.input_arg(0).type() != DT_STRING ||
+      signature.output_arg_size() == 0 || function.control_ret_size() > 0) {
+    return false;
+  }
+
+  const NodeDef* parse_node = nullptr;
+  for (const NodeDef& node : function.node_def()) {
+    if (node.op() == kParseExampleV2 && parse_node == nullptr) {
+      parse_node = &node;
+    } else if (node.op() != "Const" && node.op() != "Identity" &&
+               node.op() != "Reshape") {
+      return false;
+    }
+  }
+  if (parse_node == nullptr) return false;
+
+  // Sparse and ragged features are batched differently by the dataset, so
+  // only fixed length dense features are supported.
+  const AttrValue* num_sparse =
+      gtl::FindOrNull(parse_node->attr(), "num_sparse");
+  const AttrValue* ragged_types =
+      gtl::FindOrNull(parse_node->attr(), "ragged_value_types");
+  const AttrValue* dense_types = gtl::FindOrNull(parse_node->attr(), "Tdense");
+  const AttrValue* dense_shapes =
+      gtl::FindOrNull(parse_node->attr(), "dense_shapes");
+  if (num_sparse == nullptr || num_sparse->i() != 0 ||
+      (ragged_types != nullptr && ragged_types->list().type_size() > 0) ||
+      dense_types == nullptr || dense_shapes == nullptr) {
+    return false;
+  }
+  const int num_dense = dense_types->list().type_size();
+  if (num_dense == 0 || dense_shapes->list().shape_size() != num_dense) {
+    return false;
+  }
+  for (const TensorShapeProto& shape : dense_shapes->list().shape()) {
+    if (!PartialTensorShape(shape).IsFullyDefined()) return false;
+  }
+
+  // Inputs: serialized, names, sparse_keys, dense_keys, ragged_keys and the
+  // dense defaults, without control inputs.
+  if (parse_node->input_size() != 5 + num_dense ||
+      SkipIdentities(function, parse_node->input(0)) !=
+          signature.input_arg(0).name()) {
+    return false;
+  }
+  Tensor dense_keys;
+  if (!EvaluateFunctionConstant(function, parse_node->input(3), &dense_keys) ||
+      dense_keys.dtype() != DT_STRING ||
+      dense_keys.NumElements() != num_dense) {
+    return false;
+  }
+  match->dense_keys.clear();
+  for (int i = 0; i < num_dense; ++i) {
+    match->dense_keys.push_back(dense_keys.flat<tstring>()(i));
+  }
+  match->dense_defaults.clear();
+  for (int i = 0; i < num_dense; ++i) {
+    Tensor dense_default;
+    if (!EvaluateFunctionConstant(function, parse_node->input(5 + i),
+                                  &dense_default)) {
+      return false;
+    }
+    match->dense_defaults.push_back(std::move(dense_default));
+  }
+
+  // `ParseExampleDatasetV2` produces its features in key order, so the
+  // function has to return every feature in that order.
+  const AttrValue* batch_shapes =
+      gtl::FindOrNull(batch_node.attr(), "output_shapes");
+  if (signature.output_arg_size() != num_dense || batch_shapes == nullptr ||
+      batch_shapes->list().shape_size() != num_dense) {
+    return false;
+  }
+  const string dense_values_prefix =
+      strings::StrCat(parse_node->name(), ":dense_values:");
+  const string* previous_key = nullptr;
+  for (int i = 0; i < num_dense; ++i) {
+    const string* ret =
+        gtl::FindOrNull(function.ret(), signature.output_arg(i).name());
+    if (ret == nullptr) return false;
+    const string resolved = SkipIdentities(function, *ret);
+    StringPiece output = resolved;
+    int32_t index;
+    if (!absl::ConsumePrefix(&output, dense_values_prefix) ||
+        !strings::safe_strto32(output, &index) || index < 0 ||
+        index >= num_dense) {
+      return false;
+    }
+    const string& key = match->dense_keys[index];
+    if (previous_key != nullptr && *previous_key >= key) return false;
+    previous_key = &key;
+    // The batched feature must be the parsed feature with a batch dimension,
+    // which also rules out inputs that are not scalars.
+    const PartialTensorShape batch_shape(batch_shapes->list().shape(i));
+    const int dense_rank = dense_shapes->list().shape(index).dim_size();
+    if (batch_shape.unknown_rank() || batch_shape.dims() != dense_rank + 1) {
+      return false;
+    }
+  }
+  match->dense_types = *dense_types;
+  match->dense_shapes = *dense_shapes;
+  return true;
+}
+
+// Builds `batch(...).parse_example(...)` in place of `map(f).batch(...)` for a
+// ParseExampleFunction `f`, so that the examples of a batch are parsed by a
+// single `FastParseExample` call without a function call per element. Returns
+// the parse node.
+NodeDef* AddBatchAndParseExampleNodes(const NodeDef& map_node,
+                                      const NodeDef& batch_node,
+                                      const ParseExampleFunction& parse,
+                                      MutableGraphView* graph) {
+  NodeDef batch;
+  batch.set_op(kBatchV2);
+  graph_utils::SetUniqueGraphNodeName(kBatchV2, graph->graph(), &batch);
+  batch.add_input(map_node.input(0));
+  batch.add_input(batch_node.input(1));
+  if (batch_node.op() == kBatchV2) {
+    batch.add_input(batch_node.input(2));
+  } else {
+    NodeDef* tmp = graph_utils::AddScalarConstNode<bool>(false, graph);
+    batch.add_input(tmp->name());
+  }
+  if (gtl::FindOrNull(batch_node.attr(), "parallel_copy")) {
+    graph_utils::CopyAttribute("parallel_copy", batch_node, &batch);
+  }
+  SetAttrValue(DataTypeSlice({DT_STRING}),
+               &(*batch.mutable_attr())["output_types"]);
+  const PartialTensorShape batch_shape({-1});
+  SetAttrValue(gtl::ArraySlice<PartialTensorShape>(&batch_shape, 1),
+               &(*batch.mutable_attr())["output_shapes"]);
+  NodeDef* batch_of_strings = graph->AddNode(std::move(batch));
+
+  NodeDef parse_example;
+  parse_example.set_op(kParseExampleDataset);
+  graph_utils::SetUniqueGraphNodeName(kParseExampleDataset, graph->graph(),
+                                      &parse_example);
+  parse_example.add_input(batch_of_strings->name());
+
+  // Set the `num_parallel_calls` input argument.
+  if (map_node.op() == kParallelMapV2) {
+    parse_example.add_input(map_node.input(map_node.input_size() - 1));
+  } else if (map_node.op() == kParallelMap) {
+    NodeDef* v = graph->GetNode(map_node.input(map_node.input_size() - 1));
+    NodeDef* tmp = graph_utils::AddScalarConstNode<int64_t>(
+        v->attr().at("value").tensor().int_val(0), graph);
+    parse_example.add_input(tmp->name());
+  } else {
+    NodeDef* tmp = graph_utils::AddScalarConstNode<int64_t>(1, graph);
+    parse_example.add_input(tmp->name());
+  }
+
+  // Set the `dense_defaults` input arguments from the function's constants.
+  for (const Tensor& value : parse.dense_defaults) {
+    NodeDef dense_default;
+    dense_default.set_op("Const");
+    graph_utils::SetUniqueGraphNodeName("dense_default", graph->graph(),
+                                        &dense_default);
+    SetAttrValue(value.dtype(), &(*dense_default.mutable_attr())["dtype"]);
+    value.AsProtoTensorContent(
+        (*dense_default.mutable_attr())["value"].mutable_tensor());
+    parse_example.add_input(graph->AddNode(std::move(dense_default))->name());
+  }
+
+  auto* attr = parse_example.mutable_attr();
+  SetAttrValue(gtl::ArraySlice<string>(), &(*attr)["sparse_keys"]);
+  SetAttrValue(gtl::ArraySlice<string>(parse.dense_keys),
+               &(*attr)["dense_keys"]);
+  SetAttrValue(DataTypeSlice(), &(*attr)["sparse_types"]);
+  (*attr)["Tdense"] = parse.dense_types;
+  (*attr)["dense_shapes"] = parse.dense_shapes;
+  graph_utils::CopyShapesAndTypesAttrs(batch_node, &parse_example);
+  const AttrValue* sloppy = gtl::FindOrNull(map_node.attr(), "sloppy");
+  if (gtl::FindOrNull(map_node.attr(), "deterministic")) {
+    graph_utils::CopyAttribute("deterministic", map_node, &parse_example);
+  } else if (sloppy != nullptr && sloppy->b()) {
+    SetAttrValue("false", &(*attr)["deterministic"]);
+  } else {
+    SetAttrValue("default", &(*attr)["deterministic"]);
+  }
+  graph_utils::MaybeSetFusedMetadata(map_node, batch_node, &parse_example);
+  return graph->AddNode(std::move(parse_example));
+}
+
 }  // namespace
 
 Status MapAndBatchFusion::OptimizeAndCollectStats(Cluster* cluster,
@@ -112,6 +377,8 @@ Status MapAndBatchFusion::OptimizeAndCollectStats(Cluster* cluster,
   *output = item.graph;
   MutableGraphView graph(output);
   absl::flat_hash_set<string> nodes_to_delete;
+  FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                             item.graph.library());
   for (const NodeDef& node : item.graph.node()) {
     if (node.op() != "BatchDataset" && node.op() != "BatchDatasetV2") {
       continue;
@@ -127,8 +394,21 @@ Status MapAndBatchFusion::OptimizeAndCollectStats(Cluster* cluster,
     // Use a more descriptive variable name now that we know the node type.
     NodeDef* map_node = node2;
 
-    auto* new_node =
-        graph.AddNode(MakeMapAndBatchNode(*map_node, batch_node, &graph));
+    // A map that only parses Examples is lowered to a batch of serialized
+    // Examples that is parsed at once, instead of being fused.
+    const FunctionDef* function =
+        function_library.Find(map_node->attr().at("f").func().name());
+    ParseExampleFunction parse_example;
+    NodeDef* new_node;
+    if (function != nullptr && map_node->input_size() ==
+                                   (IsParallelMap(*map_node) ? 2 : 1) &&
+        MatchParseExampleFunction(*function, batch_node, &parse_example)) {
+      new_node = AddBatchAndParseExampleNodes(*map_node, batch_node,
+                                              parse_example, &graph);
+    } else {
+      new_node =
+          graph.AddNode(MakeMapAndBatchNode(*map_node, batch_node, &graph));
+    }
     TF_RETURN_IF_ERROR(
         graph.UpdateFanouts(batch_node.name(), new_node->name()));
 
@@ -15,7 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/data/map_and_batch_fusion.h"
 
+#include <algorithm>
+
 #include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -402,6 +406,158 @@ TEST(MapAndBatchFusionTest, NoChange) {
   EXPECT_TRUE(graph_utils::Compare(*graph.graph(), output));
 }
 
+// Returns `parse_single_example(serialized, {"a": FixedLenFeature([], float),
+// "b": FixedLenFeature([2], int64, default_value=[0, 0])})`, with the
+// features returned in key order or in reverse.
+FunctionDef ParseExampleFunction(bool sorted_outputs) {
+  using FDH = FunctionDefHelper;
+  std::vector<string> out_def = {"a: float", "b: int64"};
+  std::vector<std::pair<string, string>> ret_def = {
+      {"a", "parse:dense_values:0"}, {"b", "parse:dense_values:1"}};
+  if (!sorted_outputs) {
+    std::reverse(out_def.begin(), out_def.end());
+    std::reverse(ret_def.begin(), ret_def.end());
+  }
+  return FDH::Create(
+      "ParseExampleFn", {"serialized: string"}, out_def, {},
+      {FDH::Const<tstring>("names", gtl::ArraySlice<tstring>()),
+       FDH::Const<tstring>("sparse_keys", gtl::ArraySlice<tstring>()),
+       FDH::Const<tstring>("dense_keys", gtl::ArraySlice<tstring>({"a", "b"})),
+       FDH::Const<tstring>("ragged_keys", gtl::ArraySlice<tstring>()),
+       FDH::Const<float>("default_a", gtl::ArraySlice<float>()),
+       FDH::Const<int64_t>("default_b_value", gtl::ArraySlice<int64_t>({0, 0})),
+       FDH::Const<int32>("default_b_shape", gtl::ArraySlice<int32>({2})),
+       {{"default_b"},
+        "Reshape",
+        {"default_b_value:output:0", "default_b_shape:output:0"},
+        {{"T", DT_INT64}, {"Tshape", DT_INT32}}},
+       {{"parse"},
+        "ParseExampleV2",
+        {"serialized", "names:output:0", "sparse_keys:output:0",
+         "dense_keys:output:0", "ragged_keys:output:0", "default_a:output:0",
+         "default_b:output:0"},
+        {{"Tdense", DataTypeSlice{DT_FLOAT, DT_INT64}},
+         {"num_sparse", 0},
+         {"sparse_types", DataTypeSlice{}},
+         {"ragged_value_types", DataTypeSlice{}},
+         {"ragged_split_types", DataTypeSlice{}},
+         {"dense_shapes", gtl::ArraySlice<TensorShape>(
+                              {TensorShape({}), TensorShape({2})})}}}},
+      ret_def);
+}
+
+// Adds `source.map(ParseExampleFn).batch(5, drop_remainder)` to `item`.
+void AddParseExamplePipeline(bool sorted_outputs, GrapplerItem *item,
+                             NodeDef **map_node, NodeDef **batch_node) {
+  *item->graph.mutable_library()->add_function() =
+      ParseExampleFunction(sorted_outputs);
+  MutableGraphView graph(&item->graph);
+
+  NodeDef *source_node = graph_utils::AddNode("", "TFRecordDataset", {}, {},
+                                              &graph);
+  AttrValue f_attr;
+  f_attr.mutable_func()->set_name("ParseExampleFn");
+  AttrValue args_attr;
+  SetAttrValue(DataTypeSlice{}, &args_attr);
+  *map_node = graph_utils::AddNode(
+      "", "MapDataset", {source_node->name()},
+      {{"f", f_attr}, {"Targuments", args_attr}}, &graph);
+
+  NodeDef *batch_size_node =
+      graph_utils::AddScalarConstNode<int64_t>(5, &graph);
+  NodeDef *drop_remainder_node =
+      graph_utils::AddScalarConstNode<bool>(true, &graph);
+  AttrValue shapes_attr;
+  AttrValue types_attr;
+  if (sorted_outputs) {
+    SetAttrValue(gtl::ArraySlice<PartialTensorShape>(
+                     {PartialTensorShape({5}), PartialTensorShape({5, 2})}),
+                 &shapes_attr);
+    SetAttrValue(DataTypeSlice{DT_FLOAT, DT_INT64}, &types_attr);
+  } else {
+    SetAttrValue(gtl::ArraySlice<PartialTensorShape>(
+                     {PartialTensorShape({5, 2}), PartialTensorShape({5})}),
+                 &shapes_attr);
+    SetAttrValue(DataTypeSlice{DT_INT64, DT_FLOAT}, &types_attr);
+  }
+  *batch_node = graph_utils::AddNode(
+      "", "BatchDatasetV2",
+      {(*map_node)->name(), batch_size_node->name(),
+       drop_remainder_node->name()},
+      {{"output_shapes", shapes_attr}, {"output_types", types_attr}}, &graph);
+}
+
+TEST(MapAndBatchFusionTest, LowerParseExampleMapToBatchedParse) {
+  GrapplerItem item;
+  NodeDef *map_node;
+  NodeDef *batch_node;
+  AddParseExamplePipeline(/*sorted_outputs=*/true, &item, &map_node,
+                          &batch_node);
+  const NodeDef map_copy = *map_node;
+  const NodeDef batch_copy = *batch_node;
+
+  MapAndBatchFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(
+      graph_utils::ContainsGraphNodeWithName(map_copy.name(), output));
+  EXPECT_FALSE(
+      graph_utils::ContainsGraphNodeWithName(batch_copy.name(), output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithOp("MapAndBatchDataset", output));
+  ASSERT_TRUE(graph_utils::ContainsNodeWithOp("ParseExampleDatasetV2", output));
+  const NodeDef &parse_node = output.node(
+      graph_utils::FindGraphNodeWithOp("ParseExampleDatasetV2", output));
+
+  // input_dataset, num_parallel_calls and one default per dense feature.
+  ASSERT_EQ(parse_node.input_size(), 4);
+  const NodeDef &strings_batch_node = output.node(
+      graph_utils::FindGraphNodeWithName(parse_node.input(0), output));
+  EXPECT_EQ(strings_batch_node.op(), "BatchDatasetV2");
+  EXPECT_EQ(strings_batch_node.input(0), map_copy.input(0));
+  EXPECT_EQ(strings_batch_node.input(1), batch_copy.input(1));
+  EXPECT_EQ(strings_batch_node.input(2), batch_copy.input(2));
+  const NodeDef &num_parallel_calls_node = output.node(
+      graph_utils::FindGraphNodeWithName(parse_node.input(1), output));
+  EXPECT_EQ(num_parallel_calls_node.attr().at("value").tensor().int64_val(0),
+            1);
+  const NodeDef &default_b_node = output.node(
+      graph_utils::FindGraphNodeWithName(parse_node.input(3), output));
+  EXPECT_EQ(default_b_node.op(), "Const");
+  EXPECT_EQ(default_b_node.attr().at("dtype").type(), DT_INT64);
+  Tensor default_b;
+  ASSERT_TRUE(default_b.FromProto(default_b_node.attr().at("value").tensor()));
+  EXPECT_EQ(default_b.shape(), TensorShape({2}));
+
+  AttrValue dense_keys;
+  SetAttrValue(gtl::ArraySlice<string>({"a", "b"}), &dense_keys);
+  EXPECT_TRUE(
+      AreAttrValuesEqual(parse_node.attr().at("dense_keys"), dense_keys));
+  EXPECT_EQ(parse_node.attr().at("sparse_keys").list().s_size(), 0);
+  EXPECT_TRUE(AreAttrValuesEqual(parse_node.attr().at("output_shapes"),
+                                 batch_copy.attr().at("output_shapes")));
+  EXPECT_TRUE(AreAttrValuesEqual(parse_node.attr().at("output_types"),
+                                 batch_copy.attr().at("output_types")));
+}
+
+TEST(MapAndBatchFusionTest, FuseParseExampleMapWithUnsortedOutputs) {
+  // The features are not returned in the order `ParseExampleDatasetV2`
+  // produces them in, so the map is fused instead of lowered.
+  GrapplerItem item;
+  NodeDef *map_node;
+  NodeDef *batch_node;
+  AddParseExamplePipeline(/*sorted_outputs=*/false, &item, &map_node,
+                          &batch_node);
+
+  MapAndBatchFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_TRUE(graph_utils::ContainsNodeWithOp("MapAndBatchDataset", output));
+  EXPECT_FALSE(
+      graph_utils::ContainsNodeWithOp("ParseExampleDatasetV2", output));
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -40,6 +40,20 @@ constexpr char kShuffleAndRepeatDataset[] = "ShuffleAndRepeatDataset";
 constexpr char kShuffleAndRepeatDatasetV2[] = "ShuffleAndRepeatDatasetV2";
 
 constexpr char kReshuffleEachIteration[] = "reshuffle_each_iteration";
+constexpr char kBlockLength[] = "block_length";
+constexpr char kBufferSizeBytes[] = "buffer_size_bytes";
+
+// `ShuffleAndRepeatDatasetV2` has no equivalent of the block and byte budget
+// modes of `ShuffleDatasetV3`, so shuffle nodes using them are not fused.
+bool UsesBlockOrByteBudget(const NodeDef& shuffle_node) {
+  for (const char* attr : {kBlockLength, kBufferSizeBytes}) {
+    auto it = shuffle_node.attr().find(attr);
+    if (it != shuffle_node.attr().end() && it->second.i() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
 
 Status FuseShuffleV1AndRepeat(const NodeDef& shuffle_node,
                               const NodeDef& repeat_node,
@@ -178,6 +192,9 @@ Status ShuffleAndRepeatFusion::OptimizeAndCollectStats(
                                                 &graph, output, &fused_node));
 
     } else if (shuffle_node.op() == kShuffleDatasetV3) {
+      if (UsesBlockOrByteBudget(shuffle_node)) {
+        continue;
+      }
       TF_RETURN_IF_ERROR(FuseShuffleV3AndRepeat(shuffle_node, repeat_node,
                                                 &graph, output, &fused_node));
     } else {
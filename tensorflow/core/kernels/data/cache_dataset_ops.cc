@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <algorithm>
+#include <deque>
 #include <memory>
 #include <string>
 #include <utility>
@@ -29,9 +31,12 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/kernels/data/iterator_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
@@ -46,6 +51,8 @@ namespace data {
 /* static */ constexpr const char* const CacheDatasetOp::kFileName;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const CacheDatasetOp::kCompression;
+/* static */ constexpr const char* const CacheDatasetOp::kRamBudget;
 
 namespace {
 
@@ -59,6 +66,7 @@ constexpr char kCurIndex[] = "cur_index";
 constexpr char kShardId[] = "shard_id";
 constexpr char kCreatedAt[] = "Created at";
 constexpr char kMemoryDatasetPrefix[] = "Memory";
+constexpr char kCompressedMemoryDatasetPrefix[] = "CompressedMemory";
 constexpr char kMemoryCache[] = "MemoryCache";
 constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
@@ -1110,15 +1118,447 @@ class CacheDatasetOp::MemoryDatasetV2
   ResourceMgr* const resource_mgr_;  // Not owned.
 };
 
+// This version of memory dataset keeps the cached elements compressed and
+// spills the elements past its memory budget to local disk. The cache is
+// shared by the iterators of this dataset: each writer iterator fills a
+// private cache and the first one to reach the end of its input publishes it.
+// Reader iterators uncompress a window of upcoming elements in parallel.
+class CacheDatasetOp::CompressedMemoryDataset : public DatasetBase {
+ public:
+  CompressedMemoryDataset(OpKernelContext* ctx, const DatasetBase* input,
+                          std::string compression, int64_t ram_budget,
+                          const Tensor& resource_handle)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        env_(ctx->env()),
+        compression_(std::move(compression)),
+        ram_budget_(ram_budget),
+        resource_handle_(resource_handle) {
+    input_->Ref();
+  }
+
+  ~CompressedMemoryDataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    name_utils::IteratorPrefixParams params;
+    params.dataset_prefix = kCompressedMemoryDatasetPrefix;
+    return std::make_unique<CompressedMemoryIterator>(
+        CompressedMemoryIterator::Params{
+            this, name_utils::IteratorPrefix(kDatasetType, prefix, params)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return input_->output_shapes();
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.dataset_prefix = kCompressedMemoryDatasetPrefix;
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t CardinalityInternal() const override {
+    return input_->Cardinality();
+  };
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return input_->Cardinality(options);
+  };
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
+    Node* filename_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(tstring(""), &filename_node));
+    Node* resource_handle_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddTensor(resource_handle_, &resource_handle_node));
+    AttrValue compression;
+    b->BuildAttrValue(compression_, &compression);
+    AttrValue ram_budget;
+    b->BuildAttrValue(ram_budget_, &ram_budget);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, {input_node, filename_node, resource_handle_node},  // Inputs
+        {std::make_pair(kCompression, compression),
+         std::make_pair(kRamBudget, ram_budget)},  // Attrs
+        output));
+    return OkStatus();
+  }
+
+ private:
+  class CompressedMemoryIterator
+      : public DatasetIterator<CompressedMemoryDataset> {
+   public:
+    explicit CompressedMemoryIterator(const Params& params)
+        : DatasetIterator<CompressedMemoryDataset>(params) {}
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      return InitializeIterator(ctx);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      return iterator_->GetNext(ctx, out_tensors, end_of_sequence);
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      std::shared_ptr<CompressedCache> cache = dataset()->completed_cache();
+      if (cache) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCacheCompleted), ""));
+        TF_RETURN_IF_ERROR(cache->Save(writer, prefix()));
+      }
+      return SaveInput(ctx, writer, iterator_);
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      iterator_.reset();
+      dataset()->ResetCache();
+      if (reader->Contains(full_name(kCacheCompleted))) {
+        auto cache = std::make_shared<CompressedCache>(dataset()->env_,
+                                                       dataset()->ram_budget_);
+        TF_RETURN_IF_ERROR(cache->Restore(reader, prefix()));
+        TF_RETURN_IF_ERROR(cache->Finalize());
+        dataset()->CompleteCache(std::move(cache));
+      }
+      TF_RETURN_IF_ERROR(InitializeIterator(ctx));
+      return RestoreInput(ctx, reader, iterator_);
+    }
+
+   private:
+    class CompressedWriterIterator
+        : public DatasetIterator<CompressedMemoryDataset> {
+     public:
+      explicit CompressedWriterIterator(const Params& params)
+          : DatasetIterator<CompressedMemoryDataset>(params),
+            cache_(std::make_shared<CompressedCache>(
+                params.dataset->env_, params.dataset->ram_budget_)) {}
+
+      ~CompressedWriterIterator() override {
+        mutex_lock l(mu_);
+        if (cache_ && cache_->size() > 0) {
+          LOG(WARNING) << kIncompleteCacheErrorMessage;
+        }
+      }
+
+      Status Initialize(IteratorContext* ctx) override {
+        return dataset()->input_->MakeIterator(ctx, this, prefix(),
+                                               &input_impl_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+        if (*end_of_sequence) {
+          if (cache_) {
+            VLOG(2) << "Finalizing the cache because EOF has been reached.";
+            TF_RETURN_IF_ERROR(Complete());
+          }
+          return OkStatus();
+        }
+        if (!cache_) {
+          return OkStatus();
+        }
+        TF_RETURN_IF_ERROR(cache_->Add(*out_tensors));
+        if (cache_->size() == dataset()->input_->Cardinality()) {
+          VLOG(2) << "Finalizing the cache because its size matches the "
+                     "expected input cardinality.";
+          TF_RETURN_IF_ERROR(Complete());
+        }
+        return OkStatus();
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+
+      Status SaveInternal(SerializationContext* ctx,
+                          IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        if (cache_) {
+          TF_RETURN_IF_ERROR(cache_->Save(writer, prefix()));
+        }
+        return SaveInput(ctx, writer, input_impl_);
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        cache_ = std::make_shared<CompressedCache>(dataset()->env_,
+                                                   dataset()->ram_budget_);
+        TF_RETURN_IF_ERROR(cache_->Restore(reader, prefix()));
+        return RestoreInput(ctx, reader, input_impl_);
+      }
+
+     private:
+      Status Complete() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TF_RETURN_IF_ERROR(cache_->Finalize());
+        VLOG(2) << "Cached " << cache_->size() << " elements in "
+                << cache_->memory_bytes() << " bytes of memory and "
+                << cache_->spilled_bytes() << " bytes on disk.";
+        dataset()->CompleteCache(std::move(cache_));
+        cache_ = nullptr;
+        return OkStatus();
+      }
+
+      mutex mu_;
+      std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+      // The cache being written, or nullptr once it has been published.
+      std::shared_ptr<CompressedCache> cache_ TF_GUARDED_BY(mu_);
+    };  // CompressedWriterIterator
+
+    class CompressedReaderIterator
+        : public DatasetIterator<CompressedMemoryDataset> {
+     public:
+      explicit CompressedReaderIterator(const Params& params,
+                                        std::shared_ptr<CompressedCache> cache)
+          : DatasetIterator<CompressedMemoryDataset>(params),
+            cache_(std::move(cache)) {}
+
+      ~CompressedReaderIterator() override {
+        mutex_lock l(mu_);
+        WaitForReads(&l);
+      }
+
+      Status Initialize(IteratorContext* ctx) override {
+        mutex_lock l(mu_);
+        read_ahead_ = std::max(1, ctx->runner_threadpool_size());
+        return OkStatus();
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        std::shared_ptr<Read> read;
+        std::vector<std::pair<int64_t, std::shared_ptr<Read>>> new_reads;
+        {
+          mutex_lock l(mu_);
+          QueueReads(&new_reads);
+          if (reads_.empty()) {
+            *end_of_sequence = true;
+            return OkStatus();
+          }
+          read = reads_.front();
+          reads_.pop_front();
+          index_++;
+          QueueReads(&new_reads);
+        }
+        StartReads(ctx, std::move(new_reads));
+        read->done.WaitForNotification();
+        TF_RETURN_IF_ERROR(read->status);
+        *out_tensors = std::move(read->element);
+        *end_of_sequence = false;
+        return OkStatus();
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+
+      Status SaveInternal(SerializationContext* ctx,
+                          IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kIndex), index_));
+        return OkStatus();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        WaitForReads(&l);
+        reads_.clear();
+        {
+          // kIndex will not be set if we are restoring from a checkpoint
+          // written by a CompressedWriterIterator that has completed its
+          // cache.
+          int64_t temp = cache_->size();
+          if (reader->Contains(full_name(kIndex))) {
+            TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kIndex), &temp));
+          }
+          index_ = temp;
+          next_index_ = temp;
+        }
+        return OkStatus();
+      }
+
+     private:
+      // An element being read from the cache.
+      struct Read {
+        Notification done;
+        Status status;
+        std::vector<Tensor> element;
+      };
+
+      // Queues reads of the next elements until `read_ahead_` reads are
+      // outstanding, and appends them to `new_reads` to be started by
+      // `StartReads`.
+      void QueueReads(
+          std::vector<std::pair<int64_t, std::shared_ptr<Read>>>* new_reads)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        while (static_cast<int64_t>(reads_.size()) < read_ahead_ &&
+               next_index_ < static_cast<int64_t>(cache_->size())) {
+          reads_.push_back(std::make_shared<Read>());
+          new_reads->emplace_back(next_index_++, reads_.back());
+          num_reads_in_flight_++;
+        }
+      }
+
+      // Schedules `new_reads` on the runner. This must be called without
+      // holding `mu_` because the runner may run the reads inline.
+      void StartReads(
+          IteratorContext* ctx,
+          std::vector<std::pair<int64_t, std::shared_ptr<Read>>> new_reads)
+          TF_LOCKS_EXCLUDED(mu_) {
+        for (auto& new_read : new_reads) {
+          (*ctx->runner())([this, index = new_read.first,
+                            read = std::move(new_read.second)]() {
+            read->status = cache_->Get(index, &read->element);
+            read->done.Notify();
+            mutex_lock l(mu_);
+            num_reads_in_flight_--;
+            cond_var_.notify_all();
+          });
+        }
+      }
+
+      void WaitForReads(mutex_lock* l) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        while (num_reads_in_flight_ > 0) {
+          cond_var_.wait(*l);
+        }
+      }
+
+      mutex mu_;
+      condition_variable cond_var_;
+      const std::shared_ptr<CompressedCache> cache_;
+      int64_t read_ahead_ TF_GUARDED_BY(mu_) = 1;
+      // Index of the next element to produce.
+      int64_t index_ TF_GUARDED_BY(mu_) = 0;
+      // Index of the next element to start reading.
+      int64_t next_index_ TF_GUARDED_BY(mu_) = 0;
+      int64_t num_reads_in_flight_ TF_GUARDED_BY(mu_) = 0;
+      // Reads of the elements `index_` to `next_index_ - 1`, in order.
+      std::deque<std::shared_ptr<Read>> reads_ TF_GUARDED_BY(mu_);
+    };  // CompressedReaderIterator
+
+    Status InitializeIterator(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      std::shared_ptr<CompressedCache> cache = dataset()->completed_cache();
+      if (cache) {
+        iterator_ = std::make_unique<CompressedReaderIterator>(
+            CompressedReaderIterator::Params{dataset(),
+                                             strings::StrCat(prefix(), kImpl)},
+            std::move(cache));
+      } else {
+        iterator_ = std::make_unique<CompressedWriterIterator>(
+            CompressedWriterIterator::Params{
+                dataset(), strings::StrCat(prefix(), kImpl)});
+      }
+      TF_RETURN_IF_ERROR(iterator_->InitializeBase(ctx, this));
+      return iterator_->Initialize(ctx);
+    }
+
+    mutex mu_;
+    std::unique_ptr<IteratorBase> iterator_ TF_GUARDED_BY(mu_);
+  };  // CompressedMemoryIterator
+
+  // Returns the completed cache, or nullptr if no iterator has completed it.
+  std::shared_ptr<CompressedCache> completed_cache() const {
+    tf_shared_lock l(mu_);
+    return cache_;
+  }
+
+  // Publishes `cache` unless another iterator has completed the cache first.
+  void CompleteCache(std::shared_ptr<CompressedCache> cache) const {
+    mutex_lock l(mu_);
+    if (!cache_) {
+      cache_ = std::move(cache);
+    }
+  }
+
+  void ResetCache() const {
+    mutex_lock l(mu_);
+    cache_.reset();
+  }
+
+  const DatasetBase* const input_;
+  Env* const env_;
+  const std::string compression_;
+  const int64_t ram_budget_;
+  const Tensor resource_handle_;
+  mutable mutex mu_;
+  mutable std::shared_ptr<CompressedCache> cache_ TF_GUARDED_BY(mu_);
+};  // CompressedMemoryDataset
+
 CacheDatasetOp::CacheDatasetOp(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {
+  if (ctx->HasAttr(kCompression)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kCompression, &compression_));
+    OP_REQUIRES(
+        ctx, compression_.empty() || compression_ == io::compression::kSnappy,
+        errors::InvalidArgument("Unsupported cache compression '", compression_,
+                                "'. Expected '' or '", io::compression::kSnappy,
+                                "'."));
+  }
+  if (ctx->HasAttr(kRamBudget)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kRamBudget, &ram_budget_));
+    OP_REQUIRES(ctx, ram_budget_ == 0 || !compression_.empty(),
+                errors::InvalidArgument(
+                    "`ram_budget` requires the cache to be compressed."));
+  }
+}
 
 void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                                  DatasetBase** output) {
   // Parse out the filenames tensor.
   tstring filename;
   OP_REQUIRES_OK(ctx, ParseScalarArgument<tstring>(ctx, kFileName, &filename));
+  OP_REQUIRES(ctx, compression_.empty() || filename.empty(),
+              errors::InvalidArgument(
+                  "Compression is only supported for in-memory caches."));
+  if (!compression_.empty()) {
+    *output = new CompressedMemoryDataset(ctx, input, compression_,
+                                          ram_budget_, ctx->input(2));
+    return;
+  }
   if (filename.empty()) {
     static std::atomic<int64_t> resource_id_counter(0);
     const string& container = ctx->resource_manager()->default_container();
@@ -30,6 +30,8 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   static constexpr const char* const kFileName = "filename";
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
+  static constexpr const char* const kCompression = "compression";
+  static constexpr const char* const kRamBudget = "ram_budget";
 
   explicit CacheDatasetOp(OpKernelConstruction* ctx);
 
@@ -42,8 +44,11 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   class FileDatasetV2;
   class MemoryDataset;
   class MemoryDatasetV2;
+  class CompressedMemoryDataset;
 
   const int op_version_;
+  std::string compression_;
+  int64_t ram_budget_ = 0;
 };
 
 }  // namespace data
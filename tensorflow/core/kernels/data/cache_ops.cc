@@ -14,6 +14,11 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_ops.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -22,12 +27,16 @@ limitations under the License.
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/strcat.h"
 
 namespace tensorflow {
 namespace data {
 namespace {
 
 constexpr char kMemoryCache[] = "MemoryCache";
+constexpr char kNumElements[] = "num_elements";
+constexpr char kCompressed[] = "compressed";
 
 }  // namespace
 
@@ -68,6 +77,173 @@ const std::vector<std::vector<Tensor>>& MemoryCache::data() {
   return cache_;
 }
 
+CompressedCache::CompressedCache(Env* env, int64_t ram_budget)
+    : env_(env), ram_budget_(ram_budget) {}
+
+CompressedCache::~CompressedCache() {
+  mutex_lock l(mu_);
+  spill_reader_.reset();
+  if (spill_writer_) {
+    spill_writer_->Close().IgnoreError();
+    spill_writer_.reset();
+  }
+  if (!spill_filename_.empty()) {
+    Status s = env_->DeleteFile(spill_filename_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to delete cache spill file " << spill_filename_
+                   << ": " << s.ToString();
+    }
+  }
+}
+
+Status CompressedCache::Add(const std::vector<Tensor>& element) {
+  TF_ASSIGN_OR_RETURN(std::string compressed, CompressAndSerialize(element));
+  mutex_lock l(mu_);
+  return AddCompressedLocked(std::move(compressed));
+}
+
+Status CompressedCache::AddCompressed(std::string compressed) {
+  mutex_lock l(mu_);
+  return AddCompressedLocked(std::move(compressed));
+}
+
+Status CompressedCache::AddCompressedLocked(std::string compressed) {
+  if (finalized_) {
+    return errors::FailedPrecondition(
+        "Cannot add elements to a finalized cache.");
+  }
+  const int64_t size = compressed.size();
+  if (spilled_.empty() &&
+      (ram_budget_ == 0 || memory_bytes_ + size <= ram_budget_)) {
+    memory_bytes_ += size;
+    in_memory_.push_back(std::move(compressed));
+    return OkStatus();
+  }
+  if (!spill_writer_) {
+    if (!env_->LocalTempFilename(&spill_filename_)) {
+      return errors::Internal(
+          "Failed to create a temporary file to spill the cache to.");
+    }
+    TF_RETURN_IF_ERROR(env_->NewWritableFile(spill_filename_, &spill_writer_));
+    TF_RETURN_IF_ERROR(
+        env_->NewRandomAccessFile(spill_filename_, &spill_reader_));
+    VLOG(2) << "Cache exceeded its memory budget of " << ram_budget_
+            << " bytes after " << in_memory_.size()
+            << " elements. Spilling the remaining elements to "
+            << spill_filename_;
+  }
+  TF_RETURN_IF_ERROR(spill_writer_->Append(compressed));
+  spilled_.push_back({spill_size_, static_cast<uint64>(size)});
+  spill_size_ += size;
+  return OkStatus();
+}
+
+Status CompressedCache::Finalize() {
+  mutex_lock l(mu_);
+  finalized_ = true;
+  if (spill_writer_) {
+    TF_RETURN_IF_ERROR(spill_writer_->Close());
+    spill_writer_.reset();
+  }
+  return OkStatus();
+}
+
+Status CompressedCache::FlushSpillFile() {
+  if (spill_writer_) {
+    TF_RETURN_IF_ERROR(spill_writer_->Flush());
+  }
+  return OkStatus();
+}
+
+Status CompressedCache::GetCompressed(int64_t index, std::string* scratch,
+                                      StringPiece* out) {
+  if (index < 0 || index >= in_memory_.size() + spilled_.size()) {
+    return errors::OutOfRange("Index out of range [0, ",
+                              in_memory_.size() + spilled_.size(),
+                              "):", index);
+  }
+  if (index < in_memory_.size()) {
+    *out = in_memory_[index];
+    return OkStatus();
+  }
+  const SpilledElement& element = spilled_[index - in_memory_.size()];
+  scratch->resize(element.size);
+  TF_RETURN_IF_ERROR(
+      spill_reader_->Read(element.offset, element.size, out, &(*scratch)[0]));
+  if (out->size() != element.size) {
+    return errors::DataLoss("Cache spill file ", spill_filename_,
+                            " is truncated: expected ", element.size,
+                            " bytes at offset ", element.offset, ", got ",
+                            out->size());
+  }
+  return OkStatus();
+}
+
+Status CompressedCache::Get(int64_t index, std::vector<Tensor>* out) {
+  std::string scratch;
+  StringPiece compressed;
+  {
+    tf_shared_lock l(mu_);
+    if (!finalized_) {
+      return errors::FailedPrecondition(
+          "Cannot read elements from a cache that is still being written.");
+    }
+    TF_RETURN_IF_ERROR(GetCompressed(index, &scratch, &compressed));
+  }
+  // A finalized cache is never modified, so `compressed` stays valid after
+  // the lock is released.
+  TF_ASSIGN_OR_RETURN(*out, DeserializeAndUncompress(compressed));
+  return OkStatus();
+}
+
+size_t CompressedCache::size() {
+  tf_shared_lock l(mu_);
+  return in_memory_.size() + spilled_.size();
+}
+
+int64_t CompressedCache::memory_bytes() {
+  tf_shared_lock l(mu_);
+  return memory_bytes_;
+}
+
+int64_t CompressedCache::spilled_bytes() {
+  tf_shared_lock l(mu_);
+  return spill_size_;
+}
+
+Status CompressedCache::Save(IteratorStateWriter* writer,
+                             StringPiece key_prefix) {
+  mutex_lock l(mu_);
+  TF_RETURN_IF_ERROR(FlushSpillFile());
+  const int64_t num_elements = in_memory_.size() + spilled_.size();
+  TF_RETURN_IF_ERROR(writer->WriteScalar(key_prefix, kNumElements,
+                                         num_elements));
+  std::string scratch;
+  StringPiece compressed;
+  for (int64_t i = 0; i < num_elements; ++i) {
+    TF_RETURN_IF_ERROR(GetCompressed(i, &scratch, &compressed));
+    TF_RETURN_IF_ERROR(writer->WriteScalar(
+        key_prefix, strings::StrCat(kCompressed, "[", i, "]"),
+        tstring(compressed.data(), compressed.size())));
+  }
+  return OkStatus();
+}
+
+Status CompressedCache::Restore(IteratorStateReader* reader,
+                                StringPiece key_prefix) {
+  int64_t num_elements;
+  TF_RETURN_IF_ERROR(
+      reader->ReadScalar(key_prefix, kNumElements, &num_elements));
+  mutex_lock l(mu_);
+  for (int64_t i = 0; i < num_elements; ++i) {
+    tstring compressed;
+    TF_RETURN_IF_ERROR(reader->ReadScalar(
+        key_prefix, strings::StrCat(kCompressed, "[", i, "]"), &compressed));
+    TF_RETURN_IF_ERROR(AddCompressedLocked(std::string(compressed)));
+  }
+  return OkStatus();
+}
+
 AnonymousMemoryCacheHandleOp::AnonymousMemoryCacheHandleOp(
     OpKernelConstruction* ctx)
     : AnonymousResourceOp<MemoryCacheManager>(ctx,
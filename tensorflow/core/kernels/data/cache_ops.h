@@ -16,8 +16,14 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
 namespace data {
@@ -57,6 +63,81 @@ class MemoryCache {
   std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
 };
 
+// A thread-safe data structure for caching compressed dataset elements.
+//
+// Elements are compressed with snappy and kept in memory until the compressed
+// bytes reach `ram_budget`. Later elements are appended to a temporary file on
+// local disk. A `ram_budget` of 0 keeps all elements in memory.
+//
+// The expected use is that a single writer adds elements and then calls
+// `Finalize()`, after which any number of threads may call `Get()`.
+class CompressedCache {
+ public:
+  CompressedCache(Env* env, int64_t ram_budget);
+
+  // Deletes the spill file, if any.
+  ~CompressedCache();
+
+  // Compresses `element` and appends it to the cache.
+  Status Add(const std::vector<Tensor>& element);
+
+  // Appends an element that was compressed and serialized by
+  // `CompressAndSerialize`.
+  Status AddCompressed(std::string compressed);
+
+  // Flushes the spill file. No more elements may be added afterwards.
+  Status Finalize();
+
+  // Reads and uncompresses the element at the given index.
+  Status Get(int64_t index, std::vector<Tensor>* out);
+
+  // Returns the number of cached elements.
+  size_t size();
+
+  // Returns the number of compressed bytes held in memory.
+  int64_t memory_bytes();
+
+  // Returns the number of compressed bytes spilled to disk.
+  int64_t spilled_bytes();
+
+  // Writes the compressed elements to a checkpoint under `key_prefix`.
+  Status Save(IteratorStateWriter* writer, StringPiece key_prefix);
+
+  // Appends the compressed elements read from a checkpoint under `key_prefix`.
+  Status Restore(IteratorStateReader* reader, StringPiece key_prefix);
+
+ private:
+  // Location of a spilled element in the spill file.
+  struct SpilledElement {
+    uint64 offset;
+    uint64 size;
+  };
+
+  Status AddCompressedLocked(std::string compressed)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Points `*out` at the compressed element at the given index. In-memory
+  // elements are not copied; spilled elements are read into `*scratch`.
+  Status GetCompressed(int64_t index, std::string* scratch, StringPiece* out)
+      TF_SHARED_LOCKS_REQUIRED(mu_);
+  Status FlushSpillFile() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;
+  const int64_t ram_budget_;
+  mutex mu_;
+  bool finalized_ TF_GUARDED_BY(mu_) = false;
+  int64_t memory_bytes_ TF_GUARDED_BY(mu_) = 0;
+  // The first elements of the cache, in order.
+  std::vector<std::string> in_memory_ TF_GUARDED_BY(mu_);
+  // The remaining elements of the cache, in order. Once an element has been
+  // spilled, all later elements are spilled as well.
+  std::vector<SpilledElement> spilled_ TF_GUARDED_BY(mu_);
+  std::string spill_filename_ TF_GUARDED_BY(mu_);
+  uint64 spill_size_ TF_GUARDED_BY(mu_) = 0;
+  std::unique_ptr<WritableFile> spill_writer_ TF_GUARDED_BY(mu_);
+  // Reads from the spill file. `RandomAccessFile` reads are thread-safe.
+  std::unique_ptr<RandomAccessFile> spill_reader_ TF_GUARDED_BY(mu_);
+};
+
 // A resource wrapping a shared instance of a memory cache.
 class MemoryCacheManager : public ResourceBase {
  public:
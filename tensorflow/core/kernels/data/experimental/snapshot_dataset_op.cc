@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <deque>
+#include <limits>
 #include <memory>
 #include <random>
 #include <string>
@@ -40,6 +41,7 @@ limitations under the License.
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/stringprintf.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/profiler/lib/traceme_encode.h"
 #include "tensorflow/core/protobuf/snapshot.pb.h"
 
 namespace tensorflow {
@@ -65,6 +67,8 @@ namespace experimental {
     SnapshotDatasetV2Op::kReaderFuncTarguments;
 /* static */ constexpr const char* const
     SnapshotDatasetV2Op::kShardFuncTarguments;
+/* static */ constexpr const char* const SnapshotDatasetV2Op::kNumParallelReads;
+/* static */ constexpr const char* const SnapshotDatasetV2Op::kDeterministic;
 /* static */ constexpr const int SnapshotDatasetV2Op::kFileFormatVersion;
 
 // ==== Snapshot Implementation ====
@@ -103,7 +107,8 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
           const std::string& path, const std::string& compression,
           const std::string& reader_prefix, const std::string& writer_prefix,
           std::unique_ptr<CapturedFunction> reader_func,
-          std::unique_ptr<CapturedFunction> shard_func)
+          std::unique_ptr<CapturedFunction> shard_func,
+          int64_t num_parallel_reads, DeterminismPolicy deterministic)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         hash_(hash),
@@ -112,7 +117,9 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
         reader_prefix_(reader_prefix),
         writer_prefix_(writer_prefix),
         reader_func_(std::move(reader_func)),
-        shard_func_(std::move(shard_func)) {
+        shard_func_(std::move(shard_func)),
+        num_parallel_reads_(num_parallel_reads),
+        deterministic_(deterministic) {
     input_->Ref();
   }
 
@@ -202,6 +209,12 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
     b->BuildAttrValue(shard_func_other_args_types,
                       &shard_func_arguments_types_attr);
 
+    AttrValue num_parallel_reads_attr;
+    b->BuildAttrValue(num_parallel_reads_, &num_parallel_reads_attr);
+
+    AttrValue deterministic_attr;
+    b->BuildAttrValue(deterministic_.String(), &deterministic_attr);
+
     return b->AddDataset(
         this,
         /*inputs=*/
@@ -218,11 +231,36 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
          {kReaderFunc, reader_func_attr},
          {kShardFunc, shard_func_attr},
          {kReaderFuncTarguments, reader_func_arguments_types_attr},
-         {kShardFuncTarguments, shard_func_arguments_types_attr}},
+         {kShardFuncTarguments, shard_func_arguments_types_attr},
+         {kNumParallelReads, num_parallel_reads_attr},
+         {kDeterministic, deterministic_attr}},
         output);
   }
 
  private:
+  // Lists the shard directories of the snapshot run to read from, in sorted
+  // order, along with the file format version the run was written with.
+  Status GetShardDirectories(Env* env, std::vector<std::string>* shard_dirs,
+                             int64_t* version) const {
+    auto hash_dir = snapshot_util::HashDirectory(
+        io::JoinPath(reader_prefix_, path_), hash_);
+    bool metadata_file_exists;
+    experimental::SnapshotMetadataRecord metadata;
+    TF_RETURN_IF_ERROR(snapshot_util::ReadMetadataFile(
+        env, hash_dir, &metadata, &metadata_file_exists));
+
+    auto run_dir = snapshot_util::RunDirectory(hash_dir, metadata.run_id());
+
+    TF_RETURN_IF_ERROR(env->GetMatchingPaths(
+        io::JoinPath(run_dir,
+                     strings::Printf("%s%s", "*",
+                                     snapshot_util::kShardDirectorySuffix)),
+        shard_dirs));
+    std::sort(shard_dirs->begin(), shard_dirs->end());
+    *version = metadata.version();
+    return OkStatus();
+  }
+
   const DatasetBase* input_;
   const uint64 hash_;
   const tstring path_;
@@ -232,6 +270,8 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
 
   std::unique_ptr<CapturedFunction> reader_func_;
   std::unique_ptr<CapturedFunction> shard_func_;
+  const int64_t num_parallel_reads_;
+  const DeterminismPolicy deterministic_;
 
   class Reader : public DatasetIterator<Dataset> {
    public:
@@ -246,29 +286,15 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(dataset()->reader_func_->Instantiate(
           ctx, &instantiated_reader_func_));
 
-      auto hash_dir = snapshot_util::HashDirectory(
-          io::JoinPath(dataset()->reader_prefix_, dataset()->path_),
-          dataset()->hash_);
-      bool metadata_file_exists;
-      experimental::SnapshotMetadataRecord metadata;
-      TF_RETURN_IF_ERROR(snapshot_util::ReadMetadataFile(
-          ctx->env(), hash_dir, &metadata, &metadata_file_exists));
-
-      auto run_dir = snapshot_util::RunDirectory(hash_dir, metadata.run_id());
-
       std::vector<std::string> snapshot_shard_dirs;
-      TF_RETURN_IF_ERROR(ctx->env()->GetMatchingPaths(
-          io::JoinPath(run_dir,
-                       strings::Printf("%s%s", "*",
-                                       snapshot_util::kShardDirectorySuffix)),
-          &snapshot_shard_dirs));
-      std::sort(snapshot_shard_dirs.begin(), snapshot_shard_dirs.end());
+      int64_t version;
+      TF_RETURN_IF_ERROR(dataset()->GetShardDirectories(
+          ctx->env(), &snapshot_shard_dirs, &version));
 
       DatasetBase* dataset_of_snapshot_files;
       TF_RETURN_IF_ERROR(snapshot_util::Reader::MakeNestedDataset(
-          ctx->env(), snapshot_shard_dirs, dataset()->compression_,
-          metadata.version(), dataset()->output_dtypes(),
-          dataset()->output_shapes(), start_index_,
+          ctx->env(), snapshot_shard_dirs, dataset()->compression_, version,
+          dataset()->output_dtypes(), dataset()->output_shapes(), start_index_,
           &dataset_of_snapshot_files));
 
       Tensor input_dataset_tensor(DT_VARIANT, TensorShape({}));
@@ -325,6 +351,422 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
         TF_GUARDED_BY(mu_);
   };
 
+  // Reads the snapshot shards with `num_parallel_reads` background threads.
+  // Each thread opens, decompresses and deserializes elements of one shard at
+  // a time into a bounded reorder buffer. Elements are produced in the same
+  // round-robin order as the default `reader_func` when `deterministic_` is
+  // set, or in whatever order they become available otherwise.
+  class ParallelReader : public DatasetIterator<Dataset> {
+   public:
+    static constexpr const char* const kIteratorName = "ParallelReader";
+    static constexpr const char* const kThreadPoolName =
+        "snapshot_parallel_reader";
+    static constexpr const char* const kRead = "Read";
+    static constexpr const char* const kNumShards = "num_shards";
+    static constexpr const char* const kNumConsumed = "num_consumed";
+    static constexpr const char* const kActiveShards = "active_shards";
+    static constexpr const char* const kNextShard = "next_shard";
+    // Number of elements each reading thread may buffer ahead of the consumer.
+    static constexpr int64_t kBufferedElementsPerThread = 2;
+
+    ParallelReader(const Params& params, int64_t start_index)
+        : DatasetIterator<Dataset>(params),
+          start_index_(start_index),
+          deterministic_(params.dataset->deterministic_.IsDeterministic() ||
+                         params.dataset->deterministic_.IsDefault()) {}
+
+    ~ParallelReader() override {
+      if (deregister_fn_) deregister_fn_();
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      cond_var_.notify_all();
+      while (num_active_threads_ > 0) {
+        cond_var_.wait(l);
+      }
+    }
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      // Wakes up a blocked `GetNext()` and the reading threads on
+      // cancellation.
+      TF_RETURN_IF_ERROR(RegisterCancellationCallback(
+          ctx->cancellation_manager(),
+          [this]() {
+            mutex_lock l(mu_);
+            cancelled_ = true;
+            cond_var_.notify_all();
+          },
+          &deregister_fn_));
+
+      std::vector<std::string> shard_dirs;
+      TF_RETURN_IF_ERROR(
+          dataset()->GetShardDirectories(ctx->env(), &shard_dirs, &version_));
+
+      // Starting at `start_index_` assumes that the elements were produced in
+      // round-robin order, which is what the deterministic mode guarantees.
+      // `RestoreInternal()` replaces these positions with the saved ones.
+      const int64_t num_shards = shard_dirs.size();
+      shards_.resize(num_shards);
+      for (int64_t i = 0; i < num_shards; ++i) {
+        shards_[i].directory = shard_dirs[i];
+        shards_[i].num_to_skip = start_index_ / num_shards;
+        if (start_index_ % num_shards > i) {
+          shards_[i].num_to_skip++;
+        }
+        shards_[i].num_consumed = shards_[i].num_to_skip;
+        active_shards_.push_back(i);
+      }
+      if (num_shards > 0) {
+        next_shard_ = start_index_ % num_shards;
+      }
+
+      num_threads_ = dataset()->num_parallel_reads_;
+      if (num_threads_ == model::kAutotune) {
+        num_threads_ = ctx->runner_threadpool_size();
+      }
+      num_threads_ = std::max<int64_t>(
+          1, std::min<int64_t>(num_threads_, std::max<int64_t>(num_shards, 1)));
+      max_buffered_elements_ = num_threads_ * kBufferedElementsPerThread;
+      thread_pool_ = ctx->CreateThreadPool(kThreadPoolName, num_threads_);
+      return OkStatus();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      if (!background_threads_started_) {
+        for (int64_t i = 0; i < num_threads_; ++i) {
+          ++num_active_threads_;
+          thread_pool_->Schedule(
+              [this, env = ctx->env()]() { ReadingShardsLoop(env); });
+        }
+        background_threads_started_ = true;
+      }
+
+      while (true) {
+        if (cancelled_) {
+          return errors::Cancelled(
+              "SnapshotDatasetV2Op::Dataset::ParallelReader::GetNext");
+        }
+        if (active_shards_.empty()) {
+          *end_of_sequence = true;
+          LogThroughput();
+          return OkStatus();
+        }
+        const int64_t num_active = active_shards_.size();
+        // In deterministic mode only the next shard in round-robin order may
+        // produce an element; otherwise the first shard with a buffered
+        // element does.
+        const int64_t num_candidates = deterministic_ ? 1 : num_active;
+        for (int64_t i = 0; i < num_candidates; ++i) {
+          const int64_t position = (next_shard_ + i) % num_active;
+          Shard& shard = shards_[active_shards_[position]];
+          if (!shard.buffer.empty()) {
+            *out_tensors = std::move(shard.buffer.front());
+            shard.buffer.pop_front();
+            shard.num_consumed++;
+            next_shard_ = (position + 1) % num_active;
+            *end_of_sequence = false;
+            cond_var_.notify_all();
+            return OkStatus();
+          }
+          if (shard.done) {
+            if (!shard.status.ok()) {
+              return shard.status;
+            }
+            active_shards_.erase(active_shards_.begin() + position);
+            if (active_shards_.empty()) {
+              next_shard_ = 0;
+            } else {
+              next_shard_ = position % active_shards_.size();
+            }
+            cond_var_.notify_all();
+            break;
+          }
+          if (i == num_candidates - 1) {
+            cond_var_.wait(l);
+          }
+        }
+      }
+    }
+
+   protected:
+    // The element index saved by the main iterator determines the position
+    // in each shard only if the elements were produced in round-robin order,
+    // so the position of each shard is saved as well. Buffered elements are
+    // read again after restoring.
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      const int64_t num_shards = shards_.size();
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kNumShards), num_shards));
+      for (int64_t i = 0; i < num_shards; ++i) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(absl::StrCat(kNumConsumed, "[", i, "]")),
+            shards_[i].num_consumed));
+      }
+      const int64_t num_active = active_shards_.size();
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kActiveShards), num_active));
+      for (int64_t i = 0; i < num_active; ++i) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(absl::StrCat(kActiveShards, "[", i, "]")),
+            active_shards_[i]));
+      }
+      return writer->WriteScalar(full_name(kNextShard), next_shard_);
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      if (!reader->Contains(full_name(kNumShards))) {
+        // Checkpoints written before shard positions were saved; only correct
+        // for the deterministic round-robin order.
+        return OkStatus();
+      }
+      int64_t num_shards;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kNumShards), &num_shards));
+      if (num_shards != static_cast<int64_t>(shards_.size())) {
+        return errors::DataLoss("The snapshot has ", shards_.size(),
+                                " shards but the checkpoint has ", num_shards,
+                                ".");
+      }
+      for (int64_t i = 0; i < num_shards; ++i) {
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            full_name(absl::StrCat(kNumConsumed, "[", i, "]")),
+            &shards_[i].num_consumed));
+        shards_[i].num_to_skip = shards_[i].num_consumed;
+      }
+      int64_t num_active;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kActiveShards), &num_active));
+      active_shards_.resize(num_active);
+      for (int64_t i = 0; i < num_active; ++i) {
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            full_name(absl::StrCat(kActiveShards, "[", i, "]")),
+            &active_shards_[i]));
+        if (active_shards_[i] < 0 || active_shards_[i] >= num_shards) {
+          return errors::DataLoss("Invalid snapshot shard index ",
+                                  active_shards_[i], " in the checkpoint.");
+        }
+      }
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kNextShard), &next_shard_));
+      if (next_shard_ < 0 || (num_active > 0 && next_shard_ >= num_active)) {
+        return errors::DataLoss("Invalid next snapshot shard ", next_shard_,
+                                " in the checkpoint.");
+      }
+      return OkStatus();
+    }
+
+   private:
+    struct Shard {
+      std::string directory;
+      // The checkpoint file currently being read and its reader. These are
+      // only accessed by the thread that has set `reading`.
+      int64_t checkpoint_id = 0;
+      std::unique_ptr<snapshot_util::Reader> reader;
+      // Number of elements to skip before producing any, used when restoring.
+      int64_t num_to_skip = 0;
+      // Number of elements of the shard returned by `GetNext()`, counting
+      // those returned before the iterator was restored.
+      int64_t num_consumed = 0;
+
+      std::deque<std::vector<Tensor>> buffer;
+      bool reading = false;
+      bool done = false;
+      Status status;
+
+      int64_t num_elements = 0;
+      int64_t num_bytes = 0;
+      int64_t read_micros = 0;
+    };
+
+    // Picks the shard whose next element is needed the soonest by the
+    // consumer, assuming round-robin consumption, or returns -1 if no shard
+    // can be read without exceeding the reorder buffer.
+    int64_t NextShardToRead() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64_t num_active = active_shards_.size();
+      int64_t result = -1;
+      int64_t earliest_position = max_buffered_elements_;
+      for (int64_t i = 0; i < num_active; ++i) {
+        const int64_t index = active_shards_[(next_shard_ + i) % num_active];
+        const Shard& shard = shards_[index];
+        if (shard.reading || shard.done) {
+          continue;
+        }
+        const int64_t position = i + shard.buffer.size() * num_active;
+        if (position < earliest_position) {
+          earliest_position = position;
+          result = index;
+        }
+      }
+      return result;
+    }
+
+    bool AllShardsDone() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      for (int64_t index : active_shards_) {
+        if (!shards_[index].done) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    void ReadingShardsLoop(Env* env) {
+      auto cleanup = gtl::MakeCleanup([this]() {
+        mutex_lock l(mu_);
+        --num_active_threads_;
+        cond_var_.notify_all();
+      });
+      while (true) {
+        Shard* shard;
+        {
+          mutex_lock l(mu_);
+          int64_t index = -1;
+          while (!cancelled_ && !AllShardsDone() &&
+                 (index = NextShardToRead()) < 0) {
+            cond_var_.wait(l);
+          }
+          if (cancelled_ || AllShardsDone()) {
+            return;
+          }
+          shard = &shards_[index];
+          shard->reading = true;
+        }
+        std::vector<Tensor> element;
+        bool end_of_shard = false;
+        const uint64 start_micros = EnvTime::NowMicros();
+        Status s = ReadElement(env, shard, &element, &end_of_shard);
+        const int64_t read_micros = EnvTime::NowMicros() - start_micros;
+
+        mutex_lock l(mu_);
+        shard->reading = false;
+        shard->read_micros += read_micros;
+        if (!s.ok() || end_of_shard) {
+          shard->done = true;
+          shard->status = s;
+          shard->reader.reset();
+          LogShardThroughput(*shard);
+        } else {
+          for (const auto& tensor : element) {
+            shard->num_bytes += tensor.TotalBytes();
+          }
+          shard->num_elements++;
+          shard->buffer.push_back(std::move(element));
+        }
+        cond_var_.notify_all();
+      }
+    }
+
+    // Reads the next element of `shard`, skipping any elements that precede
+    // the restored position and moving on to the next checkpoint file of the
+    // shard when the current one is exhausted.
+    Status ReadElement(Env* env, Shard* shard, std::vector<Tensor>* element,
+                       bool* end_of_shard) {
+      profiler::TraceMe activity(
+          [&]() {
+            return profiler::TraceMeEncode(absl::StrCat(prefix(), "::", kRead),
+                                           {{"shard", shard->directory}});
+          },
+          profiler::TraceMeLevel::kInfo);
+      while (true) {
+        if (shard->reader == nullptr) {
+          const std::string filename = snapshot_util::GetCheckpointFileName(
+              shard->directory, shard->checkpoint_id);
+          Status s = env->FileExists(filename);
+          if (errors::IsNotFound(s)) {
+            *end_of_shard = true;
+            return OkStatus();
+          }
+          TF_RETURN_IF_ERROR(s);
+          TF_RETURN_IF_ERROR(snapshot_util::Reader::Create(
+              env, filename, dataset()->compression_, version_,
+              dataset()->output_dtypes(), &shard->reader));
+        }
+        element->clear();
+        Status s = shard->reader->ReadTensors(element);
+        if (errors::IsOutOfRange(s)) {
+          shard->reader.reset();
+          shard->checkpoint_id++;
+          continue;
+        }
+        TF_RETURN_IF_ERROR(s);
+        if (shard->num_to_skip > 0) {
+          shard->num_to_skip--;
+          continue;
+        }
+        return OkStatus();
+      }
+    }
+
+    void LogShardThroughput(const Shard& shard)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const double megabytes = static_cast<double>(shard.num_bytes) / 1e6;
+      const double seconds = static_cast<double>(shard.read_micros) / 1e6;
+      VLOG(1) << "Finished reading snapshot shard " << shard.directory << ": "
+              << shard.num_elements << " elements, " << megabytes << " MB in "
+              << seconds << " s ("
+              << (seconds > 0 ? megabytes / seconds : 0.0) << " MB/s)"
+              << (shard.status.ok() ? "" : ", error: ")
+              << (shard.status.ok() ? "" : shard.status.ToString());
+    }
+
+    void LogThroughput() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (throughput_logged_ || shards_.empty()) {
+        return;
+      }
+      throughput_logged_ = true;
+      double min_throughput = std::numeric_limits<double>::max();
+      double max_throughput = 0;
+      int64_t num_bytes = 0;
+      for (const Shard& shard : shards_) {
+        const double seconds = static_cast<double>(shard.read_micros) / 1e6;
+        const double throughput =
+            seconds > 0 ? static_cast<double>(shard.num_bytes) / 1e6 / seconds
+                        : 0.0;
+        min_throughput = std::min(min_throughput, throughput);
+        max_throughput = std::max(max_throughput, throughput);
+        num_bytes += shard.num_bytes;
+      }
+      LOG(INFO) << "Read " << static_cast<double>(num_bytes) / 1e6
+                << " MB from " << shards_.size() << " snapshot shards with "
+                << num_threads_ << " threads; per-shard throughput ranged from "
+                << min_throughput << " to " << max_throughput << " MB/s.";
+    }
+
+    const int64_t start_index_;
+    const bool deterministic_;
+
+    mutex mu_;
+    condition_variable cond_var_;
+
+    int64_t version_ TF_GUARDED_BY(mu_) = 0;
+    int64_t num_threads_ TF_GUARDED_BY(mu_) = 0;
+    int64_t max_buffered_elements_ TF_GUARDED_BY(mu_) = 0;
+    std::unique_ptr<thread::ThreadPool> thread_pool_;
+
+    // Shards are never removed from `shards_`, so references to them remain
+    // valid while a reading thread works on them outside of `mu_`.
+    std::vector<Shard> shards_ TF_GUARDED_BY(mu_);
+    // Indices into `shards_` of the shards that may still produce elements,
+    // in round-robin order, and the position within it of the next shard to
+    // produce an element.
+    std::vector<int64_t> active_shards_ TF_GUARDED_BY(mu_);
+    int64_t next_shard_ TF_GUARDED_BY(mu_) = 0;
+
+    bool background_threads_started_ TF_GUARDED_BY(mu_) = false;
+    bool cancelled_ TF_GUARDED_BY(mu_) = false;
+    bool throughput_logged_ TF_GUARDED_BY(mu_) = false;
+    int64_t num_active_threads_ TF_GUARDED_BY(mu_) = 0;
+
+    // Method for deregistering the cancellation callback.
+    std::function<void()> deregister_fn_;
+  };
+
   class Writer : public DatasetIterator<Dataset> {
    public:
     static constexpr const char* const kIteratorName = "Writer";
@@ -684,10 +1126,18 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
 
       switch (mode_) {
         case snapshot_util::READER:
-          iterator_ = std::make_unique<Reader>(
-              Reader::Params{dataset(),
-                             absl::StrCat(prefix(), Reader::kIteratorName)},
-              index_);
+          if (dataset()->num_parallel_reads_ != 0) {
+            iterator_ = std::make_unique<ParallelReader>(
+                ParallelReader::Params{
+                    dataset(),
+                    absl::StrCat(prefix(), ParallelReader::kIteratorName)},
+                index_);
+          } else {
+            iterator_ = std::make_unique<Reader>(
+                Reader::Params{dataset(),
+                               absl::StrCat(prefix(), Reader::kIteratorName)},
+                index_);
+          }
           break;
         case snapshot_util::WRITER:
           iterator_ = std::make_unique<Writer>(Writer::Params{
@@ -731,6 +1181,22 @@ SnapshotDatasetV2Op::SnapshotDatasetV2Op(OpKernelConstruction* ctx)
   OP_REQUIRES_OK(ctx, ctx->GetAttr(kHash, &hash));
   hash_ = static_cast<uint64>(hash);
 
+  if (ctx->HasAttr(kNumParallelReads)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kNumParallelReads, &num_parallel_reads_));
+    OP_REQUIRES(
+        ctx,
+        num_parallel_reads_ >= 0 || num_parallel_reads_ == model::kAutotune,
+        errors::InvalidArgument("num_parallel_reads must be non-negative or ",
+                                model::kAutotune, ", but got ",
+                                num_parallel_reads_, "."));
+  }
+  if (ctx->HasAttr(kDeterministic)) {
+    std::string deterministic;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kDeterministic, &deterministic));
+    OP_REQUIRES_OK(
+        ctx, DeterminismPolicy::FromString(deterministic, &deterministic_));
+  }
+
   OP_REQUIRES_OK(ctx, FunctionMetadata::Create(ctx, kReaderFunc, reader_params,
                                                &reader_func_metadata_));
   OP_REQUIRES_OK(ctx, FunctionMetadata::Create(ctx, kShardFunc, shard_params,
@@ -773,7 +1239,8 @@ void SnapshotDatasetV2Op::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
 
   *output = new SnapshotDatasetV2Op::Dataset(
       ctx, input, hash, path, compression, reader_prefix_, writer_prefix_,
-      std::move(reader_func), std::move(shard_func));
+      std::move(reader_func), std::move(shard_func), num_parallel_reads_,
+      deterministic_);
 }
 
 namespace {
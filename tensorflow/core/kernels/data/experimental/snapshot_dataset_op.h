@@ -60,6 +60,8 @@ class SnapshotDatasetV2Op : public UnaryDatasetOpKernel {
   static constexpr const char* const kReaderFuncTarguments =
       "Treader_func_args";
   static constexpr const char* const kShardFuncTarguments = "Tshard_func_args";
+  static constexpr const char* const kNumParallelReads = "num_parallel_reads";
+  static constexpr const char* const kDeterministic = "deterministic";
   // Note: If a new constant is declared here, it *must* be defined in
   // snapshot_dataset_op.cc, otherwise it will not compile in debug mode.
 
@@ -83,6 +85,8 @@ class SnapshotDatasetV2Op : public UnaryDatasetOpKernel {
   std::string writer_prefix_;
   bool hash_valid_;
   uint64 hash_;
+  int64_t num_parallel_reads_ = 0;
+  DeterminismPolicy deterministic_;
 
   std::shared_ptr<FunctionMetadata> reader_func_metadata_;
   std::shared_ptr<FunctionMetadata> shard_func_metadata_;
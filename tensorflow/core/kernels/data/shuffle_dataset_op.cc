@@ -54,6 +54,8 @@ namespace data {
     ShuffleDatasetOpBase::kReshuffleEachIteration;
 
 /* static */ constexpr const char* const ShuffleDatasetOp::kDatasetType;
+/* static */ constexpr const char* const ShuffleDatasetOp::kBlockLength;
+/* static */ constexpr const char* const ShuffleDatasetOp::kBufferSizeBytes;
 
 /* static */ constexpr const char* const
     ShuffleAndRepeatDatasetOp::kDatasetType;
@@ -70,6 +72,10 @@ constexpr char kNumElements[] = "num_elements";
 constexpr char kSlicesSize[] = "slices_size";
 constexpr char kSlicesStart[] = "slices_start";
 constexpr char kSlicesEnd[] = "slices_end";
+constexpr char kNumBlocks[] = "num_blocks";
+constexpr char kBlock[] = "block";
+constexpr char kCurrentBlock[] = "current_block";
+constexpr char kFillingBlock[] = "filling_block";
 constexpr char kSeedGenerator[] = "SeedGenerator";
 constexpr char kEpochNumRandomSamples[] = "epoch_num_random_samples";
 constexpr char kShuffleDatasetV1[] = "ShuffleDataset";
@@ -87,12 +93,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   ShuffleDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
                      int64_t buffer_size,
                      std::shared_ptr<SeedGenerator> seed_generator,
-                     int64_t count)
+                     int64_t count, int64_t block_length = 0,
+                     int64_t buffer_size_bytes = 0)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        block_length_(block_length),
+        buffer_size_bytes_(buffer_size_bytes),
         traceme_metadata_(
             {{"buffer_size",
               strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
@@ -167,6 +176,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
       const string& prefix) const override {
+    if (block_length_ > 0) {
+      return std::make_unique<BlockIterator>(
+          BlockIterator::Params{this,
+                                name_utils::IteratorPrefix(op_type(), prefix)},
+          seed_generator_.get());
+    }
     return std::make_unique<Iterator>(
         Iterator::Params{this, name_utils::IteratorPrefix(op_type(), prefix)},
         seed_generator_.get());
@@ -182,6 +197,32 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     random::SingleSampleAdapter<random::PhiloxRandom> generator =
         random::SingleSampleAdapter<random::PhiloxRandom>(&parent_generator);
 
+    if (block_length_ > 0) {
+      // Permute the blocks of `block_length_` consecutive indices, then the
+      // indices within each block.
+      const int64_t num_blocks =
+          (cardinality + block_length_ - 1) / block_length_;
+      std::vector<int64_t> blocks(num_blocks);
+      std::iota(blocks.begin(), blocks.end(), 0);
+      for (int64_t i = 0; i < num_blocks; ++i) {
+        std::swap(blocks[i], blocks[i + generator() % (num_blocks - i)]);
+      }
+      for (int64_t block : blocks) {
+        const int64_t start = block * block_length_;
+        const int64_t end = std::min(start + block_length_, cardinality);
+        for (int64_t i = start; i < end; ++i) {
+          shuffled_indices_[shuffled_index + i - start] = i;
+        }
+        for (int64_t i = 0; i < end - start; ++i) {
+          std::swap(shuffled_indices_[shuffled_index + i],
+                    shuffled_indices_[shuffled_index + i +
+                                      generator() % (end - start - i)]);
+        }
+        shuffled_index += end - start;
+      }
+      return;
+    }
+
     while (shuffled_index < cardinality) {
       int64_t offset = generator() % (cardinality - shuffled_index);
       std::swap(shuffled_indices_[shuffled_index + offset],
@@ -230,6 +271,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       int64_t index = (slices_.front()->start + offset) % buffer_->size();
       *out_tensors = std::move(buffer_->at(index));
       this->RecordBufferDequeue(ctx, *out_tensors);
+      buffered_bytes_ -= GetTotalBytes(*out_tensors);
       std::swap(buffer_->at(index),
                 buffer_->at(slices_.front()->start % buffer_->size()));
       slices_.front()->start++;
@@ -335,8 +377,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
       TF_RETURN_IF_ERROR(
           ReadElementsFromCheckpoint(ctx, reader, prefix(), buffer_.get()));
+      buffered_bytes_ = 0;
       for (const auto& element : *buffer_) {
         RecordBufferEnqueue(ctx, element);
+        buffered_bytes_ += GetTotalBytes(element);
       }
       buffer_->resize(dataset()->buffer_size_);
       slices_.clear();
@@ -432,6 +476,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         // 1`.
         return false;
       }
+      if (dataset()->buffer_size_bytes_ > 0 && num_elements_ > 0 &&
+          buffered_bytes_ >= dataset()->buffer_size_bytes_) {
+        return false;
+      }
       return num_elements_ < buffer_->size();
     }
 
@@ -460,6 +508,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                 << BufferSizeString();
       }
       this->RecordBufferEnqueue(ctx, element);
+      buffered_bytes_ += GetTotalBytes(element);
       size_t index = slices_.back()->end % buffer_->size();
       buffer_->at(index) = std::move(element);
       num_elements_++;
@@ -488,6 +537,8 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_) = nullptr;
     int64_t epoch_ TF_GUARDED_BY(mu_) = 0;
     int64_t num_elements_ TF_GUARDED_BY(mu_) = 0;
+    // Total size of the tensors in `buffer_`.
+    int64_t buffered_bytes_ TF_GUARDED_BY(mu_) = 0;
     int64_t seed_ TF_GUARDED_BY(mu_) = 0;
     int64_t seed2_ TF_GUARDED_BY(mu_) = 0;
     // Indices into `buffer_` indicating which data belongs to which epoch.
@@ -502,6 +553,276 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     bool data_produced_ TF_GUARDED_BY(mu_) = false;
   };
 
+  // Iterator used when `block_length_` is positive. The input is cut into
+  // blocks of `block_length_` consecutive elements, and the buffer holds
+  // whole blocks until it reaches `buffer_size_` elements or
+  // `buffer_size_bytes_` bytes, but always at least one block. The next block
+  // is picked uniformly at random from the buffer, and its elements are
+  // produced in a random order before the buffer is refilled. Unlike
+  // `Iterator`, the buffer is drained at the end of each epoch, so elements
+  // of different epochs are never mixed.
+  //
+  // Reading the input in whole blocks lets upstream file or record-block
+  // shuffling (e.g. shuffled file names with `block_length` set to the
+  // records per file) do most of the mixing, so a small byte budget is
+  // enough to break up the order within each block.
+  class BlockIterator : public DatasetIterator<ShuffleDatasetBase> {
+   public:
+    explicit BlockIterator(const Params& params, SeedGenerator* seed_generator)
+        : DatasetIterator<ShuffleDatasetBase>(params),
+          seed_generator_(seed_generator),
+          parent_generator_(seed_generator->seed(), seed_generator->seed2()),
+          generator_(&parent_generator_) {}
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      ResetRngs();
+      return OkStatus();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      while (current_block_.empty()) {
+        if (blocks_.empty() && filling_block_.empty() && !input_impl_) {
+          // The previous epoch, if any, has been produced in full.
+          const bool all_epochs_done =
+              dataset()->count_ != -1 && epoch_ >= dataset()->count_;
+          // An input that produced nothing in its first epoch would make
+          // an infinite repetition loop forever.
+          const bool input_is_empty = epoch_ > 0 && !data_produced_ &&
+                                      ctx->split_providers().empty();
+          if (all_epochs_done || input_is_empty) {
+            *end_of_sequence = true;
+            return OkStatus();
+          }
+          TF_RETURN_IF_ERROR(PrepareNextEpoch(ctx));
+        }
+        TF_RETURN_IF_ERROR(FillBuffer(ctx));
+        if (!blocks_.empty()) {
+          TakeRandomBlock();
+        }
+      }
+      *end_of_sequence = false;
+      *out_tensors = std::move(current_block_.back());
+      current_block_.pop_back();
+      this->RecordBufferDequeue(ctx, *out_tensors);
+      buffered_bytes_ -= GetTotalBytes(*out_tensors);
+      num_elements_--;
+      return OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kEpochNumRandomSamples),
+                              seed_generator_->num_random_samples()));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kNumRandomSamples), num_random_samples_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kSeed), seed_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kSeed2), seed2_));
+      if (!input_impl_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kEndOfInputSequence), ""));
+      } else {
+        TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+      }
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kEpoch), epoch_));
+      if (data_produced_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kDataProduced), ""));
+      }
+      TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+          writer, full_name(kCurrentBlock), current_block_));
+      TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+          writer, full_name(kFillingBlock), filling_block_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kNumBlocks), blocks_.size()));
+      for (size_t i = 0; i < blocks_.size(); ++i) {
+        TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+            writer, full_name(absl::StrCat(kBlock, "_", i)), blocks_[i]));
+      }
+      return OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      int64_t num_random_samples;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpochNumRandomSamples),
+                                            &num_random_samples));
+      seed_generator_->set_num_random_samples(num_random_samples);
+      seed_generator_->Reset();
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kNumRandomSamples), &num_random_samples_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed), &seed_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed2), &seed2_));
+      ResetRngs();
+      if (!reader->Contains(full_name(kEndOfInputSequence))) {
+        TF_RETURN_IF_ERROR(
+            dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_));
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+      } else {
+        input_impl_.reset();
+      }
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpoch), &epoch_));
+      data_produced_ = reader->Contains(full_name(kDataProduced));
+      current_block_.clear();
+      TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+          ctx, reader, full_name(kCurrentBlock), &current_block_));
+      filling_block_.clear();
+      TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+          ctx, reader, full_name(kFillingBlock), &filling_block_));
+      int64_t num_blocks;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kNumBlocks), &num_blocks));
+      blocks_.clear();
+      blocks_.resize(num_blocks);
+      for (int64_t i = 0; i < num_blocks; ++i) {
+        TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+            ctx, reader, full_name(absl::StrCat(kBlock, "_", i)), &blocks_[i]));
+      }
+      num_elements_ = 0;
+      buffered_bytes_ = 0;
+      auto restore_block = [&](const std::vector<std::vector<Tensor>>& block) {
+        for (const auto& element : block) {
+          RecordBufferEnqueue(ctx, element);
+          buffered_bytes_ += GetTotalBytes(element);
+          num_elements_++;
+        }
+      };
+      restore_block(current_block_);
+      restore_block(filling_block_);
+      for (const auto& block : blocks_) {
+        restore_block(block);
+      }
+      return OkStatus();
+    }
+
+    TraceMeMetadata GetTraceMeMetadata() const override {
+      return dataset()->traceme_metadata_;
+    }
+
+   private:
+    void ResetRngs() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      parent_generator_ = random::PhiloxRandom(seed_, seed2_);
+      generator_ =
+          random::SingleSampleAdapter<random::PhiloxRandom>(&parent_generator_);
+      generator_.Skip(num_random_samples_);
+    }
+
+    random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      num_random_samples_++;
+      return generator_();
+    }
+
+    // Starts reading the next epoch of the input. Every epoch after the
+    // first draws new seeds, as `Iterator` does when it finishes a slice.
+    Status PrepareNextEpoch(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (epoch_ > 0) {
+        num_random_samples_ = 0;
+        seed_generator_->GenerateSeeds(&seed_, &seed2_);
+        ResetRngs();
+        for (const auto& provider : ctx->split_providers()) {
+          TF_RETURN_IF_ERROR(provider->Reset());
+        }
+      }
+      TF_RETURN_IF_ERROR(
+          dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_));
+      epoch_++;
+      return OkStatus();
+    }
+
+    // Whether another input element may be buffered. The buffer may always
+    // grow until it holds one complete block.
+    bool HasRoom() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (blocks_.empty()) {
+        return true;
+      }
+      if (dataset()->buffer_size_bytes_ > 0 &&
+          buffered_bytes_ >= dataset()->buffer_size_bytes_) {
+        return false;
+      }
+      return num_elements_ < dataset()->buffer_size_;
+    }
+
+    // Reads input elements into `filling_block_` and moves every completed
+    // block to `blocks_`, until the buffer is full or the epoch ends.
+    Status FillBuffer(IteratorContext* ctx) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (input_impl_ && HasRoom()) {
+        std::vector<Tensor> element;
+        bool end_of_input_sequence = false;
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, &element, &end_of_input_sequence));
+        if (end_of_input_sequence) {
+          input_impl_.reset();
+          SealFillingBlock();
+          break;
+        }
+        data_produced_ = true;
+        RecordBufferEnqueue(ctx, element);
+        buffered_bytes_ += GetTotalBytes(element);
+        num_elements_++;
+        filling_block_.push_back(std::move(element));
+        if (static_cast<int64_t>(filling_block_.size()) ==
+            dataset()->block_length_) {
+          SealFillingBlock();
+        }
+      }
+      return OkStatus();
+    }
+
+    void SealFillingBlock() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!filling_block_.empty()) {
+        blocks_.push_back(std::move(filling_block_));
+        filling_block_.clear();
+      }
+    }
+
+    // Moves a block chosen uniformly at random from `blocks_` to
+    // `current_block_` and shuffles it. Elements are produced from the back.
+    void TakeRandomBlock() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64_t index = Random() % blocks_.size();
+      std::swap(blocks_[index], blocks_.back());
+      current_block_ = std::move(blocks_.back());
+      blocks_.pop_back();
+      for (int64_t i = current_block_.size() - 1; i > 0; --i) {
+        std::swap(current_block_[i], current_block_[Random() % (i + 1)]);
+      }
+    }
+
+    mutex mu_;
+    SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
+    std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+    // The block being produced, in reverse order of production.
+    std::vector<std::vector<Tensor>> current_block_ TF_GUARDED_BY(mu_);
+    // Complete blocks waiting to be produced.
+    std::vector<std::vector<std::vector<Tensor>>> blocks_ TF_GUARDED_BY(mu_);
+    // The block being read from the input.
+    std::vector<std::vector<Tensor>> filling_block_ TF_GUARDED_BY(mu_);
+    // Number and total size of the elements in all of the above.
+    int64_t num_elements_ TF_GUARDED_BY(mu_) = 0;
+    int64_t buffered_bytes_ TF_GUARDED_BY(mu_) = 0;
+    int64_t epoch_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed2_ TF_GUARDED_BY(mu_) = 0;
+    random::PhiloxRandom parent_generator_ TF_GUARDED_BY(mu_);
+    random::SingleSampleAdapter<random::PhiloxRandom> generator_
+        TF_GUARDED_BY(mu_);
+    int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
+    bool data_produced_ TF_GUARDED_BY(mu_) = false;
+  };
+
   const DatasetBase* const input_;
   const int64_t buffer_size_;
   const std::shared_ptr<SeedGenerator> seed_generator_;
@@ -509,6 +830,11 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64_t count_;
+  // If positive, elements are shuffled in blocks of this many consecutive
+  // input elements by `BlockIterator`.
+  const int64_t block_length_;
+  // If positive, bounds the total size in bytes of the buffered elements.
+  const int64_t buffer_size_bytes_;
   const TraceMeMetadata traceme_metadata_;
   mutable mutex mu_;
   mutable std::vector<std::int64_t> shuffled_indices_ TF_GUARDED_BY(mu_);
@@ -634,8 +960,10 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
  public:
   DatasetV3(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
             int64_t count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            ResourceHandle&& resource_handle, bool owns_resource,
+            int64_t block_length, int64_t buffer_size_bytes)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           block_length, buffer_size_bytes),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -674,13 +1002,18 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
-    TF_RETURN_IF_ERROR(
-        b->AddDataset(this,
-                      {input_graph_node, buffer_size_node, seed_node,
-                       seed2_node, resource_handle_node},  // Inputs
-                      {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
-                      output));
+    AttrValue block_length;
+    b->BuildAttrValue(block_length_, &block_length);
+    AttrValue buffer_size_bytes;
+    b->BuildAttrValue(buffer_size_bytes_, &buffer_size_bytes);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {input_graph_node, buffer_size_node, seed_node, seed2_node,
+         resource_handle_node},  // Inputs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kBlockLength, block_length),
+         std::make_pair(kBufferSizeBytes, buffer_size_bytes)},  // Attrs
+        output));
     return OkStatus();
   }
 
@@ -706,6 +1039,12 @@ ShuffleDatasetOp::ShuffleDatasetOp(OpKernelConstruction* ctx)
     OP_REQUIRES_OK(
         ctx, ctx->GetAttr(kReshuffleEachIteration, &reshuffle_each_iteration_));
   }
+  if (ctx->HasAttr(kBlockLength)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kBlockLength, &block_length_));
+  }
+  if (ctx->HasAttr(kBufferSizeBytes)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kBufferSizeBytes, &buffer_size_bytes_));
+  }
 }
 
 void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
@@ -756,9 +1095,9 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     }
 
     // Ownership of manager is transferred onto `DatasetV3`.
-    *output = new ShuffleDatasetOp::DatasetV3(ctx, input, buffer_size, count,
-                                              std::move(seeds), manager,
-                                              std::move(handle), owns_resource);
+    *output = new ShuffleDatasetOp::DatasetV3(
+        ctx, input, buffer_size, count, std::move(seeds), manager,
+        std::move(handle), owns_resource, block_length_, buffer_size_bytes_);
   } else if (op_version_ == 2) {
     auto handle = HandleFromInput(ctx, 2);
     SeedGeneratorManager* manager = nullptr;
@@ -40,6 +40,8 @@ class ShuffleDatasetOpBase : public UnaryDatasetOpKernel {
 class ShuffleDatasetOp : public ShuffleDatasetOpBase {
  public:
   static constexpr const char* const kDatasetType = "Shuffle";
+  static constexpr const char* const kBlockLength = "block_length";
+  static constexpr const char* const kBufferSizeBytes = "buffer_size_bytes";
 
   explicit ShuffleDatasetOp(OpKernelConstruction* ctx);
 
@@ -53,6 +55,8 @@ class ShuffleDatasetOp : public ShuffleDatasetOpBase {
   class DatasetV3;
   int op_version_ = 0;
   bool reshuffle_each_iteration_ = true;
+  int64_t block_length_ = 0;
+  int64_t buffer_size_bytes_ = 0;
 };
 
 class ShuffleAndRepeatDatasetOp : public ShuffleDatasetOpBase {
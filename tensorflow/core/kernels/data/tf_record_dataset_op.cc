@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include <algorithm>
+
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -25,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
 namespace data {
@@ -36,9 +39,12 @@ namespace data {
 /* static */ constexpr const char* const TFRecordDatasetOp::kFileNames;
 /* static */ constexpr const char* const TFRecordDatasetOp::kCompressionType;
 /* static */ constexpr const char* const TFRecordDatasetOp::kBufferSize;
+/* static */ constexpr const char* const TFRecordDatasetOp::kUseMmap;
+/* static */ constexpr const char* const TFRecordDatasetOp::kUseIndex;
 
 constexpr char kCurrentFileIndex[] = "current_file_index";
 constexpr char kOffset[] = "offset";
+constexpr char kRecordIndex[] = "record_index";
 constexpr char kGcsFsPrefix[] = "gs://";
 constexpr char kS3FsPrefix[] = "s3://";
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
@@ -52,18 +58,52 @@ bool is_cloud_tpu_gcs_fs() {
   return false;
 }
 
+// Reads the sidecar record index of the uncompressed record file `filename`,
+// or builds the index by scanning the file if it has none.
+Status LoadRecordIndex(Env* env, const string& filename,
+                       io::RecordIndex* index) {
+  const string index_filename = io::RecordIndex::FileName(filename);
+  string contents;
+  Status s = ReadFileToString(env, index_filename, &contents);
+  if (errors::IsNotFound(s)) {
+    VLOG(1) << "No record index found for " << filename
+            << ". Building one by scanning the file.";
+    std::unique_ptr<RandomAccessFile> file;
+    TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+    return io::RecordIndex::Build(file.get(), index);
+  }
+  TF_RETURN_IF_ERROR(s);
+  TF_RETURN_IF_ERROR(io::RecordIndex::Decode(contents, index));
+  uint64 file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename, &file_size));
+  if (file_size != index->file_size()) {
+    return errors::FailedPrecondition(
+        "The record index ", index_filename, " was built for a file of ",
+        index->file_size(), " bytes, but ", filename, " has ", file_size,
+        " bytes.");
+  }
+  return OkStatus();
+}
+
 class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
-                   const string& compression_type, int64_t buffer_size)
+                   const string& compression_type, int64_t buffer_size,
+                   bool use_mmap, bool use_index)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
         options_(io::RecordReaderOptions::CreateRecordReaderOptions(
-            compression_type)) {
+            compression_type)),
+        use_mmap_(use_mmap),
+        use_index_(use_index) {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
+    if (use_index_) {
+      indices_.resize(filenames_.size());
+      files_.resize(filenames_.size());
+    }
   }
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -91,8 +131,58 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     return OkStatus();
   }
 
+  int64_t CardinalityInternal() const override {
+    if (!use_index_) {
+      return kUnknownCardinality;
+    }
+    Status s = LoadAllIndices(Env::Default());
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to load the record indices of "
+                   << name_utils::DatasetDebugString(kDatasetType) << ": "
+                   << s;
+      return kUnknownCardinality;
+    }
+    tf_shared_lock l(mu_);
+    return first_record_.back();
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return CardinalityInternal();
+  }
+
   Status CheckExternalState() const override { return OkStatus(); }
 
+  Status Get(OpKernelContext* ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    if (use_index_) {
+      TF_RETURN_IF_ERROR(LoadAllIndices(ctx->env()));
+    }
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    RandomAccessFile* file;
+    uint64 offset;
+    {
+      mutex_lock l(mu_);
+      // The file holding record `index` is the last one whose first record is
+      // not after it.
+      const size_t file_index =
+          std::upper_bound(first_record_.begin(), first_record_.end(), index) -
+          first_record_.begin() - 1;
+      offset = indices_[file_index]->offset(index - first_record_[file_index]);
+      if (files_[file_index] == nullptr) {
+        TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
+            TranslateFileName(filenames_[file_index]), &files_[file_index]));
+      }
+      file = files_[file_index].get();
+    }
+    // Reads of a RandomAccessFile are thread-safe, so the cached file is
+    // read without holding `mu_`.
+    io::RecordReader reader(file);
+    Tensor record(DT_STRING, TensorShape({}));
+    TF_RETURN_IF_ERROR(reader.ReadRecord(&offset, &record.scalar<tstring>()()));
+    out_tensors->push_back(std::move(record));
+    return OkStatus();
+  }
+
  protected:
   Status AsGraphDefInternal(SerializationContext* ctx,
                             DatasetGraphDefBuilder* b,
@@ -103,8 +193,15 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
     Node* buffer_size = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
+    AttrValue use_mmap;
+    b->BuildAttrValue(use_mmap_, &use_mmap);
+    AttrValue use_index;
+    b->BuildAttrValue(use_index_, &use_index);
     TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {filenames, compression_type, buffer_size}, output));
+        this, {filenames, compression_type, buffer_size},
+        {std::make_pair(kUseMmap, use_mmap),
+         std::make_pair(kUseIndex, use_index)},
+        output));
     return OkStatus();
   }
 
@@ -121,16 +218,18 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       mutex_lock l(mu_);
       do {
         // We are currently processing a file, so try to read the next record.
-        if (reader_) {
+        if (reader_ || mapped_reader_) {
           out_tensors->emplace_back(ctx->allocator({}), DT_STRING,
                                     TensorShape({}));
-          Status s =
-              reader_->ReadRecord(&out_tensors->back().scalar<tstring>()());
+          tstring* record = &out_tensors->back().scalar<tstring>()();
+          Status s = mapped_reader_ ? mapped_reader_->ReadRecord(record)
+                                    : reader_->ReadRecord(record);
           if (s.ok()) {
             static monitoring::CounterCell* bytes_counter =
                 metrics::GetTFDataBytesReadCounter(kDatasetType);
             bytes_counter->IncrementBy(
                 out_tensors->back().scalar<tstring>()().size());
+            ++record_index_;
             *end_of_sequence = false;
             return OkStatus();
           }
@@ -141,6 +240,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
             // Otherwise the same file will repeat.
             ResetStreamsLocked();
             ++current_file_index_;
+            record_index_ = 0;
             return s;
           }
 
@@ -148,6 +248,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
           // next file.
           ResetStreamsLocked();
           ++current_file_index_;
+          record_index_ = 0;
         }
 
         // Iteration ends when there are no more files to process.
@@ -164,14 +265,22 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
                         bool* end_of_sequence, int* num_skipped) override {
       *num_skipped = 0;
       mutex_lock l(mu_);
+      if (dataset()->use_index_) {
+        return SkipWithIndexLocked(ctx->env(), num_to_skip, end_of_sequence,
+                                   num_skipped);
+      }
       do {
         // We are currently processing a file, so try to skip reading
         // the next (num_to_skip - *num_skipped) record.
-        if (reader_) {
+        if (reader_ || mapped_reader_) {
           int last_num_skipped;
-          Status s = reader_->SkipRecords(num_to_skip - *num_skipped,
-                                          &last_num_skipped);
+          Status s = mapped_reader_
+                         ? mapped_reader_->SkipRecords(
+                               num_to_skip - *num_skipped, &last_num_skipped)
+                         : reader_->SkipRecords(num_to_skip - *num_skipped,
+                                                &last_num_skipped);
           *num_skipped += last_num_skipped;
+          record_index_ += last_num_skipped;
           if (s.ok()) {
             *end_of_sequence = false;
             return OkStatus();
@@ -182,6 +291,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
             // Otherwise the same file will repeat.
             ResetStreamsLocked();
             ++current_file_index_;
+            record_index_ = 0;
             return s;
           }
 
@@ -189,6 +299,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
           // next file.
           ResetStreamsLocked();
           ++current_file_index_;
+          record_index_ = 0;
         }
 
         // Iteration ends when there are no more files to process.
@@ -213,10 +324,17 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCurrentFileIndex),
                                              current_file_index_));
 
-      if (reader_) {
+      if (mapped_reader_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kOffset),
+                                               mapped_reader_->TellOffset()));
+      } else if (reader_) {
         TF_RETURN_IF_ERROR(
             writer->WriteScalar(full_name(kOffset), reader_->TellOffset()));
       }
+      if (dataset()->use_index_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kRecordIndex), record_index_));
+      }
       return OkStatus();
     }
 
@@ -228,11 +346,20 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kCurrentFileIndex),
                                             &current_file_index));
       current_file_index_ = size_t(current_file_index);
+      record_index_ = 0;
+      if (reader->Contains(full_name(kRecordIndex))) {
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(full_name(kRecordIndex), &record_index_));
+      }
       if (reader->Contains(full_name(kOffset))) {
         int64_t offset;
         TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kOffset), &offset));
         TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
-        TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        if (mapped_reader_) {
+          TF_RETURN_IF_ERROR(mapped_reader_->SeekOffset(offset));
+        } else {
+          TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        }
       }
       return OkStatus();
     }
@@ -247,36 +374,164 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       }
 
       // Actually move on to next file.
-      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(
-          TranslateFileName(dataset()->filenames_[current_file_index_]),
-          &file_));
+      const string filename =
+          TranslateFileName(dataset()->filenames_[current_file_index_]);
+      if (dataset()->use_mmap_ && dataset()->options_.compression_type ==
+                                      io::RecordReaderOptions::NONE) {
+        std::unique_ptr<ReadOnlyMemoryRegion> region;
+        Status s = env->NewReadOnlyMemoryRegionFromFile(filename, &region);
+        if (s.ok() && region != nullptr) {
+          mapped_reader_ =
+              std::make_unique<io::MappedRecordReader>(std::move(region));
+          return SeekToRecordLocked(env);
+        }
+        // File systems without memory mapping, and empty files, which
+        // cannot be mapped, are read with the buffered reader below.
+        VLOG(2) << "Not memory mapping " << filename << ": " << s;
+      }
+      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file_));
       reader_ = std::make_unique<io::SequentialRecordReader>(
           file_.get(), dataset()->options_);
+      return SeekToRecordLocked(env);
+    }
+
+    // Positions the reader of the current file at record `record_index_` when
+    // the file is indexed and the record is not the first one.
+    Status SeekToRecordLocked(Env* env) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!dataset()->use_index_ || record_index_ == 0) {
+        return OkStatus();
+      }
+      const io::RecordIndex* index;
+      TF_RETURN_IF_ERROR(
+          dataset()->LoadIndex(env, current_file_index_, &index));
+      const uint64 offset = index->offset(record_index_);
+      return mapped_reader_ ? mapped_reader_->SeekOffset(offset)
+                            : reader_->SeekOffset(offset);
+    }
+
+    // Skips records by looking up the offset of the first record after them
+    // in the file indices, instead of reading through the skipped records.
+    Status SkipWithIndexLocked(Env* env, int num_to_skip,
+                               bool* end_of_sequence, int* num_skipped)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (*num_skipped < num_to_skip) {
+        if (current_file_index_ == dataset()->filenames_.size()) {
+          *end_of_sequence = true;
+          return OkStatus();
+        }
+        const io::RecordIndex* index;
+        TF_RETURN_IF_ERROR(
+            dataset()->LoadIndex(env, current_file_index_, &index));
+        const int64_t num_records = index->num_records();
+        const int64_t remaining = num_to_skip - *num_skipped;
+        if (record_index_ + remaining < num_records) {
+          record_index_ += remaining;
+          *num_skipped = num_to_skip;
+          if (reader_ || mapped_reader_) {
+            TF_RETURN_IF_ERROR(SeekToRecordLocked(env));
+          }
+          break;
+        }
+        *num_skipped += num_records - record_index_;
+        ResetStreamsLocked();
+        ++current_file_index_;
+        record_index_ = 0;
+      }
+      *end_of_sequence = false;
       return OkStatus();
     }
 
     // Resets all reader streams.
     void ResetStreamsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      mapped_reader_.reset();
       reader_.reset();
       file_.reset();
     }
 
     mutex mu_;
     size_t current_file_index_ TF_GUARDED_BY(mu_) = 0;
+    // Position of the next record in the current file. Only used to seek
+    // with the record indices when `use_index_` is set.
+    int64_t record_index_ TF_GUARDED_BY(mu_) = 0;
 
     // `reader_` will borrow the object that `file_` points to, so
     // we must destroy `reader_` before `file_`.
     std::unique_ptr<RandomAccessFile> file_ TF_GUARDED_BY(mu_);
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
+    // Used instead of `reader_` when the file is memory mapped.
+    std::unique_ptr<io::MappedRecordReader> mapped_reader_ TF_GUARDED_BY(mu_);
   };
 
   const std::vector<string> filenames_;
   const tstring compression_type_;
   io::RecordReaderOptions options_;
+  const bool use_mmap_;
+  const bool use_index_;
+
+  // Loads the record index of file `file_index` unless it is loaded already,
+  // and sets `*index` to it. Indices are only loaded when first needed, since
+  // building one scans the whole file.
+  Status LoadIndex(Env* env, size_t file_index,
+                   const io::RecordIndex** index) const TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    TF_RETURN_IF_ERROR(LoadIndexLocked(env, file_index));
+    *index = indices_[file_index].get();
+    return OkStatus();
+  }
+
+  Status LoadIndexLocked(Env* env, size_t file_index) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (indices_[file_index] != nullptr) {
+      return OkStatus();
+    }
+    auto index = std::make_unique<io::RecordIndex>();
+    TF_RETURN_IF_ERROR(LoadRecordIndex(
+        env, TranslateFileName(filenames_[file_index]), index.get()));
+    indices_[file_index] = std::move(index);
+    return OkStatus();
+  }
+
+  // Loads the record indices of all files and computes `first_record_`,
+  // which random access and the cardinality need.
+  Status LoadAllIndices(Env* env) const TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    if (!first_record_.empty()) {
+      return OkStatus();
+    }
+    for (size_t i = 0; i < filenames_.size(); ++i) {
+      TF_RETURN_IF_ERROR(LoadIndexLocked(env, i));
+    }
+    first_record_.reserve(indices_.size() + 1);
+    first_record_.push_back(0);
+    for (const auto& index : indices_) {
+      first_record_.push_back(first_record_.back() + index->num_records());
+    }
+    return OkStatus();
+  }
+
+  mutable mutex mu_;
+  // When `use_index_` is set, the record index of every file once it is
+  // loaded. A loaded index is never replaced, so it may be read without
+  // holding `mu_`.
+  mutable std::vector<std::unique_ptr<io::RecordIndex>> indices_
+      TF_GUARDED_BY(mu_);
+  // Once all indices are loaded, the position of the first record of every
+  // file in the dataset followed by the total number of records.
+  mutable std::vector<int64_t> first_record_ TF_GUARDED_BY(mu_);
+  // The files opened by `Get()`, kept open for later records of each file.
+  mutable std::vector<std::unique_ptr<RandomAccessFile>> files_
+      TF_GUARDED_BY(mu_);
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
-    : DatasetOpKernel(ctx) {}
+    : DatasetOpKernel(ctx) {
+  if (ctx->HasAttr(kUseMmap)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kUseMmap, &use_mmap_));
+  }
+  if (ctx->HasAttr(kUseIndex)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kUseIndex, &use_index_));
+  }
+}
 
 void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
                                     DatasetBase** output) {
@@ -324,8 +579,16 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
     buffer_size = kS3BlockSize;
   }
 
-  *output =
-      new Dataset(ctx, std::move(filenames), compression_type, buffer_size);
+  if (use_index_) {
+    OP_REQUIRES(ctx, compression_type.empty(),
+                errors::InvalidArgument(
+                    "`use_index` requires uncompressed files, but got "
+                    "compression type \"",
+                    compression_type, "\"."));
+  }
+
+  *output = new Dataset(ctx, std::move(filenames), compression_type,
+                        buffer_size, use_mmap_, use_index_);
 }
 
 namespace {
@@ -26,6 +26,8 @@ class TFRecordDatasetOp : public DatasetOpKernel {
   static constexpr const char* const kFileNames = "filenames";
   static constexpr const char* const kCompressionType = "compression_type";
   static constexpr const char* const kBufferSize = "buffer_size";
+  static constexpr const char* const kUseMmap = "use_mmap";
+  static constexpr const char* const kUseIndex = "use_index";
 
   explicit TFRecordDatasetOp(OpKernelConstruction* ctx);
 
@@ -34,6 +36,8 @@ class TFRecordDatasetOp : public DatasetOpKernel {
 
  private:
   class Dataset;
+  bool use_mmap_ = false;
+  bool use_index_ = false;
 };
 
 }  // namespace data
@@ -0,0 +1,525 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+enum class Combiner { kSum, kMean, kSqrtN };
+
+Status ParseCombiner(const std::string& combiner, Combiner* out) {
+  if (combiner == "sum") {
+    *out = Combiner::kSum;
+  } else if (combiner == "mean") {
+    *out = Combiner::kMean;
+  } else if (combiner == "sqrtn") {
+    *out = Combiner::kSqrtN;
+  } else {
+    return errors::InvalidArgument("Unknown combiner: ", combiner);
+  }
+  return OkStatus();
+}
+
+// Rows are accumulated in float for the 16-bit types, as in
+// SparseSegmentReductionOpBase.
+template <typename T>
+struct AccumType {
+  typedef T type;
+};
+template <>
+struct AccumType<Eigen::half> {
+  typedef float type;
+};
+template <>
+struct AccumType<bfloat16> {
+  typedef float type;
+};
+
+// Checks the inputs shared by the forward and gradient kernels and computes
+// the CSR-style boundaries of the segments: the entries of segment `s` are
+// `[(*segment_starts)[s], (*segment_starts)[s + 1])`.
+template <typename Index, typename SegmentId>
+Status ComputeSegmentStarts(const Tensor& indices, const Tensor& segment_ids,
+                            const Tensor& weights, int64_t num_rows,
+                            int64_t num_segments,
+                            std::vector<int64_t>* segment_starts) {
+  if (!TensorShapeUtils::IsVector(indices.shape())) {
+    return errors::InvalidArgument("indices should be a vector, got shape ",
+                                   indices.shape().DebugString());
+  }
+  if (!TensorShapeUtils::IsVector(segment_ids.shape())) {
+    return errors::InvalidArgument("segment_ids should be a vector, got shape ",
+                                   segment_ids.shape().DebugString());
+  }
+  const int64_t num_indices = indices.NumElements();
+  if (segment_ids.NumElements() != num_indices) {
+    return errors::InvalidArgument(
+        "segment_ids and indices should have same size, got ",
+        segment_ids.NumElements(), " vs ", num_indices);
+  }
+  if (weights.NumElements() != 0 &&
+      (!TensorShapeUtils::IsVector(weights.shape()) ||
+       weights.NumElements() != num_indices)) {
+    return errors::InvalidArgument(
+        "weights should be empty or a vector with the same size as indices, "
+        "got shape ",
+        weights.shape().DebugString());
+  }
+
+  const auto indices_vec = indices.vec<Index>();
+  const auto segment_vec = segment_ids.vec<SegmentId>();
+  segment_starts->assign(num_segments + 1, num_indices);
+  int64_t next_segment = 0;
+  for (int64_t i = 0; i < num_indices; ++i) {
+    const Index index = internal::SubtleMustCopy(indices_vec(i));
+    if (!FastBoundsCheck(index, num_rows)) {
+      return errors::InvalidArgument("indices[", i, "] == ", index,
+                                     " out of range [0, ", num_rows, ")");
+    }
+    const SegmentId segment = internal::SubtleMustCopy(segment_vec(i));
+    if (!FastBoundsCheck(segment, num_segments)) {
+      return errors::InvalidArgument("segment_ids[", i, "] == ", segment,
+                                     " out of range [0, ", num_segments, ")");
+    }
+    if (segment + 1 < next_segment) {
+      return errors::InvalidArgument("segment ids are not increasing");
+    }
+    for (; next_segment <= segment; ++next_segment) {
+      (*segment_starts)[next_segment] = i;
+    }
+  }
+  return OkStatus();
+}
+
+// Returns the factor that scales the embedding row `row` to an L2 norm of at
+// most `max_norm`, or 1 if `max_norm` is not positive.
+template <typename Acc, typename Row>
+Acc MaxNormScale(const Row& row, float max_norm) {
+  if (max_norm <= 0) return Acc(1);
+  const Acc norm = std::sqrt(row.template cast<Acc>().square().sum());
+  return norm > Acc(max_norm) ? Acc(max_norm) / norm : Acc(1);
+}
+
+// Returns the reciprocal of the combiner's denominator for the entries in
+// `[start, end)`, or 0 if the denominator is 0 (matching the `div_no_nan` in
+// `tf.nn.embedding_lookup_sparse`).
+template <typename T, typename Acc>
+Acc CombinerScale(Combiner combiner, const Tensor& weights, int64_t start,
+                  int64_t end) {
+  if (combiner == Combiner::kSum) return Acc(1);
+  Acc denominator = 0;
+  if (weights.NumElements() == 0) {
+    const Acc count = static_cast<Acc>(end - start);
+    denominator = combiner == Combiner::kMean ? count : std::sqrt(count);
+  } else {
+    const auto weights_vec = weights.vec<T>();
+    for (int64_t i = start; i < end; ++i) {
+      const Acc weight = static_cast<Acc>(weights_vec(i));
+      denominator += combiner == Combiner::kMean ? weight : weight * weight;
+    }
+    if (combiner == Combiner::kSqrtN) denominator = std::sqrt(denominator);
+  }
+  return denominator == Acc(0) ? Acc(0) : Acc(1) / denominator;
+}
+
+int64_t GetNumSegments(const Tensor& num_segments) {
+  return num_segments.dtype() == DT_INT32
+             ? internal::SubtleMustCopy(num_segments.scalar<int32>()())
+             : internal::SubtleMustCopy(num_segments.scalar<int64_t>()());
+}
+
+}  // namespace
+
+// Computes `output[s] = combine_{i : segment_ids[i] == s}(weights[i] *
+// clip(params[indices[i]]))` in a single pass. Unlike the
+// Gather + SparseSegmentReduction pipeline, the gathered rows are never
+// materialized: each row is read from `params` and accumulated straight into
+// its segment's output row.
+//
+// When `TParams` differs from `T`, this implements
+// FusedSparseEmbeddingLookupDequantize: `params` is stored in a narrower type,
+// row `r` stands for `scales[r] * params[r]`, and rows are converted to the
+// accumulator type as they are gathered.
+template <typename TParams, typename T, typename Index, typename SegmentId>
+class FusedSparseEmbeddingLookupOp : public OpKernel {
+ public:
+  explicit FusedSparseEmbeddingLookupOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    std::string combiner;
+    OP_REQUIRES_OK(context, context->GetAttr("combiner", &combiner));
+    OP_REQUIRES_OK(context, ParseCombiner(combiner, &combiner_));
+    OP_REQUIRES_OK(context, context->GetAttr("max_norm", &max_norm_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* params;
+    const Tensor* indices;
+    const Tensor* segment_ids;
+    const Tensor* weights;
+    const Tensor* num_segments_t;
+    OP_REQUIRES_OK(context, context->input("params", &params));
+    OP_REQUIRES_OK(context, context->input("indices", &indices));
+    OP_REQUIRES_OK(context, context->input("segment_ids", &segment_ids));
+    OP_REQUIRES_OK(context, context->input("weights", &weights));
+    OP_REQUIRES_OK(context, context->input("num_segments", &num_segments_t));
+
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(params->shape()),
+                errors::InvalidArgument("params must be at least 1-D, got ",
+                                        params->shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(num_segments_t->shape()),
+                errors::InvalidArgument("num_segments should be a scalar, got ",
+                                        num_segments_t->shape().DebugString()));
+    const int64_t num_segments = GetNumSegments(*num_segments_t);
+    OP_REQUIRES(context, num_segments >= 0,
+                errors::InvalidArgument("num_segments must be >= 0, got ",
+                                        num_segments));
+
+    // Per-row scales are required for int8 rows and optional for the 16-bit
+    // float types.
+    Tensor scales;
+    if (kDequantize) {
+      const Tensor* scales_t;
+      OP_REQUIRES_OK(context, context->input("scales", &scales_t));
+      scales = *scales_t;
+      const bool needs_scales = std::is_integral<TParams>::value;
+      OP_REQUIRES(
+          context,
+          (!needs_scales && scales.NumElements() == 0) ||
+              (TensorShapeUtils::IsVector(scales.shape()) &&
+               scales.NumElements() == params->dim_size(0)),
+          errors::InvalidArgument(
+              needs_scales ? "scales must be a vector"
+                           : "scales must be empty or a vector",
+              " with one entry per row of params, got shape ",
+              scales.shape().DebugString(), " for params of shape ",
+              params->shape().DebugString()));
+    }
+
+    std::vector<int64_t> segment_starts;
+    OP_REQUIRES_OK(context, (ComputeSegmentStarts<Index, SegmentId>(
+                                *indices, *segment_ids, *weights,
+                                params->dim_size(0), num_segments,
+                                &segment_starts)));
+
+    TensorShape output_shape = params->shape();
+    OP_REQUIRES_OK(context, output_shape.SetDimWithStatus(0, num_segments));
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+    if (num_segments == 0) return;
+
+    const auto params_flat = params->flat_outer_dims<TParams>();
+    const auto indices_vec = indices->vec<Index>();
+    auto output_flat = output->flat_outer_dims<T>();
+    const int64_t dim = params_flat.dimension(1);
+    const bool has_scales = scales.NumElements() != 0;
+
+    auto work = [&](int64_t begin_segment, int64_t end_segment) {
+      Eigen::Array<Acc, Eigen::Dynamic, 1> accum(dim);
+      for (int64_t s = begin_segment; s < end_segment; ++s) {
+        const int64_t start = segment_starts[s];
+        const int64_t end = segment_starts[s + 1];
+        accum.setZero();
+        for (int64_t i = start; i < end; ++i) {
+          const Index index = indices_vec(i);
+          ConstParamsRow row(&params_flat(index, 0), dim);
+          Acc scale = 1;
+          if (has_scales) scale = scales.vec<float>()(index);
+          // The max norm applies to the dequantized row.
+          const Acc abs_scale = std::abs(scale);
+          scale *= MaxNormScale<Acc>(
+              row, abs_scale > Acc(0) ? max_norm_ / abs_scale : 0);
+          if (weights->NumElements() != 0) {
+            scale *= static_cast<Acc>(weights->vec<T>()(i));
+          }
+          accum += scale * row.template cast<Acc>();
+        }
+        accum *= CombinerScale<T, Acc>(combiner_, *weights, start, end);
+        Row(&output_flat(s, 0), dim) = accum.template cast<T>();
+      }
+    };
+    const int64_t num_indices = indices->NumElements();
+    const int64_t cost_per_segment =
+        (num_indices / num_segments + 1) * dim * 4;
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_segments,
+          cost_per_segment, work);
+  }
+
+ private:
+  static constexpr bool kDequantize = !std::is_same<TParams, T>::value;
+  typedef typename AccumType<T>::type Acc;
+  typedef Eigen::Map<const Eigen::Array<TParams, Eigen::Dynamic, 1>>
+      ConstParamsRow;
+  typedef Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> Row;
+
+  Combiner combiner_;
+  float max_norm_;
+};
+
+// Computes the gradient of FusedSparseEmbeddingLookup with respect to
+// `params` as the components of an IndexedSlices: `values[i]` is the gradient
+// of the row `params[indices[i]]`, and `indices` is forwarded unchanged. The
+// max-norm scale of each row is treated as a constant.
+template <typename T, typename Index, typename SegmentId>
+class FusedSparseEmbeddingLookupGradOp : public OpKernel {
+ public:
+  explicit FusedSparseEmbeddingLookupGradOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    std::string combiner;
+    OP_REQUIRES_OK(context, context->GetAttr("combiner", &combiner));
+    OP_REQUIRES_OK(context, ParseCombiner(combiner, &combiner_));
+    OP_REQUIRES_OK(context, context->GetAttr("max_norm", &max_norm_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& grad = context->input(0);
+    const Tensor& params = context->input(1);
+    const Tensor& indices = context->input(2);
+    const Tensor& segment_ids = context->input(3);
+    const Tensor& weights = context->input(4);
+
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(params.shape()),
+                errors::InvalidArgument("params must be at least 1-D, got ",
+                                        params.shape().DebugString()));
+    OP_REQUIRES(context, grad.dims() == params.dims(),
+                errors::InvalidArgument(
+                    "grad and params must have the same rank, got ",
+                    grad.shape().DebugString(), " and ",
+                    params.shape().DebugString()));
+    for (int d = 1; d < params.dims(); ++d) {
+      OP_REQUIRES(context, grad.dim_size(d) == params.dim_size(d),
+                  errors::InvalidArgument(
+                      "grad and params must match in all but the first "
+                      "dimension, got ",
+                      grad.shape().DebugString(), " and ",
+                      params.shape().DebugString()));
+    }
+    const int64_t num_segments = grad.dim_size(0);
+
+    std::vector<int64_t> segment_starts;
+    OP_REQUIRES_OK(context, (ComputeSegmentStarts<Index, SegmentId>(
+                                indices, segment_ids, weights,
+                                params.dim_size(0), num_segments,
+                                &segment_starts)));
+
+    const int64_t num_indices = indices.NumElements();
+    TensorShape values_shape = params.shape();
+    OP_REQUIRES_OK(context, values_shape.SetDimWithStatus(0, num_indices));
+    Tensor* values = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, values_shape, &values));
+    context->set_output(1, indices);
+    if (num_indices == 0) return;
+
+    const auto grad_flat = grad.flat_outer_dims<T>();
+    const auto params_flat = params.flat_outer_dims<T>();
+    const auto indices_vec = indices.vec<Index>();
+    auto values_flat = values->flat_outer_dims<T>();
+    const int64_t dim = params_flat.dimension(1);
+
+    auto work = [&](int64_t begin_segment, int64_t end_segment) {
+      for (int64_t s = begin_segment; s < end_segment; ++s) {
+        const int64_t start = segment_starts[s];
+        const int64_t end = segment_starts[s + 1];
+        if (start == end) continue;
+        const Acc combiner_scale =
+            CombinerScale<T, Acc>(combiner_, weights, start, end);
+        ConstRow grad_row(&grad_flat(s, 0), dim);
+        for (int64_t i = start; i < end; ++i) {
+          Acc scale = combiner_scale;
+          if (max_norm_ > 0) {
+            scale *= MaxNormScale<Acc>(
+                ConstRow(&params_flat(indices_vec(i), 0), dim), max_norm_);
+          }
+          if (weights.NumElements() != 0) {
+            scale *= static_cast<Acc>(weights.vec<T>()(i));
+          }
+          Row(&values_flat(i, 0), dim) =
+              (scale * grad_row.template cast<Acc>()).template cast<T>();
+        }
+      }
+    };
+    const int64_t cost_per_segment =
+        (num_indices / std::max<int64_t>(num_segments, 1) + 1) * dim * 2;
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_segments,
+          cost_per_segment, work);
+  }
+
+ private:
+  typedef typename AccumType<T>::type Acc;
+  typedef Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> ConstRow;
+  typedef Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> Row;
+
+  Combiner combiner_;
+  float max_norm_;
+};
+
+// Quantizes each row of `params` to int8 with a symmetric per-row scale:
+// `scales[r] = max(abs(params[r])) / 127` and
+// `quantized[r] = round(params[r] / scales[r])`, so that `scales[r] *
+// quantized[r]` approximates `params[r]` to within `scales[r] / 2`. Rows
+// containing Inf or NaN cannot be quantized and are rejected.
+template <typename T>
+class QuantizeEmbeddingRowsOp : public OpKernel {
+ public:
+  explicit QuantizeEmbeddingRowsOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& params = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(params.shape()),
+                errors::InvalidArgument("params must be at least 1-D, got ",
+                                        params.shape().DebugString()));
+    Tensor* quantized = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, params.shape(), &quantized));
+    Tensor* scales = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       1, TensorShape({params.dim_size(0)}), &scales));
+    const int64_t num_rows = params.dim_size(0);
+    if (num_rows == 0) return;
+
+    const auto params_flat = params.flat_outer_dims<T>();
+    auto quantized_flat = quantized->flat_outer_dims<int8>();
+    auto scales_vec = scales->vec<float>();
+    const int64_t dim = params_flat.dimension(1);
+
+    // The first row that is not finite, or `num_rows` if there is none.
+    std::atomic<int64_t> first_non_finite_row(num_rows);
+    auto work = [&](int64_t begin_row, int64_t end_row) {
+      for (int64_t r = begin_row; r < end_row; ++r) {
+        const auto row =
+            Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>(
+                &params_flat(r, 0), dim)
+                .template cast<float>();
+        Eigen::Map<Eigen::Array<int8, Eigen::Dynamic, 1>> out(
+            &quantized_flat(r, 0), dim);
+        if (!row.isFinite().all()) {
+          // Casting a NaN or out of range value to int8 is undefined.
+          int64_t first = first_non_finite_row.load();
+          while (r < first &&
+                 !first_non_finite_row.compare_exchange_weak(first, r)) {
+          }
+          return;
+        }
+        const float max_abs = dim == 0 ? 0.0f : row.abs().maxCoeff();
+        const float scale = max_abs / 127.0f;
+        scales_vec(r) = scale;
+        if (scale == 0.0f) {
+          out.setZero();
+        } else {
+          out = (row / scale)
+                    .round()
+                    .max(-127.0f)
+                    .min(127.0f)
+                    .template cast<int8>();
+        }
+      }
+    };
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_rows,
+          dim * 4, work);
+    const int64_t non_finite_row = first_non_finite_row.load();
+    OP_REQUIRES(context, non_finite_row == num_rows,
+                errors::InvalidArgument("params row ", non_finite_row,
+                                        " contains Inf or NaN, which cannot "
+                                        "be quantized"));
+  }
+};
+
+#define REGISTER_CPU_KERNELS_WITH_INDEX(type, index_type, segment_ids_type) \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("FusedSparseEmbeddingLookup")                                    \
+          .Device(DEVICE_CPU)                                               \
+          .TypeConstraint<type>("T")                                        \
+          .TypeConstraint<index_type>("Tidx")                               \
+          .TypeConstraint<segment_ids_type>("Tsegmentids"),                 \
+      FusedSparseEmbeddingLookupOp<type, type, index_type,                  \
+                                   segment_ids_type>);                      \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("FusedSparseEmbeddingLookupGrad")                                \
+          .Device(DEVICE_CPU)                                               \
+          .TypeConstraint<type>("T")                                        \
+          .TypeConstraint<index_type>("Tidx")                               \
+          .TypeConstraint<segment_ids_type>("Tsegmentids"),                 \
+      FusedSparseEmbeddingLookupGradOp<type, index_type, segment_ids_type>);
+
+#define REGISTER_CPU_KERNELS(type)                         \
+  REGISTER_CPU_KERNELS_WITH_INDEX(type, int32, int32);     \
+  REGISTER_CPU_KERNELS_WITH_INDEX(type, int32, int64_t);   \
+  REGISTER_CPU_KERNELS_WITH_INDEX(type, int64_t, int32);   \
+  REGISTER_CPU_KERNELS_WITH_INDEX(type, int64_t, int64_t);
+
+TF_CALL_FLOAT_TYPES(REGISTER_CPU_KERNELS);
+
+#undef REGISTER_CPU_KERNELS
+#undef REGISTER_CPU_KERNELS_WITH_INDEX
+
+#define REGISTER_CPU_KERNELS_WITH_INDEX(type, index_type, segment_ids_type) \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("FusedSparseEmbeddingLookupDequantize")                          \
+          .Device(DEVICE_CPU)                                               \
+          .TypeConstraint<type>("Tparams")                                  \
+          .TypeConstraint<index_type>("Tidx")                               \
+          .TypeConstraint<segment_ids_type>("Tsegmentids"),                 \
+      FusedSparseEmbeddingLookupOp<type, float, index_type,                 \
+                                   segment_ids_type>);
+
+#define REGISTER_CPU_KERNELS(type)                         \
+  REGISTER_CPU_KERNELS_WITH_INDEX(type, int32, int32);     \
+  REGISTER_CPU_KERNELS_WITH_INDEX(type, int32, int64_t);   \
+  REGISTER_CPU_KERNELS_WITH_INDEX(type, int64_t, int32);   \
+  REGISTER_CPU_KERNELS_WITH_INDEX(type, int64_t, int64_t);
+
+TF_CALL_int8(REGISTER_CPU_KERNELS);
+TF_CALL_bfloat16(REGISTER_CPU_KERNELS);
+TF_CALL_half(REGISTER_CPU_KERNELS);
+
+#undef REGISTER_CPU_KERNELS
+#undef REGISTER_CPU_KERNELS_WITH_INDEX
+
+#define REGISTER_CPU_KERNELS(type)                                     \
+  REGISTER_KERNEL_BUILDER(Name("QuantizeEmbeddingRows")                \
+                              .Device(DEVICE_CPU)                      \
+                              .TypeConstraint<type>("T"),              \
+                          QuantizeEmbeddingRowsOp<type>);
+
+TF_CALL_FLOAT_TYPES(REGISTER_CPU_KERNELS);
+
+#undef REGISTER_CPU_KERNELS
+
+}  // namespace tensorflow
@@ -0,0 +1,352 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <limits>
+#include <string>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedSparseEmbeddingLookupOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(const std::string& combiner, float max_norm) {
+    TF_ASSERT_OK(NodeDefBuilder("lookup", "FusedSparseEmbeddingLookup")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Attr("combiner", combiner)
+                     .Attr("max_norm", max_norm)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Rows 0 and 2 form segment 0, rows 1 and 3 form segment 2, and segments 1
+  // and 3 are empty.
+  void AddInputs(bool weighted) {
+    AddInputFromArray<float>(TensorShape({4, 2}), {1, 0, 0, 2, 3, 4, 1, 1});
+    AddInputFromArray<int32>(TensorShape({4}), {0, 2, 1, 3});
+    AddInputFromArray<int32>(TensorShape({4}), {0, 0, 2, 2});
+    if (weighted) {
+      AddInputFromArray<float>(TensorShape({4}), {1, 2, 0.5, 2});
+    } else {
+      AddInputFromArray<float>(TensorShape({0}), {});
+    }
+    AddInputFromArray<int32>(TensorShape({}), {4});
+  }
+};
+
+TEST_F(FusedSparseEmbeddingLookupOpTest, WeightedSum) {
+  MakeOp("sum", 0);
+  AddInputs(/*weighted=*/true);
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({7, 8, 0, 0, 2, 3, 0, 0}, TensorShape({4, 2})),
+      1e-5);
+}
+
+TEST_F(FusedSparseEmbeddingLookupOpTest, WeightedMean) {
+  MakeOp("mean", 0);
+  AddInputs(/*weighted=*/true);
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({7.f / 3, 8.f / 3, 0, 0, 0.8, 1.2, 0, 0},
+                            TensorShape({4, 2})),
+      1e-5);
+}
+
+TEST_F(FusedSparseEmbeddingLookupOpTest, UnweightedSqrtN) {
+  MakeOp("sqrtn", 0);
+  AddInputs(/*weighted=*/false);
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>(
+          {2.828427, 2.828427, 0, 0, 0.707107, 2.121320, 0, 0},
+          TensorShape({4, 2})),
+      1e-5);
+}
+
+TEST_F(FusedSparseEmbeddingLookupOpTest, MaxNorm) {
+  MakeOp("sum", 1);
+  AddInputs(/*weighted=*/true);
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({2.2, 1.6, 0, 0, 1.414214, 1.914214, 0, 0},
+                            TensorShape({4, 2})),
+      1e-5);
+}
+
+TEST_F(FusedSparseEmbeddingLookupOpTest, IndexOutOfRange) {
+  MakeOp("sum", 0);
+  AddInputFromArray<float>(TensorShape({2, 1}), {1, 2});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 2});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 0});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({}), {1});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "indices[1] == 2 out of range"))
+      << s;
+}
+
+TEST_F(FusedSparseEmbeddingLookupOpTest, UnsortedSegments) {
+  MakeOp("sum", 0);
+  AddInputFromArray<float>(TensorShape({2, 1}), {1, 2});
+  AddInputFromArray<int32>(TensorShape({3}), {0, 1, 0});
+  AddInputFromArray<int32>(TensorShape({3}), {0, 1, 0});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({}), {2});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "segment ids are not increasing"))
+      << s;
+}
+
+TEST_F(OpsTestBase, FusedSparseEmbeddingLookupGrad) {
+  TF_ASSERT_OK(NodeDefBuilder("lookup_grad", "FusedSparseEmbeddingLookupGrad")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("combiner", "mean")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<float>(TensorShape({4, 2}), {1, 1, 9, 9, 2, 4, 9, 9});
+  AddInputFromArray<float>(TensorShape({4, 2}), {1, 0, 0, 2, 3, 4, 1, 1});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 2, 1, 3});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 0, 2, 2});
+  AddInputFromArray<float>(TensorShape({4}), {1, 2, 0.5, 2});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>(
+          {1.f / 3, 1.f / 3, 2.f / 3, 2.f / 3, 0.4, 0.8, 1.6, 3.2},
+          TensorShape({4, 2})),
+      1e-5);
+  test::ExpectTensorEqual<int32>(*GetOutput(1),
+                                 test::AsTensor<int32>({0, 2, 1, 3}));
+}
+
+TEST_F(OpsTestBase, QuantizeEmbeddingRows) {
+  TF_ASSERT_OK(NodeDefBuilder("quantize", "QuantizeEmbeddingRows")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<float>(TensorShape({3, 2}), {0.5, -1, 0, 0, 254, 127});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<int8>(
+      *GetOutput(0),
+      test::AsTensor<int8>({64, -127, 0, 0, 127, 64}, TensorShape({3, 2})));
+  test::ExpectTensorNear<float>(*GetOutput(1),
+                                test::AsTensor<float>({1.f / 127, 0, 2}),
+                                1e-6);
+}
+
+TEST_F(OpsTestBase, QuantizeEmbeddingRowsRejectsNonFiniteRows) {
+  TF_ASSERT_OK(NodeDefBuilder("quantize", "QuantizeEmbeddingRows")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<float>(
+      TensorShape({3, 2}),
+      {1, 2, std::numeric_limits<float>::quiet_NaN(), 0, 0,
+       std::numeric_limits<float>::infinity()});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "params row 1")) << s;
+}
+
+class FusedSparseEmbeddingLookupDequantizeOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(DataType params_type, float max_norm) {
+    TF_ASSERT_OK(
+        NodeDefBuilder("lookup", "FusedSparseEmbeddingLookupDequantize")
+            .Input(FakeInput(params_type))
+            .Input(FakeInput(DT_FLOAT))
+            .Input(FakeInput(DT_INT32))
+            .Input(FakeInput(DT_INT32))
+            .Input(FakeInput(DT_FLOAT))
+            .Input(FakeInput(DT_INT32))
+            .Attr("combiner", "sum")
+            .Attr("max_norm", max_norm)
+            .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // The same lookup as FusedSparseEmbeddingLookupOpTest.WeightedSum.
+  void AddLookupInputs() {
+    AddInputFromArray<int32>(TensorShape({4}), {0, 2, 1, 3});
+    AddInputFromArray<int32>(TensorShape({4}), {0, 0, 2, 2});
+    AddInputFromArray<float>(TensorShape({4}), {1, 2, 0.5, 2});
+    AddInputFromArray<int32>(TensorShape({}), {4});
+  }
+};
+
+TEST_F(FusedSparseEmbeddingLookupDequantizeOpTest, Int8WithScales) {
+  MakeOp(DT_INT8, 0);
+  // Dequantizes to {1, 0, 0, 2, 3, 4, 1, 1}.
+  AddInputFromArray<int8>(TensorShape({4, 2}), {2, 0, 0, 4, 3, 4, 4, 4});
+  AddInputFromArray<float>(TensorShape({4}), {0.5, 0.5, 1, 0.25});
+  AddLookupInputs();
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({7, 8, 0, 0, 2, 3, 0, 0}, TensorShape({4, 2})),
+      1e-5);
+}
+
+TEST_F(FusedSparseEmbeddingLookupDequantizeOpTest, Int8MaxNorm) {
+  MakeOp(DT_INT8, 1);
+  AddInputFromArray<int8>(TensorShape({4, 2}), {2, 0, 0, 4, 3, 4, 4, 4});
+  AddInputFromArray<float>(TensorShape({4}), {0.5, 0.5, 1, 0.25});
+  AddLookupInputs();
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({2.2, 1.6, 0, 0, 1.414214, 1.914214, 0, 0},
+                            TensorShape({4, 2})),
+      1e-5);
+}
+
+TEST_F(FusedSparseEmbeddingLookupDequantizeOpTest, BFloat16WithoutScales) {
+  MakeOp(DT_BFLOAT16, 0);
+  AddInputFromList<bfloat16>(TensorShape({4, 2}), {1, 0, 0, 2, 3, 4, 1, 1});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddLookupInputs();
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({7, 8, 0, 0, 2, 3, 0, 0}, TensorShape({4, 2})),
+      1e-5);
+}
+
+TEST_F(FusedSparseEmbeddingLookupDequantizeOpTest, Int8RequiresScales) {
+  MakeOp(DT_INT8, 0);
+  AddInputFromArray<int8>(TensorShape({4, 2}), {2, 0, 0, 4, 3, 4, 4, 4});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddLookupInputs();
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "scales must be a vector")) << s;
+}
+
+// Compares the fused kernel (`variant` == 1) against GatherV2 followed by
+// SparseSegmentMeanWithNumSegments (`variant` == 0) on a 100k x 64 table, and
+// against the fused lookup on the same table quantized to int8
+// (`variant` == 2).
+void BM_SparseEmbeddingLookup(::testing::benchmark::State& state) {
+  const int variant = state.range(0);
+  const int num_indices = state.range(1);
+  constexpr int kVocabSize = 100000;
+  constexpr int kDim = 64;
+  constexpr int kIdsPerSegment = 20;
+  const int num_segments = num_indices / kIdsPerSegment;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor params(DT_FLOAT, TensorShape({kVocabSize, kDim}));
+  params.flat<float>().setRandom();
+  Tensor indices(DT_INT32, TensorShape({num_indices}));
+  Tensor segment_ids(DT_INT32, TensorShape({num_indices}));
+  for (int i = 0; i < num_indices; ++i) {
+    indices.vec<int32>()(i) = (i * 7919) % kVocabSize;
+    segment_ids.vec<int32>()(i) = i / kIdsPerSegment;
+  }
+  Tensor num_segments_t(DT_INT32, TensorShape({}));
+  num_segments_t.scalar<int32>()() = num_segments;
+
+  Node* params_node = test::graph::Constant(g, params);
+  Node* indices_node = test::graph::Constant(g, indices);
+  Node* segment_ids_node = test::graph::Constant(g, segment_ids);
+  Node* num_segments_node = test::graph::Constant(g, num_segments_t);
+  Node* node;
+  if (variant == 2) {
+    // The table is quantized up front, as it would be stored.
+    Tensor quantized(DT_INT8, TensorShape({kVocabSize, kDim}));
+    quantized.flat<int8>().setRandom();
+    Tensor scales(DT_FLOAT, TensorShape({kVocabSize}));
+    scales.flat<float>().setConstant(1.0f / 127);
+    TF_CHECK_OK(
+        NodeBuilder(g->NewName("n"), "FusedSparseEmbeddingLookupDequantize")
+            .Input(test::graph::Constant(g, quantized))
+            .Input(test::graph::Constant(g, scales))
+            .Input(indices_node)
+            .Input(segment_ids_node)
+            .Input(test::graph::Constant(g, Tensor(DT_FLOAT, TensorShape({0}))))
+            .Input(num_segments_node)
+            .Attr("combiner", "mean")
+            .Finalize(g, &node));
+  } else if (variant == 1) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "FusedSparseEmbeddingLookup")
+                    .Input(params_node)
+                    .Input(indices_node)
+                    .Input(segment_ids_node)
+                    .Input(test::graph::Constant(
+                        g, Tensor(DT_FLOAT, TensorShape({0}))))
+                    .Input(num_segments_node)
+                    .Attr("combiner", "mean")
+                    .Finalize(g, &node));
+  } else {
+    Tensor axis(DT_INT32, TensorShape({}));
+    axis.scalar<int32>()() = 0;
+    Node* gathered;
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "GatherV2")
+                    .Input(params_node)
+                    .Input(indices_node)
+                    .Input(test::graph::Constant(g, axis))
+                    .Finalize(g, &gathered));
+    Tensor range(DT_INT32, TensorShape({num_indices}));
+    for (int i = 0; i < num_indices; ++i) range.vec<int32>()(i) = i;
+    TF_CHECK_OK(
+        NodeBuilder(g->NewName("n"), "SparseSegmentMeanWithNumSegments")
+            .Input(gathered)
+            .Input(test::graph::Constant(g, range))
+            .Input(segment_ids_node)
+            .Input(num_segments_node)
+            .Finalize(g, &node));
+  }
+
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_indices * kDim * sizeof(float));
+}
+
+BENCHMARK(BM_SparseEmbeddingLookup)
+    ->UseRealTime()
+    ->ArgPair(0, 10000)
+    ->ArgPair(1, 10000)
+    ->ArgPair(2, 10000)
+    ->ArgPair(0, 200000)
+    ->ArgPair(1, 200000)
+    ->ArgPair(2, 200000);
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,16 +15,27 @@ limitations under the License.
 
 // Tests kernels of lookup ops.
 
+#include <limits>
+#include <vector>
+
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
 namespace {
@@ -100,5 +111,471 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+TEST_F(LookupOpsTest, ShardedMutableHashTable) {
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableHashTable")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_FLOAT)
+                   .Attr("num_shards", 8)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  auto table_or = handle.GetResource<lookup::LookupInterface>();
+  TF_ASSERT_OK(table_or.status());
+  lookup::LookupInterface* table = table_or.value();
+
+  // Duplicate keys within one batch keep the last value, as with one shard.
+  Tensor keys = test::AsTensor<int64_t>({0, 1, 2, 3, 100, 1000, 3});
+  Tensor values = test::AsTensor<float>({0, 1, 2, 3, 100, 1000, 30});
+  TF_ASSERT_OK(table->Insert(context_.get(), keys, values));
+  EXPECT_EQ(table->size(), 6);
+
+  Tensor lookup_keys = test::AsTensor<int64_t>({3, 7, 1000, 0});
+  Tensor default_value = test::AsTensor<float>({-1});
+  Tensor found(DT_FLOAT, TensorShape({4}));
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &found, default_value));
+  test::ExpectTensorEqual<float>(found,
+                                 test::AsTensor<float>({30, -1, 1000, 0}));
+
+  TF_ASSERT_OK(table->Remove(context_.get(), test::AsTensor<int64_t>({1000})));
+  EXPECT_EQ(table->size(), 5);
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &found, default_value));
+  test::ExpectTensorEqual<float>(found, test::AsTensor<float>({30, -1, -1, 0}));
+}
+
+TEST_F(LookupOpsTest, MutableHashTableOfTensorsMinFrequency) {
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableHashTableOfTensors")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_FLOAT)
+                   .Attr("value_shape", TensorShape({1}))
+                   .Attr("min_frequency", 3)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  auto table_or = handle.GetResource<lookup::LookupInterface>();
+  TF_ASSERT_OK(table_or.status());
+  lookup::LookupInterface* table = table_or.value();
+
+  Tensor lookup_keys = test::AsTensor<int64_t>({1, 2});
+  Tensor default_value = test::AsTensor<float>({-1}, TensorShape({1}));
+  Tensor found(DT_FLOAT, TensorShape({2, 1}));
+  // Key 1 is inserted three times and admitted on the third insert, which
+  // sets its value. Key 2 is only seen twice and stays invisible.
+  for (float value : {10, 20}) {
+    TF_ASSERT_OK(table->Insert(
+        context_.get(), test::AsTensor<int64_t>({1, 2}),
+        test::AsTensor<float>({value, value}, TensorShape({2, 1}))));
+    EXPECT_EQ(table->size(), 0);
+  }
+  TF_ASSERT_OK(table->Insert(context_.get(), test::AsTensor<int64_t>({1}),
+                             test::AsTensor<float>({30}, TensorShape({1, 1}))));
+  EXPECT_EQ(table->size(), 1);
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &found, default_value));
+  test::ExpectTensorEqual<float>(
+      found, test::AsTensor<float>({30, -1}, TensorShape({2, 1})));
+
+  TF_ASSERT_OK(table->Remove(context_.get(), lookup_keys));
+  EXPECT_EQ(table->size(), 0);
+}
+
+TEST_F(LookupOpsTest, MutableHashTableOfTensorsEviction) {
+  constexpr int kMaxSize = 100;
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableHashTableOfTensors")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_FLOAT)
+                   .Attr("value_shape", TensorShape({1}))
+                   .Attr("max_size", kMaxSize)
+                   .Attr("eviction_policy", "lfu")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  auto table_or = handle.GetResource<lookup::LookupInterface>();
+  TF_ASSERT_OK(table_or.status());
+  lookup::LookupInterface* table = table_or.value();
+
+  // Keys 0..9 are looked up repeatedly, so the least-frequently-used policy
+  // must keep them while the one-off keys get evicted.
+  Tensor hot_keys(DT_INT64, TensorShape({10}));
+  for (int i = 0; i < 10; ++i) hot_keys.vec<int64_t>()(i) = i;
+  Tensor default_value = test::AsTensor<float>({-1}, TensorShape({1}));
+  Tensor found(DT_FLOAT, TensorShape({10, 1}));
+  for (int start = 0; start < 10 * kMaxSize; start += 10) {
+    Tensor keys(DT_INT64, TensorShape({10}));
+    Tensor values(DT_FLOAT, TensorShape({10, 1}));
+    for (int i = 0; i < 10; ++i) {
+      keys.vec<int64_t>()(i) = start + i;
+      values.matrix<float>()(i, 0) = start + i;
+    }
+    TF_ASSERT_OK(table->Insert(context_.get(), keys, values));
+    TF_ASSERT_OK(table->Find(context_.get(), hot_keys, &found, default_value));
+  }
+
+  // Eviction runs in the background; wait for the last pass to catch up.
+  for (int i = 0; i < 1000 && table->size() > kMaxSize; ++i) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  EXPECT_LE(table->size(), kMaxSize);
+  TF_ASSERT_OK(table->Find(context_.get(), hot_keys, &found, default_value));
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(found.matrix<float>()(i, 0), i);
+  }
+}
+
+TEST_F(LookupOpsTest, MutableHashTableOfTensorsSpill) {
+  constexpr int kMaxSize = 100;
+  constexpr int kNumKeys = 1000;
+  const string spill_dir =
+      io::JoinPath(testing::TmpDir(),
+                   strings::StrCat("spill_", Env::Default()->NowMicros()));
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableHashTableOfTensors")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_FLOAT)
+                   .Attr("value_shape", TensorShape({1}))
+                   .Attr("max_size", kMaxSize)
+                   .Attr("spill_dir", spill_dir)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  auto table_or = handle.GetResource<lookup::LookupInterface>();
+  TF_ASSERT_OK(table_or.status());
+  lookup::LookupInterface* table = table_or.value();
+
+  for (int start = 0; start < kNumKeys; start += 10) {
+    Tensor keys(DT_INT64, TensorShape({10}));
+    Tensor values(DT_FLOAT, TensorShape({10, 1}));
+    for (int i = 0; i < 10; ++i) {
+      keys.vec<int64_t>()(i) = start + i;
+      values.matrix<float>()(i, 0) = start + i;
+    }
+    TF_ASSERT_OK(table->Insert(context_.get(), keys, values));
+  }
+
+  // Wait for the background eviction to write rows to the spill file.
+  std::vector<string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(spill_dir, &children));
+  ASSERT_EQ(children.size(), 1);
+  const string spill_file = io::JoinPath(spill_dir, children[0]);
+  uint64 spill_file_size = 0;
+  for (int i = 0; i < 1000 && spill_file_size == 0; ++i) {
+    Env::Default()->SleepForMicroseconds(1000);
+    TF_ASSERT_OK(Env::Default()->GetFileSize(spill_file, &spill_file_size));
+  }
+  EXPECT_GT(spill_file_size, 0);
+
+  // Every key is still found, whether it is in memory or on disk.
+  Tensor all_keys(DT_INT64, TensorShape({kNumKeys}));
+  for (int i = 0; i < kNumKeys; ++i) all_keys.vec<int64_t>()(i) = i;
+  Tensor default_value = test::AsTensor<float>({-1}, TensorShape({1}));
+  Tensor found(DT_FLOAT, TensorShape({kNumKeys, 1}));
+  TF_ASSERT_OK(table->Find(context_.get(), all_keys, &found, default_value));
+  for (int i = 0; i < kNumKeys; ++i) {
+    EXPECT_EQ(found.matrix<float>()(i, 0), i);
+  }
+  for (int i = 0; i < 1000 && table->size() != kNumKeys; ++i) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  EXPECT_EQ(table->size(), kNumKeys);
+
+  // Removed keys are gone from both tiers, and prefetching does not change
+  // the result of a lookup.
+  Tensor removed_keys = test::AsTensor<int64_t>({0, 1, 2});
+  TF_ASSERT_OK(table->Remove(context_.get(), removed_keys));
+  TF_ASSERT_OK(table->Prefetch(context_.get(), all_keys));
+  TF_ASSERT_OK(table->Find(context_.get(), all_keys, &found, default_value));
+  for (int i = 0; i < kNumKeys; ++i) {
+    EXPECT_EQ(found.matrix<float>()(i, 0), i < 3 ? -1 : i);
+  }
+  for (int i = 0; i < 1000 && table->size() != kNumKeys - 3; ++i) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  EXPECT_EQ(table->size(), kNumKeys - 3);
+}
+
+TEST_F(LookupOpsTest, MutableHashTableOfTensorsSpillRequiresMaxSize) {
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableHashTableOfTensors")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_FLOAT)
+                   .Attr("value_shape", TensorShape({1}))
+                   .Attr("spill_dir", testing::TmpDir())
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST_F(LookupOpsTest, SwissLayoutDenseHashTable) {
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableDenseHashTable")
+                   .Input(FakeInput(DT_INT64))
+                   .Input(FakeInput(DT_INT64))
+                   .Attr("value_dtype", DT_INT64)
+                   .Attr("initial_num_buckets", 4)
+                   .Attr("layout", "swiss")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<int64_t>(TensorShape({}), {-1});
+  AddInputFromArray<int64_t>(TensorShape({}), {-2});
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  auto table_or = handle.GetResource<lookup::LookupInterface>();
+  TF_ASSERT_OK(table_or.status());
+  lookup::LookupInterface* table = table_or.value();
+
+  // Insert in small batches so that the table grows several times and every
+  // lookup below runs while an incremental rehash may be in progress.
+  constexpr int kNumKeys = 5000;
+  constexpr int kBatchSize = 50;
+  Tensor default_value = test::AsScalar<int64_t>(-1);
+  for (int start = 0; start < kNumKeys; start += kBatchSize) {
+    Tensor keys(DT_INT64, TensorShape({kBatchSize}));
+    Tensor values(DT_INT64, TensorShape({kBatchSize}));
+    for (int i = 0; i < kBatchSize; ++i) {
+      keys.vec<int64_t>()(i) = (start + i) * 64;
+      values.vec<int64_t>()(i) = start + i;
+    }
+    TF_ASSERT_OK(table->Insert(context_.get(), keys, values));
+    ASSERT_EQ(table->size(), start + kBatchSize);
+
+    Tensor found(DT_INT64, TensorShape({start + kBatchSize}));
+    Tensor all_keys(DT_INT64, TensorShape({start + kBatchSize}));
+    for (int i = 0; i < start + kBatchSize; ++i) {
+      all_keys.vec<int64_t>()(i) = i * 64;
+    }
+    TF_ASSERT_OK(table->Find(context_.get(), all_keys, &found, default_value));
+    for (int i = 0; i < start + kBatchSize; ++i) {
+      ASSERT_EQ(found.vec<int64_t>()(i), i);
+    }
+  }
+
+  // Updates, removals and misses.
+  TF_ASSERT_OK(table->Insert(context_.get(), test::AsTensor<int64_t>({0}),
+                             test::AsTensor<int64_t>({42})));
+  TF_ASSERT_OK(table->Remove(context_.get(), test::AsTensor<int64_t>({64})));
+  EXPECT_EQ(table->size(), kNumKeys - 1);
+  Tensor found(DT_INT64, TensorShape({3}));
+  TF_ASSERT_OK(table->Find(context_.get(), test::AsTensor<int64_t>({0, 64, 65}),
+                           &found, default_value));
+  test::ExpectTensorEqual<int64_t>(found,
+                                   test::AsTensor<int64_t>({42, -1, -1}));
+}
+
+// Checkpoints of both layouts share one format, so a table exported with the
+// "swiss" layout must restore into a "quadratic" one, whose probe sequences
+// start at different buckets.
+TEST_F(LookupOpsTest, SwissLayoutDenseHashTableRestoresIntoQuadratic) {
+  Graph g(OpRegistry::Global());
+  auto make_table = [&g](const string& layout) {
+    Node* table;
+    TF_CHECK_OK(
+        NodeBuilder(g.NewName("table"), "MutableDenseHashTableV2")
+            .Input(test::graph::Constant(&g, test::AsScalar<int64_t>(-1)))
+            .Input(test::graph::Constant(&g, test::AsScalar<int64_t>(-2)))
+            .Attr("value_dtype", DT_INT64)
+            .Attr("initial_num_buckets", 4)
+            .Attr("layout", layout)
+            .Finalize(&g, &table));
+    return table;
+  };
+  Node* swiss = make_table("swiss");
+  Node* quadratic = make_table("quadratic");
+  Node* keys;
+  TF_ASSERT_OK(NodeBuilder("keys", "Placeholder")
+                   .Attr("dtype", DT_INT64)
+                   .Finalize(&g, &keys));
+  Node* values;
+  TF_ASSERT_OK(NodeBuilder("values", "Placeholder")
+                   .Attr("dtype", DT_INT64)
+                   .Finalize(&g, &values));
+  Node* insert;
+  TF_ASSERT_OK(NodeBuilder("insert", "LookupTableInsertV2")
+                   .Input(swiss)
+                   .Input(keys)
+                   .Input(values)
+                   .Finalize(&g, &insert));
+  Node* exported;
+  TF_ASSERT_OK(NodeBuilder("export", "LookupTableExportV2")
+                   .Input(swiss)
+                   .Attr("Tkeys", DT_INT64)
+                   .Attr("Tvalues", DT_INT64)
+                   .Finalize(&g, &exported));
+  Node* import;
+  TF_ASSERT_OK(NodeBuilder("import", "LookupTableImportV2")
+                   .Input(quadratic)
+                   .Input(exported, 0)
+                   .Input(exported, 1)
+                   .Finalize(&g, &import));
+  Node* find;
+  TF_ASSERT_OK(
+      NodeBuilder("find", "LookupTableFindV2")
+          .Input(quadratic)
+          .Input(keys)
+          .Input(test::graph::Constant(&g, test::AsScalar<int64_t>(-1)))
+          .Finalize(&g, &find));
+  Node* size;
+  TF_ASSERT_OK(NodeBuilder("size", "LookupTableSizeV2")
+                   .Input(quadratic)
+                   .Finalize(&g, &size));
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  std::unique_ptr<Session> sess(NewSession(SessionOptions()));
+  TF_ASSERT_OK(sess->Create(gd));
+
+  // Insert in batches. With the default max_load_factor of 0.8 the last batch
+  // grows the swiss table from 2048 to 4096 buckets, so the export below
+  // happens while an incremental rehash is in progress.
+  constexpr int kNumKeys = 1700;
+  constexpr int kBatchSize = 100;
+  Tensor all_keys(DT_INT64, TensorShape({kNumKeys}));
+  for (int start = 0; start < kNumKeys; start += kBatchSize) {
+    Tensor batch_keys(DT_INT64, TensorShape({kBatchSize}));
+    Tensor batch_values(DT_INT64, TensorShape({kBatchSize}));
+    for (int i = 0; i < kBatchSize; ++i) {
+      batch_keys.vec<int64_t>()(i) = (start + i) * 64;
+      batch_values.vec<int64_t>()(i) = start + i;
+      all_keys.vec<int64_t>()(start + i) = (start + i) * 64;
+    }
+    TF_ASSERT_OK(sess->Run({{"keys", batch_keys}, {"values", batch_values}},
+                           {}, {"insert"}, nullptr));
+  }
+  TF_ASSERT_OK(sess->Run({}, {}, {"import"}, nullptr));
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(sess->Run({{"keys", all_keys}}, {"find", "size"}, {}, &outputs));
+  EXPECT_EQ(outputs[1].scalar<int64_t>()(), kNumKeys);
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(outputs[0].vec<int64_t>()(i), i);
+  }
+}
+
+// Runs `num_workers` concurrent LookupTableFindV2/LookupTableInsertV2 pairs
+// against a single MutableHashTableV2 split into `num_shards` shards, on a
+// session with one inter-op thread per worker.
+void BM_MutableHashTableFindInsert(::testing::benchmark::State& state) {
+  const int num_shards = state.range(0);
+  const int num_workers = state.range(1);
+  constexpr int kBatchSize = 4096;
+  constexpr int kNumIds = 1 << 20;
+
+  Graph g(OpRegistry::Global());
+  Node* table;
+  TF_CHECK_OK(NodeBuilder(g.NewName("table"), "MutableHashTableV2")
+                  .Attr("key_dtype", DT_INT64)
+                  .Attr("value_dtype", DT_FLOAT)
+                  .Attr("num_shards", num_shards)
+                  .Finalize(&g, &table));
+  Node* default_value = test::graph::Constant(&g, test::AsScalar<float>(-1));
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<string> targets;
+  for (int w = 0; w < num_workers; ++w) {
+    Tensor keys(DT_INT64, TensorShape({kBatchSize}));
+    Tensor values(DT_FLOAT, TensorShape({kBatchSize}));
+    for (int i = 0; i < kBatchSize; ++i) {
+      keys.flat<int64_t>()(i) = rnd.Uniform64(kNumIds);
+      values.flat<float>()(i) = i;
+    }
+    Node* keys_node = test::graph::Constant(&g, keys);
+    Node* find;
+    TF_CHECK_OK(NodeBuilder(g.NewName("find"), "LookupTableFindV2")
+                    .Input(table)
+                    .Input(keys_node)
+                    .Input(default_value)
+                    .Finalize(&g, &find));
+    Node* insert;
+    TF_CHECK_OK(NodeBuilder(g.NewName("insert"), "LookupTableInsertV2")
+                    .Input(table)
+                    .Input(keys_node)
+                    .Input(test::graph::Constant(&g, values))
+                    .Finalize(&g, &insert));
+    targets.push_back(find->name());
+    targets.push_back(insert->name());
+  }
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  SessionOptions opts;
+  opts.config.set_inter_op_parallelism_threads(num_workers);
+  std::unique_ptr<Session> sess(NewSession(opts));
+  TF_CHECK_OK(sess->Create(gd));
+  TF_CHECK_OK(sess->Run({}, {}, targets, nullptr));
+  for (auto s : state) {
+    TF_CHECK_OK(sess->Run({}, {}, targets, nullptr));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 2 *
+                          num_workers * kBatchSize);
+}
+
+BENCHMARK(BM_MutableHashTableFindInsert)
+    ->UseRealTime()
+    ->ArgPair(1, 1)
+    ->ArgPair(1, 2)
+    ->ArgPair(1, 4)
+    ->ArgPair(1, 8)
+    ->ArgPair(1, 16)
+    ->ArgPair(64, 1)
+    ->ArgPair(64, 2)
+    ->ArgPair(64, 4)
+    ->ArgPair(64, 8)
+    ->ArgPair(64, 16);
+
+// Inserts a batch of fresh random keys into a MutableDenseHashTableV2 and
+// looks up another batch on every iteration, so that the table keeps growing
+// from a small initial size. Compares the "quadratic" layout, which rehashes
+// everything at once when growing, with the incrementally rehashed "swiss"
+// layout.
+void BM_MutableDenseHashTableGrowth(::testing::benchmark::State& state) {
+  const bool swiss = state.range(0);
+  constexpr int kBatchSize = 1024;
+
+  Graph g(OpRegistry::Global());
+  Node* table;
+  TF_CHECK_OK(NodeBuilder(g.NewName("table"), "MutableDenseHashTableV2")
+                  .Input(test::graph::Constant(&g, test::AsScalar<int64_t>(-1)))
+                  .Input(test::graph::Constant(&g, test::AsScalar<int64_t>(-2)))
+                  .Attr("value_dtype", DT_INT64)
+                  .Attr("initial_num_buckets", 1024)
+                  .Attr("layout", swiss ? "swiss" : "quadratic")
+                  .Finalize(&g, &table));
+  Node* shape = test::graph::Constant(&g, test::AsTensor<int32>({kBatchSize}));
+  Node* minval = test::graph::Constant(&g, test::AsScalar<int64_t>(0));
+  Node* maxval = test::graph::Constant(
+      &g, test::AsScalar<int64_t>(std::numeric_limits<int64_t>::max()));
+  auto random_keys = [&]() {
+    Node* keys;
+    TF_CHECK_OK(NodeBuilder(g.NewName("keys"), "RandomUniformInt")
+                    .Input(shape)
+                    .Input(minval)
+                    .Input(maxval)
+                    .Finalize(&g, &keys));
+    return keys;
+  };
+  Node* insert_keys = random_keys();
+  Node* insert;
+  TF_CHECK_OK(NodeBuilder(g.NewName("insert"), "LookupTableInsertV2")
+                  .Input(table)
+                  .Input(insert_keys)
+                  .Input(insert_keys)
+                  .Finalize(&g, &insert));
+  Node* find;
+  TF_CHECK_OK(NodeBuilder(g.NewName("find"), "LookupTableFindV2")
+                  .Input(table)
+                  .Input(random_keys())
+                  .Input(test::graph::Constant(&g, test::AsScalar<int64_t>(0)))
+                  .Finalize(&g, &find));
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  std::unique_ptr<Session> sess(NewSession(SessionOptions()));
+  TF_CHECK_OK(sess->Create(gd));
+  for (auto s : state) {
+    TF_CHECK_OK(sess->Run({}, {}, {insert->name(), find->name()}, nullptr));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 2 *
+                          kBatchSize);
+}
+
+BENCHMARK(BM_MutableDenseHashTableGrowth)->UseRealTime()->Arg(0)->Arg(1);
+
 }  // namespace
 }  // namespace tensorflow
@@ -16,16 +16,31 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "absl/numeric/bits.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/random.h"
 
 namespace tensorflow {
@@ -36,11 +51,555 @@ std::string UniqueNodeName(const std::string& base) {
   return strings::StrCat(base, "/", counter.fetch_add(1), "/", random::New64());
 }
 
+namespace {
+
+template <typename T>
+inline uint64 HashScalar(const T& key) {
+  return static_cast<uint64>(key);
+}
+
+inline uint64 HashScalar(const tstring& key) { return Hash64(key); }
+
+// Integer keys hash to themselves, so tables that derive bucket or shard
+// indices from a few hash bits first scramble them with a multiplicative
+// (Fibonacci) hash. The high bits of the result are the best mixed.
+inline uint64 ScrambleHash(uint64 hash) { return hash * 0x9E3779B97F4A7C15ull; }
+
+// If the given shape is a scalar return {1} instead. Otherwise leave it alone.
+TensorShape MaybeVectorizeShape(const TensorShape& shape) {
+  if (shape.dims() == 0) {
+    return TensorShape({1});
+  }
+  return shape;
+}
+
+// Returns the value of the "num_shards" attr of a mutable hash table op, or 1
+// for the op versions that do not have the attr.
+int64_t GetNumShards(OpKernel* kernel) {
+  int64_t num_shards = 1;
+  TryGetNodeAttr(kernel->def(), "num_shards", &num_shards);
+  return num_shards;
+}
+
+// An unordered_map split into independently locked shards. Each key is owned
+// by exactly one shard, chosen from a scrambled hash of the key, so lookups
+// and inserts that land on different shards do not contend on a lock. With a
+// single shard this is equivalent to one mutex-guarded unordered_map.
+template <class K, class V>
+class ShardedHashMap {
+ public:
+  typedef std::unordered_map<K, V> Map;
+
+  explicit ShardedHashMap(int64_t num_shards) : shards_(num_shards) {}
+
+  int64_t num_shards() const { return shards_.size(); }
+
+  // Returns the index of the shard that owns `key`.
+  int64_t ShardOf(const K& key) const {
+    return (ScrambleHash(HashScalar(key)) >> 32) % shards_.size();
+  }
+
+  size_t size() const {
+    size_t ret = 0;
+    for (const Shard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      ret += shard.map.size();
+    }
+    return ret;
+  }
+
+  // Calls `fn(map, i)` for every index `i` of `keys`, where `map` is the map
+  // of the shard owning `keys(i)` and is read-locked for the duration of the
+  // call. Each shard lock is acquired at most once, and the indices owned by
+  // one shard are visited in increasing order.
+  template <typename KeyFlat, typename Fn>
+  void ForEachKeyShared(const KeyFlat& keys, Fn fn) const {
+    std::vector<int64_t> starts;
+    std::vector<int64_t> order;
+    Partition(keys, &starts, &order);
+    for (int64_t s = 0; s < num_shards(); ++s) {
+      if (starts[s] == starts[s + 1]) continue;
+      const Shard& shard = shards_[s];
+      tf_shared_lock l(shard.mu);
+      for (int64_t j = starts[s]; j < starts[s + 1]; ++j) {
+        fn(shard.map, order.empty() ? j : order[j]);
+      }
+    }
+  }
+
+  // Same as ForEachKeyShared(), except that `fn(map*, i)` receives a mutable
+  // pointer to the map of a write-locked shard.
+  template <typename KeyFlat, typename Fn>
+  void ForEachKeyExclusive(const KeyFlat& keys, Fn fn) {
+    std::vector<int64_t> starts;
+    std::vector<int64_t> order;
+    Partition(keys, &starts, &order);
+    for (int64_t s = 0; s < num_shards(); ++s) {
+      if (starts[s] == starts[s + 1]) continue;
+      Shard& shard = shards_[s];
+      mutex_lock l(shard.mu);
+      for (int64_t j = starts[s]; j < starts[s + 1]; ++j) {
+        fn(&shard.map, order.empty() ? j : order[j]);
+      }
+    }
+  }
+
+  // Calls `fn(map*)` for the map of shard `s`, holding its lock exclusively.
+  template <typename Fn>
+  void WithShardExclusive(int64_t s, Fn fn) {
+    Shard& shard = shards_[s];
+    mutex_lock l(shard.mu);
+    fn(&shard.map);
+  }
+
+  // Acquires the locks of all shards, in shard order. Used by the operations
+  // that need a consistent view of the whole table, such as import and export.
+  std::vector<mutex_lock> LockAll() TF_NO_THREAD_SAFETY_ANALYSIS {
+    std::vector<mutex_lock> locks;
+    locks.reserve(shards_.size());
+    for (Shard& shard : shards_) {
+      locks.emplace_back(shard.mu);
+    }
+    return locks;
+  }
+
+  std::vector<tf_shared_lock> LockAllShared() const
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    std::vector<tf_shared_lock> locks;
+    locks.reserve(shards_.size());
+    for (const Shard& shard : shards_) {
+      locks.emplace_back(shard.mu);
+    }
+    return locks;
+  }
+
+  // Accessors for the shard maps. The caller must hold the locks returned by
+  // LockAll() (for the mutable version) or LockAllShared().
+  Map* shard_map(int64_t s) TF_NO_THREAD_SAFETY_ANALYSIS {
+    return &shards_[s].map;
+  }
+  const Map& shard_map(int64_t s) const TF_NO_THREAD_SAFETY_ANALYSIS {
+    return shards_[s].map;
+  }
+
+ private:
+  struct Shard {
+    mutable mutex mu;
+    Map map TF_GUARDED_BY(mu);
+  };
+
+  // Groups the indices of `keys` by owning shard: the indices owned by shard
+  // `s` are `(*order)[(*starts)[s]]` to `(*order)[(*starts)[s + 1] - 1]`. With
+  // a single shard `order` is left empty, meaning the identity permutation.
+  template <typename KeyFlat>
+  void Partition(const KeyFlat& keys, std::vector<int64_t>* starts,
+                 std::vector<int64_t>* order) const {
+    const int64_t num_keys = keys.size();
+    if (shards_.size() == 1) {
+      *starts = {0, num_keys};
+      return;
+    }
+    std::vector<int64_t> shard_of(num_keys);
+    starts->assign(shards_.size() + 1, 0);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      shard_of[i] = ShardOf(SubtleMustCopyIfIntegral(keys(i)));
+      ++(*starts)[shard_of[i] + 1];
+    }
+    for (size_t s = 1; s < starts->size(); ++s) {
+      (*starts)[s] += (*starts)[s - 1];
+    }
+    std::vector<int64_t> next(starts->begin(), starts->end() - 1);
+    order->resize(num_keys);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      (*order)[next[shard_of[i]]++] = i;
+    }
+  }
+
+  std::vector<Shard> shards_;
+};
+
+// Gives a vector the indexing interface of a flat tensor, so that its
+// elements can be passed as keys to ShardedHashMap.
+template <class K>
+class VectorKeys {
+ public:
+  explicit VectorKeys(const std::vector<K>& keys) : keys_(keys) {}
+  int64_t size() const { return keys_.size(); }
+  const K& operator()(int64_t i) const { return keys_[i]; }
+
+ private:
+  const std::vector<K>& keys_;
+};
+
+// Approximates the memory held by the buckets of `map`.
+template <class Map>
+int64_t BucketMemoryUsed(const Map& map) {
+  int64_t ret = 0;
+  for (unsigned i = 0; i < map.bucket_count(); ++i) {
+    size_t bucket_size = map.bucket_size(i);
+    if (bucket_size == 0) {
+      ret++;
+    } else {
+      ret += bucket_size;
+    }
+  }
+  return ret;
+}
+
+// A disk-backed store for the fixed-size rows that one shard of a
+// MutableHashTableOfTensors evicts when it spills to local disk. Rows are
+// appended as records of a TFRecord file, and an in-memory index maps each
+// key to the offset of its record and to the access metadata its entry had
+// when it was evicted, so taking a row back costs one positioned read and the
+// entry keeps its rank for the next eviction. Dropping a row only removes it
+// from the index; Compact() copies the live records to a fresh file once the
+// dead records outnumber them. A file is deleted once no index entry or read
+// refers to it.
+//
+// No call does file I/O while the caller holds its shard lock:
+// * Evicted rows are appended by Write() and only become visible through
+//   Commit(), which the caller runs under its lock.
+// * Taking a row back starts with Claim(), which moves the index entry to an
+//   in-flight set. The caller then drops its lock, calls Read(), and ends with
+//   Release() under its lock again. Release() reports whether the row was
+//   removed in between. In-flight rows count towards size() and are visited
+//   by ForEach(), and a concurrent Claim() of the same key waits for them.
+//
+// All methods are thread safe. After an I/O error the store keeps failing
+// with that error.
+template <class K>
+class SpillStore {
+ public:
+  // A file of spilled records. The writer is only used by the store while the
+  // file is current, and the reader is safe to use concurrently.
+  struct File {
+    ~File() {
+      writer.reset();
+      file.reset();
+      read_file.reset();
+      env->DeleteFile(path).IgnoreError();
+    }
+
+    Env* env;
+    std::string path;
+    std::unique_ptr<WritableFile> file;
+    std::unique_ptr<io::RecordWriter> writer;
+    std::unique_ptr<RandomAccessFile> read_file;
+    // Guarded by the mutex of the store.
+    uint64 end_offset = 0;
+    bool needs_flush = false;
+  };
+
+  // Where a row is stored, and the access metadata of its entry.
+  struct Location {
+    std::shared_ptr<File> file;
+    uint64 offset = 0;
+    int64_t frequency = 0;
+    int64_t last_access = 0;
+  };
+
+  enum class ClaimResult {
+    kAbsent,    // The key is not stored.
+    kClaimed,   // The row is now in flight for the caller.
+    kInFlight,  // Another caller is taking the row back; wait for it.
+  };
+
+  // Creates a store for rows of `row_bytes` bytes in a new file under `dir`,
+  // which is created if needed.
+  static Status Create(Env* env, const std::string& dir, size_t row_bytes,
+                       std::unique_ptr<SpillStore>* store) {
+    TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(dir));
+    std::unique_ptr<SpillStore> ret(new SpillStore(env, dir, row_bytes));
+    TF_RETURN_IF_ERROR(ret->NewFile(&ret->current_));
+    *store = std::move(ret);
+    return OkStatus();
+  }
+
+  size_t size() const {
+    tf_shared_lock l(mu_);
+    return index_.size() + in_flight_.size() - num_removed_in_flight_;
+  }
+
+  // Approximates the memory held by the index.
+  int64_t MemoryUsed() const {
+    tf_shared_lock l(mu_);
+    return sizeof(SpillStore) + BucketMemoryUsed(index_) +
+           index_.size() * sizeof(typename Index::value_type);
+  }
+
+  // Appends `num_rows` rows of `row_bytes` bytes each, stored back to back at
+  // `rows`, and sets `*locations` to where they were written. The rows are
+  // not part of the store until they are committed.
+  Status Write(const char* rows, int64_t num_rows,
+               std::vector<Location>* locations) {
+    mutex_lock l(mu_);
+    TF_RETURN_IF_ERROR(status_);
+    locations->resize(num_rows);
+    for (int64_t i = 0; i < num_rows; ++i) {
+      TF_RETURN_IF_ERROR(Check(current_->writer->WriteRecord(
+          StringPiece(rows + i * row_bytes_, row_bytes_))));
+      (*locations)[i].file = current_;
+      (*locations)[i].offset = current_->end_offset;
+      current_->end_offset += RecordBytes();
+      ++num_records_;
+    }
+    current_->needs_flush = true;
+    return OkStatus();
+  }
+
+  // Stores the row written to `location` under `key`.
+  void Commit(const K& key, Location location) {
+    mutex_lock l(mu_);
+    index_[key] = std::move(location);
+  }
+
+  // Moves the row of `key` into flight for the caller and sets `*location`,
+  // if it is stored.
+  ClaimResult Claim(const K& key, Location* location) {
+    mutex_lock l(mu_);
+    auto it = index_.find(key);
+    auto in_flight = in_flight_.find(key);
+    if (in_flight != in_flight_.end()) {
+      // A row removed while in flight is absent, unless it was stored again.
+      return in_flight->second.removed && it == index_.end()
+                 ? ClaimResult::kAbsent
+                 : ClaimResult::kInFlight;
+    }
+    if (it == index_.end()) return ClaimResult::kAbsent;
+    *location = it->second;
+    in_flight_.emplace(key, InFlight{std::move(it->second), false});
+    index_.erase(it);
+    return ClaimResult::kClaimed;
+  }
+
+  // Reads the row at `location` into `row`.
+  Status Read(const Location& location, char* row) {
+    {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(status_);
+      if (location.file->needs_flush) {
+        TF_RETURN_IF_ERROR(Check(location.file->writer->Flush()));
+        location.file->needs_flush = false;
+      }
+    }
+    io::RecordReader reader(location.file->read_file.get());
+    uint64 offset = location.offset;
+    tstring record;
+    Status s = reader.ReadRecord(&offset, &record);
+    if (s.ok() && record.size() != row_bytes_) {
+      s = errors::DataLoss("Spill file ", location.file->path,
+                           " holds a record of ", record.size(),
+                           " bytes, expected ", row_bytes_);
+    }
+    if (!s.ok()) {
+      mutex_lock l(mu_);
+      return Check(s);
+    }
+    std::memcpy(row, record.data(), row_bytes_);
+    return OkStatus();
+  }
+
+  // Ends the flight of the row of `key` claimed by the caller. With `restore`
+  // the row is stored again, as after a failed read. Returns false if the row
+  // was removed while in flight.
+  bool Release(const K& key, bool restore) {
+    mutex_lock l(mu_);
+    auto it = in_flight_.find(key);
+    DCHECK(it != in_flight_.end());
+    const bool removed = it->second.removed;
+    if (removed) {
+      --num_removed_in_flight_;
+    } else if (restore) {
+      index_.emplace(key, std::move(it->second.location));
+    }
+    in_flight_.erase(it);
+    released_.notify_all();
+    return !removed;
+  }
+
+  // Waits until the row of `key` is not in flight.
+  void WaitUntilReleased(const K& key) {
+    mutex_lock l(mu_);
+    while (in_flight_.count(key) > 0) {
+      released_.wait(l);
+    }
+  }
+
+  // Drops the row of `key`. Returns whether there was one.
+  bool Remove(const K& key) {
+    mutex_lock l(mu_);
+    bool removed = index_.erase(key) > 0;
+    auto it = in_flight_.find(key);
+    if (it != in_flight_.end() && !it->second.removed) {
+      it->second.removed = true;
+      ++num_removed_in_flight_;
+      removed = true;
+    }
+    return removed;
+  }
+
+  // Drops all rows. The file space is reclaimed by the next compaction.
+  void Clear() {
+    mutex_lock l(mu_);
+    index_.clear();
+    for (auto& it : in_flight_) {
+      if (!it.second.removed) {
+        it.second.removed = true;
+        ++num_removed_in_flight_;
+      }
+    }
+  }
+
+  // Calls `fn(key, row)` for every stored row, including those in flight.
+  template <typename Fn>
+  Status ForEach(Fn fn) {
+    std::vector<std::pair<K, Location>> rows;
+    {
+      tf_shared_lock l(mu_);
+      TF_RETURN_IF_ERROR(status_);
+      rows.reserve(index_.size() + in_flight_.size());
+      rows.assign(index_.begin(), index_.end());
+      for (const auto& it : in_flight_) {
+        if (!it.second.removed) rows.emplace_back(it.first, it.second.location);
+      }
+    }
+    std::vector<char> row(row_bytes_);
+    for (const auto& it : rows) {
+      TF_RETURN_IF_ERROR(Read(it.second, row.data()));
+      fn(it.first, row.data());
+    }
+    return OkStatus();
+  }
+
+  // Copies the live records to a fresh file, which receives all later writes,
+  // if the dead records make up more than half of the stored ones. The copy
+  // is made without holding the lock of the store; rows written, taken back
+  // or removed meanwhile keep their location.
+  Status Compact() {
+    std::vector<std::pair<K, Location>> live;
+    uint64 num_records_before;
+    {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(status_);
+      const uint64 num_live = index_.size() + in_flight_.size();
+      const uint64 num_dead =
+          num_records_ > num_live ? num_records_ - num_live : 0;
+      if (compacting_ || num_dead < kMinDeadRecordsToCompact ||
+          num_dead <= num_live) {
+        return OkStatus();
+      }
+      compacting_ = true;
+      live.assign(index_.begin(), index_.end());
+      num_records_before = num_records_;
+    }
+    std::shared_ptr<File> file;
+    Status s = NewFile(&file);
+    std::vector<Location> moved(live.size());
+    std::vector<char> row(row_bytes_);
+    for (size_t i = 0; s.ok() && i < live.size(); ++i) {
+      s.Update(Read(live[i].second, row.data()));
+      if (!s.ok()) break;
+      s.Update(file->writer->WriteRecord(StringPiece(row.data(), row_bytes_)));
+      moved[i] = live[i].second;
+      moved[i].file = file;
+      moved[i].offset = file->end_offset;
+      file->end_offset += RecordBytes();
+    }
+    if (s.ok()) s.Update(file->writer->Flush());
+
+    mutex_lock l(mu_);
+    compacting_ = false;
+    if (!s.ok()) return s;
+    uint64 num_moved = 0;
+    for (size_t i = 0; i < live.size(); ++i) {
+      auto it = index_.find(live[i].first);
+      if (it != index_.end() && it->second.file == live[i].second.file &&
+          it->second.offset == live[i].second.offset) {
+        // Keep the access metadata, which Commit() may have updated.
+        it->second.file = moved[i].file;
+        it->second.offset = moved[i].offset;
+        ++num_moved;
+      }
+    }
+    // The old files stay until no entry or read refers to them. The rows
+    // written or put in flight during the copy are moved by a later
+    // compaction.
+    num_records_ =
+        num_moved + (num_records_ - num_records_before) + in_flight_.size();
+    current_ = std::move(file);
+    return OkStatus();
+  }
+
+ private:
+  typedef std::unordered_map<K, Location> Index;
+
+  struct InFlight {
+    Location location;
+    // Set when the row was removed while in flight.
+    bool removed;
+  };
+
+  SpillStore(Env* env, std::string dir, size_t row_bytes)
+      : env_(env), dir_(std::move(dir)), row_bytes_(row_bytes) {}
+
+  // The size of the record holding one row.
+  uint64 RecordBytes() const {
+    return io::RecordWriter::kHeaderSize + row_bytes_ +
+           io::RecordWriter::kFooterSize;
+  }
+
+  // Records `s` as the sticky error of the store if it is not OK.
+  Status Check(Status s) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (!s.ok() && status_.ok()) {
+      status_ = s;
+    }
+    return s;
+  }
+
+  // Creates an empty file under `dir_`, with a writer and a reader.
+  Status NewFile(std::shared_ptr<File>* file) const {
+    auto ret = std::make_shared<File>();
+    ret->env = env_;
+    ret->path = io::JoinPath(dir_, "mutable_hash_table_spill");
+    if (!env_->CreateUniqueFileName(&ret->path, ".tfrecord")) {
+      return errors::Internal("Failed to create a spill file name in ", dir_);
+    }
+    TF_RETURN_IF_ERROR(env_->NewWritableFile(ret->path, &ret->file));
+    ret->writer = std::make_unique<io::RecordWriter>(ret->file.get());
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(ret->path, &ret->read_file));
+    *file = std::move(ret);
+    return OkStatus();
+  }
+
+  static constexpr uint64 kMinDeadRecordsToCompact = 1024;
+
+  Env* const env_;
+  const std::string dir_;
+  const size_t row_bytes_;
+  mutable mutex mu_;
+  condition_variable released_;
+  Status status_ TF_GUARDED_BY(mu_);
+  Index index_ TF_GUARDED_BY(mu_);
+  std::unordered_map<K, InFlight> in_flight_ TF_GUARDED_BY(mu_);
+  int64_t num_removed_in_flight_ TF_GUARDED_BY(mu_) = 0;
+  // The file receiving new rows.
+  std::shared_ptr<File> current_ TF_GUARDED_BY(mu_);
+  // Approximates the number of records, live or dead, in the files still
+  // referenced.
+  uint64 num_records_ TF_GUARDED_BY(mu_) = 0;
+  bool compacting_ TF_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace
+
 // Lookup table that wraps an unordered_map, where the key and value data type
 // is specified. Each individual value must be a scalar. If vector values are
 // required, use MutableHashTableOfTensors.
 //
 // This table is mutable and thread safe - Insert can be called at any time.
+// The table is split into `num_shards` independently locked shards (1 unless
+// set through the op attr), which lets Find and Insert calls from many
+// threads scale when they touch different keys.
 //
 // Sample use case:
 //
@@ -53,12 +612,10 @@ std::string UniqueNodeName(const std::string& base) {
 template <class K, class V>
 class MutableHashTableOfScalars final : public LookupInterface {
  public:
-  MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
+  MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel)
+      : table_(GetNumShards(kernel)) {}
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -70,8 +627,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
+    table_.ForEachKeyShared(key_values, [&](const Map& map, int64_t i) {
       // is_full_size_default is true:
       //   Each key has an independent default value, key_values(i)
       //   corresponding uses default_flat(i) as its default value.
@@ -79,9 +635,9 @@ class MutableHashTableOfScalars final : public LookupInterface {
       // is_full_size_default is false:
       //   All keys will share the default_flat(0) as default value.
       value_values(i) = gtl::FindWithDefault(
-          table_, SubtleMustCopyIfIntegral(key_values(i)),
+          map, SubtleMustCopyIfIntegral(key_values(i)),
           is_full_size_default ? default_flat(i) : default_flat(0));
-    }
+    });
 
     return OkStatus();
   }
@@ -90,14 +646,24 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
     if (clear) {
-      table_.clear();
+      // Clearing and refilling must look atomic to concurrent readers, so
+      // hold every shard lock for the whole import.
+      auto locks = table_.LockAll();
+      for (int64_t s = 0; s < table_.num_shards(); ++s) {
+        table_.shard_map(s)->clear();
+      }
+      for (int64_t i = 0; i < key_values.size(); ++i) {
+        const K key = SubtleMustCopyIfIntegral(key_values(i));
+        gtl::InsertOrUpdate(table_.shard_map(table_.ShardOf(key)), key,
+                            SubtleMustCopyIfIntegral(value_values(i)));
+      }
+      return OkStatus();
     }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
+    table_.ForEachKeyExclusive(key_values, [&](Map* map, int64_t i) {
+      gtl::InsertOrUpdate(map, SubtleMustCopyIfIntegral(key_values(i)),
                           SubtleMustCopyIfIntegral(value_values(i)));
-    }
+    });
     return OkStatus();
   }
 
@@ -109,10 +675,9 @@ class MutableHashTableOfScalars final : public LookupInterface {
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
     const auto key_values = keys.flat<K>();
 
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.ForEachKeyExclusive(key_values, [&](Map* map, int64_t i) {
+      map->erase(SubtleMustCopyIfIntegral(key_values(i)));
+    });
     return OkStatus();
   }
 
@@ -122,8 +687,8 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
+    auto locks = table_.LockAllShared();
+    int64_t size = SizeLocked();
 
     Tensor* keys;
     Tensor* values;
@@ -145,21 +710,16 @@ class MutableHashTableOfScalars final : public LookupInterface {
 
   int64_t MemoryUsed() const override {
     int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
-      }
+    auto locks = table_.LockAllShared();
+    for (int64_t s = 0; s < table_.num_shards(); ++s) {
+      ret += BucketMemoryUsed(table_.shard_map(s));
     }
     return sizeof(MutableHashTableOfScalars) + ret;
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
+    auto locks = table_.LockAllShared();
+    int64_t size = SizeLocked();
     Tensor keys(key_dtype(), TensorShape({size}));
     Tensor values(value_dtype(), TensorShape({size}));
     ExportKeysAndValues(&keys, &values);
@@ -176,7 +736,8 @@ class MutableHashTableOfScalars final : public LookupInterface {
             .WithName(UniqueNodeName("MutableHashTableFromGraphDef"))
             .WithAttr("use_node_name_sharing", true)
             .WithAttr("key_dtype", key_dtype())
-            .WithAttr("value_dtype", value_dtype()));
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("num_shards", table_.num_shards()));
     Node* keys_node = ops::SourceOp(
         "Const",
         builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
@@ -195,40 +756,105 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
  private:
+  typedef typename ShardedHashMap<K, V>::Map Map;
+
+  // Returns the number of entries in the table. The caller must hold the
+  // locks of all shards.
+  int64_t SizeLocked() const {
+    int64_t size = 0;
+    for (int64_t s = 0; s < table_.num_shards(); ++s) {
+      size += table_.shard_map(s).size();
+    }
+    return size;
+  }
+
   // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  // must point to tensors of size `SizeLocked()`, and the caller must hold the
+  // locks of all shards.
+  void ExportKeysAndValues(Tensor* keys, Tensor* values) const {
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
+    for (int64_t s = 0; s < table_.num_shards(); ++s) {
+      const Map& map = table_.shard_map(s);
+      for (auto it = map.begin(); it != map.end(); ++it, ++i) {
+        keys_data(i) = it->first;
+        values_data(i) = it->second;
+      }
     }
   }
 
-  mutable mutex mu_;
-  std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, V> table_;
 };
 
 // Lookup table that wraps an unordered_map. Behaves identical to
 // MutableHashTableOfScalars except that each value must be a vector.
+//
+// The table can also bound its own size, which keeps embedding tables of
+// streaming vocabularies from growing without limit:
+//
+// * With "min_frequency" N > 1, a key that is not in the table is only
+//   admitted by its N-th insert. Until then it is a pending entry that holds
+//   no value and is invisible to Find, size and export.
+// * With "max_size" > 0, every entry tracks how often it was accessed and the
+//   value of the access clock of its shard (bumped once by every Find and
+//   Insert call that touches the shard) at its last access. When a shard
+//   grows past its share of max_size, an insert schedules a background pass
+//   that evicts the least recently ("lru") or least frequently ("lfu") used
+//   entries of the shard, pending ones included, down to 90% of its share.
+//   The table can briefly exceed max_size while the pass runs.
+// * With "spill_dir" also set, evicted entries are not dropped but written to
+//   a file per shard in that directory (see SpillStore), so the table can
+//   hold more rows than fit in memory. A spilled key is read back into memory
+//   the next time it is looked up or passed to Prefetch, which does the reads
+//   on the intra-op thread pool so that they can overlap the previous step.
+//   Spilled entries keep their access metadata, count towards size and are
+//   exported like the in-memory ones. No file is read or written while a
+//   shard lock is held.
+//
+// The access metadata is not exported or checkpointed.
 template <class K, class V>
 class MutableHashTableOfTensors final : public LookupInterface {
  public:
-  MutableHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel) {
+  MutableHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel)
+      : table_(GetNumShards(kernel)),
+        shard_clocks_(new ShardClock[table_.num_shards()]) {
     OP_REQUIRES_OK(ctx,
                    GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
     OP_REQUIRES(
         ctx, TensorShapeUtils::IsVector(value_shape_),
         errors::InvalidArgument("Default value must be a vector, got shape ",
                                 value_shape_.DebugString()));
+    // The eviction attrs are absent from the op versions that predate them.
+    TryGetNodeAttr(kernel->def(), "max_size", &max_size_);
+    TryGetNodeAttr(kernel->def(), "min_frequency", &min_frequency_);
+    std::string eviction_policy = "lru";
+    TryGetNodeAttr(kernel->def(), "eviction_policy", &eviction_policy);
+    OP_REQUIRES(ctx, eviction_policy == "lru" || eviction_policy == "lfu",
+                errors::InvalidArgument(
+                    "eviction_policy must be 'lru' or 'lfu', got: ",
+                    eviction_policy));
+    evict_least_frequent_ = (eviction_policy == "lfu");
+    TryGetNodeAttr(kernel->def(), "spill_dir", &spill_dir_);
+    if (!spill_dir_.empty()) {
+      OP_REQUIRES(ctx, max_size_ > 0,
+                  errors::InvalidArgument("spill_dir requires max_size > 0"));
+      OP_REQUIRES(ctx, std::is_trivially_copyable<V>::value,
+                  errors::InvalidArgument(
+                      "spill_dir does not support values of type ",
+                      DataTypeString(value_dtype())));
+      spill_.resize(table_.num_shards());
+      for (auto& store : spill_) {
+        OP_REQUIRES_OK(ctx, SpillStore<K>::Create(
+                                ctx->env(), spill_dir_,
+                                value_shape_.dim_size(0) * sizeof(V), &store));
+      }
+    }
   }
 
   size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
+    return table_.size() - num_pending_.load(std::memory_order_relaxed) +
+           SpilledSize();
   }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
@@ -241,16 +867,25 @@ class MutableHashTableOfTensors final : public LookupInterface {
     int64_t total = value_values.size();
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
-
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      ValueArray* value_vec =
-          gtl::FindOrNull(table_, SubtleMustCopyIfIntegral(key_values(i)));
-      if (value_vec != nullptr) {
+    const bool track_access = max_size_ > 0;
+    ShardClockReader clock(this);
+    // Indices of the keys that are not in memory but may have been spilled.
+    std::vector<int64_t> missing;
+
+    table_.ForEachKeyShared(key_values, [&](const Map& map, int64_t i) {
+      const K key = SubtleMustCopyIfIntegral(key_values(i));
+      const Entry* entry = gtl::FindOrNull(map, key);
+      if (entry != nullptr && entry->admitted) {
         for (int64_t j = 0; j < value_dim; j++) {
-          value_values(i, j) = value_vec->at(j);
+          value_values(i, j) = entry->value.at(j);
+        }
+        if (track_access) {
+          entry->RecordAccess(clock.Now(map, key));
         }
       } else {
+        if (entry == nullptr && !spill_.empty()) {
+          missing.push_back(i);
+        }
         // is_full_size_default is true:
         //   Each key has an independent default value, key_values(i)
         //   corresponding uses default_flat(i) as its default value.
@@ -262,55 +897,159 @@ class MutableHashTableOfTensors final : public LookupInterface {
               is_full_size_default ? default_flat(i, j) : default_flat(0, j);
         }
       }
+    });
+
+    if (!missing.empty()) {
+      Tensor missing_keys(key.dtype(),
+                          TensorShape({static_cast<int64_t>(missing.size())}));
+      auto missing_values = missing_keys.flat<K>();
+      for (size_t m = 0; m < missing.size(); ++m) {
+        missing_values(m) = key_values(missing[m]);
+      }
+      bool over_capacity = false;
+      TF_RETURN_IF_ERROR(Unspill(
+          missing_values,
+          [&](int64_t m, const Entry& entry) {
+            for (int64_t j = 0; j < value_dim; j++) {
+              value_values(missing[m], j) = entry.value.at(j);
+            }
+          },
+          &over_capacity));
+      if (over_capacity) {
+        MaybeScheduleEviction(
+            ctx->device()->tensorflow_cpu_worker_threads()->workers);
+      }
     }
-
     return OkStatus();
   }
 
-  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+  // Inserts `keys` and `values`, replacing the whole table if `clear` is set.
+  // Sets `*over_capacity` if a shard holds more than its share of max_size_
+  // afterwards; it is not set by a clearing insert.
+  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values,
+                  bool* over_capacity) {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat_inner_dims<V, 2>();
     int64_t value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      ValueArray value_vec;
+    auto set_value = [&](int64_t i, Entry* entry) {
+      entry->value.clear();
       for (int64_t j = 0; j < value_dim; j++) {
         V value = value_values(i, j);
-        value_vec.push_back(value);
+        entry->value.push_back(value);
+      }
+    };
+
+    if (clear) {
+      // Clearing and refilling must look atomic to concurrent readers, so
+      // hold every shard lock for the whole import. Imported keys are
+      // admitted unconditionally.
+      auto locks = table_.LockAll();
+      for (int64_t s = 0; s < table_.num_shards(); ++s) {
+        table_.shard_map(s)->clear();
+      }
+      num_pending_.store(0, std::memory_order_relaxed);
+      for (auto& store : spill_) {
+        store->Clear();
+      }
+      for (int64_t i = 0; i < key_values.size(); ++i) {
+        const K key = SubtleMustCopyIfIntegral(key_values(i));
+        set_value(i, &(*table_.shard_map(table_.ShardOf(key)))[key]);
       }
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          value_vec);
+      return OkStatus();
     }
+    const bool track_access = max_size_ > 0;
+    ShardClockReader clock(this);
+    table_.ForEachKeyExclusive(key_values, [&](Map* map, int64_t i) {
+      const K key = SubtleMustCopyIfIntegral(key_values(i));
+      auto it = map->find(key);
+      if (it == map->end()) {
+        it = map->emplace(key, Entry()).first;
+        if (track_access &&
+            static_cast<int64_t>(map->size()) > ShardCapacity()) {
+          *over_capacity = true;
+        }
+        // A spilled key was admitted before, so it does not wait again.
+        const bool spilled =
+            !spill_.empty() && spill_[table_.ShardOf(key)]->Remove(key);
+        if (min_frequency_ > 1 && !spilled) {
+          it->second.admitted = false;
+          num_pending_.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      Entry& entry = it->second;
+      entry.RecordAccess(track_access ? clock.Now(*map, key) : 0);
+      if (!entry.admitted) {
+        if (entry.frequency.load(std::memory_order_relaxed) < min_frequency_) {
+          return;
+        }
+        entry.admitted = true;
+        num_pending_.fetch_sub(1, std::memory_order_relaxed);
+      }
+      set_value(i, &entry);
+    });
     return OkStatus();
   }
 
   Status Insert(OpKernelContext* ctx, const Tensor& keys,
                 const Tensor& values) override {
-    return DoInsert(false, keys, values);
+    bool over_capacity = false;
+    TF_RETURN_IF_ERROR(DoInsert(false, keys, values, &over_capacity));
+    if (over_capacity) {
+      MaybeScheduleEviction(
+          ctx->device()->tensorflow_cpu_worker_threads()->workers);
+    }
+    return OkStatus();
   }
 
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
     const auto key_values = keys.flat<K>();
 
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
+    table_.ForEachKeyExclusive(key_values, [&](Map* map, int64_t i) {
+      const K key = SubtleMustCopyIfIntegral(key_values(i));
+      if (!spill_.empty()) {
+        spill_[table_.ShardOf(key)]->Remove(key);
+      }
+      auto it = map->find(key);
+      if (it == map->end()) return;
+      if (!it->second.admitted) {
+        num_pending_.fetch_sub(1, std::memory_order_relaxed);
+      }
+      map->erase(it);
+    });
+    return OkStatus();
+  }
+
+  Status Prefetch(OpKernelContext* ctx, const Tensor& keys) override {
+    if (spill_.empty()) {
+      return OkStatus();
     }
+    thread::ThreadPool* workers =
+        ctx->device()->tensorflow_cpu_worker_threads()->workers;
+    Ref();
+    workers->Schedule([this, keys, workers]() {
+      bool over_capacity = false;
+      Status s = Unspill(
+          keys.flat<K>(), [](int64_t, const Entry&) {}, &over_capacity);
+      if (!s.ok()) {
+        LOG(WARNING) << "Failed to prefetch spilled table entries: " << s;
+      }
+      if (over_capacity) {
+        MaybeScheduleEviction(workers);
+      }
+      Unref();
+    });
     return OkStatus();
   }
 
   Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override {
-    return DoInsert(true, keys, values);
+    return DoInsert(true, keys, values, nullptr);
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
+    auto locks = table_.LockAllShared();
+    int64_t size = SizeLocked();
     int64_t value_dim = value_shape_.dim_size(0);
 
     Tensor* keys;
@@ -319,8 +1058,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
         ctx->allocate_output("keys", TensorShape({size}), &keys));
     TF_RETURN_IF_ERROR(ctx->allocate_output(
         "values", TensorShape({size, value_dim}), &values));
-    ExportKeysAndValues(keys, values);
-    return OkStatus();
+    return ExportKeysAndValues(keys, values);
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -333,24 +1071,22 @@ class MutableHashTableOfTensors final : public LookupInterface {
 
   int64_t MemoryUsed() const override {
     int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
-      }
+    auto locks = table_.LockAllShared();
+    for (int64_t s = 0; s < table_.num_shards(); ++s) {
+      ret += BucketMemoryUsed(table_.shard_map(s));
+    }
+    for (const auto& store : spill_) {
+      ret += store->MemoryUsed();
     }
     return sizeof(MutableHashTableOfTensors) + ret;
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
+    auto locks = table_.LockAllShared();
+    int64_t size = SizeLocked();
     Tensor keys(key_dtype(), TensorShape({size}));
     Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
-    ExportKeysAndValues(&keys, &values);
+    TF_RETURN_IF_ERROR(ExportKeysAndValues(&keys, &values));
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableOfTensorsV2 kernel. This means that the
@@ -358,14 +1094,19 @@ class MutableHashTableOfTensors final : public LookupInterface {
     // manager it is created in.
     // TODO(b/181695913): Provide a mechanism for deleting this resource
     // earlier when appropriate.
-    Node* table =
-        ops::SourceOp("MutableHashTableOfTensorsV2",
-                      builder->opts()
-                          .WithName(UniqueNodeName("MutableHashTableOfTensors"))
-                          .WithAttr("use_node_name_sharing", true)
-                          .WithAttr("key_dtype", key_dtype())
-                          .WithAttr("value_dtype", value_dtype())
-                          .WithAttr("value_shape", value_shape_));
+    Node* table = ops::SourceOp(
+        "MutableHashTableOfTensorsV2",
+        builder->opts()
+            .WithName(UniqueNodeName("MutableHashTableOfTensors"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("value_shape", value_shape_)
+            .WithAttr("num_shards", table_.num_shards())
+            .WithAttr("max_size", max_size_)
+            .WithAttr("eviction_policy", evict_least_frequent_ ? "lfu" : "lru")
+            .WithAttr("min_frequency", min_frequency_)
+            .WithAttr("spill_dir", spill_dir_));
     Node* keys_node = ops::SourceOp(
         "Const",
         builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
@@ -384,50 +1125,435 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+
+  // A table entry. Find updates the access metadata while holding only a
+  // shared lock, hence the relaxed atomics.
+  struct Entry {
+    Entry() = default;
+    Entry(const Entry& other)
+        : value(other.value),
+          admitted(other.admitted),
+          frequency(other.frequency.load(std::memory_order_relaxed)),
+          last_access(other.last_access.load(std::memory_order_relaxed)) {}
+
+    void RecordAccess(int64_t now) const {
+      frequency.fetch_add(1, std::memory_order_relaxed);
+      last_access.store(now, std::memory_order_relaxed);
+    }
+
+    ValueArray value;
+    // False while the key waits for min_frequency inserts.
+    bool admitted = true;
+    mutable std::atomic<int64_t> frequency{0};
+    mutable std::atomic<int64_t> last_access{0};
+  };
+
+  typedef typename ShardedHashMap<K, Entry>::Map Map;
+
+  // The access clock of one shard. Entries are only ranked against the other
+  // entries of their shard, so the clocks of different shards need not agree,
+  // and each has its own cache line so that calls on different shards do not
+  // contend on it.
+  struct alignas(64) ShardClock {
+    std::atomic<int64_t> value{0};
+  };
+
+  // Reads the access time of the keys visited by one Find or Insert call.
+  // ShardedHashMap visits the keys of one shard at a time, so the clock of a
+  // shard is advanced once per call rather than once per key.
+  class ShardClockReader {
+   public:
+    explicit ShardClockReader(MutableHashTableOfTensors* table)
+        : table_(table) {}
+
+    // Returns the access time for `key`, which belongs to the shard of `map`.
+    int64_t Now(const Map& map, const K& key) {
+      if (&map != map_) {
+        map_ = &map;
+        ShardClock& clock = table_->shard_clocks_[table_->table_.ShardOf(key)];
+        now_ = clock.value.fetch_add(1, std::memory_order_relaxed);
+      }
+      return now_;
+    }
+
+   private:
+    MutableHashTableOfTensors* const table_;
+    const Map* map_ = nullptr;
+    int64_t now_ = 0;
+  };
+
+  // The number of entries each shard may hold before it is evicted from.
+  int64_t ShardCapacity() const {
+    return (max_size_ + table_.num_shards() - 1) / table_.num_shards();
+  }
+
+  // Starts a background eviction pass on `workers`, the intra-op thread
+  // pool, unless one is already pending.
+  void MaybeScheduleEviction(thread::ThreadPool* workers) {
+    if (eviction_scheduled_.exchange(true)) {
+      return;
+    }
+    Ref();
+    workers->Schedule([this]() {
+      Evict();
+      eviction_scheduled_.store(false);
+      Unref();
+    });
+  }
+
+  // Moves the spilled rows of those `keys` that are not in memory back into
+  // the table, and calls `fn(i, entry)` for every index `i` whose key now has
+  // an admitted in-memory entry. A spilled row is claimed under the lock of
+  // its shard, read without it, and moved into memory under the lock again,
+  // unless the key was inserted or removed meanwhile, so a key is never both
+  // in memory and stored. A key whose row another call is reading is looked
+  // up again once that read is done. Sets `*over_capacity` if a shard then
+  // holds more than its share of max_size_.
+  template <typename KeyFlat, typename Fn>
+  Status Unspill(const KeyFlat& keys, Fn fn, bool* over_capacity) {
+    typedef typename SpillStore<K>::Location Location;
+    struct Claim {
+      int64_t index;
+      Location location;
+      bool read_ok;
+    };
+    const int64_t value_dim = value_shape_.dim_size(0);
+    const size_t row_bytes = value_dim * sizeof(V);
+    // The keys still to look up, and their indices in `keys`.
+    std::vector<K> pending_keys(keys.size());
+    std::vector<int64_t> pending(keys.size());
+    for (int64_t i = 0; i < keys.size(); ++i) {
+      pending_keys[i] = SubtleMustCopyIfIntegral(keys(i));
+      pending[i] = i;
+    }
+    Status status;
+    while (!pending.empty()) {
+      std::vector<K> claimed_keys;
+      std::vector<Claim> claims;
+      // Positions in `pending` of the keys being read by another call.
+      std::vector<int64_t> in_flight;
+      ShardClockReader shared_clock(this);
+      table_.ForEachKeyShared(
+          VectorKeys<K>(pending_keys), [&](const Map& map, int64_t j) {
+            const K& key = pending_keys[j];
+            const Entry* entry = gtl::FindOrNull(map, key);
+            if (entry != nullptr) {
+              if (entry->admitted) {
+                entry->RecordAccess(shared_clock.Now(map, key));
+                fn(pending[j], *entry);
+              }
+              return;
+            }
+            Location location;
+            switch (spill_[table_.ShardOf(key)]->Claim(key, &location)) {
+              case SpillStore<K>::ClaimResult::kClaimed:
+                claimed_keys.push_back(key);
+                claims.push_back({pending[j], std::move(location), false});
+                break;
+              case SpillStore<K>::ClaimResult::kInFlight:
+                in_flight.push_back(j);
+                break;
+              case SpillStore<K>::ClaimResult::kAbsent:
+                break;
+            }
+          });
+
+      std::vector<char> rows(claims.size() * row_bytes);
+      for (size_t c = 0; c < claims.size(); ++c) {
+        Status s = spill_[table_.ShardOf(claimed_keys[c])]->Read(
+            claims[c].location, &rows[c * row_bytes]);
+        claims[c].read_ok = s.ok();
+        status.Update(s);
+      }
+
+      ShardClockReader clock(this);
+      table_.ForEachKeyExclusive(
+          VectorKeys<K>(claimed_keys), [&](Map* map, int64_t c) {
+            const K& key = claimed_keys[c];
+            const Claim& claim = claims[c];
+            // A row that failed to read stays in the store.
+            const bool stored = spill_[table_.ShardOf(key)]->Release(
+                key, /*restore=*/!claim.read_ok);
+            auto it = map->find(key);
+            if (it == map->end()) {
+              if (!stored || !claim.read_ok) return;
+              it = map->emplace(key, Entry()).first;
+              Entry& entry = it->second;
+              entry.value.resize(value_dim);
+              std::memcpy(entry.value.data(), &rows[c * row_bytes], row_bytes);
+              entry.frequency.store(claim.location.frequency,
+                                    std::memory_order_relaxed);
+              entry.last_access.store(claim.location.last_access,
+                                      std::memory_order_relaxed);
+              if (static_cast<int64_t>(map->size()) > ShardCapacity()) {
+                *over_capacity = true;
+              }
+            } else if (!it->second.admitted) {
+              return;
+            }
+            it->second.RecordAccess(clock.Now(*map, key));
+            fn(claim.index, it->second);
+          });
+
+      // Wait without holding any lock or claim, then look up again.
+      std::vector<K> next_keys;
+      std::vector<int64_t> next;
+      for (int64_t j : in_flight) {
+        spill_[table_.ShardOf(pending_keys[j])]->WaitUntilReleased(
+            pending_keys[j]);
+        next_keys.push_back(pending_keys[j]);
+        next.push_back(pending[j]);
+      }
+      pending_keys.swap(next_keys);
+      pending.swap(next);
+    }
+    return status;
+  }
+
+  // Evicts the entries with the lowest access score from every shard that
+  // holds more than its share of max_size_, down to 90% of that share. The
+  // headroom keeps the pass from being rescheduled on every insert.
+  void Evict() {
+    for (int64_t s = 0; s < table_.num_shards(); ++s) {
+      EvictShard(s);
+    }
+  }
+
+  // Evicts from shard `s`. Rows to spill are copied out under the shard lock,
+  // written to the store of the shard without it, and only dropped from
+  // memory afterwards if they did not change in the meantime. The store is
+  // then compacted, still without the shard lock.
+  void EvictShard(int64_t s) {
+    const int64_t shard_capacity = ShardCapacity();
+    const int64_t target = shard_capacity - shard_capacity / 10;
+    const size_t row_bytes = value_shape_.dim_size(0) * sizeof(V);
+    std::vector<K> spilled_keys;
+    std::vector<char> rows;
+    table_.WithShardExclusive(s, [&](Map* map) {
+      const int64_t num_evicted = static_cast<int64_t>(map->size()) - target;
+      if (static_cast<int64_t>(map->size()) <= shard_capacity ||
+          num_evicted <= 0) {
+        return;
+      }
+      std::vector<std::pair<std::pair<int64_t, int64_t>,
+                            typename Map::const_iterator>>
+          scored;
+      scored.reserve(map->size());
+      for (auto it = map->cbegin(); it != map->cend(); ++it) {
+        const int64_t frequency =
+            it->second.frequency.load(std::memory_order_relaxed);
+        const int64_t last_access =
+            it->second.last_access.load(std::memory_order_relaxed);
+        scored.push_back({evict_least_frequent_
+                              ? std::make_pair(frequency, last_access)
+                              : std::make_pair(last_access, frequency),
+                          it});
+      }
+      std::nth_element(
+          scored.begin(), scored.begin() + num_evicted, scored.end(),
+          [](const auto& a, const auto& b) { return a.first < b.first; });
+      for (int64_t i = 0; i < num_evicted; ++i) {
+        const auto it = scored[i].second;
+        if (!it->second.admitted) {
+          num_pending_.fetch_sub(1, std::memory_order_relaxed);
+        } else if (!spill_.empty()) {
+          const char* row =
+              reinterpret_cast<const char*>(it->second.value.data());
+          spilled_keys.push_back(it->first);
+          rows.insert(rows.end(), row, row + row_bytes);
+          continue;
+        }
+        map->erase(it);
+      }
+    });
+    if (spilled_keys.empty()) {
+      return;
+    }
+
+    SpillStore<K>* store = spill_[s].get();
+    std::vector<typename SpillStore<K>::Location> locations;
+    Status status = store->Write(rows.data(), spilled_keys.size(), &locations);
+    if (!status.ok()) {
+      // Keep the entries in memory rather than lose them.
+      LOG(ERROR) << "Failed to spill table entries to " << spill_dir_ << ": "
+                 << status;
+      return;
+    }
+    table_.WithShardExclusive(s, [&](Map* map) {
+      for (size_t i = 0; i < spilled_keys.size(); ++i) {
+        auto it = map->find(spilled_keys[i]);
+        // An entry that was updated or removed since it was copied stays as
+        // it is; its record is dead.
+        if (it == map->end() || !it->second.admitted ||
+            std::memcmp(it->second.value.data(), &rows[i * row_bytes],
+                        row_bytes) != 0) {
+          continue;
+        }
+        locations[i].frequency =
+            it->second.frequency.load(std::memory_order_relaxed);
+        locations[i].last_access =
+            it->second.last_access.load(std::memory_order_relaxed);
+        store->Commit(spilled_keys[i], std::move(locations[i]));
+        map->erase(it);
+      }
+    });
+    status = store->Compact();
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to compact the table entries spilled to "
+                   << spill_dir_ << ": " << status;
+    }
+  }
+
+  // Returns the number of spilled entries in the table.
+  int64_t SpilledSize() const {
+    int64_t size = 0;
+    for (const auto& store : spill_) {
+      size += store->size();
+    }
+    return size;
+  }
+
+  // Returns the number of admitted and spilled entries in the table. The
+  // caller must hold the locks of all shards.
+  int64_t SizeLocked() const {
+    int64_t size = SpilledSize();
+    for (int64_t s = 0; s < table_.num_shards(); ++s) {
+      for (const auto& it : table_.shard_map(s)) {
+        size += it.second.admitted;
+      }
+    }
+    return size;
+  }
+
+  // Writes all admitted keys and values, then the spilled ones, into `keys`
+  // and `values`. `keys` and `values` must point to tensors of size
+  // `SizeLocked()`, and the caller must hold the locks of all shards.
+  Status ExportKeysAndValues(Tensor* keys, Tensor* values) const {
     int64_t value_dim = value_shape_.dim_size(0);
     auto keys_data = keys->flat<K>();
     auto values_data = values->matrix<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      K key = it->first;
-      ValueArray value = it->second;
-      keys_data(i) = key;
-      for (int64_t j = 0; j < value_dim; j++) {
-        values_data(i, j) = value[j];
+    for (int64_t s = 0; s < table_.num_shards(); ++s) {
+      const Map& map = table_.shard_map(s);
+      for (auto it = map.begin(); it != map.end(); ++it) {
+        if (!it->second.admitted) continue;
+        keys_data(i) = it->first;
+        const ValueArray& value = it->second.value;
+        for (int64_t j = 0; j < value_dim; j++) {
+          values_data(i, j) = value[j];
+        }
+        ++i;
       }
     }
+    V* values_base = values->flat<V>().data();
+    for (const auto& store : spill_) {
+      TF_RETURN_IF_ERROR(store->ForEach([&](const K& key, const char* row) {
+        keys_data(i) = key;
+        std::memcpy(values_base + i * value_dim, row, value_dim * sizeof(V));
+        ++i;
+      }));
+    }
+    return OkStatus();
   }
 
   TensorShape value_shape_;
-  mutable mutex mu_;
-  typedef gtl::InlinedVector<V, 4> ValueArray;
-  std::unordered_map<K, ValueArray> table_ TF_GUARDED_BY(mu_);
+  int64_t max_size_ = 0;
+  int64_t min_frequency_ = 0;
+  bool evict_least_frequent_ = false;
+  std::string spill_dir_;
+  ShardedHashMap<K, Entry> table_;
+  std::unique_ptr<ShardClock[]> shard_clocks_;
+  // One store per shard, or none if the table does not spill.
+  std::vector<std::unique_ptr<SpillStore<K>>> spill_;
+  std::atomic<int64_t> num_pending_{0};
+  std::atomic<bool> eviction_scheduled_{false};
 };
 
 namespace {
 
-template <typename T>
-inline uint64 HashScalar(const T& key) {
-  return static_cast<uint64>(key);
-}
+// Control bytes of the "swiss" bucket layout of MutableDenseHashTable. Each
+// bucket has one control byte holding kCtrlEmpty, kCtrlDeleted or, for a full
+// bucket, a 7-bit tag taken from the key hash. Probing compares the tag
+// against a whole group of control bytes at once and only touches the key
+// tensor for buckets whose tag matches.
+typedef int8 ctrl_t;
+constexpr ctrl_t kCtrlEmpty = -128;
+constexpr ctrl_t kCtrlDeleted = -2;
+
+// Number of control bytes matched at once while probing.
+constexpr int kGroupWidth = 16;
+
+// A window of kGroupWidth consecutive control bytes. Uses SSE2 when available
+// and a portable loop otherwise.
+class CtrlGroup {
+ public:
+  explicit CtrlGroup(const ctrl_t* ctrl) {
+#ifdef __SSE2__
+    ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+    std::copy(ctrl, ctrl + kGroupWidth, ctrl_);
+#endif
+  }
 
-inline uint64 HashScalar(const tstring& key) { return Hash64(key); }
+  // Returns a bitmask of the positions whose control byte equals `tag`.
+  uint32 Match(ctrl_t tag) const {
+#ifdef __SSE2__
+    return static_cast<uint32>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl_)));
+#else
+    uint32 mask = 0;
+    for (int i = 0; i < kGroupWidth; ++i) {
+      if (ctrl_[i] == tag) mask |= 1u << i;
+    }
+    return mask;
+#endif
+  }
 
-// If the given shape is a scalar return {1} instead. Otherwise leave it alone.
-TensorShape MaybeVectorizeShape(const TensorShape& shape) {
-  if (shape.dims() == 0) {
-    return TensorShape({1});
+  // Returns a bitmask of the positions that are empty or deleted. Both special
+  // values are smaller than -1, while tags of full buckets are non-negative.
+  uint32 MatchEmptyOrDeleted() const {
+#ifdef __SSE2__
+    return static_cast<uint32>(
+        _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl_)));
+#else
+    uint32 mask = 0;
+    for (int i = 0; i < kGroupWidth; ++i) {
+      if (ctrl_[i] < -1) mask |= 1u << i;
+    }
+    return mask;
+#endif
   }
-  return shape;
-}
+
+ private:
+#ifdef __SSE2__
+  __m128i ctrl_;
+#else
+  ctrl_t ctrl_[kGroupWidth];
+#endif
+};
+
+// Minimum number of old buckets moved into the new bucket array by every
+// insert while an incremental rehash is in progress.
+constexpr int64_t kMinBucketsMigratedPerInsert = 1024;
 
 }  // namespace
 
 // Modeled after densehashtable in https://github.com/sparsehash/sparsehash
+//
+// The table supports two bucket layouts, selected by the "layout" attr:
+//
+// "quadratic" (the default) probes one bucket at a time with quadratic
+// probing, and grows by rehashing every entry at once.
+//
+// "swiss" keeps a control byte per bucket and probes groups of kGroupWidth
+// buckets with SIMD compares, as in Swiss tables. It grows incrementally: the
+// old bucket array is kept alongside the new one, and every subsequent insert
+// moves a bounded number of old buckets over, so no single insert pays for a
+// full rehash. Lookups consult both arrays while a rehash is in progress.
+// Exported tensors use the same format for both layouts, and both rebuild
+// their layout when importing them, so a checkpoint of one layout restores
+// into the other.
 template <class K, class V>
 class MutableDenseHashTable final : public LookupInterface {
  public:
@@ -439,6 +1565,13 @@ class MutableDenseHashTable final : public LookupInterface {
                     "max_load_factor must be between 0 and 1, got: ",
                     max_load_factor_));
 
+    std::string layout = "quadratic";
+    TryGetNodeAttr(kernel->def(), "layout", &layout);
+    OP_REQUIRES(ctx, layout == "quadratic" || layout == "swiss",
+                errors::InvalidArgument(
+                    "layout must be 'quadratic' or 'swiss', got: ", layout));
+    swiss_layout_ = (layout == "swiss");
+
     OP_REQUIRES_OK(ctx,
                    GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
     OP_REQUIRES(ctx,
@@ -533,6 +1666,27 @@ class MutableDenseHashTable final : public LookupInterface {
         return errors::InvalidArgument(
             "Using the deleted_key as a table key is not allowed");
       }
+      if (swiss_layout_) {
+        const uint64 hash = ScrambleHash(key_hash);
+        const Tensor* values = &value_buckets_;
+        int64_t bucket = SwissFind(key_buckets_, ctrl_, key_matrix, i, hash);
+        if (bucket < 0 && old_num_buckets_ > 0) {
+          values = &old_value_buckets_;
+          bucket = SwissFind(old_key_buckets_, old_ctrl_, key_matrix, i, hash);
+        }
+        if (bucket >= 0) {
+          const auto values_matrix = values->template matrix<V>();
+          for (int64_t j = 0; j < value_size; ++j) {
+            value_matrix(i, j) =
+                SubtleMustCopyIfIntegral(values_matrix(bucket, j));
+          }
+        } else {
+          for (int64_t j = 0; j < value_size; ++j) {
+            value_matrix(i, j) = SubtleMustCopyIfIntegral(default_flat(j));
+          }
+        }
+        continue;
+      }
       int64_t bucket_index = key_hash & bit_mask;
       int64_t num_probes = 0;
       while (true) {
@@ -574,6 +1728,10 @@ class MutableDenseHashTable final : public LookupInterface {
                                      key.shape().DebugString());
     }
     mutex_lock l(mu_);
+    // Every insert pays off part of a pending incremental rehash, at a rate
+    // that finishes it long before the table needs to grow again.
+    TF_RETURN_IF_ERROR(MigrateBuckets(
+        std::max<int64_t>(kMinBucketsMigratedPerInsert, 2 * batch_size)));
     // For simplicity we assume that all keys in the input result in inserts
     // rather than updates. That means we may grow the table even though we
     // don't need to. As long as the number of keys inserted in one call is
@@ -584,7 +1742,11 @@ class MutableDenseHashTable final : public LookupInterface {
       do {
         new_num_buckets <<= 1;
       } while (pending_num_entries > new_num_buckets * max_load_factor_);
-      TF_RETURN_IF_ERROR(Rebucket(ctx, new_num_buckets));
+      if (swiss_layout_) {
+        TF_RETURN_IF_ERROR(StartIncrementalRehash(ctx, new_num_buckets));
+      } else {
+        TF_RETURN_IF_ERROR(Rebucket(ctx, new_num_buckets));
+      }
     }
     return DoInsert(ctx, key, value, false);
   }
@@ -605,29 +1767,20 @@ class MutableDenseHashTable final : public LookupInterface {
   Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override TF_LOCKS_EXCLUDED(mu_) {
     mutex_lock l(mu_);
-    num_buckets_ = keys.dim_size(0);
-    key_buckets_ = keys;
-    value_buckets_ = values;
-    // Count the number of keys that are not the empty_key or deleted_key.
-    // This requires iterating through the whole table but that is OK as we
-    // only execute it during checkpoint restore.
-    num_entries_ = 0;
-    const auto empty_key_tensor =
-        empty_key_.template shaped<K, 2>({1, key_shape_.num_elements()});
-    const auto deleted_key_tensor =
-        deleted_key_.template shaped<K, 2>({1, key_shape_.num_elements()});
-    const auto key_buckets_tensor = key_buckets_.template matrix<K>();
-    for (int64_t i = 0; i < num_buckets_; ++i) {
-      if (!IsEqualKey(key_buckets_tensor, i, empty_key_tensor, 0) &&
-          !IsEqualKey(key_buckets_tensor, i, deleted_key_tensor, 0)) {
-        ++num_entries_;
-      }
-    }
-    return OkStatus();
+    // The imported buckets may have been laid out by either layout, whose
+    // probe sequences differ, so reinsert every entry instead of adopting the
+    // tensors. This visits every bucket, which is OK as we only execute it
+    // during checkpoint restore.
+    ResetIncrementalRehash();
+    TF_RETURN_IF_ERROR(AllocateBuckets(ctx, keys.dim_size(0)));
+    return DoInsert(ctx, keys, values, true);
   }
 
   Status ExportValues(OpKernelContext* ctx) override TF_LOCKS_EXCLUDED(mu_) {
-    tf_shared_lock l(mu_);
+    mutex_lock l(mu_);
+    // The exported tensors hold a single bucket array, so finish any pending
+    // incremental rehash first.
+    TF_RETURN_IF_ERROR(MigrateBuckets(old_num_buckets_));
     TF_RETURN_IF_ERROR(ctx->set_output("keys", key_buckets_));
     TF_RETURN_IF_ERROR(ctx->set_output("values", value_buckets_));
     return OkStatus();
@@ -669,7 +1822,10 @@ class MutableDenseHashTable final : public LookupInterface {
   int64_t MemoryUsed() const override TF_LOCKS_EXCLUDED(mu_) {
     tf_shared_lock l(mu_);
     return sizeof(MutableDenseHashTable) + key_buckets_.AllocatedBytes() +
-           value_buckets_.AllocatedBytes() + empty_key_.AllocatedBytes();
+           value_buckets_.AllocatedBytes() + empty_key_.AllocatedBytes() +
+           old_key_buckets_.AllocatedBytes() +
+           old_value_buckets_.AllocatedBytes() + ctrl_.capacity() +
+           old_ctrl_.capacity();
   }
 
  private:
@@ -707,6 +1863,11 @@ class MutableDenseHashTable final : public LookupInterface {
         return errors::InvalidArgument(
             "Using the deleted_key as a table key is not allowed");
       }
+      if (swiss_layout_) {
+        TF_RETURN_IF_ERROR(
+            SwissInsert(key_matrix, value_matrix, i, ScrambleHash(key_hash)));
+        continue;
+      }
       int64_t bucket_index = key_hash & bit_mask;
       int64_t num_probes = 0;
       while (true) {
@@ -768,6 +1929,10 @@ class MutableDenseHashTable final : public LookupInterface {
         return errors::InvalidArgument(
             "Using the deleted_key as a table key is not allowed");
       }
+      if (swiss_layout_) {
+        SwissRemove(key_matrix, i, ScrambleHash(key_hash));
+        continue;
+      }
       int64_t bucket_index = key_hash & bit_mask;
       int64_t num_probes = 0;
       while (true) {
@@ -794,7 +1959,11 @@ class MutableDenseHashTable final : public LookupInterface {
     return OkStatus();
   }
 
-  Status AllocateBuckets(OpKernelContext* ctx, int64_t new_num_buckets)
+  // Allocates `new_num_buckets` empty buckets. With `defer_initialization`,
+  // which only the "swiss" layout supports, only the control bytes are set
+  // and the key and value rows are left for InitializeBuckets().
+  Status AllocateBuckets(OpKernelContext* ctx, int64_t new_num_buckets,
+                         bool defer_initialization = false)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     if (new_num_buckets < 4 ||
         ((new_num_buckets & (new_num_buckets - 1)) != 0)) {
@@ -808,6 +1977,22 @@ class MutableDenseHashTable final : public LookupInterface {
     const int64_t key_size = key_shape_.num_elements();
     TF_RETURN_IF_ERROR(ctx->allocate_temp(
         key_dtype(), TensorShape({num_buckets_, key_size}), &key_buckets_));
+    const int64_t value_size = value_shape_.num_elements();
+    TF_RETURN_IF_ERROR(ctx->allocate_temp(
+        value_dtype(), TensorShape({num_buckets_, value_size}),
+        &value_buckets_));
+
+    if (swiss_layout_) {
+      // The control bytes of the first kGroupWidth - 1 buckets are mirrored
+      // past the end, so that a group can be loaded at any bucket index.
+      ctrl_.assign(num_buckets_ + kGroupWidth - 1, kCtrlEmpty);
+    }
+    if (defer_initialization) {
+      DCHECK(swiss_layout_);
+      num_initialized_buckets_ = 0;
+      return OkStatus();
+    }
+
     auto key_buckets_matrix = key_buckets_.matrix<K>();
     const auto empty_key_flat = empty_key_.template flat<K>();
     for (int64_t i = 0; i < num_buckets_; ++i) {
@@ -815,12 +2000,6 @@ class MutableDenseHashTable final : public LookupInterface {
         key_buckets_matrix(i, j) = empty_key_flat(j);
       }
     }
-
-    const int64_t value_size = value_shape_.num_elements();
-
-    TF_RETURN_IF_ERROR(ctx->allocate_temp(
-        value_dtype(), TensorShape({num_buckets_, value_size}),
-        &value_buckets_));
     auto value_buckets_matrix = value_buckets_.matrix<V>();
     for (int64_t i = 0; i < num_buckets_; ++i) {
       for (int64_t j = 0; j < value_size; ++j) {
@@ -829,9 +2008,37 @@ class MutableDenseHashTable final : public LookupInterface {
         value_buckets_matrix(i, j) = V();
       }
     }
+    num_initialized_buckets_ = num_buckets_;
     return OkStatus();
   }
 
+  // Initializes the key and value rows of the empty buckets among the first
+  // `end` buckets of a "swiss" layout table allocated with deferred
+  // initialization. Probing only reads the control bytes of empty buckets, so
+  // their rows only need to be set before they are exported. Buckets filled
+  // before their turn here already hold their entry and are left alone.
+  void InitializeBuckets(int64_t end) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    end = std::min(end, num_buckets_);
+    if (num_initialized_buckets_ >= end) {
+      return;
+    }
+    auto key_buckets_matrix = key_buckets_.template matrix<K>();
+    auto value_buckets_matrix = value_buckets_.template matrix<V>();
+    const auto empty_key_flat = empty_key_.template flat<K>();
+    for (int64_t i = num_initialized_buckets_; i < end; ++i) {
+      if (ctrl_[i] != kCtrlEmpty) {
+        continue;
+      }
+      for (int64_t j = 0; j < key_shape_.num_elements(); ++j) {
+        key_buckets_matrix(i, j) = empty_key_flat(j);
+      }
+      for (int64_t j = 0; j < value_shape_.num_elements(); ++j) {
+        value_buckets_matrix(i, j) = V();
+      }
+    }
+    num_initialized_buckets_ = end;
+  }
+
   Status Rebucket(OpKernelContext* ctx, int64_t num_new_buckets)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     Tensor old_key_buckets = key_buckets_;
@@ -840,7 +2047,211 @@ class MutableDenseHashTable final : public LookupInterface {
     return DoInsert(ctx, old_key_buckets, old_value_buckets, true);
   }
 
-  uint64 HashKey(typename TTypes<K>::ConstMatrix key, int64_t index) const {
+  // Starts growing a "swiss" layout table to `num_new_buckets` buckets. The
+  // current buckets become the old bucket array, which MigrateBuckets() then
+  // drains into the new one over the following inserts. Only the control
+  // bytes of the new array are set here; its key and value rows are
+  // initialized alongside the migration.
+  Status StartIncrementalRehash(OpKernelContext* ctx, int64_t num_new_buckets)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    // Growing again before the previous rehash has finished only happens when
+    // a single insert is larger than the table; finish that rehash first.
+    TF_RETURN_IF_ERROR(MigrateBuckets(old_num_buckets_));
+    old_key_buckets_ = key_buckets_;
+    old_value_buckets_ = value_buckets_;
+    old_ctrl_.swap(ctrl_);
+    old_num_buckets_ = num_buckets_;
+    migrate_pos_ = 0;
+    const int64_t num_entries = num_entries_;
+    TF_RETURN_IF_ERROR(
+        AllocateBuckets(ctx, num_new_buckets, /*defer_initialization=*/true));
+    num_entries_ = num_entries;
+    return OkStatus();
+  }
+
+  // Moves up to `max_buckets` buckets of the old bucket array into the current
+  // one, and releases the old array once it is empty. A no-op when no
+  // incremental rehash is in progress.
+  Status MigrateBuckets(int64_t max_buckets) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (old_num_buckets_ == 0) {
+      return OkStatus();
+    }
+    const Tensor& old_key_buckets = old_key_buckets_;
+    const Tensor& old_value_buckets = old_value_buckets_;
+    const auto old_keys = old_key_buckets.template matrix<K>();
+    const auto old_values = old_value_buckets.template matrix<V>();
+    const int64_t end = std::min(old_num_buckets_, migrate_pos_ + max_buckets);
+    // The new array is a power of two times larger than the old one; keep its
+    // initialization in step with the migration, so that both finish
+    // together.
+    InitializeBuckets(end * (num_buckets_ / old_num_buckets_));
+    for (; migrate_pos_ < end; ++migrate_pos_) {
+      if (old_ctrl_[migrate_pos_] < 0) {
+        continue;  // Empty or deleted.
+      }
+      // Keys live in exactly one of the two arrays, so the key cannot already
+      // be present in the current array.
+      TF_RETURN_IF_ERROR(SwissPlace(old_keys, old_values, migrate_pos_,
+                                    ScrambleHash(HashKey(old_keys,
+                                                         migrate_pos_))));
+      SetCtrl(&old_ctrl_, old_num_buckets_, migrate_pos_, kCtrlDeleted);
+    }
+    if (migrate_pos_ == old_num_buckets_) {
+      ResetIncrementalRehash();
+    }
+    return OkStatus();
+  }
+
+  // Drops the old bucket array of an incremental rehash.
+  void ResetIncrementalRehash() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    old_key_buckets_ = Tensor();
+    old_value_buckets_ = Tensor();
+    std::vector<ctrl_t>().swap(old_ctrl_);
+    old_num_buckets_ = 0;
+    migrate_pos_ = 0;
+  }
+
+  // Sets the control byte of `bucket`, including its mirrored copy if any.
+  static void SetCtrl(std::vector<ctrl_t>* ctrl, int64_t num_buckets,
+                      int64_t bucket, ctrl_t value) {
+    for (int64_t i = bucket; i < static_cast<int64_t>(ctrl->size());
+         i += num_buckets) {
+      (*ctrl)[i] = value;
+    }
+  }
+
+  // The tag stored in the control byte comes from the top 7 bits of the
+  // scrambled hash, and the probe sequence starts from the bits below the tag.
+  static ctrl_t SwissTag(uint64 hash) {
+    return static_cast<ctrl_t>(hash >> 57);
+  }
+  static int64_t SwissStart(uint64 hash, int64_t bit_mask) {
+    return (hash >> 7) & bit_mask;
+  }
+
+  // Returns the number of groups after which the probe sequence has visited
+  // every bucket of an array with `num_buckets` buckets. Groups start at
+  // offsets that grow by triangular multiples of kGroupWidth, which cover all
+  // group-aligned offsets when the number of buckets is a power of two.
+  static int64_t MaxGroupProbes(int64_t num_buckets) {
+    return std::max<int64_t>(1, num_buckets / kGroupWidth);
+  }
+
+  // Returns the bucket of the "swiss" layout bucket array (`key_buckets`,
+  // `ctrl`) that holds row `index` of `key_matrix`, or -1 if it is absent.
+  template <typename MT>
+  int64_t SwissFind(const Tensor& key_buckets, const std::vector<ctrl_t>& ctrl,
+                    MT key_matrix, int64_t index, uint64 hash) const {
+    const auto key_buckets_matrix = key_buckets.template matrix<K>();
+    const int64_t num_buckets = key_buckets.dim_size(0);
+    const int64_t bit_mask = num_buckets - 1;
+    const ctrl_t tag = SwissTag(hash);
+    int64_t pos = SwissStart(hash, bit_mask);
+    for (int64_t probe = 0; probe < MaxGroupProbes(num_buckets); ++probe) {
+      const CtrlGroup group(&ctrl[pos]);
+      for (uint32 match = group.Match(tag); match != 0; match &= match - 1) {
+        const int64_t bucket = (pos + absl::countr_zero(match)) & bit_mask;
+        if (IsEqualKey(key_buckets_matrix, bucket, key_matrix, index)) {
+          return bucket;
+        }
+      }
+      if (group.Match(kCtrlEmpty) != 0) {
+        return -1;
+      }
+      pos = (pos + (probe + 1) * kGroupWidth) & bit_mask;
+    }
+    return -1;
+  }
+
+  // Stores row `index` of `key_matrix` and `value_matrix` in the first empty
+  // or deleted bucket of its probe sequence in the current bucket array. The
+  // key must not be present in the table.
+  template <typename KMT, typename VMT>
+  Status SwissPlace(KMT key_matrix, VMT value_matrix, int64_t index,
+                    uint64 hash) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const int64_t bit_mask = num_buckets_ - 1;
+    int64_t pos = SwissStart(hash, bit_mask);
+    for (int64_t probe = 0; probe < MaxGroupProbes(num_buckets_); ++probe) {
+      const uint32 free = CtrlGroup(&ctrl_[pos]).MatchEmptyOrDeleted();
+      if (free != 0) {
+        const int64_t bucket = (pos + absl::countr_zero(free)) & bit_mask;
+        auto key_buckets_matrix = key_buckets_.template matrix<K>();
+        auto value_buckets_matrix = value_buckets_.template matrix<V>();
+        for (int64_t j = 0; j < key_shape_.num_elements(); ++j) {
+          key_buckets_matrix(bucket, j) =
+              SubtleMustCopyIfIntegral(key_matrix(index, j));
+        }
+        for (int64_t j = 0; j < value_shape_.num_elements(); ++j) {
+          value_buckets_matrix(bucket, j) =
+              SubtleMustCopyIfIntegral(value_matrix(index, j));
+        }
+        SetCtrl(&ctrl_, num_buckets_, bucket, SwissTag(hash));
+        return OkStatus();
+      }
+      pos = (pos + (probe + 1) * kGroupWidth) & bit_mask;
+    }
+    return errors::Internal("Internal error in MutableDenseHashTable insert");
+  }
+
+  // Inserts or updates one entry of a "swiss" layout table.
+  template <typename KMT, typename VMT>
+  Status SwissInsert(KMT key_matrix, VMT value_matrix, int64_t index,
+                     uint64 hash) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const int64_t bucket =
+        SwissFind(key_buckets_, ctrl_, key_matrix, index, hash);
+    if (bucket >= 0) {
+      auto value_buckets_matrix = value_buckets_.template matrix<V>();
+      for (int64_t j = 0; j < value_shape_.num_elements(); ++j) {
+        value_buckets_matrix(bucket, j) =
+            SubtleMustCopyIfIntegral(value_matrix(index, j));
+      }
+      return OkStatus();
+    }
+    TF_RETURN_IF_ERROR(SwissPlace(key_matrix, value_matrix, index, hash));
+    // A key still waiting in the old bucket array moves to the current one,
+    // which is an update rather than a new entry.
+    const int64_t old_bucket =
+        old_num_buckets_ > 0
+            ? SwissFind(old_key_buckets_, old_ctrl_, key_matrix, index, hash)
+            : -1;
+    if (old_bucket >= 0) {
+      SetCtrl(&old_ctrl_, old_num_buckets_, old_bucket, kCtrlDeleted);
+    } else {
+      ++num_entries_;
+    }
+    return OkStatus();
+  }
+
+  // Removes one entry of a "swiss" layout table, if present.
+  template <typename KMT>
+  void SwissRemove(KMT key_matrix, int64_t index, uint64 hash)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const int64_t bucket =
+        SwissFind(key_buckets_, ctrl_, key_matrix, index, hash);
+    if (bucket >= 0) {
+      auto key_buckets_matrix = key_buckets_.template matrix<K>();
+      const auto deleted_key_flat = deleted_key_.template flat<K>();
+      for (int64_t j = 0; j < key_shape_.num_elements(); ++j) {
+        key_buckets_matrix(bucket, j) = deleted_key_flat(j);
+      }
+      SetCtrl(&ctrl_, num_buckets_, bucket, kCtrlDeleted);
+      --num_entries_;
+      return;
+    }
+    if (old_num_buckets_ > 0) {
+      const int64_t old_bucket =
+          SwissFind(old_key_buckets_, old_ctrl_, key_matrix, index, hash);
+      if (old_bucket >= 0) {
+        SetCtrl(&old_ctrl_, old_num_buckets_, old_bucket, kCtrlDeleted);
+        --num_entries_;
+      }
+    }
+  }
+
+  // Use a template to allow this function to be used both with Matrix and
+  // ConstMatrix types.
+  template <typename MT>
+  uint64 HashKey(MT key, int64_t index) const {
     if (key_shape_.num_elements() == 1) {
       return HashScalar(key(index, 0));
     }
@@ -853,9 +2264,9 @@ class MutableDenseHashTable final : public LookupInterface {
 
   // Use a template to allow this function to be used both with Matrix and
   // ConstMatrix types.
-  template <typename MT2>
-  bool IsEqualKey(typename TTypes<K>::Matrix tensor1, int64_t index1,
-                  MT2 tensor2, int64_t index2) const {
+  template <typename MT1, typename MT2>
+  bool IsEqualKey(MT1 tensor1, int64_t index1, MT2 tensor2,
+                  int64_t index2) const {
     for (int64_t i = 0; i < key_shape_.num_elements(); ++i) {
       if (tensor1(index1, i) != tensor2(index2, i)) {
         return false;
@@ -867,11 +2278,25 @@ class MutableDenseHashTable final : public LookupInterface {
   TensorShape key_shape_;
   TensorShape value_shape_;
   float max_load_factor_;
+  bool swiss_layout_;
   mutable mutex mu_;
   int64_t num_entries_ TF_GUARDED_BY(mu_);
   int64_t num_buckets_ TF_GUARDED_BY(mu_);
   Tensor key_buckets_ TF_GUARDED_BY(mu_);
   Tensor value_buckets_ TF_GUARDED_BY(mu_);
+  // Control bytes of the "swiss" layout, empty for the "quadratic" one.
+  std::vector<ctrl_t> ctrl_ TF_GUARDED_BY(mu_);
+  // The bucket array being drained by an incremental rehash of a "swiss"
+  // layout table. Buckets before migrate_pos_ have been moved already;
+  // old_num_buckets_ is 0 when no rehash is in progress.
+  Tensor old_key_buckets_ TF_GUARDED_BY(mu_);
+  Tensor old_value_buckets_ TF_GUARDED_BY(mu_);
+  std::vector<ctrl_t> old_ctrl_ TF_GUARDED_BY(mu_);
+  int64_t old_num_buckets_ TF_GUARDED_BY(mu_) = 0;
+  int64_t migrate_pos_ TF_GUARDED_BY(mu_) = 0;
+  // The number of leading buckets whose key and value rows are initialized,
+  // which is less than num_buckets_ only during an incremental rehash.
+  int64_t num_initialized_buckets_ TF_GUARDED_BY(mu_) = 0;
   Tensor empty_key_;
   uint64 empty_key_hash_;
   Tensor deleted_key_;
@@ -1001,6 +2426,28 @@ class LookupTableRemoveOp : public LookupTableOpKernel {
 REGISTER_KERNEL_BUILDER(Name("LookupTableRemoveV2").Device(DEVICE_CPU),
                         LookupTableRemoveOp);
 
+// Table prefetch op.
+class LookupTablePrefetchOp : public LookupTableOpKernel {
+ public:
+  using LookupTableOpKernel::LookupTableOpKernel;
+
+  void Compute(OpKernelContext* ctx) override {
+    lookup::LookupInterface* table;
+    OP_REQUIRES_OK(ctx, GetTable(ctx, &table));
+    core::ScopedUnref unref_me(table);
+
+    DataTypeVector expected_inputs = {expected_input_0_, table->key_dtype()};
+    OP_REQUIRES_OK(ctx, ctx->MatchSignature(expected_inputs, {}));
+
+    const Tensor& key = ctx->input(1);
+    OP_REQUIRES_OK(ctx, table->CheckKeyTensorForRemove(key));
+    OP_REQUIRES_OK(ctx, table->Prefetch(ctx, key));
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("LookupTablePrefetch").Device(DEVICE_CPU),
+                        LookupTablePrefetchOp);
+
 // Op that returns the size of the given table.
 class LookupTableSizeOp : public LookupTableOpKernel {
  public:
@@ -1185,17 +2632,26 @@ REGISTER_KERNEL(tstring, int64_t);
           lookup::MutableHashTableOfTensors<key_dtype, value_dtype>,           \
           key_dtype, value_dtype>)
 
+REGISTER_KERNEL(int32, bfloat16);
 REGISTER_KERNEL(int32, double);
 REGISTER_KERNEL(int32, float);
+REGISTER_KERNEL(int32, Eigen::half);
+REGISTER_KERNEL(int32, int8);
 REGISTER_KERNEL(int32, int32);
+REGISTER_KERNEL(int64_t, bfloat16);
 REGISTER_KERNEL(int64_t, double);
 REGISTER_KERNEL(int64_t, float);
+REGISTER_KERNEL(int64_t, Eigen::half);
+REGISTER_KERNEL(int64_t, int8);
 REGISTER_KERNEL(int64_t, int32);
 REGISTER_KERNEL(int64_t, int64_t);
 REGISTER_KERNEL(int64_t, tstring);
+REGISTER_KERNEL(tstring, bfloat16);
 REGISTER_KERNEL(tstring, bool);
 REGISTER_KERNEL(tstring, double);
 REGISTER_KERNEL(tstring, float);
+REGISTER_KERNEL(tstring, Eigen::half);
+REGISTER_KERNEL(tstring, int8);
 REGISTER_KERNEL(tstring, int32);
 REGISTER_KERNEL(tstring, int64_t);
 
@@ -16,8 +16,11 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_SCATTER_FUNCTOR_H_
 #define TENSORFLOW_CORE_KERNELS_SCATTER_FUNCTOR_H_
 
+#include <algorithm>
 #include <type_traits>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "third_party/eigen3/Eigen/Core"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/bounds_check.h"
@@ -199,10 +202,118 @@ struct ScatterFunctorBase {
     return -1;
   }
 
+  // Estimates the number of distinct values in `indices` from the number of
+  // colliding pairs in an evenly strided sample of at most kSampleSize of
+  // them: with D roughly equally frequent values, about C(s, 2) / D pairs of
+  // an s-element sample collide. Returns N if no pair collides.
+  static Index EstimateNumUnique(typename TTypes<Index>::ConstFlat indices) {
+    constexpr Index kSampleSize = 1024;
+    const Index N = static_cast<Index>(indices.size());
+    const Index stride = std::max<Index>(N / kSampleSize, 1);
+    std::vector<Index> sample;
+    sample.reserve(std::min(N, kSampleSize));
+    for (Index i = 0; i < N && static_cast<Index>(sample.size()) < kSampleSize;
+         i += stride) {
+      sample.push_back(::tensorflow::internal::SubtleMustCopy(indices(i)));
+    }
+    std::sort(sample.begin(), sample.end());
+    double colliding_pairs = 0;
+    for (size_t begin = 0; begin < sample.size();) {
+      size_t end = begin + 1;
+      while (end < sample.size() && sample[end] == sample[begin]) ++end;
+      const double run = end - begin;
+      colliding_pairs += run * (run - 1) / 2;
+      begin = end;
+    }
+    if (colliding_pairs == 0) return N;
+    const double s = sample.size();
+    const double estimate = s * (s - 1) / 2 / colliding_pairs;
+    return estimate >= N ? N : static_cast<Index>(estimate);
+  }
+
+  // Sums the updates of repeated indices before applying them, so that each
+  // row of `params` is read and written once and without locking. Only valid
+  // for ADD and SUB. Returns false without modifying `params` if there are
+  // too few duplicates for this to pay off, judging first from a sample so
+  // that mostly unique indices never pay for the hash map; otherwise returns
+  // true and sets `*bad_i` as the other Execute methods would return it.
+  bool CoalescedExecute(OpKernelContext* c, const Device& d,
+                        typename TTypes<T>::Matrix params,
+                        typename TTypes<T>::ConstMatrix updates,
+                        typename TTypes<Index>::ConstFlat indices,
+                        Index* bad_i) {
+    const Index N = static_cast<Index>(indices.size());
+    const Index limit = static_cast<Index>(params.dimension(0));
+    // Only coalesce if at least a quarter of the indices are expected to be
+    // repeats, i.e. if no more than `max_unique` of them are distinct.
+    const Index max_unique = N / 4 * 3;
+    if (EstimateNumUnique(indices) > max_unique) return false;
+    // Slots are numbered in order of first occurrence of their index.
+    absl::flat_hash_map<Index, Index> slot_of_index;
+    slot_of_index.reserve(N);
+    std::vector<Index> slots(N);
+    std::vector<Index> unique_indices;
+    for (Index i = 0; i < N; ++i) {
+      const Index index = ::tensorflow::internal::SubtleMustCopy(indices(i));
+      if (!FastBoundsCheck(index, limit)) {
+        *bad_i = i;
+        return true;
+      }
+      auto it = slot_of_index.try_emplace(
+          index, static_cast<Index>(unique_indices.size()));
+      if (it.second) unique_indices.push_back(index);
+      slots[i] = it.first->second;
+    }
+    const Index num_unique = static_cast<Index>(unique_indices.size());
+    if (num_unique > max_unique) return false;
+
+    Tensor sums_t;
+    if (!c->allocate_temp(DataTypeToEnum<T>::value,
+                          TensorShape({num_unique, params.dimension(1)}),
+                          &sums_t)
+             .ok()) {
+      return false;
+    }
+    auto sums = sums_t.matrix<T>();
+    Index next_slot = 0;
+    for (Index i = 0; i < N; ++i) {
+      if (slots[i] == next_slot) {
+        sums.template chip<0>(next_slot++) = updates.template chip<0>(i);
+      } else {
+        sums.template chip<0>(slots[i]) += updates.template chip<0>(i);
+      }
+    }
+
+    auto ApplySums = [&](int64_t start, int64_t end) {
+      for (int64_t s = start; s < end; ++s) {
+        scatter_op::internal::Assign<op>::Run(
+            params.template chip<0>(unique_indices[s]),
+            sums.template chip<0>(s));
+      }
+    };
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *(c->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers, num_unique,
+          /*cost_per_unit=*/2.5f * params.dimension(1), ApplySums);
+    *bad_i = -1;
+    return true;
+  }
+
   Index operator()(OpKernelContext* c, const Device& d,
                    typename TTypes<T>::Matrix params,
                    typename TTypes<T>::ConstMatrix updates,
                    typename TTypes<Index>::ConstFlat indices) {
+    // Embedding gradients often hit the same rows many times; coalescing them
+    // first turns those into a single read-modify-write per row.
+    if constexpr (op == scatter_op::UpdateOp::ADD ||
+                  op == scatter_op::UpdateOp::SUB) {
+      const Index kMinCoalesceN = 1024;
+      Index bad_i;
+      if (indices.size() >= kMinCoalesceN &&
+          CoalescedExecute(c, d, params, updates, indices, &bad_i)) {
+        return bad_i;
+      }
+    }
 #ifdef PLATFORM_GOOGLE
     // The parallel version is significantly slower internally. Only call the
     // serial version for now.
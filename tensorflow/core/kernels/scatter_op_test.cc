@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cmath>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -217,6 +218,45 @@ TEST_F(ScatterSubOpTest, StressIndexTest) {
   test::ExpectTensorEqual<int32>(expected, params_tensor);
 }
 
+TEST_F(ScatterSubOpTest, CoalescedDuplicateIndices) {
+  MakeOp(DT_FLOAT_REF, DT_INT32);
+  // Enough repeated indices that the updates are summed per row before they
+  // are applied.
+  const int kNumUpdates = 3000;
+  std::vector<int32> indices(kNumUpdates);
+  std::vector<float> updates(kNumUpdates * 2);
+  for (int i = 0; i < kNumUpdates; ++i) {
+    indices[i] = (i % 3 == 0) ? 3 : i % 2;
+    updates[2 * i] = 1;
+    updates[2 * i + 1] = 0.5;
+  }
+  AddInputFromArray<float>(TensorShape({5, 2}), {0, 0, 0, 0, 0, 0, 0, 0, 7, 7});
+  AddInputFromArray<int32>(TensorShape({kNumUpdates}), indices);
+  AddInputFromArray<float>(TensorShape({kNumUpdates, 2}), updates);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor params_tensor = *mutable_input(0).tensor;
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({5, 2}));
+  test::FillValues<float>(&expected,
+                          {-1000, -500, -1000, -500, 0, 0, -1000, -500, 7, 7});
+  test::ExpectTensorEqual<float>(expected, params_tensor);
+}
+
+TEST_F(ScatterSubOpTest, CoalescedIndexOutOfRange) {
+  MakeOp(DT_FLOAT_REF, DT_INT32);
+  const int kNumUpdates = 2048;
+  std::vector<int32> indices(kNumUpdates, 1);
+  indices[kNumUpdates - 1] = 99;
+  AddInputFromArray<float>(TensorShape({2}), {0, 0});
+  AddInputFromArray<int32>(TensorShape({kNumUpdates}), indices);
+  AddInputFromArray<float>(TensorShape({kNumUpdates}),
+                           std::vector<float>(kNumUpdates, 1));
+  Status s = RunOpKernel();
+  EXPECT_TRUE(
+      absl::StrContains(s.ToString(), "indices[2047] = 99 is not in [0, 2)"))
+      << s;
+}
+
 TEST_F(ScatterUpdateOpTest, Error_WrongDimsIndices) {
   MakeOp(DT_FLOAT_REF, DT_INT32);
 
@@ -281,7 +321,8 @@ class ScatterUpdateBM : public ScatterUpdateOpTest {
 
 template <typename Index>
 void BM_ScatterHelper(::testing::benchmark::State& state, int embedding_size,
-                      const char* op, bool big_num_updates = false) {
+                      const char* op, bool big_num_updates = false,
+                      bool skewed = false) {
   const int kRows = 10000000 / embedding_size;
   std::vector<float> values;
   values.reserve(kRows);
@@ -294,7 +335,11 @@ void BM_ScatterHelper(::testing::benchmark::State& state, int embedding_size,
   std::vector<Index> indices;
   std::vector<float> updates;
   for (int i = 0; i < kNumUpdates; i++) {
-    indices.push_back(rnd.Uniform(kRows));
+    // Skewed indices concentrate on the first rows, like the IDs of popular
+    // items in embedding gradients.
+    indices.push_back(skewed ? static_cast<Index>(
+                                   std::pow(rnd.RandDouble(), 4) * kRows)
+                             : rnd.Uniform(kRows));
     for (int j = 0; j < embedding_size; j++) {
       updates.push_back(i * 10 + j);
     }
@@ -335,6 +380,11 @@ void BM_ScatterAddInt32Large(::testing::benchmark::State& state) {
 
   BM_ScatterHelper<int32>(state, embedding_size, "ScatterAdd", true);
 }
+void BM_ScatterAddInt32LargeSkewed(::testing::benchmark::State& state) {
+  const int embedding_size = state.range(0);
+
+  BM_ScatterHelper<int32>(state, embedding_size, "ScatterAdd", true, true);
+}
 void BM_ScatterAddInt64(::testing::benchmark::State& state) {
   const int embedding_size = state.range(0);
 
@@ -417,6 +467,13 @@ BENCHMARK(BM_ScatterAddInt32Large)
     ->Arg(256)
     ->Arg(1024);
 
+BENCHMARK(BM_ScatterAddInt32LargeSkewed)
+    ->Arg(1)
+    ->Arg(10)
+    ->Arg(64)
+    ->Arg(256)
+    ->Arg(1024);
+
 BENCHMARK(BM_ScatterAddInt64)->Arg(1)->Arg(10)->Arg(64)->Arg(256)->Arg(1024);
 
 BENCHMARK(BM_ScatterMulInt32)->Arg(1)->Arg(10)->Arg(64)->Arg(256)->Arg(1024);
@@ -17,6 +17,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/training_ops.h"
 
 #include <algorithm>  // NOLINT
+#include <vector>
 
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -25,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/variable_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/util.h"
 
 namespace tensorflow {
@@ -40,6 +42,60 @@ inline T sgn(const T x) {
   T one(1);
   return (x == zero ? zero : (x < zero ? -one : one));
 }
+
+// Returns the lock stripe guarding the variable row starting at `row`. The
+// stripes are shared by all kernels running with `row_striped_locking`, so
+// that concurrent steps updating the same variable serialize per row.
+mutex* RowStripe(const void* row) {
+  static constexpr int kLog2NumStripes = 10;
+  static mutex* stripes = new mutex[1 << kLog2NumStripes];
+  const uint64 addr = reinterpret_cast<uintptr_t>(row) >> 4;
+  return &stripes[(addr * 0x9E3779B97F4A7C15ull) >> (64 - kLog2NumStripes)];
+}
+
+// Calls `update_fn(i, rows[i])` for every position `i` of `rows`, holding the
+// lock stripe of row `rows[i]` of `var_data`. Positions are bucketed by row
+// range so that each row is updated by exactly one shard, in the order in
+// which it appears in `rows`. `rows` must hold the indices copied once from
+// the input and checked to be in bounds, so that they cannot change between
+// the check and the update.
+template <typename Tindex, typename UpdateFn>
+void ParallelForRowStriped(const CPUDevice& d, const std::vector<Tindex>& rows,
+                           Tindex num_rows, const char* var_data,
+                           int64_t row_bytes, const Eigen::TensorOpCost& cost,
+                           const UpdateFn& update_fn) {
+  const Tindex N = static_cast<Tindex>(rows.size());
+  const int64_t num_shards =
+      std::min<int64_t>(N, std::max(1, d.numThreads()) * 4);
+  const int64_t rows_per_shard = (num_rows + num_shards - 1) / num_shards;
+
+  // Counting sort of the positions by shard; stable, so duplicates of a row
+  // keep their relative order.
+  std::vector<Tindex> shard_starts(num_shards + 1, 0);
+  for (Tindex i = 0; i < N; ++i) {
+    ++shard_starts[rows[i] / rows_per_shard + 1];
+  }
+  for (int64_t s = 0; s < num_shards; ++s) {
+    shard_starts[s + 1] += shard_starts[s];
+  }
+  std::vector<Tindex> order(N);
+  {
+    std::vector<Tindex> next(shard_starts.begin(), shard_starts.end() - 1);
+    for (Tindex i = 0; i < N; ++i) {
+      order[next[rows[i] / rows_per_shard]++] = i;
+    }
+  }
+
+  d.parallelFor(num_shards, cost * (static_cast<double>(N) / num_shards),
+                [&](Index begin, Index end) {
+                  for (Tindex k = shard_starts[begin]; k < shard_starts[end];
+                       ++k) {
+                    const Tindex i = order[k];
+                    mutex_lock l(*RowStripe(var_data + rows[i] * row_bytes));
+                    update_fn(i, rows[i]);
+                  }
+                });
+}
 }  // namespace
 
 namespace functor {
@@ -164,6 +220,10 @@ struct ApplyAdagradV2<CPUDevice, T> {
 
 template <typename T, typename Tindex, bool has_epsilon>
 struct SparseApplyAdagrad<CPUDevice, T, Tindex, has_epsilon> {
+  // If true, rows are sharded by range and guarded by `RowStripe` instead of
+  // relying on the caller's variable lock.
+  bool row_striped = false;
+
   Status operator()(const CPUDevice& d, typename TTypes<T>::Matrix var,
                     typename TTypes<T>::Matrix accum,
                     typename TTypes<T>::ConstScalar lr,
@@ -181,61 +241,59 @@ struct SparseApplyAdagrad<CPUDevice, T, Tindex, has_epsilon> {
                                     Eigen::TensorOpCost::MulCost<T>() * 2);
     const Eigen::TensorOpCost cost(in_bytes, out_bytes, cycles);
 
-    if (inner_dim > 1) {
-      for (Tindex i = 0; i < N; ++i) {
-        const Tindex index = internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, first_dim_size)) {
-          return errors::InvalidArgument(
-              strings::StrCat("Index ", index, " at offset ", i,
-                              " in indices is out of range"));
-        }
+    // With row striping, the checked copies of the indices are kept and used
+    // for the updates as well.
+    std::vector<Tindex> rows(row_striped ? N : 0);
+    for (Tindex i = 0; i < N; ++i) {
+      const Tindex index = internal::SubtleMustCopy(indices(i));
+      if (!FastBoundsCheck(index, first_dim_size)) {
+        return errors::InvalidArgument(
+            strings::StrCat("Index ", index, " at offset ", i,
+                            " in indices is out of range"));
       }
-
-      const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-        for (Tindex i = start_idx; i < end_idx; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices(i));
-          auto a = accum.template chip<0>(index);
-          auto g = grad.template chip<0>(i);
-          auto v = var.template chip<0>(index);
-          if (update_slots) {
-            a += g.square();
-          }
-          if (has_epsilon) {
-            v -= g.constant(lr_scalar) * g / (a.sqrt() + a.constant(epsilon()));
-          } else {
-            v -= g.constant(lr_scalar) * g * a.rsqrt();
+      if (row_striped) rows[i] = index;
+    }
+    const auto run = [&](const auto& update) {
+      if (row_striped) {
+        ParallelForRowStriped<Tindex>(
+            d, rows, first_dim_size, reinterpret_cast<const char*>(var.data()),
+            inner_dim * sizeof(T), cost, update);
+      } else {
+        d.parallelFor(N, cost, [&](Tindex start_idx, Tindex end_idx) {
+          for (Tindex i = start_idx; i < end_idx; ++i) {
+            update(i, internal::SubtleMustCopy(indices(i)));
           }
-        }
-      };
+        });
+      }
+    };
 
-      d.parallelFor(N, cost, shard);
+    if (inner_dim > 1) {
+      run([&](Tindex i, Tindex index) {
+        auto a = accum.template chip<0>(index);
+        auto g = grad.template chip<0>(i);
+        auto v = var.template chip<0>(index);
+        if (update_slots) {
+          a += g.square();
+        }
+        if (has_epsilon) {
+          v -= g.constant(lr_scalar) * g / (a.sqrt() + a.constant(epsilon()));
+        } else {
+          v -= g.constant(lr_scalar) * g * a.rsqrt();
+        }
+      });
     } else {
-      for (Tindex i = 0; i < N; ++i) {
-        const Tindex index = internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, first_dim_size)) {
-          return errors::InvalidArgument(
-              strings::StrCat("Index ", index, " at offset ", i,
-                              " in indices is out of range"));
+      run([&](Tindex i, Tindex index) {
+        T& a = accum(index);
+        const T& g = grad(i);
+        if (update_slots) {
+          a += g * g;
         }
-      }
-
-      const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-        for (Tindex i = start_idx; i < end_idx; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices(i));
-          T& a = accum(index);
-          const T& g = grad(i);
-          if (update_slots) {
-            a += g * g;
-          }
-          if (has_epsilon) {
-            var(index) -= lr_scalar * g / (Eigen::numext::sqrt(a) + epsilon());
-          } else {
-            var(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
-          }
+        if (has_epsilon) {
+          var(index) -= lr_scalar * g / (Eigen::numext::sqrt(a) + epsilon());
+        } else {
+          var(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
         }
-      };
-
-      d.parallelFor(N, cost, shard);
+      });
     }
 
     return OkStatus();
@@ -587,6 +645,10 @@ void ComputeFtrl(GradTy grad,
 
 template <typename T, typename Tindex, bool has_l2_shrinkage>
 struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
+  // If true, rows are sharded by range and guarded by `RowStripe` instead of
+  // being updated serially under the caller's variable lock.
+  bool row_striped = false;
+
   Status operator()(const CPUDevice& d, typename TTypes<T>::Matrix var_flat,
                     typename TTypes<T>::Matrix accum_flat,
                     typename TTypes<T>::Matrix linear_flat,
@@ -608,10 +670,11 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
         l2_shrinkage_scalar = l2_shrinkage();
       }
       T lr_power_scalar = lr_power();
-      if (inner_dim > 1) {
-        const Tindex first_dim_size =
-            static_cast<Tindex>(var_flat.dimension(0));
-
+      const Tindex first_dim_size = static_cast<Tindex>(var_flat.dimension(0));
+      // The checked copies of the indices are used for the updates as well.
+      std::vector<Tindex> rows;
+      if (row_striped) {
+        rows.resize(N);
         for (Tindex i = 0; i < N; i++) {
           const Tindex index = internal::SubtleMustCopy(indices_vec(i));
           if (!FastBoundsCheck(index, first_dim_size)) {
@@ -619,6 +682,18 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
                 strings::StrCat("Index ", index, " at offset ", i,
                                 " in indices is out of range"));
           }
+          rows[i] = index;
+        }
+      }
+      const Eigen::TensorOpCost cost(
+          inner_dim * sizeof(T) * 4, inner_dim * sizeof(T) * 3,
+          inner_dim * (Eigen::TensorOpCost::AddCost<T>() * 6 +
+                       Eigen::TensorOpCost::MulCost<T>() * 6 +
+                       Eigen::TensorOpCost::DivCost<T>() * 2));
+      const char* var_data = reinterpret_cast<const char*>(var_flat.data());
+
+      if (inner_dim > 1) {
+        const auto update = [&](Tindex i, Tindex index) {
           auto accum = accum_flat.template chip<0>(index);
           auto linear = linear_flat.template chip<0>(index);
           auto grad = grad_flat.template chip<0>(i);
@@ -642,10 +717,13 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
                         /*lr_power_scalar=*/lr_power_scalar,
                         /*lr_scalar=*/lr_scalar);
           }
-        }
-      } else {
-        const Tindex first_dim_size = accum_flat.size();
+        };
 
+        if (row_striped) {
+          ParallelForRowStriped<Tindex>(d, rows, first_dim_size, var_data,
+                                        inner_dim * sizeof(T), cost, update);
+          return OkStatus();
+        }
         for (Tindex i = 0; i < N; i++) {
           const Tindex index = internal::SubtleMustCopy(indices_vec(i));
           if (!FastBoundsCheck(index, first_dim_size)) {
@@ -653,6 +731,10 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
                 strings::StrCat("Index ", index, " at offset ", i,
                                 " in indices is out of range"));
           }
+          update(i, index);
+        }
+      } else {
+        const auto update = [&](Tindex i, Tindex index) {
           T& a = accum_flat(index);
           T& l = linear_flat(index);
           T& v = var_flat(index);
@@ -676,6 +758,21 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
                           lr_power_scalar, multiply_linear_by_lr);
           a = updated_a;
           l = updated_l;
+        };
+
+        if (row_striped) {
+          ParallelForRowStriped<Tindex>(d, rows, first_dim_size, var_data,
+                                        sizeof(T), cost, update);
+          return OkStatus();
+        }
+        for (Tindex i = 0; i < N; i++) {
+          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
+          if (!FastBoundsCheck(index, first_dim_size)) {
+            return errors::InvalidArgument(
+                strings::StrCat("Index ", index, " at offset ", i,
+                                " in indices is out of range"));
+          }
+          update(i, index);
         }
       }
     }
@@ -1884,6 +1981,14 @@ class SparseApplyAdagradOp : public OpKernel {
   explicit SparseApplyAdagradOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("use_locking", &use_exclusive_lock_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("update_slots", &update_slots_));
+    if (ctx->HasAttr("row_striped_locking")) {
+      OP_REQUIRES_OK(
+          ctx, ctx->GetAttr("row_striped_locking", &row_striped_locking_));
+    }
+    // Row-striped updates only hold the variable lock shared.
+    if (std::is_same<Device, CPUDevice>::value && row_striped_locking_) {
+      use_exclusive_lock_ = false;
+    }
   }
 
   void Compute(OpKernelContext* ctx) override TF_NO_THREAD_SAFETY_ANALYSIS {
@@ -1939,9 +2044,13 @@ class SparseApplyAdagradOp : public OpKernel {
                     "Inner dimension should be greater than zero."));
 
     const Device& device = ctx->template eigen_device<Device>();
+    functor::SparseApplyAdagrad<Device, T, Tindex, /*has_epsilon = */ false>
+        functor;
+    if constexpr (std::is_same<Device, CPUDevice>::value) {
+      functor.row_striped = row_striped_locking_;
+    }
     OP_REQUIRES_OK(
-        ctx, functor::SparseApplyAdagrad<Device, T, Tindex,
-                                         /*has_epsilon = */ false>()(
+        ctx, functor(
                  device, var.flat_outer_dims<T>(), accum.flat_outer_dims<T>(),
                  // Note: Passing lr as a placeholder for unused epsilon.
                  lr.scalar<T>(), lr.scalar<T>(), grad.flat_outer_dims<T>(),
@@ -1953,6 +2062,7 @@ class SparseApplyAdagradOp : public OpKernel {
  private:
   bool use_exclusive_lock_;
   bool update_slots_;
+  bool row_striped_locking_ = false;
 };
 
 #define REGISTER_KERNELS(D, T, Tindices)                                 \
@@ -2014,6 +2124,14 @@ class SparseApplyAdagradV2Op : public OpKernel {
   explicit SparseApplyAdagradV2Op(OpKernelConstruction* ctx) : OpKernel(ctx) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("use_locking", &use_exclusive_lock_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("update_slots", &update_slots_));
+    if (ctx->HasAttr("row_striped_locking")) {
+      OP_REQUIRES_OK(
+          ctx, ctx->GetAttr("row_striped_locking", &row_striped_locking_));
+    }
+    // Row-striped updates only hold the variable lock shared.
+    if (std::is_same<Device, CPUDevice>::value && row_striped_locking_) {
+      use_exclusive_lock_ = false;
+    }
   }
 
   void Compute(OpKernelContext* ctx) override TF_NO_THREAD_SAFETY_ANALYSIS {
@@ -2073,9 +2191,13 @@ class SparseApplyAdagradV2Op : public OpKernel {
                     "Inner dimension should be greater than zero."));
 
     const Device& device = ctx->template eigen_device<Device>();
+    functor::SparseApplyAdagrad<Device, T, Tindex, /*has_epsilon = */ true>
+        functor;
+    if constexpr (std::is_same<Device, CPUDevice>::value) {
+      functor.row_striped = row_striped_locking_;
+    }
     OP_REQUIRES_OK(
-        ctx, functor::SparseApplyAdagrad<Device, T, Tindex,
-                                         /*has_epsilon = */ true>()(
+        ctx, functor(
                  device, var.flat_outer_dims<T>(), accum.flat_outer_dims<T>(),
                  lr.scalar<T>(), epsilon.scalar<T>(), grad.flat_outer_dims<T>(),
                  indices.vec<Tindex>(), inner_dim, update_slots_));
@@ -2086,6 +2208,7 @@ class SparseApplyAdagradV2Op : public OpKernel {
  private:
   bool use_exclusive_lock_;
   bool update_slots_;
+  bool row_striped_locking_ = false;
 };
 
 #define REGISTER_KERNELS(D, T, Tindices)                                   \
@@ -2802,6 +2925,14 @@ class SparseApplyFtrlOp : public OpKernel {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("use_locking", &use_exclusive_lock_));
     OP_REQUIRES_OK(
         ctx, ctx->GetAttr("multiply_linear_by_lr", &multiply_linear_by_lr_));
+    if (ctx->HasAttr("row_striped_locking")) {
+      OP_REQUIRES_OK(
+          ctx, ctx->GetAttr("row_striped_locking", &row_striped_locking_));
+    }
+    // Row-striped updates only hold the variable lock shared.
+    if (std::is_same<Device, CPUDevice>::value && row_striped_locking_) {
+      use_exclusive_lock_ = false;
+    }
   }
 
   void Compute(OpKernelContext* ctx) override TF_NO_THREAD_SAFETY_ANALYSIS {
@@ -2919,8 +3050,12 @@ class SparseApplyFtrlOp : public OpKernel {
 
     const Device& device = ctx->template eigen_device<Device>();
     auto indices_vec = indices.vec<Tindex>();
+    functor::SparseApplyFtrl<Device, T, Tindex, has_l2_shrinkage> functor;
+    if constexpr (std::is_same<Device, CPUDevice>::value) {
+      functor.row_striped = row_striped_locking_;
+    }
     OP_REQUIRES_OK(
-        ctx, functor::SparseApplyFtrl<Device, T, Tindex, has_l2_shrinkage>()(
+        ctx, functor(
                  device, var.flat_outer_dims<T>(), accum.flat_outer_dims<T>(),
                  linear.flat_outer_dims<T>(), lr.scalar<T>(), l1.scalar<T>(),
                  l2.scalar<T>(),
@@ -2936,6 +3071,7 @@ class SparseApplyFtrlOp : public OpKernel {
  private:
   bool use_exclusive_lock_;
   bool multiply_linear_by_lr_;
+  bool row_striped_locking_ = false;
 };
 
 #define REGISTER_KERNELS(D, T, Tindices)                                      \
@@ -13,9 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <functional>
+#include <limits>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/framework/bounds_check.h"
@@ -26,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace {
@@ -68,6 +73,162 @@ struct UniqueOpHashMap<bfloat16, TIndex> {
   using map_type = std::unordered_map<bfloat16, TIndex>;
 };
 
+// Inputs with fewer elements than this are uniquified on the calling thread;
+// below it the cost of the extra passes outweighs the parallel speedup.
+constexpr int64_t kParallelUniqueMinSize = 1 << 17;
+
+// Upper bound on the number of hash partitions, so that partition ids fit in
+// the low bits of a uint16 next to `kFirstOccurrenceBit`.
+constexpr int kMaxParallelUniquePartitions = 256;
+constexpr uint16 kFirstOccurrenceBit = 0x8000;
+
+// Only integral keys take the parallel path: the floating-point maps above
+// rely on `std::unordered_map` semantics for `NaN` and signed zeros, and
+// strings and bools gain little from it.
+template <typename T>
+constexpr bool SupportsParallelUnique() {
+  return std::is_integral<T>::value && !std::is_same<T, bool>::value;
+}
+
+// Computes the same `y` and `idx` outputs as the sequential 1-D loop in
+// `UniqueOp`, using `num_partitions` threads of the intra-op pool. Each key is
+// assigned to a partition by hash, so every partition can be uniquified by one
+// thread with a private, cache-sized map. The order of `y` is recovered
+// afterwards from the positions of first occurrences, which keeps the output
+// identical to the sequential implementation.
+//
+// The input is processed in `num_partitions` contiguous chunks:
+//  1. Each chunk computes the partition of its elements and counts them per
+//     partition.
+//  2. Each chunk scatters its positions into per-partition position lists,
+//     which are therefore in increasing order.
+//  3. Each partition builds its map in position order, writes partition-local
+//     ids into `idx` and flags first occurrences.
+//  4. Each chunk numbers its first occurrences, starting at the number of
+//     first occurrences in the preceding chunks, and writes them to `y`.
+//  5. Each chunk translates the local ids in `idx` to those global ids.
+//
+// REQUIRES: input.NumElements() <= std::numeric_limits<TIndex>::max().
+template <typename T, typename TIndex>
+Status ParallelUnique(OpKernelContext* context, const Tensor& input,
+                      int num_partitions, TIndex* idx, int64_t* uniq_size) {
+  thread::ThreadPool* workers =
+      context->device()->tensorflow_cpu_worker_threads()->workers;
+  const T* in = input.flat<T>().data();
+  const int64_t n = input.NumElements();
+  const int num_chunks = num_partitions;
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  auto chunk_begin = [&](int64_t c) { return std::min(c * chunk_size, n); };
+  // Runs `fn(task)` for every task in `[0, num_tasks)`, one task per shard.
+  auto parallel_for = [&](int64_t num_tasks,
+                          const std::function<void(int64_t)>& fn) {
+    workers->ParallelFor(num_tasks, /*cost_per_unit=*/chunk_size * 100,
+                         [&fn](int64_t begin, int64_t end) {
+                           for (int64_t task = begin; task < end; ++task) {
+                             fn(task);
+                           }
+                         });
+  };
+  auto partition_of = [num_partitions](const T& key) {
+    const uint64 h =
+        static_cast<uint64>(hash<T>{}(key)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<uint16>(((h >> 32) * num_partitions) >> 32);
+  };
+
+  // `counts[c * num_partitions + p]` is the number of elements of chunk `c`
+  // in partition `p`, and becomes the write offset of that pair in step 2.
+  std::vector<int64_t> counts(num_chunks * num_partitions, 0);
+  std::vector<uint16> partitions(n);
+  parallel_for(num_chunks, [&](int64_t c) {
+    int64_t* chunk_counts = &counts[c * num_partitions];
+    for (int64_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+      partitions[i] = partition_of(in[i]);
+      ++chunk_counts[partitions[i]];
+    }
+  });
+
+  std::vector<int64_t> partition_begin(num_partitions + 1, 0);
+  int64_t offset = 0;
+  for (int p = 0; p < num_partitions; ++p) {
+    partition_begin[p] = offset;
+    for (int c = 0; c < num_chunks; ++c) {
+      const int64_t count = counts[c * num_partitions + p];
+      counts[c * num_partitions + p] = offset;
+      offset += count;
+    }
+  }
+  partition_begin[num_partitions] = n;
+
+  std::vector<TIndex> positions(n);
+  parallel_for(num_chunks, [&](int64_t c) {
+    int64_t* offsets = &counts[c * num_partitions];
+    for (int64_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+      positions[offsets[partitions[i]]++] = static_cast<TIndex>(i);
+    }
+  });
+
+  // `first_counts[c * num_partitions + p]` is the number of first occurrences
+  // of partition `p` keys in chunk `c`.
+  std::vector<int64_t> first_counts(num_chunks * num_partitions, 0);
+  std::vector<int64_t> partition_uniq_size(num_partitions);
+  parallel_for(num_partitions, [&](int64_t p) {
+    const int64_t begin = partition_begin[p];
+    const int64_t end = partition_begin[p + 1];
+    typename UniqueOpHashMap<T, TIndex>::map_type uniq;
+    uniq.reserve(2 * (end - begin));
+    TIndex j = 0;
+    for (int64_t k = begin; k < end; ++k) {
+      const int64_t i = positions[k];
+      auto it = uniq.emplace(in[i], j);
+      idx[i] = it.first->second;
+      if (it.second) {
+        ++j;
+        partitions[i] |= kFirstOccurrenceBit;
+        ++first_counts[(i / chunk_size) * num_partitions + p];
+      }
+    }
+    partition_uniq_size[p] = j;
+  });
+
+  std::vector<int64_t> chunk_first_id(num_chunks + 1, 0);
+  for (int c = 0; c < num_chunks; ++c) {
+    chunk_first_id[c + 1] = chunk_first_id[c];
+    for (int p = 0; p < num_partitions; ++p) {
+      chunk_first_id[c + 1] += first_counts[c * num_partitions + p];
+    }
+  }
+  *uniq_size = chunk_first_id[num_chunks];
+
+  TensorShape output_shape(input.shape());
+  output_shape.set_dim(0, *uniq_size);
+  Tensor* output = nullptr;
+  TF_RETURN_IF_ERROR(context->allocate_output(0, output_shape, &output));
+  T* out = output->flat<T>().data();
+
+  // `global_ids[p][j]` is the output position of the key with local id `j` in
+  // partition `p`.
+  std::vector<std::vector<TIndex>> global_ids(num_partitions);
+  for (int p = 0; p < num_partitions; ++p) {
+    global_ids[p].resize(partition_uniq_size[p]);
+  }
+  parallel_for(num_chunks, [&](int64_t c) {
+    int64_t id = chunk_first_id[c];
+    for (int64_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+      if (partitions[i] & kFirstOccurrenceBit) {
+        global_ids[partitions[i] & ~kFirstOccurrenceBit][idx[i]] = id;
+        out[id] = in[i];
+        ++id;
+      }
+    }
+  });
+  parallel_for(num_chunks, [&](int64_t c) {
+    for (int64_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+      idx[i] = global_ids[partitions[i] & ~kFirstOccurrenceBit][idx[i]];
+    }
+  });
+  return OkStatus();
+}
+
 // `UniqueOp` computes the unique elements in the input tensor.
 //
 // * `T` is the element type.
@@ -150,6 +311,21 @@ class UniqueOp : public OpKernel {
       auto Tin = input.flat<T>();
       const int64_t N = static_cast<int64_t>(Tin.size());
 
+      if constexpr (SupportsParallelUnique<T>()) {
+        const int num_partitions = std::min(
+            context->device()->tensorflow_cpu_worker_threads()->num_threads,
+            kMaxParallelUniquePartitions);
+        // Positions are stored as TIndex; larger inputs take the serial path.
+        if (N >= kParallelUniqueMinSize && num_partitions > 1 &&
+            N <= std::numeric_limits<TIndex>::max()) {
+          OP_REQUIRES_OK(context, (ParallelUnique<T, TIndex>(
+                                      context, input, num_partitions,
+                                      idx_vec.data(), &uniq_size)));
+          ComputeCounts(context, *idx, uniq_size);
+          return;
+        }
+      }
+
       typename UniqueOpHashMap<T, TIndex>::map_type uniq;
       uniq.reserve(2 * N);
       for (Eigen::Index i = 0, j = 0; i < N; ++i) {
@@ -225,7 +401,15 @@ class UniqueOp : public OpKernel {
       }
     }
 
+    ComputeCounts(context, *idx, uniq_size);
+  }
+
+ private:
+  // Produces the `count` output of the UniqueWithCounts ops.
+  void ComputeCounts(OpKernelContext* context, const Tensor& idx,
+                     int64_t uniq_size) {
     if (num_outputs() > 2) {
+      auto idx_vec = idx.vec<TIndex>();
       Tensor* output = nullptr;
       OP_REQUIRES_OK(context, context->allocate_output(
                                   2, TensorShape({uniq_size}), &output));
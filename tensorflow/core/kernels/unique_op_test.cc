@@ -13,12 +13,18 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <functional>
 #include <memory>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -28,6 +34,8 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -37,6 +45,51 @@ namespace {
 
 const int kMaxStrLen = 40;
 
+class UniqueOpTest : public OpsTestBase {};
+
+// Large enough to take the hash-partitioned path when the device has more
+// than one intra-op thread; the result must match the first-occurrence order
+// of the sequential implementation.
+TEST_F(UniqueOpTest, LargeInt64InputKeepsFirstOccurrenceOrder) {
+  TF_ASSERT_OK(NodeDefBuilder("unique", "UniqueWithCounts")
+                   .Input(FakeInput(DT_INT64))
+                   .Attr("out_idx", DT_INT32)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+
+  constexpr int kDim = 1 << 20;
+  constexpr int kNumUnique = 5000;
+  std::vector<int64_t> input(kDim);
+  random::PhiloxRandom philox(7, 11);
+  random::SimplePhilox rnd(&philox);
+  for (int i = 0; i < kDim; ++i) {
+    input[i] = static_cast<int64_t>(rnd.Uniform(kNumUnique)) - kNumUnique / 2;
+  }
+  AddInputFromArray<int64_t>(TensorShape({kDim}), input);
+  TF_ASSERT_OK(RunOpKernel());
+
+  std::vector<int64_t> expected_y;
+  std::vector<int32> expected_idx(kDim);
+  std::vector<int32> expected_count;
+  absl::flat_hash_map<int64_t, int32> ids;
+  for (int i = 0; i < kDim; ++i) {
+    auto it = ids.emplace(input[i], expected_y.size());
+    if (it.second) {
+      expected_y.push_back(input[i]);
+      expected_count.push_back(0);
+    }
+    expected_idx[i] = it.first->second;
+    ++expected_count[it.first->second];
+  }
+  const int64_t num_unique = expected_y.size();
+  test::ExpectTensorEqual<int64_t>(
+      *GetOutput(0), test::AsTensor<int64_t>(expected_y, {num_unique}));
+  test::ExpectTensorEqual<int32>(*GetOutput(1),
+                                 test::AsTensor<int32>(expected_idx, {kDim}));
+  test::ExpectTensorEqual<int32>(
+      *GetOutput(2), test::AsTensor<int32>(expected_count, {num_unique}));
+}
+
 TensorProto GetRandomInt32TensorProto(int dim, int max_int) {
   TensorProto tensor_proto;
   tensor_proto.set_dtype(DT_INT32);
@@ -111,6 +164,38 @@ void BM_Unique_INT32_Repeat(::testing::benchmark::State& state) {
                           sizeof(int32));
 }
 
+// Uniquifies `dim` int64 ids, of which `unique_percent` percent are distinct,
+// with the default executor so that the kernel can use the intra-op pool.
+void BM_Unique_INT64_DuplicateRatio(::testing::benchmark::State& state) {
+  const int dim = state.range(0);
+  const int unique_percent = state.range(1);
+  const int64_t num_unique =
+      std::max<int64_t>(1, static_cast<int64_t>(dim) * unique_percent / 100);
+
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor input(DT_INT64, TensorShape({dim}));
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  auto input_vec = input.vec<int64_t>();
+  for (int i = 0; i < dim; ++i) {
+    // Spread the ids over the int64 range, as hashed feature ids are.
+    input_vec(i) = static_cast<int64_t>(rnd.Uniform64(num_unique) *
+                                        0x9E3779B97F4A7C15ull);
+  }
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Unique")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("T", DT_INT64)
+                  .Finalize(g, &node));
+  FixupSourceAndSinkEdges(g);
+
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * dim *
+                          sizeof(int64_t));
+}
+
 TensorProto GetRandomStringsTensorProto(int dim, int max_str_len) {
   TensorProto tensor_proto;
   tensor_proto.set_dtype(DT_STRING);
@@ -193,6 +278,21 @@ BENCHMARK(BM_Unique_INT32_Repeat)
     ->ArgPair(64 * 1024, 64 * 1024 * 1024)
     ->ArgPair(1024 * 1024, 64 * 1024 * 1024);
 
+BENCHMARK(BM_Unique_INT64_DuplicateRatio)
+    ->UseRealTime()
+    ->ArgPair(64 * 1024, 1)
+    ->ArgPair(64 * 1024, 10)
+    ->ArgPair(64 * 1024, 50)
+    ->ArgPair(64 * 1024, 100)
+    ->ArgPair(1024 * 1024, 1)
+    ->ArgPair(1024 * 1024, 10)
+    ->ArgPair(1024 * 1024, 50)
+    ->ArgPair(1024 * 1024, 100)
+    ->ArgPair(8 * 1024 * 1024, 1)
+    ->ArgPair(8 * 1024 * 1024, 10)
+    ->ArgPair(8 * 1024 * 1024, 50)
+    ->ArgPair(8 * 1024 * 1024, 100);
+
 BENCHMARK(BM_Unique_STRING)
     ->UseRealTime()
     ->Arg(32)
@@ -30,6 +30,8 @@ limitations under the License.
 namespace tensorflow {
 namespace io {
 // NOLINTBEGIN(misc-unused-using-decls)
+using tsl::io::MappedRecordReader;
+using tsl::io::RecordIndex;
 using tsl::io::RecordReader;
 using tsl::io::RecordReaderOptions;
 using tsl::io::SequentialRecordReader;
@@ -32,6 +32,7 @@ limitations under the License.
 namespace tensorflow {
 namespace io {
 // NOLINTBEGIN(misc-unused-using-decls)
+using tsl::io::IndexedRecordWriter;
 using tsl::io::RecordWriter;
 using tsl::io::RecordWriterOptions;
 // NOLINTEND(misc-unused-using-decls)
@@ -1126,6 +1126,8 @@ REGISTER_OP("SnapshotDatasetV2")
     .Attr("Treader_func_args: list(type) >= 0")
     .Attr("Tshard_func_args: list(type) >= 0")
     .Attr("metadata: string = ''")
+    .Attr("num_parallel_reads: int = 0")
+    .Attr("deterministic: string = 'default'")
     .SetTypeConstructor(full_type::VariadicTensorContainer(TFT_DATASET,
                                                            "output_types"))
     .SetShapeFn([](shape_inference::InferenceContext* c) {
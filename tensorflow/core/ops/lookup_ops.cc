@@ -225,6 +225,16 @@ REGISTER_OP("LookupTableRemoveV2")
       return OkStatus();
     });
 
+REGISTER_OP("LookupTablePrefetch")
+    .Input("table_handle: resource")
+    .Input("keys: Tin")
+    .Attr("Tin: type")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle handle;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &handle));
+      return OkStatus();
+    });
+
 REGISTER_OP("LookupTableSize")
     .Input("table_handle: Ref(string)")
     .Output("size: int64")
@@ -400,6 +410,7 @@ REGISTER_OP("MutableHashTableV2")
     .Attr("use_node_name_sharing: bool = false")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
+    .Attr("num_shards: int >= 1 = 1")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableShapeFn);
 
@@ -407,6 +418,7 @@ REGISTER_OP("AnonymousMutableHashTable")
     .Output("table_handle: resource")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
+    .Attr("num_shards: int >= 1 = 1")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableShapeFn);
 
@@ -429,6 +441,11 @@ REGISTER_OP("MutableHashTableOfTensorsV2")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
     .Attr("value_shape: shape = {}")
+    .Attr("num_shards: int >= 1 = 1")
+    .Attr("max_size: int >= 0 = 0")
+    .Attr("eviction_policy: {'lru', 'lfu'} = 'lru'")
+    .Attr("min_frequency: int >= 0 = 0")
+    .Attr("spill_dir: string = ''")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableOfTensorsShapeFn);
 
@@ -437,6 +454,11 @@ REGISTER_OP("AnonymousMutableHashTableOfTensors")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
     .Attr("value_shape: shape = {}")
+    .Attr("num_shards: int >= 1 = 1")
+    .Attr("max_size: int >= 0 = 0")
+    .Attr("eviction_policy: {'lru', 'lfu'} = 'lru'")
+    .Attr("min_frequency: int >= 0 = 0")
+    .Attr("spill_dir: string = ''")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableOfTensorsShapeFn);
 
@@ -466,6 +488,7 @@ REGISTER_OP("MutableDenseHashTableV2")
     .Attr("value_shape: shape = {}")
     .Attr("initial_num_buckets: int = 131072")  // 2^17
     .Attr("max_load_factor: float = 0.8")
+    .Attr("layout: {'quadratic', 'swiss'} = 'quadratic'")
     .SetIsStateful()
     .SetShapeFn(MutableDenseHashTableShapeFn);
 
@@ -478,6 +501,7 @@ REGISTER_OP("AnonymousMutableDenseHashTable")
     .Attr("value_shape: shape = {}")
     .Attr("initial_num_buckets: int = 131072")  // 2^17
     .Attr("max_load_factor: float = 0.8")
+    .Attr("layout: {'quadratic', 'swiss'} = 'quadratic'")
     .SetIsStateful()
     .SetShapeFn(MutableDenseHashTableShapeFn);
 
@@ -1449,6 +1449,123 @@ REGISTER_OP("SparseSegmentSqrtNGrad")
     .Attr("Tsegmentids: {int32, int64} = DT_INT32")
     .SetShapeFn(SparseSegmentReductionGradShapeFn);
 
+REGISTER_OP("FusedSparseEmbeddingLookup")
+    .Input("params: T")
+    .Input("indices: Tidx")
+    .Input("segment_ids: Tsegmentids")
+    .Input("weights: T")
+    .Input("num_segments: Tnumsegments")
+    .Output("output: T")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'sum'")
+    .Attr("max_norm: float = 0")
+    .Attr("T: {bfloat16, half, float, double}")
+    .Attr("Tidx: {int32, int64} = DT_INT32")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT32")
+    .Attr("Tnumsegments: {int32, int64} = DT_INT32")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle params_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &params_shape));
+      ShapeHandle indices_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &indices_shape));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->Merge(indices_shape, c->input(2), &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(3), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 0, &unused));
+
+      DimensionHandle num_segments;
+      TF_RETURN_IF_ERROR(c->MakeDimForScalarInput(4, &num_segments));
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(params_shape, 1, &subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(
+          c->Concatenate(c->Vector(num_segments), subshape, &out));
+      c->set_output(0, out);
+      return OkStatus();
+    });
+
+REGISTER_OP("FusedSparseEmbeddingLookupGrad")
+    .Input("grad: T")
+    .Input("params: T")
+    .Input("indices: Tidx")
+    .Input("segment_ids: Tsegmentids")
+    .Input("weights: T")
+    .Output("values: T")
+    .Output("output_indices: Tidx")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'sum'")
+    .Attr("max_norm: float = 0")
+    .Attr("T: {bfloat16, half, float, double}")
+    .Attr("Tidx: {int32, int64} = DT_INT32")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT32")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle params_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(1), 1, &params_shape));
+      ShapeHandle indices_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &indices_shape));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->Merge(indices_shape, c->input(3), &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(4), 1, &unused));
+
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(params_shape, 1, &subshape));
+      ShapeHandle grad_subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(c->input(0), 1, &grad_subshape));
+      TF_RETURN_IF_ERROR(c->Merge(subshape, grad_subshape, &subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(indices_shape, subshape, &out));
+      c->set_output(0, out);
+      c->set_output(1, indices_shape);
+      return OkStatus();
+    });
+
+REGISTER_OP("FusedSparseEmbeddingLookupDequantize")
+    .Input("params: Tparams")
+    .Input("scales: float")
+    .Input("indices: Tidx")
+    .Input("segment_ids: Tsegmentids")
+    .Input("weights: float")
+    .Input("num_segments: Tnumsegments")
+    .Output("output: float")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'sum'")
+    .Attr("max_norm: float = 0")
+    .Attr("Tparams: {int8, bfloat16, half}")
+    .Attr("Tidx: {int32, int64} = DT_INT32")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT32")
+    .Attr("Tnumsegments: {int32, int64} = DT_INT32")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle params_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &params_shape));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(1), 1, &unused));
+      ShapeHandle indices_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &indices_shape));
+      TF_RETURN_IF_ERROR(c->Merge(indices_shape, c->input(3), &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(4), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(5), 0, &unused));
+
+      DimensionHandle num_segments;
+      TF_RETURN_IF_ERROR(c->MakeDimForScalarInput(5, &num_segments));
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(params_shape, 1, &subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(
+          c->Concatenate(c->Vector(num_segments), subshape, &out));
+      c->set_output(0, out);
+      return OkStatus();
+    });
+
+REGISTER_OP("QuantizeEmbeddingRows")
+    .Input("params: T")
+    .Output("quantized: int8")
+    .Output("scales: float")
+    .Attr("T: {bfloat16, half, float, double} = DT_FLOAT")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle params_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &params_shape));
+      c->set_output(0, params_shape);
+      c->set_output(1, c->Vector(c->Dim(params_shape, 0)));
+      return OkStatus();
+    });
+
 REGISTER_OP("All")
     .Input("input: bool")
     .Input("reduction_indices: Tidx")
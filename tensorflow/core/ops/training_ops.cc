@@ -300,6 +300,7 @@ REGISTER_OP("ResourceSparseApplyAdagrad")
     .Attr("Tindices: {int32, int64}")
     .Attr("use_locking: bool = false")
     .Attr("update_slots: bool = true")
+    .Attr("row_striped_locking: bool = false")
     .SetShapeFn(ApplyAdagradShapeFn</*is_sparse=*/true, /*is_resource=*/true>);
 
 template <bool is_sparse, bool is_resource>
@@ -369,6 +370,7 @@ REGISTER_OP("ResourceSparseApplyAdagradV2")
     .Attr("Tindices: {int32, int64}")
     .Attr("use_locking: bool = false")
     .Attr("update_slots: bool = true")
+    .Attr("row_striped_locking: bool = false")
     .SetShapeFn(
         ApplyAdagradV2ShapeFn</*is_sparse=*/true, /*is_resource=*/true>);
 
@@ -607,6 +609,7 @@ REGISTER_OP("ResourceSparseApplyFtrl")
     .Attr("Tindices: {int32, int64}")
     .Attr("use_locking: bool = false")
     .Attr("multiply_linear_by_lr: bool = false")
+    .Attr("row_striped_locking: bool = false")
     .SetShapeFn(ApplyFtrlShapeFn</*is_sparse=*/true, /*is_resource=*/true>);
 
 REGISTER_OP("ApplyFtrlV2")
@@ -673,6 +676,7 @@ REGISTER_OP("ResourceSparseApplyFtrlV2")
     .Attr("Tindices: {int32, int64}")
     .Attr("use_locking: bool = false")
     .Attr("multiply_linear_by_lr: bool = false")
+    .Attr("row_striped_locking: bool = false")
     .SetShapeFn(ApplyFtrlShapeFn</*is_sparse=*/true, /*is_resource=*/true>);
 
 template <bool is_sparse, bool is_resource>
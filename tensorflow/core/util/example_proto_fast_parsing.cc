@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <cstring>
 #include <vector>
 
 #include "absl/base/casts.h"
@@ -113,6 +114,69 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+constexpr uint64 kVarintContinuationBits = 0x8080808080808080ULL;
+constexpr uint64 kLowByteBits = 0x0101010101010101ULL;
+
+// Returns the number of varints in a packed buffer that ends on a complete
+// varint. Each varint ends with the only one of its bytes that has the
+// continuation bit clear, so counting those bytes counts the values. The
+// bulk of the buffer is counted eight bytes at a time.
+size_t CountPackedVarints(StringPiece packed) {
+  const uint8* p = reinterpret_cast<const uint8*>(packed.data());
+  const uint8* const end = p + packed.size();
+  size_t count = 0;
+  for (; end - p >= 8; p += 8) {
+    uint64 word;
+    std::memcpy(&word, p, sizeof(word));
+    // One bit per last byte in the low bit of each byte, then summed into
+    // the top byte.
+    const uint64 last_bytes = (~word & kVarintContinuationBits) >> 7;
+    count += (last_bytes * kLowByteBits) >> 56;
+  }
+  for (; p < end; ++p) count += (*p & 0x80) == 0;
+  return count;
+}
+
+// Decodes exactly `num_values` packed varints from `packed` into `out`.
+// Eight consecutive single-byte varints, the common case for small ids and
+// counts, are decoded from a single load. Returns false if the buffer does
+// not hold exactly `num_values` well-formed varints.
+bool DecodePackedVarints(StringPiece packed, int64_t* out, size_t num_values) {
+  const uint8* p = reinterpret_cast<const uint8*>(packed.data());
+  const uint8* const end = p + packed.size();
+  int64_t* const out_end = out + num_values;
+  while (out < out_end) {
+    if (end - p >= 8 && out_end - out >= 8) {
+      uint64 word;
+      std::memcpy(&word, p, sizeof(word));
+      if ((word & kVarintContinuationBits) == 0) {
+        for (int i = 0; i < 8; ++i) out[i] = p[i];
+        p += 8;
+        out += 8;
+        continue;
+      }
+    }
+    uint64 value = 0;
+    for (int shift = 0;; shift += 7) {
+      // Same limit as CodedInputStream::ReadVarint64: at most 10 bytes.
+      if (p == end || shift >= 64) return false;
+      const uint8 byte = *p++;
+      value |= static_cast<uint64>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) break;
+    }
+    *out++ = static_cast<int64_t>(value);
+  }
+  return p == end;
+}
+
+// Vector like sink that only counts the values pushed into it.
+template <typename T>
+struct CountingSink {
+  using value_type = T;
+  void push_back(T&& value) { ++count; }
+  size_t count = 0;
+};
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -166,6 +230,52 @@ class Feature {
     return true;
   }
 
+  bool GetNumElementsInFloatList(size_t* num_elements) {
+    protobuf::io::CodedInputStream stream(
+        reinterpret_cast<const uint8*>(serialized_.data()), serialized_.size());
+    EnableAliasing(&stream);
+    uint32 length = 0;
+    if (!stream.ReadVarint32(&length)) return false;
+    auto limit = stream.PushLimit(length);
+    *num_elements = 0;
+    if (!stream.ExpectAtEnd()) {
+      // Matches the number of values ParseFloatList resizes its output to.
+      constexpr int32_t kNumFloatBytes = 4;
+      const uint8 peek_tag = PeekTag(&stream);
+      if (peek_tag == kDelimitedTag(1)) {  // packed
+        if (!stream.ExpectTag(kDelimitedTag(1))) return false;
+        uint32 packed_length;
+        if (!stream.ReadVarint32(&packed_length)) return false;
+        // Outputs are sized from this count before the values are parsed, so
+        // a length past the end of the list must be rejected here.
+        if (static_cast<int64_t>(packed_length) > stream.BytesUntilLimit()) {
+          return false;
+        }
+        *num_elements = packed_length / kNumFloatBytes;
+      } else if (peek_tag == kFixed32Tag(1)) {  // non-packed
+        *num_elements = stream.BytesUntilLimit() / (1 + kNumFloatBytes);
+      } else {
+        return false;
+      }
+    }
+    stream.PopLimit(limit);
+    return true;
+  }
+
+  bool GetNumElementsInInt64List(size_t* num_elements) {
+    StringPiece packed;
+    if (GetPackedInt64Values(&packed)) {
+      // A packed list that ends inside a varint is malformed.
+      if (!packed.empty() && (packed.back() & 0x80)) return false;
+      *num_elements = CountPackedVarints(packed);
+      return true;
+    }
+    CountingSink<int64_t> sink;
+    if (!ParseInt64List(&sink)) return false;
+    *num_elements = sink.count;
+    return true;
+  }
+
   // Helper methods
   tstring* construct_at_end(LimitedArraySlice<tstring>* bytes_list) {
     if (bytes_list->EndDistance() <= 0) {
@@ -321,9 +431,46 @@ class Feature {
     return true;
   }
 
+  // Decodes an int64 list of `num_elements` values, as counted by
+  // GetNumElementsInInt64List, into `int64_array`. Returns false unless
+  // exactly that many values were decoded.
+  bool ParseInt64Array(int64_t* int64_array, size_t num_elements) {
+    StringPiece packed;
+    if (GetPackedInt64Values(&packed)) {
+      return DecodePackedVarints(packed, int64_array, num_elements);
+    }
+    LimitedArraySlice<int64_t> slice(int64_array, num_elements);
+    return ParseInt64List(&slice) && slice.EndDistance() == 0;
+  }
+
   StringPiece GetSerialized() const { return serialized_; }
 
  private:
+  // If this is a packed int64 list, points `packed` to the encoded values and
+  // returns true. Like ParseInt64List, only the first packed run is used.
+  bool GetPackedInt64Values(StringPiece* packed) {
+    protobuf::io::CodedInputStream stream(
+        reinterpret_cast<const uint8*>(serialized_.data()), serialized_.size());
+    EnableAliasing(&stream);
+    uint32 length;
+    if (!stream.ReadVarint32(&length)) return false;
+    stream.PushLimit(length);
+    if (stream.ExpectAtEnd() || PeekTag(&stream) != kDelimitedTag(1)) {
+      return false;
+    }
+    if (!stream.ExpectTag(kDelimitedTag(1))) return false;
+    uint32 packed_length;
+    if (!stream.ReadVarint32(&packed_length)) return false;
+    const void* data = nullptr;
+    int size = 0;
+    if (packed_length > 0 && (!stream.GetDirectBufferPointer(&data, &size) ||
+                              static_cast<uint32>(size) < packed_length)) {
+      return false;
+    }
+    *packed = StringPiece(static_cast<const char*>(data), packed_length);
+    return true;
+  }
+
   // TODO(lew): Pair of uint8* would be more natural.
   StringPiece serialized_;
 };
@@ -540,7 +687,8 @@ void ParallelFor(const std::function<void(size_t)>& f, size_t n,
 // and relies on the fact that they are default-initialized to Dense.
 enum class Type { Dense, Sparse, Ragged };
 
-// Note: We use SparseBuffer for sparse, ragged, and dense_varlen features.
+// Note: We use SparseBuffer for dense_varlen features. Sparse and ragged
+// features are written straight into the output, see FeatureValueList.
 struct SparseBuffer {
   // Features are in one of the 3 vectors below depending on config's dtype.
   // Other 2 vectors remain empty.
@@ -554,6 +702,24 @@ struct SparseBuffer {
   std::vector<size_t> example_end_indices;
 };
 
+// The values of a sparse or ragged feature in one example.
+//
+// FastParseExample parses sparse and ragged features in two passes. The first
+// pass only counts the values of every feature list and records where they
+// are. Once the sizes of all outputs are known, the second pass decodes each
+// list straight into its place in the batch output tensors.
+struct FeatureValueList {
+  size_t example_index;
+  // Positioned after the data type tag, see Feature::ParseDataType().
+  parsed::Feature feature;
+  size_t num_values;
+  // Position of the first value in the batch output.
+  size_t offset;
+};
+
+// Per config feature, the non-empty lists of one minibatch in example order.
+using FeatureValueLists = std::vector<std::vector<FeatureValueList>>;
+
 struct SeededHasher {
   uint64 operator()(StringPiece s) const {
     return Hash64(s.data(), s.size(), seed);
@@ -589,8 +755,7 @@ Status FastParseSerializedExample(
     const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
     SeededHasher hasher, std::vector<Tensor>* output_dense,
     std::vector<SparseBuffer>* output_varlen_dense,
-    std::vector<SparseBuffer>* output_sparse,
-    std::vector<SparseBuffer>* output_ragged,
+    FeatureValueLists* output_sparse, FeatureValueLists* output_ragged,
     PerExampleFeatureStats* output_stats) {
   DCHECK(output_dense != nullptr);
   DCHECK(output_sparse != nullptr);
@@ -816,7 +981,6 @@ Status FastParseSerializedExample(
       last_example[d] = example_index;
 
       // Handle sparse features.
-      SparseBuffer& out = is_ragged ? (*output_ragged)[d] : (*output_sparse)[d];
       DataType feature_dtype =
           is_ragged ? config.ragged[d].dtype : config.sparse[d].dtype;
       if (example_dtype != DT_INVALID && example_dtype != feature_dtype) {
@@ -825,54 +989,42 @@ Status FastParseSerializedExample(
                             "Expected type: ", DataTypeString(feature_dtype),
                             ", Actual type: ", DataTypeString(example_dtype)));
       }
+      if (example_dtype == DT_INVALID) continue;
 
+      // Only count the values here, they are decoded into the output once
+      // every example has been counted.
+      size_t num_values = 0;
       switch (feature_dtype) {
         case DT_INT64: {
-          if (example_dtype != DT_INVALID) {
-            if (!feature.ParseInt64List(&out.int64_list)) {
-              return parse_error();
-            }
+          if (!feature.GetNumElementsInInt64List(&num_values)) {
+            return parse_error();
           }
-          out.example_end_indices.push_back(out.int64_list.size());
           break;
         }
         case DT_FLOAT: {
-          if (example_dtype != DT_INVALID) {
-            if (!feature.ParseFloatList(&out.float_list)) {
-              return parse_error();
-            }
+          if (!feature.GetNumElementsInFloatList(&num_values)) {
+            return parse_error();
           }
-          out.example_end_indices.push_back(out.float_list.size());
           break;
         }
         case DT_STRING: {
-          if (example_dtype != DT_INVALID) {
-            if (!feature.ParseBytesList(&out.bytes_list)) {
-              return parse_error();
-            }
+          int num_elements;
+          if (!feature.GetNumElementsInBytesList(&num_elements)) {
+            return parse_error();
           }
-          out.example_end_indices.push_back(out.bytes_list.size());
+          num_values = num_elements;
           break;
         }
         default:
           LOG(FATAL) << "Should not happen.";
       }
+      if (num_values > 0) {
+        auto& out = is_ragged ? (*output_ragged)[d] : (*output_sparse)[d];
+        out.push_back({example_index, feature, num_values, 0});
+      }
 
       if (output_stats) {
-        // Use `out.example_end_indices` to determine the feature-value count
-        // for this feature, because the preceding switch statement pushes
-        // the length of the appropriate feature list to that vector.
-        // TODO(b/111553342): If desirable, we could add support for counting
-        // elements in the features that aren't parsed, but this could add
-        // considerable runtime cost.
-        const size_t out_examples_count = out.example_end_indices.size();
-        if (out_examples_count == 1) {
-          output_stats->feature_values_count += out.example_end_indices[0];
-        } else {
-          output_stats->feature_values_count +=
-              out.example_end_indices[out_examples_count - 1] -
-              out.example_end_indices[out_examples_count - 2];
-        }
+        output_stats->feature_values_count += num_values;
       }
     }
   }
@@ -923,24 +1075,6 @@ Status FastParseSerializedExample(
     out.example_end_indices.push_back(prev_example_end_index);
   }
 
-  // Handle missing sparse features.
-  for (size_t d = 0; d < config.sparse.size(); ++d) {
-    if (sparse_feature_last_example[d] == example_index) continue;
-    SparseBuffer& out = (*output_sparse)[d];
-    size_t prev_example_end_index =
-        out.example_end_indices.empty() ? 0 : out.example_end_indices.back();
-    out.example_end_indices.push_back(prev_example_end_index);
-  }
-
-  // Handle missing ragged features.
-  for (size_t d = 0; d < config.ragged.size(); ++d) {
-    if (ragged_feature_last_example[d] == example_index) continue;
-    SparseBuffer& out = (*output_ragged)[d];
-    size_t prev_example_end_index =
-        out.example_end_indices.empty() ? 0 : out.example_end_indices.back();
-    out.example_end_indices.push_back(prev_example_end_index);
-  }
-
   return OkStatus();
 }
 
@@ -1087,41 +1221,63 @@ class TensorVector {
   T* data_ = nullptr;
 };
 
-void CountSparseFeatures(
-    const std::vector<std::vector<SparseBuffer>>& sparse_buffers, size_t d,
-    size_t* total_num_features, size_t* max_num_features) {
-  for (auto& sparse_values_tmp : sparse_buffers) {
-    const std::vector<size_t>& end_indices =
-        sparse_values_tmp[d].example_end_indices;
-    *total_num_features += end_indices.back();
-    *max_num_features = std::max(*max_num_features, end_indices[0]);
-    for (size_t i = 1; i < end_indices.size(); ++i) {
-      size_t example_size = end_indices[i] - end_indices[i - 1];
-      *max_num_features = std::max(*max_num_features, example_size);
+// Assigns every list of feature `d` its position in the batch output, in
+// example order across minibatches.
+void AssignFeatureValueOffsets(std::vector<FeatureValueLists>* lists, size_t d,
+                               size_t* total_num_features,
+                               size_t* max_num_features) {
+  for (FeatureValueLists& minibatch_lists : *lists) {
+    for (FeatureValueList& list : minibatch_lists[d]) {
+      list.offset = *total_num_features;
+      *total_num_features += list.num_values;
+      *max_num_features = std::max(*max_num_features, list.num_values);
+    }
+  }
+}
+
+template <typename T>
+void FillRowSplits(const std::vector<FeatureValueLists>& lists, size_t d,
+                   size_t batch_size, T* row_splits) {
+  size_t next_example = 0;
+  row_splits[0] = 0;
+  for (const FeatureValueLists& minibatch_lists : lists) {
+    for (const FeatureValueList& list : minibatch_lists[d]) {
+      // Examples without the feature have empty rows.
+      for (; next_example < list.example_index; ++next_example) {
+        row_splits[next_example + 1] = row_splits[next_example];
+      }
+      row_splits[next_example + 1] =
+          static_cast<T>(list.offset + list.num_values);
+      ++next_example;
     }
   }
+  for (; next_example < batch_size; ++next_example) {
+    row_splits[next_example + 1] = row_splits[next_example];
+  }
 }
 
-void CopySparseBufferToTensor(DataType dtype, size_t offset, SparseBuffer* src,
-                              Tensor* dst) {
+// Decodes the values of `list` into their place in `values`.
+bool ParseFeatureValueList(DataType dtype, const FeatureValueList& list,
+                           Tensor* values) {
+  parsed::Feature feature = list.feature;
   switch (dtype) {
     case DT_INT64: {
-      std::copy(src->int64_list.begin(), src->int64_list.end(),
-                dst->flat<int64_t>().data() + offset);
-      break;
+      return feature.ParseInt64Array(
+          values->flat<int64_t>().data() + list.offset, list.num_values);
     }
     case DT_FLOAT: {
-      std::copy(src->float_list.begin(), src->float_list.end(),
-                dst->flat<float>().data() + offset);
-      break;
+      LimitedArraySlice<float> slice(values->flat<float>().data() + list.offset,
+                                     list.num_values);
+      return feature.ParseFloatList(&slice) && slice.EndDistance() == 0;
     }
     case DT_STRING: {
-      std::move(src->bytes_list.begin(), src->bytes_list.end(),
-                dst->flat<tstring>().data() + offset);
-      break;
+      LimitedArraySlice<tstring> slice(
+          values->flat<tstring>().data() + list.offset, list.num_values);
+      return feature.ParseBytesList(&slice) && slice.EndDistance() == 0;
     }
     default:
       ReportUnexpectedDataType(dtype);
+      return false;
   }
 }
 
@@ -1171,7 +1327,8 @@ Status FastParseExample(const Config& config,
   }
 
   // Allocate dense output for fixed length dense values
-  // (variable-length dense and sparse and ragged have to be buffered).
+  // (variable-length dense has to be buffered, sparse and ragged are counted
+  // before they are allocated).
   std::vector<Tensor> fixed_dense_values(config.dense.size());
   for (size_t d = 0; d < config.dense.size(); ++d) {
     if (config.dense[d].variable_length) continue;
@@ -1221,14 +1378,14 @@ Status FastParseExample(const Config& config,
   //   Maybe accept outside parameter #num_minibatches?
 
   // Do minibatches in parallel.
-  std::vector<std::vector<SparseBuffer>> sparse_buffers(num_minibatches);
+  std::vector<FeatureValueLists> sparse_lists(num_minibatches);
   std::vector<std::vector<SparseBuffer>> varlen_dense_buffers(num_minibatches);
-  std::vector<std::vector<SparseBuffer>> ragged_buffers(num_minibatches);
+  std::vector<FeatureValueLists> ragged_lists(num_minibatches);
   std::vector<Status> status_of_minibatch(num_minibatches);
   auto ProcessMiniBatch = [&](size_t minibatch) {
-    sparse_buffers[minibatch].resize(config.sparse.size());
+    sparse_lists[minibatch].resize(config.sparse.size());
     varlen_dense_buffers[minibatch].resize(config.dense.size());
-    ragged_buffers[minibatch].resize(config.ragged.size());
+    ragged_lists[minibatch].resize(config.ragged.size());
     size_t start = first_example_of_minibatch(minibatch);
     size_t end = first_example_of_minibatch(minibatch + 1);
     for (size_t e = start; e < end; ++e) {
@@ -1240,8 +1397,8 @@ Status FastParseExample(const Config& config,
           serialized[e],
           (!example_names.empty() ? example_names[e] : "<unknown>"), e, config,
           config_index, hasher, &fixed_dense_values,
-          &varlen_dense_buffers[minibatch], &sparse_buffers[minibatch],
-          &ragged_buffers[minibatch], stats);
+          &varlen_dense_buffers[minibatch], &sparse_lists[minibatch],
+          &ragged_lists[minibatch], stats);
       if (!status_of_minibatch[minibatch].ok()) break;
     }
   };
@@ -1263,66 +1420,36 @@ Status FastParseExample(const Config& config,
     result->dense_values.push_back(std::move(fixed_dense_values[d]));
   }
 
-  // Merge SparseBuffers from all minibatches for every config.sparse.
-  auto MergeSparseMinibatches = [&](size_t d) {
-    // Loop over minibatches
+  // Allocate the outputs of every config.sparse, now that the number of
+  // values of each of its lists is known.
+  auto AllocateSparseOutputs = [&](size_t d) {
     size_t total_num_features = 0;
     size_t max_num_features = 0;
-    CountSparseFeatures(sparse_buffers, d, &total_num_features,
-                        &max_num_features);
+    AssignFeatureValueOffsets(&sparse_lists, d, &total_num_features,
+                              &max_num_features);
 
     TensorShape indices_shape;
     indices_shape.AddDim(total_num_features);
     indices_shape.AddDim(2);
     result->sparse_indices.emplace_back(DT_INT64, indices_shape);
-    Tensor* indices = &result->sparse_indices.back();
 
     TensorShape values_shape;
     values_shape.AddDim(total_num_features);
     result->sparse_values.emplace_back(config.sparse[d].dtype, values_shape);
-    Tensor* values = &result->sparse_values.back();
 
     result->sparse_shapes.emplace_back(DT_INT64, TensorShape({2}));
     auto shapes_shape_t = result->sparse_shapes.back().vec<int64_t>();
     shapes_shape_t(0) = serialized.size();
     shapes_shape_t(1) = max_num_features;
-
-    size_t offset = 0;
-    for (size_t i = 0; i < sparse_buffers.size(); ++i) {
-      SparseBuffer& buffer = sparse_buffers[i][d];
-
-      // Update indices.
-      size_t delta = 0;
-
-      if (indices->NumElements() > 0) {
-        int64* ix_p = &indices->matrix<int64_t>()(offset, 0);
-        size_t example_index = first_example_of_minibatch(i);
-        for (size_t example_end_index : buffer.example_end_indices) {
-          size_t feature_index = 0;
-          for (; delta < example_end_index; ++delta) {
-            // Column 0: example index
-            *ix_p = example_index;
-            // Column 1: the feature index buffer example
-            *(ix_p + 1) = feature_index;
-            ix_p += 2;
-            ++feature_index;
-          }
-          ++example_index;
-        }
-      }
-
-      CopySparseBufferToTensor(config.sparse[d].dtype, offset, &buffer, values);
-      offset += delta;
-    }
   };
 
-  // Merge SparseBuffers from all minibatches for every config.ragged.
-  auto MergeRaggedMinibatches = [&](size_t d) {
-    // Loop over minibatches
+  // Allocate the outputs of every config.ragged. The row splits only depend
+  // on the counts, so they are filled in here as well.
+  auto AllocateRaggedOutputs = [&](size_t d) {
     size_t total_num_features = 0;
     size_t max_num_features = 0;
-    CountSparseFeatures(ragged_buffers, d, &total_num_features,
-                        &max_num_features);
+    AssignFeatureValueOffsets(&ragged_lists, d, &total_num_features,
+                              &max_num_features);
 
     TensorShape row_splits_shape;
     row_splits_shape.AddDim(serialized.size() + 1);
@@ -1330,45 +1457,74 @@ Status FastParseExample(const Config& config,
                                        row_splits_shape);
     Tensor* row_splits = &result->ragged_splits.back();
     if (config.ragged[d].splits_dtype == DT_INT64) {
-      row_splits->flat<int64_t>()(0) = 0;
+      FillRowSplits(ragged_lists, d, serialized.size(),
+                    row_splits->flat<int64_t>().data());
     } else {
-      row_splits->flat<int32>()(0) = 0;
+      FillRowSplits(ragged_lists, d, serialized.size(),
+                    row_splits->flat<int32>().data());
     }
 
     TensorShape values_shape;
     values_shape.AddDim(total_num_features);
     result->ragged_values.emplace_back(config.ragged[d].dtype, values_shape);
-    Tensor* values = &result->ragged_values.back();
-
-    size_t values_offset = 0;
-    size_t splits_offset = 0;
-    for (size_t i = 0; i < ragged_buffers.size(); ++i) {
-      SparseBuffer& buffer = ragged_buffers[i][d];
-      if (buffer.example_end_indices.empty()) continue;
-
-      // Update row_splits.  row_splits are formed by concatenating the example
-      // end_indices (adjusting each to start after the previous one ends).
-      if (config.ragged[d].splits_dtype == DT_INT64) {
-        int64* row_splits_out = &row_splits->flat<int64_t>()(splits_offset);
-        int64_t start = *row_splits_out;
-        for (size_t example_end_index : buffer.example_end_indices) {
-          *++row_splits_out = start + example_end_index;
+  };
+
+  for (size_t d = 0; d < config.sparse.size(); ++d) {
+    AllocateSparseOutputs(d);
+  }
+
+  for (size_t d = 0; d < config.ragged.size(); ++d) {
+    AllocateRaggedOutputs(d);
+  }
+
+  // Decode the sparse and ragged values of the same minibatches in parallel,
+  // each list straight into its place in the outputs.
+  auto ParseMiniBatchValues = [&](size_t minibatch) {
+    auto parse_error = [&](const tstring& feature_name,
+                           const FeatureValueList& list) {
+      return errors::InvalidArgument(
+          "Name: ",
+          (!example_names.empty() ? example_names[list.example_index]
+                                  : "<unknown>"),
+          ", Key: ", feature_name, ", Index: ", list.example_index,
+          ".  Can't parse serialized Example.");
+    };
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      Tensor* values = &result->sparse_values[d];
+      auto indices = result->sparse_indices[d].matrix<int64_t>();
+      for (const FeatureValueList& list : sparse_lists[minibatch][d]) {
+        if (!ParseFeatureValueList(config.sparse[d].dtype, list, values)) {
+          status_of_minibatch[minibatch] =
+              parse_error(config.sparse[d].feature_name, list);
+          return;
         }
-      } else {
-        int32* row_splits_out = &row_splits->flat<int32>()(splits_offset);
-        int32_t start = *row_splits_out;
-        for (size_t example_end_index : buffer.example_end_indices) {
-          *++row_splits_out = start + example_end_index;
+        for (size_t j = 0; j < list.num_values; ++j) {
+          // Column 0: example index
+          indices(list.offset + j, 0) = list.example_index;
+          // Column 1: the feature index in the example
+          indices(list.offset + j, 1) = j;
+        }
+      }
+    }
+    for (size_t d = 0; d < config.ragged.size(); ++d) {
+      Tensor* values = &result->ragged_values[d];
+      for (const FeatureValueList& list : ragged_lists[minibatch][d]) {
+        if (!ParseFeatureValueList(config.ragged[d].dtype, list, values)) {
+          status_of_minibatch[minibatch] =
+              parse_error(config.ragged[d].feature_name, list);
+          return;
         }
       }
-
-      CopySparseBufferToTensor(config.ragged[d].dtype, values_offset, &buffer,
-                               values);
-      values_offset += buffer.example_end_indices.back();
-      splits_offset += buffer.example_end_indices.size();
     }
   };
 
+  if (!config.sparse.empty() || !config.ragged.empty()) {
+    ParallelFor(ParseMiniBatchValues, num_minibatches, thread_pool);
+    for (Status& status : status_of_minibatch) {
+      TF_RETURN_IF_ERROR(status);
+    }
+  }
+
   // Merge SparseBuffers from all minibatches for every config.dense having
   // variable_length.
   auto MergeDenseVarLenMinibatches = [&](size_t d) {
@@ -1430,14 +1586,6 @@ Status FastParseExample(const Config& config,
     MergeDenseVarLenMinibatches(d);
   }
 
-  for (size_t d = 0; d < config.sparse.size(); ++d) {
-    MergeSparseMinibatches(d);
-  }
-
-  for (size_t d = 0; d < config.ragged.size(); ++d) {
-    MergeRaggedMinibatches(d);
-  }
-
   return OkStatus();
 }
 
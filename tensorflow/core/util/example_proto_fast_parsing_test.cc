@@ -17,8 +17,11 @@ limitations under the License.
 
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include "absl/strings/match.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/protobuf.h"
@@ -427,6 +430,139 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+int64_t SparseInt64Value(int i, int j) {
+  // Mixes one byte, multi byte and ten byte (negative) varints.
+  switch (j % 3) {
+    case 0:
+      return j;
+    case 1:
+      return -int64_t{1000003} * i;
+    default:
+      return int64_t{1} << (j + 40);
+  }
+}
+
+TEST(TestFastParseExample, SparseAndRagged) {
+  // Enough examples for several minibatches, some without the features and
+  // some with empty lists.
+  const int kNumExamples = 37;
+  std::vector<tstring> serialized;
+  for (int i = 0; i < kNumExamples; ++i) {
+    Example example;
+    auto& features = *example.mutable_features()->mutable_feature();
+    if (i % 5 == 0) {
+      // No features.
+    } else if (i % 5 == 1) {
+      features["ids"].mutable_int64_list();
+      features["weights"].mutable_float_list();
+      features["counts"].mutable_int64_list();
+      features["tags"].mutable_bytes_list();
+    } else {
+      for (int j = 0; j < i % 13; ++j) {
+        features["ids"].mutable_int64_list()->add_value(SparseInt64Value(i, j));
+        features["weights"].mutable_float_list()->add_value(i + 0.5f * j);
+        features["counts"].mutable_int64_list()->add_value(j);
+        features["tags"].mutable_bytes_list()->add_value(
+            strings::StrCat("tag", i, "_", j));
+      }
+    }
+    serialized.push_back(Serialize(example));
+  }
+  // An int64 list that is not packed.
+  serialized.push_back(
+      "\x0a\x0e\x0a\x0c\x0a\x03ids\x12\x05\x1a\x03\x08\xac\x02");
+
+  FastParseExampleConfig config;
+  AddSparseFeature("ids", DT_INT64, &config);
+  AddSparseFeature("weights", DT_FLOAT, &config);
+  config.ragged.push_back({"counts", DT_INT64, DT_INT32});
+  config.ragged.push_back({"tags", DT_STRING, DT_INT64});
+
+  Result result;
+  TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+
+  std::vector<int64_t> ids_indices;
+  std::vector<int64_t> ids;
+  std::vector<float> weights;
+  std::vector<int32> counts_splits = {0};
+  std::vector<int64_t> counts;
+  std::vector<int64_t> tags_splits = {0};
+  std::vector<tstring> tags;
+  int64_t max_num_features = 0;
+  for (int i = 0; i < kNumExamples; ++i) {
+    const int num_values = i % 5 < 2 ? 0 : i % 13;
+    for (int j = 0; j < num_values; ++j) {
+      ids_indices.push_back(i);
+      ids_indices.push_back(j);
+      ids.push_back(SparseInt64Value(i, j));
+      weights.push_back(i + 0.5f * j);
+      counts.push_back(j);
+      tags.push_back(strings::StrCat("tag", i, "_", j));
+    }
+    counts_splits.push_back(static_cast<int32>(counts.size()));
+    tags_splits.push_back(tags.size());
+    max_num_features = std::max<int64_t>(max_num_features, num_values);
+  }
+  ids_indices.push_back(kNumExamples);
+  ids_indices.push_back(0);
+  ids.push_back(300);
+
+  ASSERT_EQ(result.sparse_values.size(), 2);
+  const int64_t num_ids = ids.size();
+  test::ExpectTensorEqual<int64_t>(
+      result.sparse_indices[0],
+      test::AsTensor<int64_t>(ids_indices, {num_ids, 2}));
+  test::ExpectTensorEqual<int64_t>(result.sparse_values[0],
+                                   test::AsTensor<int64_t>(ids));
+  test::ExpectTensorEqual<int64_t>(
+      result.sparse_shapes[0],
+      test::AsTensor<int64_t>({kNumExamples + 1, max_num_features}));
+  test::ExpectTensorEqual<float>(result.sparse_values[1],
+                                 test::AsTensor<float>(weights));
+
+  counts_splits.push_back(static_cast<int32>(counts.size()));
+  tags_splits.push_back(tags.size());
+  ASSERT_EQ(result.ragged_values.size(), 2);
+  test::ExpectTensorEqual<int64_t>(result.ragged_values[0],
+                                   test::AsTensor<int64_t>(counts));
+  test::ExpectTensorEqual<int32>(result.ragged_splits[0],
+                                 test::AsTensor<int32>(counts_splits));
+  test::ExpectTensorEqual<tstring>(result.ragged_values[1],
+                                   test::AsTensor<tstring>(tags));
+  test::ExpectTensorEqual<int64_t>(result.ragged_splits[1],
+                                   test::AsTensor<int64_t>(tags_splits));
+}
+
+TEST(TestFastParseExample, SparseTruncatedVarint) {
+  // Packed int64 list whose only value is missing its last byte.
+  std::vector<tstring> serialized = {
+      "\x0a\x0e\x0a\x0c\x0a\x03ids\x12\x05\x1a\x03\x0a\x01\x80"};
+  FastParseExampleConfig config;
+  AddSparseFeature("ids", DT_INT64, &config);
+  Result result;
+  Status status = FastParseExample(config, serialized, {}, nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+  EXPECT_TRUE(absl::StrContains(status.error_message(),
+                                "Can't parse serialized Example"))
+      << status;
+}
+
+TEST(TestFastParseExample, SparseFloatListPackedLengthPastEnd) {
+  // Packed float list claiming 0xfffffffc bytes of values, with none present.
+  // Sizing the outputs from that length would allocate tens of gigabytes.
+  std::vector<tstring> serialized = {
+      "\x0a\x15\x0a\x13\x0a\x07weights\x12\x08\x12\x06"
+      "\x0a\xfc\xff\xff\xff\x0f"};
+  FastParseExampleConfig config;
+  AddSparseFeature("weights", DT_FLOAT, &config);
+  Result result;
+  Status status = FastParseExample(config, serialized, {}, nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+  EXPECT_TRUE(absl::StrContains(status.error_message(),
+                                "Can't parse serialized Example"))
+      << status;
+}
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
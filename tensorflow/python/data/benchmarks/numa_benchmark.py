@@ -0,0 +1,59 @@
+# Copyright 2026 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Benchmarks for NUMA-aware tf.data execution."""
+from tensorflow.python.data.benchmarks import benchmark_base
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.data.ops import options as options_lib
+from tensorflow.python.ops import math_ops
+from tensorflow.python.ops import random_ops
+
+
+class NumaBenchmark(benchmark_base.DatasetBenchmarkBase):
+  """Benchmarks for `tf.data.ThreadingOptions.experimental_numa_aware`."""
+
+  def _make_dataset(self, numa_aware, element_size):
+    # Each element is produced by an interleave worker, transformed by a
+    # parallel map and copied into a batch, so that on hosts with several NUMA
+    # nodes the element buffers cross nodes unless the pipeline is pinned.
+    dataset = dataset_ops.Dataset.range(16).interleave(
+        lambda _: dataset_ops.Dataset.range(1000000).map(
+            lambda _: random_ops.random_uniform([element_size])),
+        cycle_length=8,
+        num_parallel_calls=8)
+    dataset = dataset.map(
+        lambda x: math_ops.reduce_sum(x) * x, num_parallel_calls=8)
+    dataset = dataset.batch(32).prefetch(2)
+    options = options_lib.Options()
+    options.threading.experimental_numa_aware = numa_aware
+    return dataset.with_options(options)
+
+  def benchmark_numa_aware(self):
+    num_elements = 2000
+    for element_size in [1024, 64 * 1024]:
+      for numa_aware in [False, True]:
+        dataset = self._make_dataset(numa_aware, element_size)
+        self.run_and_report_benchmark(
+            dataset,
+            num_elements=num_elements,
+            extras={
+                "model_name": "numa.benchmark.%d" % (1 + int(numa_aware)),
+                "parameters": "%d" % element_size,
+            },
+            name="numa_aware_{}_element_size_{}".format(
+                numa_aware, element_size))
+
+
+if __name__ == "__main__":
+  benchmark_base.test.main()
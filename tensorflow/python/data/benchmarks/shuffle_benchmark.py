@@ -0,0 +1,121 @@
+# Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Benchmarks for `tf.data.Dataset.shuffle()`."""
+import numpy as np
+
+from tensorflow.python.data.benchmarks import benchmark_base
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.ops import array_ops
+
+
+class ShuffleBenchmark(benchmark_base.DatasetBenchmarkBase):
+  """Benchmarks for `tf.data.Dataset.shuffle()`.
+
+  Compares the element buffer over an ordered input with the block mode over
+  an input whose blocks were shuffled upstream, under a byte budget. Each
+  element is an index followed by a `record_bytes` payload, so the indices of
+  one pass over the shuffled dataset give the randomness metrics:
+
+  * `mean_displacement`: mean of `|position - index| / num_elements`. An
+    unshuffled dataset scores 0 and a uniform permutation about 1/3.
+  * `adjacent_pairs`: fraction of consecutive outputs that were also
+    consecutive in the input. A uniform permutation scores about 0.
+  """
+
+  def _make_dataset(self, num_elements, record_bytes, buffer_size,
+                    block_length, buffer_size_bytes):
+    if block_length:
+      # Shuffle the order of the blocks upstream, as shuffling file names
+      # would, and leave the shuffle within each block to `ShuffleDataset`.
+      num_blocks = num_elements // block_length
+      dataset = dataset_ops.Dataset.range(num_blocks).shuffle(
+          num_blocks, seed=42)
+      dataset = dataset.flat_map(lambda block: dataset_ops.Dataset.range(
+          block * block_length, (block + 1) * block_length))
+    else:
+      dataset = dataset_ops.Dataset.range(num_elements)
+    dataset = dataset.map(
+        lambda i: (i, array_ops.zeros([record_bytes], dtype=dtypes.uint8)))
+    return dataset_ops.ShuffleDataset(
+        dataset,
+        buffer_size,
+        seed=42,
+        block_length=block_length,
+        buffer_size_bytes=buffer_size_bytes)
+
+  def _randomness(self, dataset, num_elements):
+    indices = np.array(
+        [index for index, _ in dataset.as_numpy_iterator()], dtype=np.int64)
+    displacement = np.abs(indices - np.arange(num_elements)) / num_elements
+    adjacent = np.sum(np.diff(indices) == 1) / (num_elements - 1)
+    return float(np.mean(displacement)), float(adjacent)
+
+  def _benchmark(self, name, benchmark_id, buffer_size, block_length=None,
+                 buffer_size_bytes=None):
+    num_elements = 100000
+    record_bytes = 1024
+    dataset = self._make_dataset(num_elements, record_bytes, buffer_size,
+                                 block_length, buffer_size_bytes)
+    mean_displacement, adjacent_pairs = self._randomness(dataset, num_elements)
+    # Upper bound on the memory held by the shuffle buffer. The block mode may
+    # exceed its byte budget by at most one block.
+    buffer_bytes = buffer_size * record_bytes
+    if buffer_size_bytes:
+      buffer_bytes = min(buffer_bytes,
+                         buffer_size_bytes + (block_length or 1) * record_bytes)
+    self.run_and_report_benchmark(
+        dataset.repeat(),
+        num_elements=num_elements,
+        extras={
+            "model_name": "shuffle.benchmark.%d" % benchmark_id,
+            "parameters": "%d.%d.%d.%d" % (buffer_size, block_length or 0,
+                                           buffer_size_bytes or 0,
+                                           record_bytes),
+            "buffer_bytes": buffer_bytes,
+            "mean_displacement": mean_displacement,
+            "adjacent_pairs": adjacent_pairs,
+        },
+        name=name)
+
+  def benchmark_element_buffer(self):
+    self._benchmark("element_buffer", benchmark_id=1, buffer_size=10000)
+
+  def benchmark_element_buffer_with_byte_budget(self):
+    self._benchmark(
+        "element_buffer_with_byte_budget",
+        benchmark_id=2,
+        buffer_size=10000,
+        buffer_size_bytes=1 << 20)
+
+  def benchmark_block(self):
+    self._benchmark(
+        "block",
+        benchmark_id=3,
+        buffer_size=10000,
+        block_length=100,
+        buffer_size_bytes=1 << 20)
+
+  def benchmark_large_block(self):
+    self._benchmark(
+        "large_block",
+        benchmark_id=4,
+        buffer_size=10000,
+        block_length=1000,
+        buffer_size_bytes=1 << 20)
+
+
+if __name__ == "__main__":
+  benchmark_base.test.main()
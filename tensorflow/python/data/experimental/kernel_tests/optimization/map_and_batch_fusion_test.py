@@ -15,11 +15,16 @@
 """Tests for the `MapAndBatchFusion` optimization."""
 from absl.testing import parameterized
 
+from tensorflow.core.example import example_pb2
+from tensorflow.core.example import feature_pb2
 from tensorflow.python.data.experimental.ops import testing
 from tensorflow.python.data.kernel_tests import test_base
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.ops import options as options_lib
 from tensorflow.python.framework import combinations
+from tensorflow.python.framework import dtypes
+from tensorflow.python.ops import parsing_config
+from tensorflow.python.ops import parsing_ops
 from tensorflow.python.platform import test
 
 
@@ -37,6 +42,43 @@ class MapAndBatchFusionTest(test_base.DatasetTestBase, parameterized.TestCase):
     self.assertDatasetProduces(
         dataset, expected_output=[[x * x for x in range(10)]])
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testParseExampleLoweredToBatchedParse(self):
+    serialized = []
+    for i in range(10):
+      feature = {
+          "b": feature_pb2.Feature(
+              int64_list=feature_pb2.Int64List(value=[i, -i]))
+      }
+      if i % 2:
+        feature["a"] = feature_pb2.Feature(
+            float_list=feature_pb2.FloatList(value=[i / 2]))
+      example = example_pb2.Example(
+          features=feature_pb2.Features(feature=feature))
+      serialized.append(example.SerializeToString())
+    features = {
+        "a": parsing_config.FixedLenFeature([], dtypes.float32, -1.0),
+        "b": parsing_config.FixedLenFeature([2], dtypes.int64),
+    }
+
+    dataset = dataset_ops.Dataset.from_tensor_slices(serialized)
+    dataset = dataset.apply(testing.assert_next(["Batch", "ParseExample"]))
+    dataset = dataset.map(
+        lambda x: parsing_ops.parse_single_example(x, features)).batch(4)
+    options = options_lib.Options()
+    options.experimental_optimization.apply_default_optimizations = False
+    options.experimental_optimization.map_and_batch_fusion = True
+    dataset = dataset.with_options(options)
+
+    expected_output = []
+    for start in range(0, 10, 4):
+      indices = range(start, min(start + 4, 10))
+      expected_output.append({
+          "a": [i / 2 if i % 2 else -1.0 for i in indices],
+          "b": [[i, -i] for i in indices],
+      })
+    self.assertDatasetProduces(dataset, expected_output=expected_output)
+
 
 if __name__ == "__main__":
   test.main()
@@ -35,6 +35,8 @@ from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import errors
 from tensorflow.python.framework import ops
 from tensorflow.python.ops import math_ops
+from tensorflow.python.ops import random_ops
+from tensorflow.python.ops import string_ops
 from tensorflow.python.ops import variables
 from tensorflow.python.platform import test
 
@@ -426,6 +428,41 @@ class MemoryCacheTest(test_base.DatasetTestBase, parameterized.TestCase):
     dataset = dataset_ops.Dataset.from_tensors(42).cache(name="cache")
     self.assertDatasetProduces(dataset, [42])
 
+  @combinations.generate(
+      combinations.times(test_base.default_test_combinations(),
+                         combinations.combine(ram_budget=[0, 1, 100])))
+  def testCompressedCache(self, ram_budget):
+    # With a budget of 1 byte every element is spilled to disk, and with a
+    # budget of 100 bytes only the first few are kept in memory.
+    dataset = dataset_ops.Dataset.range(10).map(
+        lambda x: (x, string_ops.as_string(x)))
+    dataset = dataset_ops.CacheDataset(
+        dataset, "", compression="SNAPPY", ram_budget=ram_budget).repeat(3)
+    self.assertDatasetProduces(
+        dataset, [(i, str(i).encode()) for i in range(10)] * 3)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testCompressedCacheReplaysFromCache(self):
+    dataset = dataset_ops.Dataset.range(5).map(
+        lambda _: random_ops.random_uniform([8]))
+    dataset = dataset_ops.CacheDataset(
+        dataset, "", compression="SNAPPY", ram_budget=1).repeat(2)
+    get_next = self.getNext(dataset)
+    first_epoch = [self.evaluate(get_next()) for _ in range(5)]
+    second_epoch = [self.evaluate(get_next()) for _ in range(5)]
+    self.assertAllEqual(first_epoch, second_epoch)
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next())
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testCompressedCacheRequiresMemoryCache(self):
+    filename = os.path.join(self.get_temp_dir(), "cache")
+    with self.assertRaisesRegex(errors.InvalidArgumentError,
+                                "only supported for in-memory caches"):
+      dataset = dataset_ops.CacheDataset(
+          dataset_ops.Dataset.range(10), filename, compression="SNAPPY")
+      self.evaluate(self.getNext(dataset)())
+
 
 class CacheCheckpointTest(checkpoint_test_base.CheckpointTestBase,
                           parameterized.TestCase):
@@ -472,6 +509,30 @@ class CacheCheckpointTest(checkpoint_test_base.CheckpointTestBase,
             verify_exhausted=False))
     self.assertSequenceEqual(outputs, self.expected_outputs())
 
+  @combinations.generate(
+      combinations.times(test_base.default_test_combinations(),
+                         combinations.combine(num_steps=[5, 15]),
+                         combinations.combine(ram_budget=[0, 1])))
+  def testCheckpointCompressedCache(self, num_steps, ram_budget):
+
+    def ds_fn():
+      return dataset_ops.CacheDataset(
+          dataset_ops.Dataset.range(self.range_size),
+          "",
+          compression="SNAPPY",
+          ram_budget=ram_budget).repeat(self.num_repeats)
+
+    # Save a checkpoint while writing the cache (5 steps) or while reading
+    # from it (15 steps), then restore and produce the rest of the elements.
+    outputs = self.gen_outputs(ds_fn, [], num_steps, verify_exhausted=False)
+    outputs.extend(
+        self.gen_outputs(
+            ds_fn, [],
+            self.num_outputs - num_steps,
+            ckpt_saved=True,
+            verify_exhausted=False))
+    self.assertSequenceEqual(outputs, self.expected_outputs())
+
   @combinations.generate(
       combinations.times(test_base.default_test_combinations(),
                          combinations.combine(is_memory=[True, False])))
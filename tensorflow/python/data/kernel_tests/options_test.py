@@ -138,6 +138,8 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.autotune.enabled = True
     options.autotune.cpu_budget = 10
     options.autotune.ram_budget = 20
+    options.autotune.experimental_enforce_ram_budget = True
+    options.autotune.experimental_state_dir = "/tmp/autotune"
     options.deterministic = True
     options.experimental_external_state_policy = (
         options_lib.ExternalStatePolicy.FAIL)
@@ -158,6 +160,7 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.experimental_slack = True
     options.threading.max_intra_op_parallelism = 30
     options.threading.private_threadpool_size = 40
+    options.threading.experimental_numa_aware = True
     pb = options._to_proto()
     result = options_lib.Options()
     result._from_proto(pb)
@@ -187,6 +190,24 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
         dataset_options_pb2.ThreadingOptions())
     self.assertProtoEquals(expected_pb, result)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testNumaAwareThreading(self):
+    dataset = dataset_ops.Dataset.range(100)
+    dataset = dataset.interleave(
+        lambda x: dataset_ops.Dataset.from_tensors(x).repeat(2),
+        cycle_length=4,
+        block_length=2,
+        num_parallel_calls=4,
+        deterministic=True)
+    dataset = dataset.map(lambda x: x * 2, num_parallel_calls=4).batch(10)
+    dataset = dataset.prefetch(1)
+    options = options_lib.Options()
+    options.threading.experimental_numa_aware = True
+    dataset = dataset.with_options(options)
+    expected = [2 * x for x in range(100) for _ in range(2)]
+    self.assertDatasetProduces(
+        dataset, [expected[i:i + 10] for i in range(0, 200, 10)])
+
   @combinations.generate(test_base.default_test_combinations())
   def testThreadingOptionsBackwardCompatibility(self):
     opts = options_lib.Options()
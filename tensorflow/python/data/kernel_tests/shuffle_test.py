@@ -418,6 +418,55 @@ class ShuffleTest(test_base.DatasetTestBase, parameterized.TestCase):
     dataset = dataset_ops.Dataset.from_tensors(42).shuffle(1, name="shuffle")
     self.assertDatasetProduces(dataset, [42])
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testBlockShuffle(self):
+    block_length = 4
+    dataset = dataset_ops.ShuffleDataset(
+        dataset_ops.Dataset.range(22),
+        buffer_size=100,
+        seed=42,
+        block_length=block_length)
+    get_next = self.getNext(dataset)
+    output = [self.evaluate(get_next()) for _ in range(22)]
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next())
+    self.assertCountEqual(range(22), output)
+    # Each block, including the final partial one, is produced in full
+    # before the next one starts.
+    blocks = [output[i:i + block_length] for i in range(0, 20, block_length)]
+    blocks.append(output[20:])
+    for block in blocks:
+      self.assertLen(set(x // block_length for x in block), 1)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testBlockShuffleDoesNotMixEpochs(self):
+    dataset = dataset_ops.ShuffleDataset(
+        dataset_ops.Dataset.range(10),
+        buffer_size=100,
+        seed=42,
+        block_length=3).repeat(3)
+    get_next = self.getNext(dataset)
+    for _ in range(3):
+      self.assertCountEqual(
+          range(10), [self.evaluate(get_next()) for _ in range(10)])
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next())
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testBufferSizeBytes(self):
+    # Each element uses 8 bytes, so the budget only fits 2 elements and no
+    # element can be produced more than 1 position early.
+    dataset = dataset_ops.ShuffleDataset(
+        dataset_ops.Dataset.range(100),
+        buffer_size=100,
+        seed=42,
+        buffer_size_bytes=16)
+    get_next = self.getNext(dataset)
+    output = [self.evaluate(get_next()) for _ in range(100)]
+    self.assertCountEqual(range(100), output)
+    for position, element in enumerate(output):
+      self.assertLessEqual(element, position + 1)
+
 
 class ShuffleCheckpointTest(checkpoint_test_base.CheckpointTestBase,
                             parameterized.TestCase):
@@ -456,6 +505,23 @@ class ShuffleCheckpointTest(checkpoint_test_base.CheckpointTestBase,
             seed=seed,
             reshuffle_each_iteration=reshuffle_each_iteration), num_outputs)
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          checkpoint_test_base.default_test_combinations(),
+          combinations.combine(block_length=[1, 2, 3, 7])))
+  def testBlockShuffle(self, verify_fn, block_length):
+
+    def build_dataset():
+      return dataset_ops.ShuffleDataset(
+          dataset_ops.Dataset.range(7),
+          buffer_size=4,
+          seed=55,
+          block_length=block_length,
+          buffer_size_bytes=24).repeat(2)
+
+    verify_fn(self, build_dataset, num_outputs=14)
+
   @combinations.generate(
       combinations.combine(
           tf_api_version=1,
@@ -240,6 +240,53 @@ class SnapshotTest(tf_record_test_base.TFRecordTestBase,
       next_fn = self.getNext(dataset)
       self.evaluate(next_fn())
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(num_parallel_reads=[1, 3, -1])))
+  def testReadSnapshotDatasetParallelReads(self, num_parallel_reads):
+    dataset = dataset_ops.Dataset.range(1000)
+    dataset = dataset_ops._SnapshotDataset(
+        dataset,
+        self._snapshot_dir,
+        shard_func=lambda x: x % 4,
+        num_parallel_reads=num_parallel_reads,
+        deterministic=True)
+    self.assertDatasetProduces(dataset, list(range(1000)))
+    self.assertSnapshotDirectoryContains(
+        self._snapshot_dir,
+        num_fingerprints=1,
+        num_runs_per_fingerprint=1,
+        num_snapshot_shards_per_run=4)
+
+    # The second iteration reads the snapshot back in round-robin order.
+    self.assertDatasetProduces(dataset, list(range(1000)))
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testReadSnapshotDatasetParallelReadsNondeterministic(self):
+    dataset = dataset_ops.Dataset.range(1000)
+    dataset = dataset_ops._SnapshotDataset(
+        dataset,
+        self._snapshot_dir,
+        shard_func=lambda x: x % 4,
+        num_parallel_reads=4,
+        deterministic=False)
+    self.assertDatasetProduces(dataset, list(range(1000)))
+    self.assertDatasetProducesSet(dataset, list(range(1000)))
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testReadSnapshotDatasetParallelReadsUnevenShards(self):
+    dataset = dataset_ops.Dataset.range(100)
+    dataset = dataset_ops._SnapshotDataset(
+        dataset,
+        self._snapshot_dir,
+        shard_func=lambda x: x % 3,
+        num_parallel_reads=2,
+        deterministic=True)
+    self.assertDatasetProduces(dataset, list(range(100)))
+    # The first shard holds one more element than the others.
+    self.assertDatasetProduces(dataset, list(range(100)))
+
   @combinations.generate(test_base.default_test_combinations())
   def testRoundtripEmptySnapshot(self):
     dataset = dataset_ops.Dataset.range(0)
@@ -1012,7 +1059,10 @@ class LegacySnapshotTest(tf_record_test_base.TFRecordTestBase,
 class SnapshotCheckpointTest(checkpoint_test_base.CheckpointTestBase,
                              parameterized.TestCase):
 
-  def _build_snapshot_dataset(self, repeat=False):
+  def _build_snapshot_dataset(self,
+                              repeat=False,
+                              num_parallel_reads=None,
+                              deterministic=True):
 
     def ds_fn():
       self._snapshot_dir = os.path.join(self.get_temp_dir(), "snapshot")
@@ -1020,7 +1070,15 @@ class SnapshotCheckpointTest(checkpoint_test_base.CheckpointTestBase,
         os.mkdir(self._snapshot_dir)
 
       dataset = dataset_ops.Dataset.range(100)
-      dataset = dataset.snapshot(path=self._snapshot_dir)
+      if num_parallel_reads is None:
+        dataset = dataset.snapshot(path=self._snapshot_dir)
+      else:
+        dataset = dataset_ops._SnapshotDataset(
+            dataset,
+            self._snapshot_dir,
+            shard_func=lambda x: x % 4,
+            num_parallel_reads=num_parallel_reads,
+            deterministic=deterministic)
       if repeat:
         dataset = dataset.repeat(2)
       return dataset
@@ -1053,6 +1111,31 @@ class SnapshotCheckpointTest(checkpoint_test_base.CheckpointTestBase,
         outputs,
         list(range(50)) + list(range(50, 100)) + list(range(100)))
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testCheckpointWhileReadingInParallel(self):
+    ds_fn = self._build_snapshot_dataset(repeat=True, num_parallel_reads=2)
+    outputs = self.gen_outputs(
+        ds_fn, [150], 170, verify_exhausted=False, save_checkpoint_at_end=False)
+    self.assertSequenceEqual(outputs, list(range(100)) + list(range(70)))
+
+    outputs = outputs[:150]
+    outputs.extend(
+        self.gen_outputs(ds_fn, [], 50, ckpt_saved=True, verify_exhausted=True))
+    self.assertSequenceEqual(outputs, list(range(100)) + list(range(100)))
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testCheckpointWhileReadingInParallelNondeterministic(self):
+    ds_fn = self._build_snapshot_dataset(
+        repeat=True, num_parallel_reads=4, deterministic=False)
+    outputs = self.gen_outputs(ds_fn, [], 130, verify_exhausted=False)
+    self.assertCountEqual(outputs[:100], list(range(100)))
+
+    # The second epoch resumes from the saved position of every shard, so it
+    # produces each element exactly once whatever the order was.
+    outputs.extend(
+        self.gen_outputs(ds_fn, [], 70, ckpt_saved=True, verify_exhausted=True))
+    self.assertCountEqual(outputs[100:], list(range(100)))
+
   @combinations.generate(test_base.default_test_combinations())
   def testCheckpointBeforeOneEpochThenRunAFewSteps(self):
     ds_fn = self._build_snapshot_dataset(repeat=False)
@@ -20,6 +20,7 @@ import zlib
 
 from absl.testing import parameterized
 
+from tensorflow.python.data.experimental.ops import random_access
 from tensorflow.python.data.kernel_tests import checkpoint_test_base
 from tensorflow.python.data.kernel_tests import test_base
 from tensorflow.python.data.kernel_tests import tf_record_test_base
@@ -27,6 +28,8 @@ from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.ops import readers
 from tensorflow.python.framework import combinations
 from tensorflow.python.framework import constant_op
+from tensorflow.python.framework import errors
+from tensorflow.python.ops import stateless_random_ops
 from tensorflow.python.platform import test
 
 
@@ -147,6 +150,94 @@ class TFRecordDatasetTest(tf_record_test_base.TFRecordTestBase,
           [self._record(j, i) for i in range(self._num_records)])
     self.assertDatasetProduces(dataset, expected_output=expected_output)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testReadWithMmap(self):
+    dataset = readers.TFRecordDataset(
+        self._filenames, experimental_use_mmap=True)
+    expected_output = []
+    for j in range(self._num_files):
+      expected_output.extend(
+          [self._record(j, i) for i in range(self._num_records)])
+    self.assertDatasetProduces(dataset, expected_output=expected_output)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testReadCorruptedFileWithMmap(self):
+    with open(self._filenames[0], "rb") as f:
+      contents = bytearray(f.read())
+    # Corrupt the data of the last record.
+    contents[-5] ^= 1
+    corrupted = os.path.join(self.get_temp_dir(), "tfrecord_corrupted")
+    with open(corrupted, "wb") as f:
+      f.write(contents)
+    dataset = readers.TFRecordDataset(corrupted, experimental_use_mmap=True)
+    get_next = self.getNext(dataset)
+    for i in range(self._num_records - 1):
+      self.assertEqual(self._record(0, i), self.evaluate(get_next()))
+    with self.assertRaisesRegex(errors.DataLossError, "corrupted record"):
+      self.evaluate(get_next())
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testReadWithIndex(self):
+    dataset = readers._TFRecordDataset(self._filenames, use_index=True)
+    expected_output = []
+    for j in range(self._num_files):
+      expected_output.extend(
+          [self._record(j, i) for i in range(self._num_records)])
+    self.assertEqual(len(expected_output),
+                     self.evaluate(dataset.cardinality()))
+    self.assertDatasetProduces(dataset, expected_output=expected_output)
+
+    # Skipping seeks across files to the first record after the skipped ones.
+    num_records = self._num_files * self._num_records
+    for num_to_skip in [1, self._num_records, num_records - 1, num_records]:
+      self.assertDatasetProduces(
+          dataset.skip(num_to_skip),
+          expected_output=expected_output[num_to_skip:])
+    self.assertDatasetProduces(
+        dataset.shard(3, 1), expected_output=expected_output[1::3])
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testReadWithCorruptedIndex(self):
+    with open(self._filenames[0] + ".index", "wb") as f:
+      f.write(b"not an index")
+    # Indices are loaded on first use, so the error surfaces on random access.
+    dataset = readers._TFRecordDataset(self._filenames, use_index=True)
+    with self.assertRaisesRegex(errors.DataLossError, "record index"):
+      self.evaluate(random_access.at(dataset, 0))
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testRandomAccessWithIndex(self):
+    dataset = readers._TFRecordDataset(self._filenames, use_index=True)
+    for j in range(self._num_files):
+      for i in range(self._num_records):
+        self.assertEqual(
+            self._record(j, i),
+            self.evaluate(
+                random_access.at(dataset, j * self._num_records + i)))
+
+    # Reading the records at a permutation of the indices shuffles the whole
+    # dataset without a shuffle buffer.
+    num_records = self._num_files * self._num_records
+    shuffled = dataset_ops.Dataset.range(num_records).map(
+        lambda i: random_access.at(  # pylint: disable=g-long-lambda
+            dataset,
+            stateless_random_ops.index_shuffle(
+                i, seed=[5, 9], max_index=num_records - 1)))
+    expected_output = []
+    for j in range(self._num_files):
+      expected_output.extend(
+          [self._record(j, i) for i in range(self._num_records)])
+    self.assertDatasetProduces(
+        shuffled, expected_output=expected_output, assert_items_equal=True)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testIndexRequiresUncompressedFiles(self):
+    with self.assertRaisesRegex(errors.InvalidArgumentError,
+                                "requires uncompressed files"):
+      dataset = readers._TFRecordDataset(
+          self._filenames, compression_type="ZLIB", use_index=True)
+      self.evaluate(dataset.cardinality())
+
   @combinations.generate(test_base.default_test_combinations())
   def testReadFromDatasetOfFiles(self):
     files = dataset_ops.Dataset.from_tensor_slices(self._filenames)
@@ -196,7 +287,8 @@ class TFRecordDatasetCheckpointTest(tf_record_test_base.TFRecordTestBase,
                    num_epochs,
                    batch_size=1,
                    compression_type=None,
-                   buffer_size=None):
+                   buffer_size=None,
+                   use_mmap=False):
     filenames = self._createFiles()
     if compression_type == "ZLIB":
       zlib_files = []
@@ -220,8 +312,10 @@ class TFRecordDatasetCheckpointTest(tf_record_test_base.TFRecordTestBase,
       filenames = gzip_files
 
     return readers.TFRecordDataset(
-        filenames, compression_type,
-        buffer_size=buffer_size).repeat(num_epochs).batch(batch_size)
+        filenames,
+        compression_type,
+        buffer_size=buffer_size,
+        experimental_use_mmap=use_mmap).repeat(num_epochs).batch(batch_size)
 
   @combinations.generate(
       combinations.times(
@@ -260,6 +354,15 @@ class TFRecordDatasetCheckpointTest(tf_record_test_base.TFRecordTestBase,
         self, lambda: self.make_dataset(
             num_epochs, compression_type=compression_type), num_outputs)
 
+  @combinations.generate(
+      combinations.times(test_base.default_test_combinations(),
+                         checkpoint_test_base.default_test_combinations()))
+  def testMmap(self, verify_fn):
+    num_epochs = 5
+    num_outputs = num_epochs * self._num_files * self._num_records
+    verify_fn(self, lambda: self.make_dataset(num_epochs, use_mmap=True),
+              num_outputs)
+
 
 if __name__ == "__main__":
   test.main()
@@ -5142,17 +5142,40 @@ class RangeDataset(DatasetSource):
 class CacheDataset(UnaryUnchangedStructureDataset):
   """A `Dataset` that caches elements of its input."""
 
-  def __init__(self, input_dataset, filename, name=None):
-    """See `Dataset.cache()` for details."""
+  def __init__(self,
+               input_dataset,
+               filename,
+               compression=None,
+               ram_budget=None,
+               name=None):
+    """See `Dataset.cache()` for details.
+
+    Args:
+      input_dataset: The input dataset.
+      filename: See `Dataset.cache()`.
+      compression: (Optional.) If set to `"SNAPPY"`, an in-memory cache keeps
+        its elements compressed with snappy. Requires `filename` to be empty.
+      ram_budget: (Optional.) If positive, a compressed in-memory cache keeps
+        at most this many compressed bytes in memory and spills the remaining
+        elements to a temporary file on local disk.
+      name: (Optional.) A name for the tf.data operation.
+    """
     self._input_dataset = input_dataset
     self._filename = ops.convert_to_tensor(
         filename, dtype=dtypes.string, name="filename")
+    self._compression = compression or ""
+    self._ram_budget = ram_budget or 0
     self._name = name
-    if tf2.enabled() and (context.executing_eagerly() or ops.inside_function()):
+    # Only `CacheDatasetV2` supports the compression and memory budget options.
+    if ((tf2.enabled() and
+         (context.executing_eagerly() or ops.inside_function())) or
+        self._compression or self._ram_budget):
       variant_tensor = gen_dataset_ops.cache_dataset_v2(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
           cache=gen_dataset_ops.dummy_memory_cache(),
+          compression=self._compression,
+          ram_budget=self._ram_budget,
           **self._common_args)
     else:
       variant_tensor = gen_dataset_ops.cache_dataset(
@@ -5170,8 +5193,25 @@ class ShuffleDataset(UnaryUnchangedStructureDataset):
                buffer_size,
                seed=None,
                reshuffle_each_iteration=None,
+               block_length=None,
+               buffer_size_bytes=None,
                name=None):
-    """See `Dataset.shuffle()` for details."""
+    """See `Dataset.shuffle()` for details.
+
+    Args:
+      input_dataset: The input dataset.
+      buffer_size: See `Dataset.shuffle()`.
+      seed: See `Dataset.shuffle()`.
+      reshuffle_each_iteration: See `Dataset.shuffle()`.
+      block_length: (Optional.) If positive, the input is shuffled in blocks of
+        this many consecutive elements: a random buffered block is picked and
+        its elements are produced in a random order. Elements of different
+        epochs are not mixed in this mode.
+      buffer_size_bytes: (Optional.) If positive, the buffer stops filling once
+        its elements use this many bytes, even if it holds fewer than
+        `buffer_size` elements.
+      name: (Optional.) A name for the tf.data operation.
+    """
     self._input_dataset = input_dataset
     self._buffer_size = ops.convert_to_tensor(
         buffer_size, dtype=dtypes.int64, name="buffer_size")
@@ -5179,10 +5219,14 @@ class ShuffleDataset(UnaryUnchangedStructureDataset):
     if reshuffle_each_iteration is None:
       reshuffle_each_iteration = True
     self._reshuffle_each_iteration = reshuffle_each_iteration
+    self._block_length = block_length or 0
+    self._buffer_size_bytes = buffer_size_bytes or 0
     self._name = name
 
-    if (tf2.enabled() and
-        (context.executing_eagerly() or ops.inside_function())):
+    # Only `ShuffleDatasetV3` supports the block and byte budget options.
+    if ((tf2.enabled() and
+         (context.executing_eagerly() or ops.inside_function())) or
+        self._block_length or self._buffer_size_bytes):
       variant_tensor = gen_dataset_ops.shuffle_dataset_v3(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           buffer_size=self._buffer_size,
@@ -5190,6 +5234,8 @@ class ShuffleDataset(UnaryUnchangedStructureDataset):
           seed2=self._seed2,
           seed_generator=gen_dataset_ops.dummy_seed_generator(),
           reshuffle_each_iteration=self._reshuffle_each_iteration,
+          block_length=self._block_length,
+          buffer_size_bytes=self._buffer_size_bytes,
           **self._common_args)
     else:
       variant_tensor = gen_dataset_ops.shuffle_dataset(
@@ -6031,6 +6077,8 @@ class _SnapshotDataset(UnaryUnchangedStructureDataset):
                reader_func=None,
                pending_snapshot_expiry_seconds=None,
                use_legacy_function=False,
+               num_parallel_reads=None,
+               deterministic=None,
                name=None):
 
     if reader_func is None:
@@ -6063,6 +6111,17 @@ class _SnapshotDataset(UnaryUnchangedStructureDataset):
                       f"`tf.int64` scalar tensor but its return type is "
                       f"{self._shard_func.output_structure}.")
 
+    # If `num_parallel_reads` is set, the snapshot shards are read by a
+    # parallel reader in the kernel and `reader_func` is not used.
+    if num_parallel_reads is None:
+      num_parallel_reads = 0
+    if deterministic is None:
+      deterministic_string = "default"
+    elif deterministic:
+      deterministic_string = "true"
+    else:
+      deterministic_string = "false"
+
     self._name = name
     variant_tensor = ged_ops.snapshot_dataset_v2(
         input_dataset._variant_tensor,  # pylint: disable=protected-access
@@ -6072,6 +6131,8 @@ class _SnapshotDataset(UnaryUnchangedStructureDataset):
         compression=compression,
         reader_func=self._reader_func.function,
         shard_func=self._shard_func.function,
+        num_parallel_reads=num_parallel_reads,
+        deterministic=deterministic_string,
         **self._common_args)
     super(_SnapshotDataset, self).__init__(input_dataset, variant_tensor)
 
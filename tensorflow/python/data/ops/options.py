@@ -227,6 +227,25 @@ class AutotuneOptions(options_lib.OptionsBase):
       docstring="When autotuning is enabled (through `autotune`), determines "
       "the algorithm to use.")
 
+  experimental_enforce_ram_budget = options_lib.create_option(
+      name="experimental_enforce_ram_budget",
+      ty=bool,
+      docstring="When autotuning is enabled (through `autotune`), determines "
+      "whether `ram_budget` is a hard limit. If True, the bytes buffered by "
+      "all transformations, including `shuffle`, count against the budget, "
+      "and buffer sizes and parallelism are reduced based on measured "
+      "element sizes when the pipeline exceeds it. If None, defaults to "
+      "False.")
+
+  experimental_state_dir = options_lib.create_option(
+      name="experimental_state_dir",
+      ty=str,
+      docstring="When autotuning is enabled (through `autotune`), determines "
+      "a directory in which the tuned parallelism and buffer sizes are saved, "
+      "keyed by the fingerprint of the input pipeline graph. A later run of "
+      "the same input pipeline starts from the saved values instead of "
+      "repeating the warm-up. If None, the tuned values are not persisted.")
+
   def _to_proto(self):
     pb = dataset_options_pb2.AutotuneOptions()
     if self.enabled is not None:
@@ -238,6 +257,10 @@ class AutotuneOptions(options_lib.OptionsBase):
     if self.autotune_algorithm is not None:
       pb.autotune_algorithm = AutotuneAlgorithm._to_proto(  # pylint: disable=protected-access
           self.autotune_algorithm)
+    if self.experimental_enforce_ram_budget is not None:
+      pb.enforce_ram_budget = self.experimental_enforce_ram_budget
+    if self.experimental_state_dir is not None:
+      pb.state_dir = self.experimental_state_dir
     return pb
 
   def _from_proto(self, pb):
@@ -250,6 +273,10 @@ class AutotuneOptions(options_lib.OptionsBase):
     if pb.WhichOneof("optional_autotune_algorithm") is not None:
       self.autotune_algorithm = AutotuneAlgorithm._from_proto(  # pylint: disable=protected-access
           pb.autotune_algorithm)
+    if pb.WhichOneof("optional_enforce_ram_budget") is not None:
+      self.experimental_enforce_ram_budget = pb.enforce_ram_budget
+    if pb.WhichOneof("optional_state_dir") is not None:
+      self.experimental_state_dir = pb.state_dir
 
   def _set_mutable(self, mutable):
     """Change the mutability value to `mutable` on this options and children."""
@@ -473,12 +500,22 @@ class ThreadingOptions(options_lib.OptionsBase):
       "The value 0 can be used to indicate that the threadpool size should be "
       "determined at runtime based on the number of available CPU cores.")
 
+  experimental_numa_aware = options_lib.create_option(
+      name="experimental_numa_aware",
+      ty=bool,
+      docstring=
+      "Whether the dataset should pin its threads to NUMA nodes and allocate "
+      "element buffers on the node of the thread that produces them. Has no "
+      "effect on hosts with a single NUMA node. If None, defaults to False.")
+
   def _to_proto(self):
     pb = dataset_options_pb2.ThreadingOptions()
     if self.max_intra_op_parallelism is not None:
       pb.max_intra_op_parallelism = self.max_intra_op_parallelism
     if self.private_threadpool_size is not None:
       pb.private_threadpool_size = self.private_threadpool_size
+    if self.experimental_numa_aware is not None:
+      pb.numa_aware = self.experimental_numa_aware
     return pb
 
   def _from_proto(self, pb):
@@ -486,6 +523,8 @@ class ThreadingOptions(options_lib.OptionsBase):
       self.max_intra_op_parallelism = pb.max_intra_op_parallelism
     if pb.WhichOneof("optional_private_threadpool_size") is not None:
       self.private_threadpool_size = pb.private_threadpool_size
+    if pb.WhichOneof("optional_numa_aware") is not None:
+      self.experimental_numa_aware = pb.numa_aware
 
 
 @tf_export("data.Options")
@@ -282,6 +282,8 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
                filenames,
                compression_type=None,
                buffer_size=None,
+               use_mmap=False,
+               use_index=False,
                name=None):
     """Creates a `TFRecordDataset`.
 
@@ -291,6 +293,10 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         `""` (no compression), `"ZLIB"`, or `"GZIP"`.
       buffer_size: (Optional.) A `tf.int64` scalar representing the number of
         bytes in the read buffer. 0 means no buffering.
+      use_mmap: (Optional.) Whether to read uncompressed files through a memory
+        mapping.
+      use_index: (Optional.) Whether to locate the records of uncompressed
+        files with their record indices, for random access and fast skipping.
       name: (Optional.) A name for the tf.data operation.
     """
     self._filenames = filenames
@@ -306,8 +312,12 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
     self._name = name
 
     variant_tensor = gen_dataset_ops.tf_record_dataset(
-        self._filenames, self._compression_type, self._buffer_size,
-        metadata=self._metadata.SerializeToString())
+        self._filenames,
+        self._compression_type,
+        self._buffer_size,
+        metadata=self._metadata.SerializeToString(),
+        use_mmap=use_mmap,
+        use_index=use_index)
     super(_TFRecordDataset, self).__init__(variant_tensor)
 
   @property
@@ -430,6 +440,8 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
                compression_type=None,
                buffer_size=None,
                num_parallel_reads=None,
+               experimental_use_mmap=False,
+               experimental_use_index=False,
                name=None):
     """Creates a `TFRecordDataset` to read one or more TFRecord files.
 
@@ -450,6 +462,17 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
         input pipeline is I/O bottlenecked, consider setting this parameter to a
         value greater than one to parallelize the I/O. If `None`, files will be
         read sequentially.
+      experimental_use_mmap: (Optional.) If `True`, uncompressed files on file
+        systems that support it (such as local disks) are memory mapped instead
+        of read through a buffer, and their checksums are verified a chunk of
+        records at a time. This saves a copy and a read call per record. Other
+        files are read as usual.
+      experimental_use_index: (Optional.) If `True`, the files must be
+        uncompressed, and the offset of every record is read from the record
+        index stored next to each file as `<filename>.index`, or found by
+        scanning the file once when it has no index. `skip`, `shard` and
+        checkpoint restore then seek directly to a record instead of reading
+        through the records before it.
       name: (Optional.) A name for the tf.data operation.
 
     Raises:
@@ -465,7 +488,12 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
 
     def creator_fn(filename):
       return _TFRecordDataset(
-          filename, compression_type, buffer_size, name=name)
+          filename,
+          compression_type,
+          buffer_size,
+          use_mmap=experimental_use_mmap,
+          use_index=experimental_use_index,
+          name=name)
 
     self._impl = _create_dataset_reader(
         creator_fn, filenames, num_parallel_reads, name=name)
@@ -489,9 +517,17 @@ class TFRecordDatasetV1(dataset_ops.DatasetV1Adapter):
                compression_type=None,
                buffer_size=None,
                num_parallel_reads=None,
+               experimental_use_mmap=False,
+               experimental_use_index=False,
                name=None):
     wrapped = TFRecordDatasetV2(
-        filenames, compression_type, buffer_size, num_parallel_reads, name=name)
+        filenames,
+        compression_type,
+        buffer_size,
+        num_parallel_reads,
+        experimental_use_mmap=experimental_use_mmap,
+        experimental_use_index=experimental_use_index,
+        name=name)
     super(TFRecordDatasetV1, self).__init__(wrapped)
 
   __init__.__doc__ = TFRecordDatasetV2.__init__.__doc__
@@ -1820,7 +1820,12 @@ class MutableHashTable(LookupInterface):
                default_value,
                name="MutableHashTable",
                checkpoint=True,
-               experimental_is_anonymous=False):
+               experimental_is_anonymous=False,
+               experimental_num_shards=1,
+               experimental_max_size=0,
+               experimental_eviction_policy="lru",
+               experimental_min_frequency=0,
+               experimental_spill_dir=""):
     """Creates an empty `MutableHashTable` object.
 
     Creates a table, the type of its keys and values are specified by key_dtype
@@ -1840,12 +1845,34 @@ class MutableHashTable(LookupInterface):
         be looked up by a name. When all resource handles pointing to
         that resource are gone, the resource will be deleted
         automatically.
+      experimental_num_shards: Number of independently locked partitions the
+        table is split into (default is 1). Values larger than 1 let lookups
+        and inserts issued concurrently from many threads proceed without
+        contending on a single table lock.
+      experimental_max_size: If positive, the table is kept to roughly this
+        many entries by evicting entries in the background (default is 0,
+        unbounded). Only supported for tables with non-scalar values.
+      experimental_eviction_policy: Either "lru" (default), which evicts the
+        least recently accessed entries, or "lfu", which evicts the least
+        frequently accessed ones, when `experimental_max_size` is set.
+      experimental_min_frequency: If greater than 1, a new key is only admitted
+        to the table once it has been inserted this many times; until then
+        lookups return the default value (default is 0). Only supported for
+        tables with non-scalar values.
+      experimental_spill_dir: If non-empty, entries evicted because of
+        `experimental_max_size` are written to a file in this local directory
+        instead of being dropped, and are read back into memory when next
+        looked up or prefetched with `experimental_prefetch`. This lets the
+        table hold more entries than fit in memory. Requires
+        `experimental_max_size`.
 
     Returns:
       A `MutableHashTable` object.
 
     Raises:
-      ValueError: If checkpoint is True and no name was specified.
+      ValueError: If checkpoint is True and no name was specified, or if
+        `experimental_max_size`, `experimental_min_frequency` or
+        `experimental_spill_dir` is set for a table with scalar values.
     """
     self._default_value = ops.convert_to_tensor(
         default_value, dtype=value_dtype)
@@ -1855,6 +1882,18 @@ class MutableHashTable(LookupInterface):
     self._value_dtype = value_dtype
     self._name = name
     self._is_anonymous = experimental_is_anonymous
+    self._num_shards = experimental_num_shards
+    self._max_size = experimental_max_size
+    self._eviction_policy = experimental_eviction_policy
+    self._min_frequency = experimental_min_frequency
+    self._spill_dir = experimental_spill_dir
+    if self._value_shape.ndims == 0 and (self._max_size or self._min_frequency
+                                         or self._spill_dir):
+      raise ValueError(
+          "`experimental_max_size`, `experimental_min_frequency` and "
+          "`experimental_spill_dir` are only supported for tables with "
+          "non-scalar values, received default_value of shape "
+          f"{self._value_shape}.")
     if not self._is_anonymous:
       self._shared_name = None
       if context.executing_eagerly():
@@ -1876,12 +1915,18 @@ class MutableHashTable(LookupInterface):
         table_ref = gen_lookup_ops.anonymous_mutable_hash_table(
             key_dtype=self._key_dtype,
             value_dtype=self._value_dtype,
+            num_shards=self._num_shards,
             name=self._name)
       else:
         table_ref = gen_lookup_ops.anonymous_mutable_hash_table_of_tensors(
             key_dtype=self._key_dtype,
             value_dtype=self._value_dtype,
             value_shape=self._default_value.get_shape(),
+            num_shards=self._num_shards,
+            max_size=self._max_size,
+            eviction_policy=self._eviction_policy,
+            min_frequency=self._min_frequency,
+            spill_dir=self._spill_dir,
             name=self._name)
     else:
       # The table must be shared if checkpointing is requested for multi-worker
@@ -1894,6 +1939,7 @@ class MutableHashTable(LookupInterface):
             use_node_name_sharing=use_node_name_sharing,
             key_dtype=self._key_dtype,
             value_dtype=self._value_dtype,
+            num_shards=self._num_shards,
             name=self._name)
       else:
         table_ref = gen_lookup_ops.mutable_hash_table_of_tensors_v2(
@@ -1902,6 +1948,11 @@ class MutableHashTable(LookupInterface):
             key_dtype=self._key_dtype,
             value_dtype=self._value_dtype,
             value_shape=self._default_value.get_shape(),
+            num_shards=self._num_shards,
+            max_size=self._max_size,
+            eviction_policy=self._eviction_policy,
+            min_frequency=self._min_frequency,
+            spill_dir=self._spill_dir,
             name=self._name)
 
     if context.executing_eagerly():
@@ -1953,6 +2004,36 @@ class MutableHashTable(LookupInterface):
 
     return op
 
+  def experimental_prefetch(self, keys, name=None):
+    """Hints that `keys` are about to be looked up.
+
+    For a table created with `experimental_spill_dir`, starts reading the
+    entries of `keys` that were spilled to disk back into memory in the
+    background, so that a later `lookup` does not wait for them. Running it
+    for the next batch while the current one is processed overlaps the disk
+    reads with computation. Does nothing for other tables.
+
+    Args:
+      keys: Keys to prefetch. Can be a tensor of any shape. Must match the
+        table's key type.
+      name: A name for the operation (optional).
+
+    Returns:
+      The created Operation.
+
+    Raises:
+      TypeError: when `keys` do not match the table data types.
+    """
+    if keys.dtype != self._key_dtype:
+      raise TypeError(f"Dtype of argument `keys` must be {self._key_dtype}, "
+                      f"received: {keys.dtype}")
+
+    with ops.name_scope(name, "%s_lookup_table_prefetch" % self.name,
+                        (self.resource_handle, keys)):
+      op = gen_lookup_ops.lookup_table_prefetch(self.resource_handle, keys)
+
+    return op
+
   def lookup(self, keys, dynamic_default_values=None, name=None):
     """Looks up `keys` in a table, outputs the corresponding values.
 
@@ -2124,7 +2205,8 @@ class DenseHashTable(LookupInterface):
                initial_num_buckets=None,
                name="MutableDenseHashTable",
                checkpoint=True,
-               experimental_is_anonymous=False):
+               experimental_is_anonymous=False,
+               experimental_layout="quadratic"):
     """Creates an empty `DenseHashTable` object.
 
     Creates a table, the type of its keys and values are specified by key_dtype
@@ -2155,6 +2237,11 @@ class DenseHashTable(LookupInterface):
         be looked up by a name. When all resource handles pointing to
         that resource are gone, the resource will be deleted
         automatically.
+      experimental_layout: The bucket layout of the table, either
+        "quadratic" (default) or "swiss". The "swiss" layout probes groups of
+        buckets with SIMD compares and grows incrementally across inserts
+        instead of rehashing the whole table at once, which keeps lookup
+        latency flat while the table grows.
 
     Returns:
       A `DenseHashTable` object.
@@ -2175,6 +2262,7 @@ class DenseHashTable(LookupInterface):
     self._empty_key = empty_key
     self._deleted_key = deleted_key
     self._is_anonymous = experimental_is_anonymous
+    self._layout = experimental_layout
     if not self._is_anonymous:
       self._shared_name = None
       if context.executing_eagerly():
@@ -2202,6 +2290,7 @@ class DenseHashTable(LookupInterface):
           value_dtype=self._value_dtype,
           value_shape=self._value_shape,
           initial_num_buckets=self._initial_num_buckets,
+          layout=self._layout,
           name=self._name)
     else:
       # The table must be shared if checkpointing is requested for multi-worker
@@ -2216,6 +2305,7 @@ class DenseHashTable(LookupInterface):
           value_dtype=self._value_dtype,
           value_shape=self._value_shape,
           initial_num_buckets=self._initial_num_buckets,
+          layout=self._layout,
           name=self._name)
     if context.executing_eagerly():
       self._table_name = None
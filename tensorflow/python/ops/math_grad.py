@@ -19,6 +19,7 @@ from tensorflow.python.compat import compat
 from tensorflow.python.eager import context
 from tensorflow.python.framework import constant_op
 from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import indexed_slices as indexed_slices_lib
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import tensor_util
 from tensorflow.python.ops import array_ops
@@ -388,6 +389,29 @@ def _SparseSegmentSqrtNWithNumSegmentsGrad(op, grad):
                                               dim0), None, None, None)
 
 
+@ops.RegisterGradient("FusedSparseEmbeddingLookup")
+def _FusedSparseEmbeddingLookupGrad(op, grad):
+  """Gradient for FusedSparseEmbeddingLookup."""
+  params = op.inputs[0]
+  values, indices = gen_math_ops.fused_sparse_embedding_lookup_grad(
+      grad,
+      params,
+      op.inputs[1],
+      op.inputs[2],
+      op.inputs[3],
+      combiner=op.get_attr("combiner"),
+      max_norm=op.get_attr("max_norm"))
+  params_grad = indexed_slices_lib.IndexedSlices(
+      values, indices, array_ops.shape(params, out_type=indices.dtype))
+  return (params_grad, None, None, None, None)
+
+
+# Low-precision tables are lookup-only; they are refreshed from a float32
+# table with QuantizeEmbeddingRows rather than trained in place.
+ops.NotDifferentiable("FusedSparseEmbeddingLookupDequantize")
+ops.NotDifferentiable("QuantizeEmbeddingRows")
+
+
 def _SegmentMinOrMaxGrad(op, grad):
   """ Gradient for SegmentMin and SegmentMax. """
   zeros = array_ops.zeros_like(op.inputs[0], dtype=op.inputs[0].dtype)
@@ -399,6 +399,58 @@ class TrainingOpsTest(TensorFlowTestCase):
       indices = np.array([0, 2]).astype(index_type)
       self._testTypesForSparseFtrlMultiplyLinearByLr(x, y, z, lr, grad, indices)
 
+  @test_util.run_in_graph_and_eager_modes
+  def testResourceSparseApplyRowStripedLocking(self):
+    # Repeated indices must be applied in order, as in the serial kernels.
+    x = np.arange(40).reshape([20, 2]).astype(np.float32)
+    y = np.ones([20, 2]).astype(np.float32)
+    grad = np.arange(1, 13).reshape([6, 2]).astype(np.float32)
+    indices = np.array([3, 17, 3, 0, 17, 3], dtype=np.int32)
+    lr = 0.5
+
+    expected_var, expected_accum = x.copy(), y.copy()
+    for i, index in enumerate(indices):
+      expected_accum[index] += grad[i] * grad[i]
+      expected_var[index] -= lr * grad[i] / np.sqrt(expected_accum[index])
+
+    with self.cached_session(use_gpu=False):
+      var = resource_variable_ops.ResourceVariable(x)
+      accum = resource_variable_ops.ResourceVariable(y)
+      self.evaluate(variables.global_variables_initializer())
+      self.evaluate(
+          training_ops.resource_sparse_apply_adagrad(
+              var.handle,
+              accum.handle,
+              lr,
+              grad,
+              indices,
+              row_striped_locking=True))
+      self.assertAllClose(expected_var, self.evaluate(var))
+      self.assertAllClose(expected_accum, self.evaluate(accum))
+
+      # The same updates through the serial Ftrl kernel must match the
+      # row-striped one.
+      results = []
+      for row_striped_locking in [False, True]:
+        var = resource_variable_ops.ResourceVariable(x)
+        accum = resource_variable_ops.ResourceVariable(y)
+        linear = resource_variable_ops.ResourceVariable(np.zeros_like(x))
+        self.evaluate(variables.global_variables_initializer())
+        self.evaluate(
+            training_ops.resource_sparse_apply_ftrl(
+                var.handle,
+                accum.handle,
+                linear.handle,
+                grad,
+                indices,
+                lr,
+                0.1,
+                0.2,
+                -0.5,
+                row_striped_locking=row_striped_locking))
+        results.append(self.evaluate([var, accum, linear]))
+      self.assertAllClose(results[0], results[1])
+
   @test_util.run_v1_only("ApplyAdam op returns a ref, so it is not "
                          "supported in eager mode.")
   def testApplyAdam(self):
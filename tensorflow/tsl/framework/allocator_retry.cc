@@ -71,8 +71,10 @@ void* AllocatorRetry::AllocateRaw(
       if (now < deadline_micros) {
         tracker.Enable();
         mutex_lock l(mu_);
+        num_waiters_.fetch_add(1, std::memory_order_release);
         WaitForMilliseconds(&l, &memory_returned_,
                             (deadline_micros - now) / 1000);
+        num_waiters_.fetch_sub(1, std::memory_order_release);
       } else {
         return alloc_func(alignment, num_bytes, true);
       }
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_TSL_FRAMEWORK_ALLOCATOR_RETRY_H_
 #define TENSORFLOW_TSL_FRAMEWORK_ALLOCATOR_RETRY_H_
 
+#include <atomic>
+
 #include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/mutex.h"
 #include "tensorflow/tsl/platform/types.h"
@@ -47,10 +49,14 @@ class AllocatorRetry {
   Env* env_;
   mutex mu_;
   condition_variable memory_returned_;
+  // Number of callers blocked in AllocateRaw(), so that NotifyDealloc() can
+  // skip taking mu_ when nobody is waiting.
+  std::atomic<int> num_waiters_{0};
 };
 
 // Implementation details below
 inline void AllocatorRetry::NotifyDealloc() {
+  if (num_waiters_.load(std::memory_order_acquire) == 0) return;
   mutex_lock l(mu_);
   memory_returned_.notify_all();
 }
@@ -17,11 +17,14 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <functional>
+#include <thread>  // NOLINT
 #include <utility>
 
 #include "absl/strings/string_view.h"
 #include "tensorflow/tsl/framework/allocator_retry.h"
 #include "tensorflow/tsl/lib/core/bits.h"
+#include "tensorflow/tsl/platform/cpu_info.h"
 #include "tensorflow/tsl/platform/file_system.h"
 #include "tensorflow/tsl/platform/logging.h"
 #include "tensorflow/tsl/platform/mutex.h"
@@ -39,6 +42,7 @@ limitations under the License.
 namespace tsl {
 
 constexpr BFCAllocator::ChunkHandle BFCAllocator::kInvalidChunkHandle;
+constexpr int64_t BFCAllocator::kCachedAllocationId;
 
 BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
                            size_t total_memory, const string& name,
@@ -80,6 +84,21 @@ BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
       CHECK_NE(BinForSize(bin_size * 2), BinFromIndex(b));
     }
   }
+
+#ifndef TENSORFLOW_MEM_DEBUG
+  // The caches do not record the op that made each allocation, so they are
+  // disabled when debugging memory usage.
+  if (opts.per_cpu_cache_bytes > 0) {
+    const int num_caches = std::max(port::NumTotalCPUs(), 1);
+    VLOG(1) << "Creating " << num_caches << " caches of "
+            << strings::HumanReadableNumBytes(opts.per_cpu_cache_bytes)
+            << " for " << name;
+    caches_.reserve(num_caches);
+    for (int i = 0; i < num_caches; ++i) {
+      caches_.push_back(std::make_unique<ChunkCache>());
+    }
+  }
+#endif
 }
 
 BFCAllocator::~BFCAllocator() {
@@ -258,6 +277,14 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes;
+  if (!caches_.empty() && timing_counter_ == nullptr) {
+    void* result = AllocateFromCache(num_bytes);
+    if (result != nullptr) {
+      VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes << " " << result
+              << " from cache";
+      return result;
+    }
+  }
   void* result = [&] {
     if (!opts_.allow_retry_on_failure || !allocation_attr.retry_on_failure) {
       // If we have globally disabled retry-on-failure and fail to allocate an
@@ -444,6 +471,16 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // Return the chunks held by the per-CPU caches to the bins, where they can
+  // be merged with their neighbors.
+  if (FlushCaches()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, freed_before);
+    if (ptr != nullptr) {
+      AddTraceMe("MemoryAllocation", ptr);
+      return ptr;
+    }
+  }
+
   if ((freed_before == 0) && (!timestamped_chunks_.empty())) {
     // We're unable to satisfy an allocation request without a specific
     // timestamp requirement.  Rather than fail, try merging any held-out
@@ -494,6 +531,109 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
   return nullptr;
 }
 
+BFCAllocator::ChunkCache* BFCAllocator::CacheForCurrentCPU() {
+  const int cpu = port::GetCurrentCPU();
+  const size_t index =
+      cpu >= 0 ? cpu
+               : std::hash<std::thread::id>()(std::this_thread::get_id());
+  return caches_[index % caches_.size()].get();
+}
+
+void* BFCAllocator::AllocateFromCache(size_t num_bytes) {
+  const size_t rounded_bytes = RoundedBytes(num_bytes);
+  if (num_bytes == 0 || rounded_bytes > kMaxCachedChunkSize) {
+    return nullptr;
+  }
+  ChunkCache* cache = CacheForCurrentCPU();
+  tf_shared_lock l(lock_);
+  ChunkHandle h;
+  {
+    mutex_lock cache_lock(cache->mu);
+    std::vector<ChunkHandle>& free_chunks =
+        cache->free_chunks[rounded_bytes / kMinAllocationSize - 1];
+    if (free_chunks.empty()) {
+      return nullptr;
+    }
+    h = free_chunks.back();
+    free_chunks.pop_back();
+    cache->bytes -= rounded_bytes;
+    ++cache->num_allocs;
+    cache->largest_alloc_size =
+        std::max<int64_t>(cache->largest_alloc_size, rounded_bytes);
+  }
+
+  // The chunk is owned by this thread until it is returned, so it can be
+  // updated without holding lock_ exclusively.
+  Chunk* chunk = ChunkFromHandle(h);
+  DCHECK(chunk->in_cache());
+  DCHECK_EQ(chunk->size, rounded_bytes);
+  chunk->requested_size = num_bytes;
+  chunk->allocation_id = next_allocation_id_++;
+
+  const int64_t bytes_in_use =
+      stats_.bytes_in_use -
+      (cached_bytes_.fetch_sub(rounded_bytes, std::memory_order_relaxed) -
+       static_cast<int64_t>(rounded_bytes));
+  int64_t peak = cache_peak_bytes_in_use_.load(std::memory_order_relaxed);
+  while (bytes_in_use > peak &&
+         !cache_peak_bytes_in_use_.compare_exchange_weak(
+             peak, bytes_in_use, std::memory_order_relaxed)) {
+  }
+
+  AddTraceMe("MemoryAllocation", chunk->ptr, num_bytes, rounded_bytes);
+  return chunk->ptr;
+}
+
+bool BFCAllocator::DeallocateToCache(void* ptr) {
+  ChunkCache* cache = CacheForCurrentCPU();
+  tf_shared_lock l(lock_);
+  BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
+  CHECK(h != kInvalidChunkHandle);
+  Chunk* chunk = ChunkFromHandle(h);
+  const size_t chunk_size = chunk->size;
+  const int64_t req_bytes = chunk->requested_size;
+  if (chunk_size > kMaxCachedChunkSize) {
+    return false;
+  }
+  {
+    mutex_lock cache_lock(cache->mu);
+    if (cache->bytes + chunk_size > opts_.per_cpu_cache_bytes) {
+      return false;
+    }
+    DCHECK(chunk->in_use() && !chunk->in_cache());
+    chunk->allocation_id = kCachedAllocationId;
+    cached_bytes_.fetch_add(chunk_size, std::memory_order_relaxed);
+    cache->bytes += chunk_size;
+    cache->free_chunks[chunk_size / kMinAllocationSize - 1].push_back(h);
+  }
+  AddTraceMe("MemoryDeallocation", ptr, req_bytes, chunk_size);
+  return true;
+}
+
+bool BFCAllocator::FlushCaches() {
+  bool flushed = false;
+  for (const auto& cache : caches_) {
+    mutex_lock cache_lock(cache->mu);
+    for (std::vector<ChunkHandle>& free_chunks : cache->free_chunks) {
+      for (ChunkHandle h : free_chunks) {
+        Chunk* c = ChunkFromHandle(h);
+        DCHECK(c->in_cache());
+        cached_bytes_.fetch_sub(c->size, std::memory_order_relaxed);
+        MarkFree(h);
+        InsertFreeChunkIntoBin(TryToCoalesce(h, /*ignore_freed_at=*/false));
+        flushed = true;
+      }
+      free_chunks.clear();
+    }
+    cache->bytes = 0;
+  }
+  return flushed;
+}
+
+int64_t BFCAllocator::BytesInUse() {
+  return stats_.bytes_in_use - cached_bytes_.load(std::memory_order_relaxed);
+}
+
 int64_t BFCAllocator::LargestFreeChunk() {
   for (int i = kNumBins - 1; i >= 0; i--) {
     if (!BinFromIndex(i)->free_chunks.empty()) {
@@ -504,7 +644,7 @@ int64_t BFCAllocator::LargestFreeChunk() {
 }
 
 double BFCAllocator::GetFragmentation() {
-  int64_t bytes_available = total_region_allocated_bytes_ - stats_.bytes_in_use;
+  int64_t bytes_available = total_region_allocated_bytes_ - BytesInUse();
   DCHECK_GT(bytes_available, 0);
   return static_cast<double>(bytes_available - LargestFreeChunk()) /
          bytes_available;
@@ -521,8 +661,9 @@ void BFCAllocator::AddTraceMe(absl::string_view traceme_name,
   tsl::profiler::TraceMe::InstantActivity(
       [this, traceme_name, chunk_ptr, req_bytes, alloc_bytes]()
           TF_NO_THREAD_SAFETY_ANALYSIS {
+            const int64_t bytes_in_use = BytesInUse();
             int64_t bytes_available =
-                memory_limit_ - stats_.bytes_reserved - stats_.bytes_in_use;
+                memory_limit_ - stats_.bytes_reserved - bytes_in_use;
             const auto& annotation = tensorflow::profiler::
                 ScopedMemoryDebugAnnotation::CurrentAnnotation();
             const auto op_name = annotation.pending_op_name
@@ -534,7 +675,7 @@ void BFCAllocator::AddTraceMe(absl::string_view traceme_name,
             return tsl::profiler::TraceMeEncode(
                 traceme_name, {{"allocator_name", name_},
                                {"bytes_reserved", stats_.bytes_reserved},
-                               {"bytes_allocated", stats_.bytes_in_use},
+                               {"bytes_allocated", bytes_in_use},
                                {"bytes_available", bytes_available},
                                {"fragmentation", GetFragmentation()},
                                {"peak_bytes_in_use", stats_.peak_bytes_in_use},
@@ -596,12 +737,13 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
         // Update stats.
         ++stats_.num_allocs;
         stats_.bytes_in_use += chunk->size;
-        if (stats_.bytes_in_use > stats_.peak_bytes_in_use) {
-          VLOG(2) << "New Peak memory usage of " << stats_.bytes_in_use
+        const int64_t bytes_in_use = BytesInUse();
+        if (bytes_in_use > stats_.peak_bytes_in_use) {
+          VLOG(2) << "New Peak memory usage of " << bytes_in_use
                   << " bytes for " << Name();
         }
         stats_.peak_bytes_in_use =
-            std::max(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+            std::max(stats_.peak_bytes_in_use, bytes_in_use);
         stats_.largest_alloc_size =
             std::max<std::size_t>(stats_.largest_alloc_size, chunk->size);
 
@@ -679,7 +821,10 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(3) << "DeallocateRaw " << Name() << " "
           << (ptr ? RequestedSize(ptr) : 0);
-  DeallocateRawInternal(ptr);
+  if (caches_.empty() || timing_counter_ != nullptr || ptr == nullptr ||
+      !DeallocateToCache(ptr)) {
+    DeallocateRawInternal(ptr);
+  }
   retry_helper_.NotifyDealloc();
 }
 
@@ -1009,7 +1154,7 @@ string BFCAllocator::RenderOccupancy() {
     // Then render each chunk left to right.
     while (h != kInvalidChunkHandle) {
       Chunk* c = ChunkFromHandle(h);
-      if (c->in_use()) {
+      if (c->in_use() && !c->in_cache()) {
         // Render the wasted space
         size_t wasted = c->size - c->requested_size;
         if (wasted > 0) {
@@ -1035,8 +1180,9 @@ void BFCAllocator::DumpMemoryLog(size_t num_bytes) {
   for (BinNum bin_num = 0; bin_num < kNumBins; bin_num++) {
     Bin* b = BinFromIndex(bin_num);
     const BinDebugInfo& bin_info = bin_infos[bin_num];
-    CHECK_EQ(b->free_chunks.size(),
-             bin_info.total_chunks_in_bin - bin_info.total_chunks_in_use);
+    CHECK_EQ(b->free_chunks.size(), bin_info.total_chunks_in_bin -
+                                        bin_info.total_chunks_in_use -
+                                        bin_info.total_chunks_in_cache);
 
     LOG(INFO) << "Bin (" << b->bin_size
               << "): \tTotal Chunks: " << bin_info.total_chunks_in_bin
@@ -1047,7 +1193,8 @@ void BFCAllocator::DumpMemoryLog(size_t num_bytes) {
               << " in use in bin. "
               << strings::HumanReadableNumBytes(
                      bin_info.total_requested_bytes_in_use)
-              << " client-requested in use in bin.";
+              << " client-requested in use in bin. "
+              << bin_info.total_chunks_in_cache << " chunks in cache.";
   }
 
   // Find the bin that we would have liked to allocate in, so we
@@ -1071,12 +1218,14 @@ void BFCAllocator::DumpMemoryLog(size_t num_bytes) {
     ChunkHandle h = region_manager_.get_handle(region.ptr());
     while (h != kInvalidChunkHandle) {
       const Chunk* c = ChunkFromHandle(h);
-      if (c->in_use()) {
+      if (c->in_use() && !c->in_cache()) {
         in_use_by_size[c->size]++;
       }
+      const char* state =
+          c->in_cache() ? "Cache" : (c->in_use() ? "InUse" : "Free ");
       string buf = strings::StrCat(
-          (c->in_use() ? "InUse" : "Free "), " at ",
-          strings::Hex(reinterpret_cast<uint64>(c->ptr)), " of size ", c->size);
+          state, " at ", strings::Hex(reinterpret_cast<uint64>(c->ptr)),
+          " of size ", c->size);
 #ifdef TENSORFLOW_MEM_DEBUG
       if (ShouldRecordOpName()) {
         strings::StrAppend(&buf, " by op ", c->op_name, " action_count ",
@@ -1107,7 +1256,7 @@ void BFCAllocator::DumpMemoryLog(size_t num_bytes) {
             << (memory_limit_ - total_region_allocated_bytes_)
             << " curr_region_allocation_bytes_: "
             << curr_region_allocation_bytes_;
-  LOG(INFO) << "Stats: \n" << stats_.DebugString();
+  LOG(INFO) << "Stats: \n" << StatsInternal().DebugString();
 }
 
 void BFCAllocator::MaybeWriteMemoryMap() {
@@ -1140,19 +1289,21 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
   md.set_allocator_name(Name());
 
   // Record the general stats
+  const AllocatorStats stats = StatsInternal();
   tensorflow::MemAllocatorStats* mas = md.mutable_stats();
-  mas->set_num_allocs(stats_.num_allocs);
-  mas->set_bytes_in_use(stats_.bytes_in_use);
-  mas->set_peak_bytes_in_use(stats_.peak_bytes_in_use);
-  mas->set_largest_alloc_size(stats_.largest_alloc_size);
+  mas->set_num_allocs(stats.num_allocs);
+  mas->set_bytes_in_use(stats.bytes_in_use);
+  mas->set_peak_bytes_in_use(stats.peak_bytes_in_use);
+  mas->set_largest_alloc_size(stats.largest_alloc_size);
 
   // Record summary data for every bin.
   const std::array<BinDebugInfo, kNumBins> bin_infos = get_bin_debug_info();
   for (BinNum bin_num = 0; bin_num < kNumBins; bin_num++) {
     Bin* b = BinFromIndex(bin_num);
     const BinDebugInfo& bin_info = bin_infos[bin_num];
-    DCHECK_EQ(b->free_chunks.size(),
-              bin_info.total_chunks_in_bin - bin_info.total_chunks_in_use);
+    DCHECK_EQ(b->free_chunks.size(), bin_info.total_chunks_in_bin -
+                                         bin_info.total_chunks_in_use -
+                                         bin_info.total_chunks_in_cache);
     tensorflow::BinSummary* bs = md.add_bin_summary();
     bs->set_bin(bin_num);
     bs->set_total_bytes_in_use(bin_info.total_bytes_in_use);
@@ -1167,7 +1318,7 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
     while (h != kInvalidChunkHandle) {
       const Chunk* c = ChunkFromHandle(h);
       tensorflow::MemChunk* mc = md.add_chunk();
-      mc->set_in_use(c->in_use());
+      mc->set_in_use(c->in_use() && !c->in_cache());
       mc->set_address(reinterpret_cast<uint64>(c->ptr));
       mc->set_size(c->size);
       mc->set_requested_size(c->requested_size);
@@ -1201,16 +1352,38 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
   return md;
 }
 
+AllocatorStats BFCAllocator::StatsInternal() {
+  AllocatorStats stats = stats_;
+  stats.bytes_in_use = BytesInUse();
+  stats.peak_bytes_in_use =
+      std::max(stats.peak_bytes_in_use,
+               cache_peak_bytes_in_use_.load(std::memory_order_relaxed));
+  for (const auto& cache : caches_) {
+    mutex_lock cache_lock(cache->mu);
+    stats.num_allocs += cache->num_allocs;
+    stats.largest_alloc_size =
+        std::max(stats.largest_alloc_size, cache->largest_alloc_size);
+  }
+  return stats;
+}
+
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
   mutex_lock l(lock_);
-  return stats_;
+  return StatsInternal();
 }
 
 bool BFCAllocator::ClearStats() {
   mutex_lock l(lock_);
   stats_.num_allocs = 0;
-  stats_.peak_bytes_in_use = stats_.bytes_in_use;
+  stats_.peak_bytes_in_use = BytesInUse();
   stats_.largest_alloc_size = 0;
+  cache_peak_bytes_in_use_.store(stats_.peak_bytes_in_use,
+                                 std::memory_order_relaxed);
+  for (const auto& cache : caches_) {
+    mutex_lock cache_lock(cache->mu);
+    cache->num_allocs = 0;
+    cache->largest_alloc_size = 0;
+  }
   return true;
 }
 
@@ -1225,7 +1398,9 @@ BFCAllocator::get_bin_debug_info() {
       BinDebugInfo& bin_info = bin_infos[bin_num];
       bin_info.total_bytes_in_bin += c->size;
       bin_info.total_chunks_in_bin++;
-      if (c->in_use()) {
+      if (c->in_cache()) {
+        bin_info.total_chunks_in_cache++;
+      } else if (c->in_use()) {
         bin_info.total_bytes_in_use += c->size;
         bin_info.total_requested_bytes_in_use += c->requested_size;
         bin_info.total_chunks_in_use++;
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_TSL_FRAMEWORK_BFC_ALLOCATOR_H_
 
 #include <array>
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <string>
@@ -68,6 +69,15 @@ class BFCAllocator : public Allocator {
     // Controls when a chunk should be split, if its size exceeds the requested
     // allocation size.
     double fragmentation_fraction = 0;
+
+    // If non-zero, every CPU keeps a cache of up to this many bytes of freed
+    // chunks of at most 32KiB, in front of the bins.  Allocations and
+    // deallocations served from these caches only take the allocator lock in
+    // shared mode, which reduces contention when many threads allocate small
+    // buffers.  Cached chunks are returned to the bins when an allocation
+    // cannot otherwise be satisfied.  The caches are bypassed when a timing
+    // counter is set.
+    size_t per_cpu_cache_bytes = 0;
   };
   BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator, size_t total_memory,
                const string& name, const Options& opts);
@@ -120,6 +130,18 @@ class BFCAllocator : public Allocator {
 
   void DeallocateRawInternal(void* ptr);
 
+  // Returns a cached chunk of exactly RoundedBytes(num_bytes) bytes from the
+  // cache of the current CPU, or nullptr if there is none.
+  void* AllocateFromCache(size_t num_bytes) TF_LOCKS_EXCLUDED(lock_);
+
+  // Moves the chunk at 'ptr' into the cache of the current CPU.  Returns false
+  // if the chunk is too large or the cache is full.
+  bool DeallocateToCache(void* ptr) TF_LOCKS_EXCLUDED(lock_);
+
+  // Returns all cached chunks to the bins.  Returns true if any chunk was
+  // returned.
+  bool FlushCaches() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -139,18 +161,18 @@ class BFCAllocator : public Allocator {
 
   // Return the largest free chunk bytes from the largest bin in constant time.
   // The free chunks are sorted by size (and then address) in a bin.
-  int64_t LargestFreeChunk() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  int64_t LargestFreeChunk() TF_SHARED_LOCKS_REQUIRED(lock_);
 
   // Add TraceMe (in memory allocation and deallocation) for memory stats
   // profiling. The chunk_ptr is passed to get information such as address,
   // chunk size and requested_size.
   void AddTraceMe(absl::string_view traceme_name, const void* ptr)
-      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+      TF_SHARED_LOCKS_REQUIRED(lock_);
 
   // Overloaded AddTraceMe function with chunk information.
   void AddTraceMe(absl::string_view traceme_name, const void* chunk_ptr,
                   int64_t req_bytes, int64_t alloc_bytes)
-      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+      TF_SHARED_LOCKS_REQUIRED(lock_);
 
   // A ChunkHandle is an index into the chunks_ vector in BFCAllocator
   // kInvalidChunkHandle means an invalid chunk
@@ -162,6 +184,11 @@ class BFCAllocator : public Allocator {
   // The following means that the largest bin'd chunk size is 256 << 21 = 512MB.
   static constexpr int kNumBins = 21;
 
+  // allocation_id of a chunk that is held by a per-CPU cache.  Such a chunk is
+  // free from the client's point of view, but is neither in a bin nor merged
+  // with its neighbors.
+  static constexpr int64_t kCachedAllocationId = -2;
+
   // A Chunk points to a piece of memory that's either entirely free or entirely
   // in use by one user memory allocation.
   //
@@ -210,6 +237,8 @@ class BFCAllocator : public Allocator {
 
     bool in_use() const { return allocation_id != -1; }
 
+    bool in_cache() const { return allocation_id == kCachedAllocationId; }
+
 #ifdef TENSORFLOW_MEM_DEBUG
     // optional debugging info
     const char* op_name = nullptr;
@@ -277,6 +306,29 @@ class BFCAllocator : public Allocator {
   static constexpr size_t kMinAllocationBits = 8;
   static constexpr size_t kMinAllocationSize = 1 << kMinAllocationBits;
 
+  // Chunks up to this size are kept in the per-CPU caches, in one free list
+  // per multiple of kMinAllocationSize.
+  static constexpr size_t kMaxCachedChunkSize = 32 << 10;
+  static constexpr int kNumCachedSizes =
+      kMaxCachedChunkSize / kMinAllocationSize;
+
+  // A cache of free chunks in front of the bins, shared by the threads running
+  // on one CPU.  Chunks are added and removed while holding lock_ in shared
+  // mode, so holding lock_ exclusively also excludes all cache accesses.
+  struct ChunkCache {
+    mutex mu;
+    // Handles of the cached chunks of size (i + 1) * kMinAllocationSize.
+    std::vector<ChunkHandle> free_chunks[kNumCachedSizes] TF_GUARDED_BY(mu);
+    // Total size of the cached chunks.
+    size_t bytes TF_GUARDED_BY(mu) = 0;
+    // Stats of the allocations served by this cache since the last
+    // ClearStats().
+    int64_t num_allocs TF_GUARDED_BY(mu) = 0;
+    int64_t largest_alloc_size TF_GUARDED_BY(mu) = 0;
+  };
+
+  ChunkCache* CacheForCurrentCPU();
+
   // BFCAllocator allocates memory into a collection of disjoint
   // AllocationRegions.  Each AllocationRegion corresponds to one call to
   // SubAllocator::Alloc().  (Actually, if a subsequent call to
@@ -495,6 +547,13 @@ class BFCAllocator : public Allocator {
   // Removes the chunk metadata represented by 'h'.
   void DeleteChunk(ChunkHandle h) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Returns the number of bytes allocated to clients, which excludes the chunks
+  // held by the per-CPU caches.
+  int64_t BytesInUse() TF_SHARED_LOCKS_REQUIRED(lock_);
+
+  // Returns stats_ merged with the stats of the per-CPU caches.
+  AllocatorStats StatsInternal() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   string RenderOccupancy() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
   void DumpMemoryLog(size_t num_bytes) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
   tensorflow::MemoryDump RecordMemoryMapInternal()
@@ -504,9 +563,11 @@ class BFCAllocator : public Allocator {
   ChunkHandle AllocateChunk() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
   void DeallocateChunk(ChunkHandle h) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
-  Chunk* ChunkFromHandle(ChunkHandle h) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Chunks held by a per-CPU cache are modified with lock_ held in shared mode;
+  // all other chunks only with lock_ held exclusively.
+  Chunk* ChunkFromHandle(ChunkHandle h) TF_SHARED_LOCKS_REQUIRED(lock_);
   const Chunk* ChunkFromHandle(ChunkHandle h) const
-      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+      TF_SHARED_LOCKS_REQUIRED(lock_);
 
   void MarkFree(ChunkHandle h) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
@@ -515,7 +576,7 @@ class BFCAllocator : public Allocator {
 
   // Fragmentation is calculated as the reverse ratio of the largest free chunk
   // size over total free memory, and returns a value within [0, 1].
-  double GetFragmentation() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  double GetFragmentation() TF_SHARED_LOCKS_REQUIRED(lock_);
 
   // Information about a Bin that is useful for debugging.
   struct BinDebugInfo {
@@ -524,6 +585,7 @@ class BFCAllocator : public Allocator {
     size_t total_requested_bytes_in_use = 0;
     size_t total_chunks_in_use = 0;
     size_t total_chunks_in_bin = 0;
+    size_t total_chunks_in_cache = 0;
   };
 
   // Computes and returns a BinDebugInfo for each Bin.
@@ -609,11 +671,20 @@ class BFCAllocator : public Allocator {
   ChunkHandle free_chunks_list_ TF_GUARDED_BY(lock_);
 
   // Counter containing the next unique identifier to assign to a
-  // newly-created chunk.
-  int64_t next_allocation_id_ TF_GUARDED_BY(lock_);
+  // newly-created chunk.  Atomic because allocations served by the per-CPU
+  // caches only hold lock_ in shared mode.
+  std::atomic<int64_t> next_allocation_id_;
 
-  // Stats.
+  // Stats.  stats_.bytes_in_use includes the chunks held by the per-CPU
+  // caches, whose total size is cached_bytes_.
   AllocatorStats stats_ TF_GUARDED_BY(lock_);
+
+  // Per-CPU caches of free chunks; empty unless Options::per_cpu_cache_bytes
+  // is set.  Immutable after construction.
+  std::vector<std::unique_ptr<ChunkCache>> caches_;
+  std::atomic<int64_t> cached_bytes_{0};
+  // Peak of BytesInUse() observed by allocations served by the caches.
+  std::atomic<int64_t> cache_peak_bytes_in_use_{0};
 #ifdef TENSORFLOW_MEM_DEBUG
   int64 action_counter_ = 0 TF_GUARDED_BY(lock_);
 #define MEM_DEBUG_SIZE_HISTORY_SIZE 4096
@@ -0,0 +1,231 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/framework/bfc_allocator.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/tsl/platform/blocking_counter.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/mem.h"
+#include "tensorflow/tsl/platform/random.h"
+#include "tensorflow/tsl/platform/test.h"
+#include "tensorflow/tsl/platform/test_benchmark.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+#include "tensorflow/tsl/protobuf/bfc_memory_map.pb.h"
+
+namespace tsl {
+namespace {
+
+// A SubAllocator returning host memory.
+class HostSubAllocator : public SubAllocator {
+ public:
+  HostSubAllocator() : SubAllocator({}, {}) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes,
+              size_t* bytes_received) override {
+    *bytes_received = num_bytes;
+    return port::AlignedMalloc(num_bytes, Allocator::kAllocatorAlignment);
+  }
+
+  void Free(void* ptr, size_t num_bytes) override { port::AlignedFree(ptr); }
+
+  bool SupportsCoalescing() const override { return false; }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return AllocatorMemoryType::kHostPageable;
+  }
+};
+
+std::unique_ptr<BFCAllocator> CreateAllocator(size_t total_memory,
+                                              size_t per_cpu_cache_bytes) {
+  BFCAllocator::Options opts;
+  opts.allow_growth = false;
+  opts.allow_retry_on_failure = false;
+  opts.per_cpu_cache_bytes = per_cpu_cache_bytes;
+  return std::make_unique<BFCAllocator>(std::make_unique<HostSubAllocator>(),
+                                        total_memory, "host_bfc", opts);
+}
+
+void CheckStats(Allocator* a, int64_t num_allocs, int64_t bytes_in_use,
+                int64_t peak_bytes_in_use, int64_t largest_alloc_size) {
+  absl::optional<AllocatorStats> stats = a->GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->num_allocs, num_allocs);
+  EXPECT_EQ(stats->bytes_in_use, bytes_in_use);
+  EXPECT_EQ(stats->peak_bytes_in_use, peak_bytes_in_use);
+  EXPECT_EQ(stats->largest_alloc_size, largest_alloc_size);
+}
+
+TEST(BFCAllocatorCacheTest, StatsExcludeCachedChunks) {
+  auto a = CreateAllocator(1 << 20, /*per_cpu_cache_bytes=*/64 << 10);
+  void* p1 = a->AllocateRaw(1, 1000);
+  void* p2 = a->AllocateRaw(1, 4096);
+  CheckStats(a.get(), 2, 1024 + 4096, 1024 + 4096, 4096);
+  EXPECT_EQ(a->RequestedSize(p1), 1000);
+  EXPECT_EQ(a->AllocatedSize(p1), 1024);
+
+  a->DeallocateRaw(p1);
+  CheckStats(a.get(), 2, 4096, 1024 + 4096, 4096);
+
+  // Whether or not this is served by the cache of the current CPU, it is
+  // counted as a new allocation.
+  void* p3 = a->AllocateRaw(1, 1000);
+  EXPECT_EQ(a->RequestedSize(p3), 1000);
+  EXPECT_GT(a->AllocationId(p3), a->AllocationId(p2));
+  CheckStats(a.get(), 3, 1024 + 4096, 1024 + 4096, 4096);
+
+  a->DeallocateRaw(p2);
+  a->DeallocateRaw(p3);
+  CheckStats(a.get(), 3, 0, 1024 + 4096, 4096);
+
+  EXPECT_TRUE(a->ClearStats());
+  CheckStats(a.get(), 0, 0, 0, 0);
+}
+
+TEST(BFCAllocatorCacheTest, MemoryDumpExcludesCachedChunks) {
+  auto a = CreateAllocator(1 << 20, /*per_cpu_cache_bytes=*/64 << 10);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 8; ++i) {
+    ptrs.push_back(a->AllocateRaw(1, 2048));
+  }
+  for (int i = 0; i < 6; ++i) {
+    a->DeallocateRaw(ptrs[i]);
+  }
+
+  tensorflow::MemoryDump dump = a->RecordMemoryMap();
+  EXPECT_EQ(dump.stats().bytes_in_use(), 2 * 2048);
+  EXPECT_EQ(dump.stats().num_allocs(), 8);
+  int64_t chunks_in_use = 0;
+  int64_t bytes_in_use = 0;
+  for (const tensorflow::MemChunk& chunk : dump.chunk()) {
+    if (chunk.in_use()) {
+      ++chunks_in_use;
+      bytes_in_use += chunk.size();
+    }
+  }
+  EXPECT_EQ(chunks_in_use, 2);
+  EXPECT_EQ(bytes_in_use, 2 * 2048);
+  int64_t bin_chunks_in_use = 0;
+  for (const tensorflow::BinSummary& bin : dump.bin_summary()) {
+    bin_chunks_in_use += bin.total_chunks_in_use();
+  }
+  EXPECT_EQ(bin_chunks_in_use, 2);
+
+  a->DeallocateRaw(ptrs[6]);
+  a->DeallocateRaw(ptrs[7]);
+}
+
+TEST(BFCAllocatorCacheTest, CachedChunksAreReturnedWhenOutOfMemory) {
+  auto a = CreateAllocator(1 << 20, /*per_cpu_cache_bytes=*/1 << 20);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 64; ++i) {
+    void* p = a->AllocateRaw(1, 16 << 10);
+    ASSERT_NE(p, nullptr);
+    ptrs.push_back(p);
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+
+  // The freed chunks are only usable once they are merged in the bins.
+  AllocationAttributes attr;
+  attr.retry_on_failure = false;
+  void* p = a->AllocateRaw(1, 512 << 10, attr);
+  ASSERT_NE(p, nullptr);
+  a->DeallocateRaw(p);
+  CheckStats(a.get(), 65, 0, 1 << 20, 512 << 10);
+}
+
+TEST(BFCAllocatorCacheTest, MultiThreaded) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocsPerThread = 2000;
+  auto a = CreateAllocator(64 << 20, /*per_cpu_cache_bytes=*/256 << 10);
+  thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+  BlockingCounter counter(kNumThreads);
+  for (int t = 0; t < kNumThreads; ++t) {
+    pool.Schedule([&a, &counter]() {
+      std::vector<void*> live;
+      for (int i = 0; i < kNumAllocsPerThread; ++i) {
+        const size_t bytes = 1 + random::New64() % (64 << 10);
+        void* p = a->AllocateRaw(1, bytes);
+        CHECK(p != nullptr);
+        CHECK_EQ(a->RequestedSize(p), bytes);
+        memset(p, i, bytes);
+        live.push_back(p);
+        if (live.size() > 16 || random::New64() % 2 == 0) {
+          const size_t index = random::New64() % live.size();
+          a->DeallocateRaw(live[index]);
+          live[index] = live.back();
+          live.pop_back();
+        }
+      }
+      for (void* p : live) {
+        a->DeallocateRaw(p);
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+
+  absl::optional<AllocatorStats> stats = a->GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->num_allocs, kNumThreads * kNumAllocsPerThread);
+  EXPECT_EQ(stats->bytes_in_use, 0);
+}
+
+// Allocates and frees buffers of a few small sizes from 'num_threads' threads.
+// The second argument is Options::per_cpu_cache_bytes.
+void BM_AllocationThreaded(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  constexpr int kAllocsPerThread = 10000;
+  auto a = CreateAllocator(256 << 20, state.range(1));
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+
+  for (auto s : state) {
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&a, &counter]() {
+        const size_t sizes[] = {64, 256, 1024, 4096, 256, 16384, 512, 2048};
+        void* ptrs[4] = {};
+        for (int i = 0; i < kAllocsPerThread; ++i) {
+          void*& p = ptrs[i % 4];
+          if (p != nullptr) {
+            a->DeallocateRaw(p);
+          }
+          p = a->AllocateRaw(1, sizes[i % 8]);
+        }
+        for (void* p : ptrs) {
+          a->DeallocateRaw(p);
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads * kAllocsPerThread);
+}
+BENCHMARK(BM_AllocationThreaded)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1 << 20)
+    ->ArgPair(4, 0)
+    ->ArgPair(4, 1 << 20)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1 << 20);
+
+}  // namespace
+}  // namespace tsl
@@ -17,10 +17,13 @@ limitations under the License.
 
 #include <limits.h>
 
+#include <utility>
+
 #include "tensorflow/tsl/lib/hash/crc32c.h"
 #include "tensorflow/tsl/lib/io/buffered_inputstream.h"
 #include "tensorflow/tsl/lib/io/compression.h"
 #include "tensorflow/tsl/lib/io/random_inputstream.h"
+#include "tensorflow/tsl/platform/coding.h"
 #include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/raw_coding.h"
@@ -259,5 +262,170 @@ SequentialRecordReader::SequentialRecordReader(
     RandomAccessFile* file, const RecordReaderOptions& options)
     : underlying_(file, options), offset_(0) {}
 
+MappedRecordReader::MappedRecordReader(
+    std::unique_ptr<ReadOnlyMemoryRegion> region, size_t verify_chunk_bytes)
+    : region_(std::move(region)),
+      data_(static_cast<const char*>(region_->data())),
+      size_(region_->length()),
+      verify_chunk_bytes_(verify_chunk_bytes) {}
+
+MappedRecordReader::~MappedRecordReader() = default;
+
+void MappedRecordReader::VerifyNextChunk() {
+  constexpr uint64 kHeaderSize = RecordReader::kHeaderSize;
+  constexpr uint64 kFooterSize = RecordReader::kFooterSize;
+  verified_.clear();
+  next_verified_ = 0;
+  uint64 offset = verified_end_;
+  const uint64 limit = offset + verify_chunk_bytes_;
+  while (offset < size_ && (verified_.empty() || offset < limit)) {
+    if (size_ - offset < kHeaderSize) {
+      verify_status_ = errors::DataLoss("truncated record at ", offset,
+                                        GetChecksumErrorSuffix(offset));
+      break;
+    }
+    const char* header = data_ + offset;
+    if (crc32c::Unmask(core::DecodeFixed32(header + sizeof(uint64))) !=
+        crc32c::Value(header, sizeof(uint64))) {
+      verify_status_ = errors::DataLoss("corrupted record at ", offset,
+                                        GetChecksumErrorSuffix(offset));
+      break;
+    }
+    const uint64 length = core::DecodeFixed64(header);
+    if (length > size_ - offset - kHeaderSize ||
+        size_ - offset - kHeaderSize - length < kFooterSize) {
+      verify_status_ = errors::DataLoss("truncated record at ", offset);
+      break;
+    }
+    const char* record = header + kHeaderSize;
+    if (crc32c::Unmask(core::DecodeFixed32(record + length)) !=
+        crc32c::Value(record, length)) {
+      verify_status_ = errors::DataLoss("corrupted record at ", offset,
+                                        GetChecksumErrorSuffix(offset));
+      break;
+    }
+    verified_.push_back({offset + kHeaderSize, length});
+    offset += kHeaderSize + length + kFooterSize;
+  }
+  verified_end_ = offset;
+}
+
+Status MappedRecordReader::NextExtent(Extent* extent) {
+  if (next_verified_ == verified_.size()) {
+    TF_RETURN_IF_ERROR(verify_status_);
+    if (verified_end_ >= size_) {
+      return errors::OutOfRange("eof", GetChecksumErrorSuffix(offset_));
+    }
+    VerifyNextChunk();
+    if (verified_.empty()) {
+      return verify_status_;
+    }
+  }
+  *extent = verified_[next_verified_++];
+  offset_ = extent->offset + extent->length + RecordReader::kFooterSize;
+  return OkStatus();
+}
+
+Status MappedRecordReader::ReadRecord(tstring* record) {
+  Extent extent;
+  TF_RETURN_IF_ERROR(NextExtent(&extent));
+  record->assign(data_ + extent.offset, extent.length);
+  return OkStatus();
+}
+
+Status MappedRecordReader::ReadRecord(StringPiece* record) {
+  Extent extent;
+  TF_RETURN_IF_ERROR(NextExtent(&extent));
+  *record = StringPiece(data_ + extent.offset, extent.length);
+  return OkStatus();
+}
+
+Status MappedRecordReader::SkipRecords(int num_to_skip, int* num_skipped) {
+  *num_skipped = 0;
+  Extent extent;
+  while (*num_skipped < num_to_skip) {
+    TF_RETURN_IF_ERROR(NextExtent(&extent));
+    (*num_skipped)++;
+  }
+  return OkStatus();
+}
+
+Status MappedRecordReader::SeekOffset(uint64 offset) {
+  if (offset > size_) {
+    return errors::InvalidArgument("Trying to seek offset: ", offset,
+                                   " which is past the end of the file: ",
+                                   size_);
+  }
+  offset_ = offset;
+  verified_.clear();
+  next_verified_ = 0;
+  verified_end_ = offset;
+  verify_status_ = OkStatus();
+  return OkStatus();
+}
+
+void RecordIndex::Encode(const std::vector<uint64>& offsets, uint64 file_size,
+                         string* result) {
+  result->resize(offsets.size() * sizeof(uint64) + kFooterSize);
+  char* dst = &(*result)[0];
+  for (uint64 offset : offsets) {
+    core::EncodeFixed64(dst, offset);
+    dst += sizeof(uint64);
+  }
+  core::EncodeFixed64(dst, offsets.size());
+  dst += sizeof(uint64);
+  core::EncodeFixed64(dst, file_size);
+  dst += sizeof(uint64);
+  core::EncodeFixed32(
+      dst, crc32c::Mask(crc32c::Value(result->data(), dst - result->data())));
+  dst += sizeof(uint32);
+  core::EncodeFixed64(dst, kMagic);
+}
+
+Status RecordIndex::Decode(StringPiece data, RecordIndex* index) {
+  if (data.size() < kFooterSize) {
+    return errors::DataLoss("record index is truncated: ", data.size(),
+                            " bytes");
+  }
+  const char* footer = data.data() + data.size() - kFooterSize;
+  if (core::DecodeFixed64(footer + 2 * sizeof(uint64) + sizeof(uint32)) !=
+      kMagic) {
+    return errors::DataLoss("not a record index");
+  }
+  const uint64 num_records = core::DecodeFixed64(footer);
+  if ((data.size() - kFooterSize) / sizeof(uint64) != num_records ||
+      (data.size() - kFooterSize) % sizeof(uint64) != 0) {
+    return errors::DataLoss("record index of ", data.size(),
+                            " bytes cannot hold ", num_records, " records");
+  }
+  const char* crc = footer + 2 * sizeof(uint64);
+  if (crc32c::Unmask(core::DecodeFixed32(crc)) !=
+      crc32c::Value(data.data(), crc - data.data())) {
+    return errors::DataLoss("corrupted record index");
+  }
+  index->offsets_.resize(num_records);
+  for (uint64 i = 0; i < num_records; ++i) {
+    index->offsets_[i] = core::DecodeFixed64(data.data() + i * sizeof(uint64));
+  }
+  index->file_size_ = core::DecodeFixed64(footer + sizeof(uint64));
+  return OkStatus();
+}
+
+Status RecordIndex::Build(RandomAccessFile* file, RecordIndex* index) {
+  RecordReader reader(file);
+  index->offsets_.clear();
+  uint64 offset = 0;
+  while (true) {
+    const uint64 record_offset = offset;
+    int num_skipped;
+    Status s = reader.SkipRecords(&offset, 1, &num_skipped);
+    if (errors::IsOutOfRange(s)) break;
+    TF_RETURN_IF_ERROR(s);
+    index->offsets_.push_back(record_offset);
+  }
+  index->file_size_ = offset;
+  return OkStatus();
+}
+
 }  // namespace io
 }  // namespace tsl
@@ -16,6 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_TSL_LIB_IO_RECORD_READER_H_
 #define TENSORFLOW_TSL_LIB_IO_RECORD_READER_H_
 
+#include <memory>
+#include <vector>
+
 #include "tensorflow/tsl/lib/io/inputstream_interface.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/stringpiece.h"
@@ -30,6 +33,7 @@ limitations under the License.
 
 namespace tsl {
 class RandomAccessFile;
+class ReadOnlyMemoryRegion;
 
 namespace io {
 
@@ -173,6 +177,133 @@ class SequentialRecordReader {
   uint64 offset_ = 0;
 };
 
+// Reads uncompressed TFRecord files through a read-only memory mapping.
+//
+// Checksums are verified in bulk: whenever the reader runs out of verified
+// records it walks up to `verify_chunk_bytes` of records ahead of the read
+// position, checking their length and data CRCs back to back over the
+// mapped bytes, and remembers where each record's data lies. Reading a
+// record then costs a single copy from the mapping into the result, with no
+// read syscall and no intermediate buffer.
+//
+// Errors found while verifying a chunk are returned once all the valid
+// records before the bad one have been read, so the reader returns the same
+// records and errors as SequentialRecordReader does on the same file.
+//
+// Note: this class is not thread safe; external synchronization required.
+class MappedRecordReader {
+ public:
+  static constexpr size_t kDefaultVerifyChunkBytes = 4 << 20;  // 4MB
+
+  explicit MappedRecordReader(
+      std::unique_ptr<ReadOnlyMemoryRegion> region,
+      size_t verify_chunk_bytes = kDefaultVerifyChunkBytes);
+
+  ~MappedRecordReader();
+
+  // Read the next record in the file into *record. Returns OK on success,
+  // OUT_OF_RANGE for end of file, or something else for an error.
+  Status ReadRecord(tstring* record);
+
+  // Like the above, but points *record at the record inside the mapping
+  // instead of copying it. The data stays valid while this reader is alive.
+  Status ReadRecord(StringPiece* record);
+
+  // Skip the next num_to_skip record in the file. Return OK on success,
+  // OUT_OF_RANGE for end of file, or something else for an error.
+  // "*num_skipped" records the number of records that are actually skipped.
+  // It should be equal to num_to_skip on success.
+  Status SkipRecords(int num_to_skip, int* num_skipped);
+
+  // Return the current offset in the file.
+  uint64 TellOffset() const { return offset_; }
+
+  // Seek to this offset within the file, which must be the offset of a
+  // record or the end of the file, and set it as the current offset.
+  Status SeekOffset(uint64 offset);
+
+ private:
+  // Location of the data of a verified record within the mapping.
+  struct Extent {
+    uint64 offset;
+    uint64 length;
+  };
+
+  // Verifies the records of the next chunk after `verified_end_`.
+  void VerifyNextChunk();
+  Status NextExtent(Extent* extent);
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region_;
+  const char* const data_;
+  const uint64 size_;
+  const size_t verify_chunk_bytes_;
+  uint64 offset_ = 0;
+  // Verified records in [offset_, verified_end_), in file order.
+  std::vector<Extent> verified_;
+  size_t next_verified_ = 0;
+  uint64 verified_end_ = 0;
+  // Error found at `verified_end_`, returned once `verified_` is consumed.
+  Status verify_status_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MappedRecordReader);
+};
+
+// The offsets of the records of an uncompressed TFRecord file, which let
+// readers seek to any record without scanning the records before it.
+//
+// An index is stored in a sidecar file named `FileName(record_filename)`,
+// written by IndexedRecordWriter or built from an existing file with
+// `Build()`. Format of an index:
+//  uint64    offset of record i, for each of the n records
+//  uint64    n
+//  uint64    size of the record file
+//  uint32    masked crc of the preceding bytes
+//  uint64    kMagic
+class RecordIndex {
+ public:
+  static constexpr char kFileSuffix[] = ".index";
+  static constexpr uint64 kMagic = 0x7864695f64726374ULL;
+  static constexpr size_t kFooterSize =
+      2 * sizeof(uint64) + sizeof(uint32) + sizeof(uint64);
+
+  RecordIndex() = default;
+
+  // Returns the name of the index file of the record file `record_filename`.
+  static string FileName(const string& record_filename) {
+    return record_filename + kFileSuffix;
+  }
+
+  // Serializes the index of a record file of `file_size` bytes whose records
+  // start at `offsets` into `*result`.
+  static void Encode(const std::vector<uint64>& offsets, uint64 file_size,
+                     string* result);
+
+  // Parses an index serialized by `Encode()`. Returns DATA_LOSS if `data` is
+  // truncated or corrupted.
+  static Status Decode(StringPiece data, RecordIndex* index);
+
+  // Builds the index of the uncompressed record file `file` by skipping
+  // through its records once.
+  static Status Build(RandomAccessFile* file, RecordIndex* index);
+
+  // Number of records in the file.
+  int64_t num_records() const { return offsets_.size(); }
+
+  // Size of the record file the index was built for. Callers should compare
+  // it with the actual file size to detect a stale index.
+  uint64 file_size() const { return file_size_; }
+
+  // Returns the offset of record `i`, or the file size if `i` is
+  // `num_records()`.
+  uint64 offset(int64_t i) const {
+    return static_cast<size_t>(i) < offsets_.size() ? offsets_[i] : file_size_;
+  }
+
+ private:
+  std::vector<uint64> offsets_;
+  uint64 file_size_ = 0;
+};
+
 }  // namespace io
 }  // namespace tsl
 
@@ -267,6 +267,151 @@ TEST(RecordReaderWriterTest, TestMalformedInput) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestMapped) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_mapped_test";
+  std::vector<string> records;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    for (int i = 0; i < 100; ++i) {
+      records.push_back(string(i, 'a' + i % 26));
+      TF_EXPECT_OK(writer.WriteRecord(records.back()));
+    }
+    TF_CHECK_OK(writer.Close());
+  }
+
+  // Small verify chunks exercise verifying the file across many chunks.
+  for (size_t verify_chunk_bytes : {1, 100, 1 << 20}) {
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+    io::MappedRecordReader reader(std::move(region), verify_chunk_bytes);
+    uint64 offset_of_record_50 = 0;
+    for (int i = 0; i < 100; ++i) {
+      if (i == 50) offset_of_record_50 = reader.TellOffset();
+      tstring record;
+      TF_ASSERT_OK(reader.ReadRecord(&record));
+      EXPECT_EQ(records[i], record);
+    }
+    EXPECT_EQ(GetFileSize(fname), reader.TellOffset());
+    tstring record;
+    EXPECT_EQ(error::OUT_OF_RANGE, reader.ReadRecord(&record).code());
+
+    TF_ASSERT_OK(reader.SeekOffset(offset_of_record_50));
+    int num_skipped;
+    TF_ASSERT_OK(reader.SkipRecords(10, &num_skipped));
+    EXPECT_EQ(10, num_skipped);
+    StringPiece view;
+    TF_ASSERT_OK(reader.ReadRecord(&view));
+    EXPECT_EQ(records[60], view);
+    Status s = reader.SkipRecords(100, &num_skipped);
+    EXPECT_EQ(39, num_skipped);
+    EXPECT_EQ(error::OUT_OF_RANGE, s.code());
+  }
+}
+
+TEST(RecordReaderWriterTest, TestMappedCorruption) {
+  Env* env = Env::Default();
+  string fname =
+      testing::TmpDir() + "/record_reader_writer_mapped_corruption_test";
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_CHECK_OK(writer.Close());
+  }
+  string contents;
+  TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+  // Flip a byte of the second record's data, which starts after the first
+  // record ("abc") and the second record's header.
+  const size_t second_record_data = 2 * io::RecordReader::kHeaderSize +
+                                    io::RecordReader::kFooterSize + 3;
+  contents[second_record_data] ^= 1;
+  TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  io::MappedRecordReader reader(std::move(region));
+  // The record before the corruption is still returned.
+  tstring record;
+  TF_ASSERT_OK(reader.ReadRecord(&record));
+  EXPECT_EQ("abc", record);
+  Status s = reader.ReadRecord(&record);
+  EXPECT_EQ(error::DATA_LOSS, s.code());
+  EXPECT_EQ("corrupted record at 19", s.error_message());
+}
+
+TEST(RecordReaderWriterTest, TestIndexed) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_indexed_test";
+  std::vector<string> records;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    std::unique_ptr<WritableFile> index_file;
+    TF_CHECK_OK(env->NewWritableFile(io::RecordIndex::FileName(fname),
+                                     &index_file));
+    io::IndexedRecordWriter writer(file.get(), index_file.get());
+    for (int i = 0; i < 100; ++i) {
+      records.push_back(string(i, 'a' + i % 26));
+      TF_EXPECT_OK(writer.WriteRecord(records.back()));
+    }
+    TF_CHECK_OK(writer.Close());
+    TF_CHECK_OK(file->Close());
+    TF_CHECK_OK(index_file->Close());
+  }
+
+  string contents;
+  TF_CHECK_OK(ReadFileToString(env, io::RecordIndex::FileName(fname),
+                               &contents));
+  io::RecordIndex index;
+  TF_ASSERT_OK(io::RecordIndex::Decode(contents, &index));
+  EXPECT_EQ(100, index.num_records());
+  EXPECT_EQ(GetFileSize(fname), index.file_size());
+  EXPECT_EQ(index.file_size(), index.offset(100));
+
+  // Building the index from the record file gives the same offsets.
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+  io::RecordIndex built_index;
+  TF_ASSERT_OK(io::RecordIndex::Build(read_file.get(), &built_index));
+  EXPECT_EQ(index.num_records(), built_index.num_records());
+  EXPECT_EQ(index.file_size(), built_index.file_size());
+
+  // Every record can be read directly at its offset, in any order.
+  io::RecordReader reader(read_file.get());
+  for (int i = 99; i >= 0; i -= 7) {
+    EXPECT_EQ(index.offset(i), built_index.offset(i));
+    uint64 offset = index.offset(i);
+    tstring record;
+    TF_ASSERT_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ(records[i], record);
+    EXPECT_EQ(index.offset(i + 1), offset);
+  }
+}
+
+TEST(RecordReaderWriterTest, TestIndexCorruption) {
+  string encoded;
+  io::RecordIndex::Encode({0, 20, 45}, 70, &encoded);
+  io::RecordIndex index;
+  TF_ASSERT_OK(io::RecordIndex::Decode(encoded, &index));
+  EXPECT_EQ(3, index.num_records());
+  EXPECT_EQ(45, index.offset(2));
+  EXPECT_EQ(70, index.offset(3));
+
+  string corrupted = encoded;
+  corrupted[8] ^= 1;
+  EXPECT_EQ(error::DATA_LOSS,
+            io::RecordIndex::Decode(corrupted, &index).code());
+  EXPECT_EQ(error::DATA_LOSS,
+            io::RecordIndex::Decode(StringPiece(encoded).substr(8), &index)
+                .code());
+  EXPECT_EQ(error::DATA_LOSS, io::RecordIndex::Decode("junk", &index).code());
+}
+
 TEST(RecordReaderWriterTest, TestSnappy) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_snappy_test";
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "tensorflow/tsl/lib/hash/crc32c.h"
 #include "tensorflow/tsl/lib/io/compression.h"
+#include "tensorflow/tsl/lib/io/record_reader.h"
 #include "tensorflow/tsl/platform/coding.h"
 #include "tensorflow/tsl/platform/env.h"
 
@@ -155,5 +156,32 @@ Status RecordWriter::Flush() {
   return dest_->Flush();
 }
 
+IndexedRecordWriter::IndexedRecordWriter(WritableFile* dest,
+                                         WritableFile* index_dest)
+    : writer_(dest), index_dest_(index_dest) {}
+
+Status IndexedRecordWriter::WriteRecord(StringPiece data) {
+  if (closed_) {
+    return Status(::tensorflow::error::FAILED_PRECONDITION,
+                  "Writer previously closed");
+  }
+  TF_RETURN_IF_ERROR(writer_.WriteRecord(data));
+  offsets_.push_back(offset_);
+  offset_ +=
+      RecordWriter::kHeaderSize + data.size() + RecordWriter::kFooterSize;
+  return OkStatus();
+}
+
+Status IndexedRecordWriter::Flush() { return writer_.Flush(); }
+
+Status IndexedRecordWriter::Close() {
+  if (closed_) return OkStatus();
+  closed_ = true;
+  TF_RETURN_IF_ERROR(writer_.Close());
+  string index;
+  RecordIndex::Encode(offsets_, offset_, &index);
+  return index_dest_->Append(index);
+}
+
 }  // namespace io
 }  // namespace tsl
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_TSL_LIB_IO_RECORD_WRITER_H_
 #define TENSORFLOW_TSL_LIB_IO_RECORD_WRITER_H_
 
+#include <vector>
+
 #include "tensorflow/tsl/lib/hash/crc32c.h"
 #include "tensorflow/tsl/platform/coding.h"
 #include "tensorflow/tsl/platform/status.h"
@@ -127,6 +129,37 @@ class RecordWriter {
   TF_DISALLOW_COPY_AND_ASSIGN(RecordWriter);
 };
 
+// Writes an uncompressed TFRecord file like RecordWriter, and records the
+// offset of every record. Close() writes the offsets as a RecordIndex (see
+// record_reader.h) to "*index_dest", which should be the file named
+// `RecordIndex::FileName()` of the record file.
+//
+// "*dest" and "*index_dest" must be initially empty and must remain live
+// while this writer is in use.
+class IndexedRecordWriter {
+ public:
+  IndexedRecordWriter(WritableFile* dest, WritableFile* index_dest);
+
+  Status WriteRecord(StringPiece data);
+
+  // Flushes the record file. The index is only written by Close().
+  Status Flush();
+
+  // Writes the index. Does *not* close either WritableFile.
+  Status Close();
+
+  int64_t num_records() const { return offsets_.size(); }
+
+ private:
+  RecordWriter writer_;
+  WritableFile* index_dest_;
+  std::vector<uint64> offsets_;
+  uint64 offset_ = 0;
+  bool closed_ = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(IndexedRecordWriter);
+};
+
 void RecordWriter::PopulateHeader(char* header, const char* data, size_t n) {
   core::EncodeFixed64(header + 0, n);
   core::EncodeFixed32(header + sizeof(uint64),